@@ -379,8 +379,23 @@ class FG_vector
 	/**
 	 * \brief Write the space separated vector to file.
 	 * \param fn The file name you wish written to file.
-	 */
-	void to_file(std::string fn) {
+	 * \param binary Write the elements as raw values in the native byte
+	 *        order instead. The file can be read back with `from_file'.
+	 */
+	void to_file(std::string fn, bool binary = false) {
+		if (binary) {
+			FILE *f = fopen(fn.c_str(), "w");
+			if (f == NULL) {
+				BOOST_LOG_TRIVIAL(error) << boost::format(
+						"can't open %1%: %2%") % fn % strerror(errno);
+				return;
+			}
+			if (fwrite(eles.data(), sizeof(T), get_size(), f) != get_size())
+				BOOST_LOG_TRIVIAL(error) << boost::format(
+						"can't write %1%: %2%") % fn % strerror(errno);
+			fclose(f);
+			return;
+		}
 		std::ofstream f;
 		f.open(fn);
 		for (vsize_t i=0; i < get_size(); i++) {
@@ -389,6 +404,37 @@ class FG_vector
 		f.close();
 	}
 
+	/**
+	 * \brief Read a vector written by `to_file' in the binary form.
+	 * \param fn The file name to read from.
+	 * \return A vector with all values in the file, or NULL on error.
+	 */
+	static ptr from_file(const std::string &fn) {
+		FILE *f = fopen(fn.c_str(), "r");
+		if (f == NULL) {
+			BOOST_LOG_TRIVIAL(error) << boost::format(
+					"can't open %1%: %2%") % fn % strerror(errno);
+			return ptr();
+		}
+		ptr vec;
+		if (fseek(f, 0, SEEK_END) == 0) {
+			long size = ftell(f);
+			if (size >= 0 && size % sizeof(T) == 0) {
+				rewind(f);
+				vec = create(size / sizeof(T));
+				if (fread(vec->eles.data(), sizeof(T), vec->get_size(), f)
+						!= vec->get_size())
+					vec = ptr();
+			}
+		}
+		if (vec == NULL)
+			BOOST_LOG_TRIVIAL(error) << boost::format(
+					"%1% isn't a binary vector of %2%-byte elements")
+				% fn % sizeof(T);
+		fclose(f);
+		return vec;
+	}
+
 	/**
 	 * \brief In place division of vector by a single value.
 	 * \param v The value by which you want the array divided.
@@ -61,14 +61,6 @@ FG_graph::FG_graph(const std::string &graph_file,
 		exist_in_safs = safs_graph.exist() && safs_index.exist();
 	}
 
-	if (graph_conf.use_in_mem_graph() && exist_in_safs)
-		graph_data = in_mem_graph::load_safs_graph(graph_file);
-	else if (!exist_in_safs) {
-		// If we can't initialize SAFS, we assume the graph file is
-		// in the local filesystem.
-		graph_data = in_mem_graph::load_graph(graph_file);
-	}
-
 	if (graph_conf.use_in_mem_index() && exist_in_safs) {
 		index_data = vertex_index::safs_load(index_file);
 		header = index_data->get_graph_header();
@@ -85,6 +77,27 @@ FG_graph::FG_graph(const std::string &graph_file,
 		io_interface::ptr io = index_factory->create_io(thread::get_curr_thread());
 		io->access((char *) &header, 0, sizeof(header), READ);
 	}
+
+	// The graph data is split among NUMA nodes with the vertex index,
+	// so the index has to be loaded first.
+	bool numa_graph = graph_conf.use_numa_graph()
+		&& (graph_conf.use_in_mem_graph() || !exist_in_safs);
+	if (numa_graph && index_data == NULL) {
+		BOOST_LOG_TRIVIAL(warning)
+			<< "NUMA graph data requires the in-memory vertex index";
+		numa_graph = false;
+	}
+
+	if (numa_graph)
+		graph_data = in_mem_graph::load_numa_graph(graph_file, index_data,
+				exist_in_safs);
+	else if (graph_conf.use_in_mem_graph() && exist_in_safs)
+		graph_data = in_mem_graph::load_safs_graph(graph_file);
+	else if (!exist_in_safs) {
+		// If we can't initialize SAFS, we assume the graph file is
+		// in the local filesystem.
+		graph_data = in_mem_graph::load_graph(graph_file);
+	}
 }
 
 FG_graph::FG_graph(std::shared_ptr<in_mem_graph> graph_data,
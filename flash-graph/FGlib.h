@@ -20,6 +20,8 @@
  * limitations under the License.
  */
 
+#include <limits.h>
+
 #include "graph_engine.h"
 #include "graph.h"
 #include "FG_vector.h"
@@ -155,6 +157,23 @@ FG_vector<vertex_id_t>::ptr compute_wcc(FG_graph::ptr fg);
  */
 FG_vector<vertex_id_t>::ptr compute_sync_wcc(FG_graph::ptr fg);
 
+/**
+  * \brief Compute all weakly connectected components of a graph with
+  *        an in-memory union-find forest. The vertices with few edges
+  *        are linked with their neighbors first, and then only
+  *        the vertices outside the largest component found so far read
+  *        their edge lists. This avoids reading most of the edges in
+  *        a graph dominated by a giant component.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param max_sample_degree The vertices with at most this many edges
+  *        are linked in the sampling phase.
+  * \return A vector with a component ID for each vertex in the graph.
+  *
+*/
+FG_vector<vertex_id_t>::ptr compute_sampled_wcc(FG_graph::ptr fg,
+		vsize_t max_sample_degree = 16);
+
 /**
  * \brief Compute all weakly connectected components of a time-series graph
  *        in a specified time interval.
@@ -222,6 +241,99 @@ FG_vector<size_t>::ptr compute_local_scan(FG_graph::ptr);
 FG_vector<std::pair<vertex_id_t, size_t> >::ptr compute_topK_scan(
 		FG_graph::ptr, size_t topK);
 
+/**
+  * \brief Compute the BFS depth of all vertices from a start vertex with
+  *        the direction-optimizing BFS. A level is expanded top-down from
+  *        the frontier when the frontier is small and bottom-up from
+  *        the unvisited vertices when the frontier is large.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param start_vertex The vertex where the BFS starts.
+  * \param traverse_edge The type of edges that the BFS follows:
+  *        IN_EDGE, OUT_EDGE, BOTH_EDGES. It's ignored in an undirected graph.
+  * \return A vector with the BFS depth of each vertex. A vertex that
+  *         can't be reached from the start vertex has depth -1.
+  *
+*/
+FG_vector<int>::ptr compute_bfs(FG_graph::ptr fg, vertex_id_t start_vertex,
+		edge_type traverse_edge = edge_type::OUT_EDGE);
+
+/**
+  * \brief Compute the shortest distance from a vertex to all vertices with
+  *        delta-stepping. The edge count stored as edge data is used as
+  *        edge weight. If the graph doesn't have edge data, all edges have
+  *        weight 1.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param start_vertex The source vertex.
+  * \param delta The width of a bucket. Vertices whose distance falls in
+  *        the same bucket are relaxed before the next bucket.
+  * \param type The type of edges to follow: IN_EDGE, OUT_EDGE, BOTH_EDGES.
+  *        It's ignored in an undirected graph.
+  * \return A vector with the distance of each vertex. A vertex that can't
+  *         be reached has an infinite distance.
+  *
+*/
+FG_vector<double>::ptr compute_sssp(FG_graph::ptr fg, vertex_id_t start_vertex,
+		double delta, edge_type type = edge_type::OUT_EDGE);
+
+/**
+  * \brief Run BFS from up to 512 source vertices at once. All BFS share
+  *        the reads of the edge lists.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param sources The source vertices. A vertex may appear more than once.
+  * \param traverse_edge The type of edges to follow: IN_EDGE, OUT_EDGE,
+  *        BOTH_EDGES. It's ignored in an undirected graph.
+  * \return A vector for each source with the BFS depth of each vertex.
+  *         A vertex that can't be reached has depth -1. The result is
+  *         empty if the sources are invalid.
+  *
+*/
+std::vector<FG_vector<int>::ptr> compute_multi_bfs(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources,
+		edge_type traverse_edge = edge_type::OUT_EDGE);
+
+/**
+  * \brief Run BFS from up to 512 source vertices at once like
+  *        `compute_multi_bfs`, but only count the vertices each BFS
+  *        reaches. It doesn't keep the distances of all vertices, so it's
+  *        suitable for estimating closeness or reachability in a large graph.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param sources The source vertices. A vertex may appear more than once.
+  * \param traverse_edge The type of edges to follow: IN_EDGE, OUT_EDGE,
+  *        BOTH_EDGES. It's ignored in an undirected graph.
+  * \param num_reached The number of vertices reached from each source,
+  *        including the source itself.
+  * \param sum_dists The sum of the distances from each source to
+  *        the vertices it reaches.
+  * \return false if the sources are invalid.
+  *
+*/
+bool count_multi_bfs_reach(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources, edge_type traverse_edge,
+		std::vector<size_t> &num_reached, std::vector<size_t> &sum_dists);
+
+/**
+  * \brief Compute the betweenness centrality of vertices with Brandes'
+  *        algorithm. The BFS from multiple sources run together and share
+  *        the reads of the edge lists. It follows out-edges in a directed
+  *        graph.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param num_samples The number of sources sampled uniformly at random
+  *        to estimate betweenness. If it's 0 or not smaller than the number
+  *        of vertices, all vertices are sources and the result is exact.
+  * \param batch_size The number of sources processed together (at most 64).
+  *        It needs `batch_size * 20' bytes of memory for each vertex.
+  * \return A vector with an entry for each vertex. Each pair of vertices
+  *         is counted once in an undirected graph.
+  *
+*/
+FG_vector<double>::ptr compute_betweenness(FG_graph::ptr fg,
+		size_t num_samples = 0, int batch_size = 64);
+
 /**
   * \brief Compute the diameter estimation for a graph. 
   * \param fg The FlashGraph graph object for which you want to compute.
@@ -230,6 +342,56 @@ FG_vector<std::pair<vertex_id_t, size_t> >::ptr compute_topK_scan(
 */
 size_t estimate_diameter(FG_graph::ptr fg, int num_bfs, bool directed);
 
+/**
+  * \brief Compute the exact diameter and radius of a graph with
+  *        the bounding algorithm of Takes and Kosters. It prunes vertices
+  *        with the bounds of their eccentricities, so it usually needs
+  *        a small number of BFS. Edge direction is ignored, and
+  *        the diameter and the radius are computed in the connected
+  *        component of the vertex with the largest degree.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param radius (Optional) Returns the radius.
+  * \return The diameter.
+  *
+*/
+size_t compute_exact_diameter(FG_graph::ptr fg, size_t *radius = NULL);
+
+/**
+  * \brief Approximate the neighbourhood function of a graph with HyperANF.
+  *        Each vertex keeps a HyperLogLog counter of the vertices within
+  *        distance t from it, and the counters are merged with
+  *        the counters of in-neighbors in each level. The computation
+  *        stops when no counter changes.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param log2_num_regs The log2 of the number of registers per counter
+  *        (between 4 and 16). The relative standard error is about
+  *        1.04 / sqrt(2^log2_num_regs).
+  * \param num_levels The maximum number of levels.
+  * \param counts (Optional) Returns the estimated number of vertices
+  *        that can reach each vertex.
+  * \param harmonics (Optional) Returns the estimated harmonic centrality
+  *        of each vertex.
+  * \return The neighbourhood function: the estimated number of pairs of
+  *         vertices within distance t for t = 0, 1, ...
+  *
+*/
+std::vector<double> compute_hyper_anf(FG_graph::ptr fg,
+		int log2_num_regs = 6, int num_levels = INT_MAX,
+		FG_vector<float>::ptr *counts = NULL,
+		FG_vector<float>::ptr *harmonics = NULL);
+
+/**
+  * \brief Compute the effective diameter from a neighbourhood function,
+  *        i.e., the interpolated distance within which the given fraction
+  *        of the reachable pairs of vertices are.
+  * \param nf The neighbourhood function returned by `compute_hyper_anf'.
+  * \param fraction The fraction of the reachable pairs.
+  * \return The effective diameter.
+  *
+*/
+double compute_effective_diameter(const std::vector<double> &nf,
+		double fraction = 0.9);
+
 /**
   * \brief Compute the PageRank of a graph using the pull method
   *       where vertices request the data from all their neighbors
@@ -246,6 +408,26 @@ size_t estimate_diameter(FG_graph::ptr fg, int num_bfs, bool directed);
 FG_vector<float>::ptr compute_pagerank(FG_graph::ptr fg, int num_iters,
 		float damping_factor);
 
+/**
+  * \brief The order in which the push-based PageRank runs the vertices
+  *        that have received deltas.
+  *
+  * - PR_DEFAULT_SCHED: all of them run in the next iteration in the order
+  *     of vertex ID.
+  * - PR_PRIORITY_SCHED: only the quarter of them with the largest
+  *     residual run in the next iteration, the largest first. The others
+  *     keep accumulating deltas in later iterations.
+  * - PR_ASYNC_SCHED: only the ones whose residual is above the average
+  *     run in the next iteration, the largest first. The others keep
+  *     accumulating deltas until they become large enough.
+  */
+enum pr_schedule_type
+{
+	PR_DEFAULT_SCHED,
+	PR_PRIORITY_SCHED,
+	PR_ASYNC_SCHED,
+};
+
 /**
   * \brief Compute the PageRank of a graph using the push method
   *       where vertices send deltas of their PageRank to neighbors
@@ -254,17 +436,99 @@ FG_vector<float>::ptr compute_pagerank(FG_graph::ptr fg, int num_iters,
   * \param fg The FlashGraph graph object for which you want to compute.
   * \param num_iters The maximum number of iterations for PageRank.
   * \param damping_factor The damping factor. Originally .85.
+  * \param sched_type The order in which vertices push their deltas.
+  * \param num_edge_reads (Optional) If it isn't NULL, it gets the number
+  *        of edges read by all vertices.
   *
   * \return A vector with an entry for each vertex in the graph's
   *         PageRank value.
   *
 */
 FG_vector<float>::ptr compute_pagerank2(FG_graph::ptr, int num_iters,
-		float damping_factor);
+		float damping_factor, pr_schedule_type sched_type = PR_DEFAULT_SCHED,
+		size_t *num_edge_reads = NULL);
+
+/**
+  * \brief A sparse personalized PageRank vector: the vertices with
+  *        non-zero PageRank and their PageRank, in descending order.
+*/
+typedef std::vector<std::pair<vertex_id_t, float> > ppr_vector;
+
+/**
+  * \brief Compute personalized PageRank for many seed sets with forward
+  *        push. A batch of seed sets is computed together, and a vertex
+  *        reads its adjacency list once for all seed sets in the batch.
+  *        The error of the PageRank of a vertex is at most
+  *        epsilon times its out-degree.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param seed_sets The seed sets. The random surfer of a seed set jumps
+  *        to its seeds uniformly.
+  * \param damping_factor The damping factor. Originally .85.
+  * \param epsilon The residual threshold per edge.
+  * \param topK The number of vertices kept in each PageRank vector.
+  *        0 keeps all vertices with non-zero PageRank.
+  * \param batch_size The number of seed sets computed together (at most 64).
+  *
+  * \return A PageRank vector for each seed set.
+  *
+*/
+std::vector<ppr_vector> compute_personalized_pagerank(FG_graph::ptr fg,
+		const std::vector<std::vector<vertex_id_t> > &seed_sets,
+		float damping_factor = 0.85, double epsilon = 1e-6,
+		size_t topK = 100, int batch_size = 32);
+
+/**
+  * \brief Estimate personalized PageRank for many seed sets with
+  *        random walks. It needs less memory than forward push
+  *        for a very large number of seed sets.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param seed_sets The seed sets.
+  * \param damping_factor The damping factor. Originally .85.
+  * \param num_walks The number of random walks from each seed set.
+  *        The walks are spread over the seeds of a set evenly. If a set
+  *        has more seeds than walks, each walk starts from a different
+  *        seed sampled uniformly at random from the set.
+  * \param topK The number of vertices kept in each PageRank vector.
+  *        0 keeps all vertices with non-zero PageRank.
+  * \param max_walks The maximal number of walks in memory.
+  *
+  * \return A PageRank vector for each seed set.
+  *
+*/
+std::vector<ppr_vector> compute_mc_personalized_pagerank(FG_graph::ptr fg,
+		const std::vector<std::vector<vertex_id_t> > &seed_sets,
+		float damping_factor = 0.85, int num_walks = 10000,
+		size_t topK = 100, size_t max_walks = 16 * 1024 * 1024);
 
 FG_vector<float>::ptr compute_sstsg(FG_graph::ptr fg, time_t start_time,
 		time_t interval, int num_intervals);
 
+/**
+  * \brief Compute scan statistics in a sequence of time windows.
+  *        The window slides forward by one interval at a time. A vertex
+  *        reuses the local scans in the previous window if it has the same
+  *        neighbors in the latest interval. It then only reads the neighbors
+  *        whose edges in the new interval differ from those in the previous
+  *        interval, and it doesn't read any neighbors if none of them change.
+  *        A vertex whose neighbors change in every interval recomputes all
+  *        of its local scans, so the mode saves little on such graphs.
+  *
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param start_time The start time of the latest interval in the first window.
+  * \param interval The length of a time interval.
+  * \param num_intervals The number of time intervals in a window.
+  * \param num_windows The number of windows.
+  *
+  * \return The scan statistics of each window, as returned by
+  *         `compute_sstsg`.
+  *
+*/
+std::vector<FG_vector<float>::ptr> compute_sstsg_sliding(FG_graph::ptr fg,
+		time_t start_time, time_t interval, int num_intervals,
+		int num_windows);
+
 /**
  * \brief Fetch the clusters with the wanted cluster IDs.
  *  
@@ -278,18 +542,120 @@ in_mem_subgraph::ptr fetch_subgraph(FG_graph::ptr graph,
 /**
  * \brief Compute the k-core/coreness of a graph. The algorithm will 
  *        determine which vertices are between core `k` and `kmax` --
- *        all other vertices will be assigned to core 0.
+ *        all other vertices will be assigned to core 0. All cores are
+ *        computed in a single pass that peels vertices in the order of
+ *        their remaining degree.
  * \param fg The FlashGraph graph object for which you want to compute.
  * \param k The core value to be computed.
  * \param kmax (Optional) The kmax value. If omitted then all cores are
- *        computed i.e., coreness. *This is not recommended for very large
- *        graphs.*
+ *        computed i.e., coreness. Peeling stops once it passes `kmax`.
  * \return An `FG_vector` containing the core of each vertex between `k`
  *         and `kmax`. All other vertices are assigned to core 0.
+ *         With `k` = 0 and `kmax` omitted, this is the coreness of
+ *         every vertex.
  */
 FG_vector<size_t>::ptr compute_kcore(FG_graph::ptr fg,
 		                size_t k, size_t kmax=0);
 
+/**
+ * \brief Compute the truss number of every vertex in an undirected graph.
+ *        The k-truss is the largest subgraph in which every edge is in
+ *        at least k - 2 triangles. The edges are peeled in the order of
+ *        the number of triangles that contain them.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \param edge_trusses (Optional) If it isn't NULL, it gets every edge
+ *        with its truss number. An edge appears once, from the endpoint
+ *        with the smaller ID to the other one. Duplicated edges and
+ *        self-loops aren't included.
+ * \return A vector with the largest k for each vertex such that
+ *         the vertex has an edge in the k-truss. A vertex without edges
+ *         gets 0.
+ */
+FG_vector<vsize_t>::ptr compute_ktruss(FG_graph::ptr fg,
+		std::vector<edge<vsize_t> > *edge_trusses = NULL);
+
+/**
+ * \brief Detect communities with label propagation. Each vertex
+ *        repeatedly takes the most frequent label among its neighbors.
+ *        Edge direction is ignored. It stops when the labels are stable.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \param num_iters The maximum number of iterations.
+ * \return A vector with the label of each vertex. Vertices with the same
+ *         label are in the same community.
+ */
+FG_vector<vertex_id_t>::ptr compute_label_propagation(FG_graph::ptr fg,
+		int num_iters = 100);
+
+/**
+ * \brief Detect communities with the Louvain method, which maximizes
+ *        modularity. Edge direction is ignored, and the edge data of
+ *        the input graph isn't used as weights. The communities of each
+ *        level are merged into the vertices of an in-memory graph for
+ *        the next level.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \param num_iters The maximum number of iterations of moving vertices
+ *        in a level.
+ * \param max_levels The maximum number of levels.
+ * \param modularity The modularity of the communities.
+ * \return A vector with the community ID of each vertex. The IDs are
+ *         between 0 and the number of communities.
+ */
+FG_vector<vertex_id_t>::ptr compute_louvain(FG_graph::ptr fg,
+		int num_iters = 20, int max_levels = 20, double *modularity = NULL);
+
+/**
+ * \brief Compute the minimum spanning forest of a graph with Borůvka's
+ *        algorithm. Edge direction is ignored. The edge count stored as
+ *        edge data is used as edge weight. If the graph doesn't have
+ *        edge data, all edges have weight 1.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \param forest The edges in the minimum spanning forest with their
+ *        weights. An edge keeps its direction in the input graph.
+ */
+void compute_msf(FG_graph::ptr fg, std::vector<edge<edge_count> > &forest);
+
+/**
+ * \brief Find a maximal independent set with Luby's algorithm.
+ *        Edge direction is ignored. Vertices get random priorities, and
+ *        a vertex joins the set if none of its neighbors with higher
+ *        priorities is in the set.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \return A vector with an entry for each vertex, which is 1 if
+ *         the vertex is in the set and 0 otherwise.
+ */
+FG_vector<vsize_t>::ptr compute_mis(FG_graph::ptr fg);
+
+/**
+ * \brief Color the vertices with the Jones-Plassmann algorithm, so that
+ *        adjacent vertices get different colors. Edge direction is ignored.
+ *        Vertices get random priorities, and a vertex takes the smallest
+ *        color that none of its neighbors with higher priorities has.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \return A vector with the color of each vertex. The colors start from 0.
+ */
+FG_vector<vsize_t>::ptr compute_coloring(FG_graph::ptr fg);
+
+/**
+  * \brief Generate random walks for DeepWalk and node2vec and write them
+  *        to a file, one walk per line. The walkers on a vertex are
+  *        advanced together with one read of its adjacency list.
+  *        A walk follows the out-edges in a directed graph and ends at
+  *        a vertex without edges.
+  * \param fg The FlashGraph graph object for which you want to compute.
+  * \param out_file The output file.
+  * \param num_walks The number of walks starting from each vertex.
+  * \param length The maximum number of vertices in a walk.
+  * \param p The return parameter of node2vec.
+  * \param q The in-out parameter of node2vec. The walks are uniform
+  *        random walks as in DeepWalk if p and q are 1.
+  * \param batch_size The maximal number of walks in memory.
+  * \return The number of walks written to the file.
+  *
+*/
+size_t compute_random_walks(FG_graph::ptr fg, const std::string &out_file,
+		int num_walks = 10, int length = 80, double p = 1, double q = 1,
+		size_t batch_size = 1024 * 1024);
+
 /**
  * \brief Get the degree of all vertices in the graph.
  * \param fg The FlashGraph graph object for which you want to compute.
@@ -327,6 +693,27 @@ std::pair<time_t, time_t> get_time_range(FG_graph::ptr fg);
 void compute_overlap(FG_graph::ptr fg, const std::vector<vertex_id_t> &vids,
 		std::vector<std::vector<double> > &overlap_matrix);
 
+/**
+ * \brief Find the K most similar vertices of every vertex, where
+ *        the similarity is the Jaccard similarity of the neighbors of two
+ *        vertices. The candidates are found with MinHash and locality
+ *        sensitive hashing, and their similarities are computed exactly.
+ *        Edge direction is ignored.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \param k The number of similar vertices kept for each vertex. It has to
+ *        be positive.
+ * \param file The output file. Each line has a vertex and its similar
+ *        vertices with the similarities, in the form of "id:similarity".
+ * \param num_bands The number of bands in a MinHash signature. It has to
+ *        be positive.
+ * \param num_rows The number of MinHash values in a band. It has to be
+ *        positive. A pair of vertices with similarity s becomes a candidate
+ *        with the probability 1 - (1 - s^num_rows)^num_bands.
+ * \param min_sim The minimal similarity of a pair of similar vertices.
+ */
+void compute_topK_similar(FG_graph::ptr fg, int k, const std::string &file,
+		int num_bands = 64, int num_rows = 2, double min_sim = 0.1);
+
 /**
  * \brief Compute transitivity of all vertices in the graph.
  * \param fg The FlashGraph graph object for which you want to compute.
@@ -334,4 +721,49 @@ void compute_overlap(FG_graph::ptr fg, const std::vector<vertex_id_t> &vids,
  */
 FG_vector<float>::ptr compute_transitivity(FG_graph::ptr fg);
 
+/**
+ * \brief An estimate and its confidence interval.
+ */
+struct approx_estimate
+{
+	double estimate;
+	double lower;
+	double upper;
+};
+
+/**
+ * \brief Estimate the global transitivity, the fraction of wedges that are
+ *        closed, by sampling wedges uniformly. Edge direction is ignored.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \param num_samples The number of sampled wedges. The standard error
+ *        of the estimate is at most 1 / (2 * sqrt(num_samples)).
+ * \param confidence The confidence level of the interval.
+ * \return The estimated transitivity and its confidence interval.
+ */
+approx_estimate estimate_transitivity(FG_graph::ptr fg, size_t num_samples,
+		double confidence = 0.95);
+
+/**
+ * \brief Estimate the local transitivity of every vertex by sampling
+ *        the same number of wedges at every vertex. It's exact for
+ *        the vertices that don't have more wedges. Edge direction is ignored.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \param num_samples The number of sampled wedges at a vertex.
+ * \return A vector with the local transitivity of each vertex.
+ */
+FG_vector<float>::ptr estimate_local_transitivity(FG_graph::ptr fg,
+		size_t num_samples);
+
+/**
+ * \brief Estimate the number of triangles with DOULION, which counts
+ *        the triangles in a graph whose edges are kept with a probability.
+ *        Edge direction is ignored.
+ * \param fg The FlashGraph graph object for which you want to compute.
+ * \param edge_prob The probability of keeping an edge. It's exact if it's 1.
+ * \param confidence The confidence level of the interval.
+ * \return The estimated number of triangles and its confidence interval.
+ */
+approx_estimate estimate_triangles(FG_graph::ptr fg, double edge_prob,
+		double confidence = 0.95);
+
 #endif
@@ -571,6 +571,24 @@ RcppExport SEXP R_FG_compute_kcore(SEXP graph, SEXP _k, SEXP _kmax)
 	return res;
 }
 
+RcppExport SEXP R_FG_compute_mis(SEXP graph)
+{
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	FG_vector<vsize_t>::ptr fg_vec = compute_mis(fg);
+	Rcpp::LogicalVector res(fg_vec->get_size());
+	fg_vec->copy_to(res.begin(), fg_vec->get_size());
+	return res;
+}
+
+RcppExport SEXP R_FG_compute_coloring(SEXP graph)
+{
+	FG_graph::ptr fg = R_FG_get_graph(graph);
+	FG_vector<vsize_t>::ptr fg_vec = compute_coloring(fg);
+	Rcpp::IntegerVector res(fg_vec->get_size());
+	fg_vec->copy_to(res.begin(), fg_vec->get_size());
+	return res;
+}
+
 RcppExport SEXP R_FG_compute_overlap(SEXP graph, SEXP _vids)
 {
 	Rcpp::IntegerVector Rvids(_vids);
@@ -270,6 +270,21 @@ public:
 		ptr[arr_off].fetch_or(1L << inside_off, std::memory_order_relaxed);
 	}
 
+	/*
+	 * Set the bit and return its old value. Only one of the threads that
+	 * set the same bit concurrently sees false.
+	 */
+	bool test_and_set(size_t idx) {
+		assert(idx < max_num_bits);
+		size_t arr_off = idx / NUM_BITS_LONG;
+		size_t inside_off = idx % NUM_BITS_LONG;
+		unsigned long mask = 1UL << inside_off;
+		// Avoid the atomic operation if the bit has been set.
+		if (ptr[arr_off].load(std::memory_order_relaxed) & mask)
+			return true;
+		return ptr[arr_off].fetch_or(mask, std::memory_order_relaxed) & mask;
+	}
+
 	bool get(size_t idx) const {
 		assert(idx < max_num_bits);
 		size_t arr_off = idx / NUM_BITS_LONG;
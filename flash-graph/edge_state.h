@@ -0,0 +1,396 @@
+#ifndef __EDGE_STATE_H__
+#define __EDGE_STATE_H__
+
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <numa.h>
+
+#include <memory>
+#include <vector>
+#include <limits>
+#include <atomic>
+#include <type_traits>
+
+#include <boost/format.hpp>
+
+#include "graph_engine.h"
+#include "RAID_config.h"
+
+/**
+ * This keeps a value for every edge in the adjacency lists of a graph.
+ * The values of the edges of a vertex are stored together in the order
+ * of its adjacency list, so the value of an edge is located with
+ * the vertex and the offset of the edge in the adjacency list.
+ *
+ * The location of the first value of a vertex is derived from the offset
+ * of its adjacency list in the in-memory vertex index, so the array
+ * doesn't keep any per-vertex data. The adjacency lists are stored in
+ * the order of vertex IDs, and each has a header followed by the edges.
+ * Counting the edges before a vertex in units of the bytes of an edge
+ * gives a location that is at least as large as the number of edges
+ * before the vertex. Padding in the adjacency lists may leave a few
+ * locations that don't belong to any edge.
+ *
+ * The locations of a range of vertices of the range partitioner are
+ * contiguous in each direction, so they form a part of the array, which
+ * is stored on the NUMA node of the worker thread that owns the range.
+ * If the values don't fit in the memory given to the array, they are
+ * stored in files striped over the SSDs of SAFS, which are mapped to
+ * memory and cached by the page cache. The values of a trivially
+ * constructible type are zero-filled pages, so they aren't touched until
+ * they're used.
+ *
+ * In a directed graph, the values of in-edges are stored before the ones
+ * of out-edges. An undirected graph has only one adjacency list per
+ * vertex, which is accessed as out-edges.
+ */
+template<class T>
+class edge_state_array
+{
+	struct direction
+	{
+		// The offset of the adjacency list of vertex 0 in the graph file.
+		off_t base_off;
+		// The location of the first value of the direction.
+		size_t base_loc;
+		bool valid;
+	};
+
+	in_mem_query_vertex_index::ptr vindex;
+	bool directed;
+	size_t header_size;
+	// The number of bytes that an edge takes in an adjacency list.
+	size_t edge_size;
+	// The in-edges and the out-edges.
+	direction dirs[2];
+	size_t num_vals;
+	T *vals;
+	size_t alloc_size;
+	// It's true if the values are stored in SAFS.
+	bool spilled;
+	// The location of the first value of every part.
+	std::vector<size_t> part_starts;
+	// The NUMA node of every part.
+	std::vector<int> part_nodes;
+
+	static int get_dir_idx(edge_type type) {
+		assert(type == edge_type::IN_EDGE || type == edge_type::OUT_EDGE);
+		return type == edge_type::IN_EDGE ? 0 : 1;
+	}
+
+	edge_type get_list_type(edge_type type) const {
+		return directed ? type : edge_type::OUT_EDGE;
+	}
+
+	/*
+	 * The location of the first value of a vertex relative to the first
+	 * value of the direction.
+	 */
+	size_t get_dir_loc(const direction &dir, vertex_id_t id,
+			off_t off) const {
+		return (off - dir.base_off - id * header_size) / edge_size;
+	}
+
+	/*
+	 * Map files on the SSDs of SAFS to store the values. The values are
+	 * striped over the SSDs, and each SSD has a file mapped to a contiguous
+	 * range of the values. The files are unlinked right away, so they're
+	 * deleted when they're unmapped. The number of bytes mapped is returned
+	 * in `map_size'.
+	 */
+	static T *map_safs_files(size_t size, size_t &map_size) {
+		static std::atomic<size_t> num_files;
+		const RAID_config &conf = get_sys_RAID_conf();
+		int num_disks = conf.get_num_disks();
+		if (num_disks == 0)
+			return NULL;
+		size_t chunk_size = ROUNDUP_PAGE((size + num_disks - 1) / num_disks);
+		map_size = chunk_size * num_disks;
+		char *addr = (char *) mmap(NULL, map_size, PROT_NONE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (addr == MAP_FAILED) {
+			perror("mmap");
+			return NULL;
+		}
+		size_t file_id = num_files.fetch_add(1);
+		for (int i = 0; i < num_disks; i++) {
+			std::string file_name = (boost::format("%1%/edge_state-%2%-%3%-%4%")
+					% conf.get_disk(i).name % getpid() % file_id % i).str();
+			int fd = open(file_name.c_str(), O_RDWR | O_CREAT | O_EXCL,
+					S_IRUSR | S_IWUSR);
+			if (fd < 0) {
+				perror("open");
+				munmap(addr, map_size);
+				return NULL;
+			}
+			void *chunk = MAP_FAILED;
+			if (ftruncate(fd, chunk_size) == 0)
+				chunk = mmap(addr + chunk_size * i, chunk_size,
+						PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+			else
+				perror("ftruncate");
+			unlink(file_name.c_str());
+			close(fd);
+			if (chunk == MAP_FAILED) {
+				munmap(addr, map_size);
+				return NULL;
+			}
+		}
+		return (T *) addr;
+	}
+
+	/*
+	 * Split the locations at the first vertex of every range of the range
+	 * partitioner in every direction. A part belongs to the worker thread
+	 * that owns the range.
+	 */
+	void init_parts(const graph_engine &graph) {
+		const graph_partitioner *partitioner = graph.get_partitioner();
+		size_t num_vertices = graph.get_num_vertices();
+		size_t range_size = 1UL << graph_conf.get_part_range_size_log();
+		for (int i = 0; i < 2; i++) {
+			if (!dirs[i].valid)
+				continue;
+			edge_type type = i == 0 ? edge_type::IN_EDGE : edge_type::OUT_EDGE;
+			for (vertex_id_t id = 0; id < num_vertices; id += range_size) {
+				part_starts.push_back(get_begin(id, type));
+				part_nodes.push_back(graph.get_node_id(partitioner->map(id)));
+			}
+		}
+	}
+
+	/*
+	 * Bind the pages of the parts to their NUMA nodes before the pages are
+	 * touched. The adjacent parts on the same node are bound together,
+	 * and a page shared by two nodes goes with the part that ends in it.
+	 */
+	void bind_parts() {
+		size_t i = 0;
+		while (i < part_starts.size()) {
+			size_t j = i + 1;
+			while (j < part_starts.size() && part_nodes[j] == part_nodes[i])
+				j++;
+			size_t start = i == 0 ? 0 : ROUNDUP_PAGE(part_starts[i] * sizeof(T));
+			size_t end = j == part_starts.size()
+				? alloc_size : ROUNDUP_PAGE(part_starts[j] * sizeof(T));
+			if (end > start)
+				numa_tonode_memory((char *) vals + start, end - start,
+						part_nodes[i]);
+			i = j;
+		}
+	}
+
+	void init_vals(bool spill) {
+		size_t size = std::max(num_vals, 1UL) * sizeof(T);
+		vals = NULL;
+		spilled = false;
+		if (spill) {
+			vals = map_safs_files(size, alloc_size);
+			if (vals)
+				spilled = true;
+			else
+				BOOST_LOG_TRIVIAL(error) << "can't store edge values in SAFS";
+		}
+		if (vals == NULL) {
+			alloc_size = ROUNDUP_PAGE(size);
+			vals = (T *) numa_alloc(alloc_size);
+			bind_parts();
+		}
+		// Both kinds of memory start with zero-filled pages.
+		if (!std::is_trivially_default_constructible<T>::value)
+			for (size_t i = 0; i < num_vals; i++)
+				new (vals + i) T();
+	}
+
+	edge_state_array(const graph_engine &graph, edge_type type,
+			size_t max_mem_size) {
+		vindex = graph.get_in_mem_index();
+		directed = graph.is_directed();
+		header_size = ext_mem_undirected_vertex::get_header_size();
+		edge_size = sizeof(vertex_id_t)
+			+ graph.get_graph_header().get_edge_data_size();
+		if (!directed)
+			type = edge_type::OUT_EDGE;
+		dirs[0].valid = type == edge_type::IN_EDGE
+			|| type == edge_type::BOTH_EDGES;
+		dirs[1].valid = type == edge_type::OUT_EDGE
+			|| type == edge_type::BOTH_EDGES;
+
+		size_t num_vertices = graph.get_num_vertices();
+		num_vals = 0;
+		for (int i = 0; i < 2; i++) {
+			direction &dir = dirs[i];
+			dir.base_off = 0;
+			dir.base_loc = num_vals;
+			if (!dir.valid || num_vertices == 0)
+				continue;
+			edge_type list_type = get_list_type(i == 0
+					? edge_type::IN_EDGE : edge_type::OUT_EDGE);
+			dir.base_off = vindex->get_vertex_info(0, list_type).get_off();
+			ext_mem_vertex_info last = vindex->get_vertex_info(
+					num_vertices - 1, list_type);
+			num_vals += get_dir_loc(dir, num_vertices,
+					last.get_off() + last.get_size());
+		}
+
+		init_parts(graph);
+		bool spill = num_vals * sizeof(T) > max_mem_size;
+		if (spill && !is_safs_init()) {
+			BOOST_LOG_TRIVIAL(warning)
+				<< "SAFS isn't initialized, edge values are kept in memory";
+			spill = false;
+		}
+		else if (spill)
+			BOOST_LOG_TRIVIAL(info) << boost::format(
+					"store %1% bytes of edge values in SAFS")
+				% (num_vals * sizeof(T));
+		init_vals(spill);
+	}
+
+	edge_state_array(const edge_state_array<T> &) = delete;
+	edge_state_array<T> &operator=(const edge_state_array<T> &) = delete;
+public:
+	typedef std::shared_ptr<edge_state_array<T> > ptr;
+
+	/**
+	 * \brief Create the values of edges. They are value-initialized.
+	 * \param graph The graph engine of the graph.
+	 * \param type The edges that have values: IN_EDGE, OUT_EDGE or
+	 *        BOTH_EDGES. It's ignored in an undirected graph.
+	 * \param max_mem_size The maximal number of bytes of the values kept
+	 *        in memory. The values are stored in SAFS if they need more.
+	 */
+	static ptr create(const graph_engine &graph, edge_type type,
+			size_t max_mem_size = std::numeric_limits<size_t>::max()) {
+		return ptr(new edge_state_array<T>(graph, type, max_mem_size));
+	}
+
+	~edge_state_array() {
+		if (!std::is_trivially_destructible<T>::value)
+			for (size_t i = 0; i < num_vals; i++)
+				vals[i].~T();
+		if (spilled)
+			munmap(vals, alloc_size);
+		else
+			numa_free(vals, alloc_size);
+	}
+
+	/**
+	 * \brief The total number of values, including the locations that
+	 *        don't belong to any edge.
+	 */
+	size_t get_size() const {
+		return num_vals;
+	}
+
+	/**
+	 * \brief Whether the values are stored in SAFS.
+	 */
+	bool is_spilled() const {
+		return spilled;
+	}
+
+	/**
+	 * \brief The number of parts that the locations are split into, so
+	 *        all values can be processed in parallel without knowing
+	 *        the vertices. A part holds the values of a range of vertices
+	 *        of the range partitioner in one direction.
+	 */
+	int get_num_parts() const {
+		return part_starts.size();
+	}
+
+	size_t get_part_begin(int part_id) const {
+		return part_starts[part_id];
+	}
+
+	size_t get_part_end(int part_id) const {
+		return (size_t) part_id + 1 < part_starts.size()
+			? part_starts[part_id + 1] : num_vals;
+	}
+
+	/**
+	 * \brief The NUMA node where the values of a part are stored.
+	 */
+	int get_part_node(int part_id) const {
+		return part_nodes[part_id];
+	}
+
+	/**
+	 * \brief The location of the first edge of a vertex. The locations of
+	 *        the edges of the vertex end at get_end().
+	 */
+	size_t get_begin(vertex_id_t id, edge_type type) const {
+		const direction &dir = dirs[get_dir_idx(get_list_type(type))];
+		assert(dir.valid);
+		ext_mem_vertex_info info = vindex->get_vertex_info(id,
+				get_list_type(type));
+		return dir.base_loc + get_dir_loc(dir, id, info.get_off());
+	}
+
+	size_t get_end(vertex_id_t id, edge_type type) const {
+		return get_begin(id, type) + vindex->get_num_edges(id,
+				get_list_type(type));
+	}
+
+	/**
+	 * \brief The location of an edge.
+	 * \param id The vertex that the edge belongs to.
+	 * \param type The edge type: IN_EDGE or OUT_EDGE.
+	 * \param idx The offset of the edge in the adjacency list.
+	 */
+	size_t get_loc(vertex_id_t id, edge_type type, size_t idx) const {
+		assert(idx < vindex->get_num_edges(id, get_list_type(type)));
+		return get_begin(id, type) + idx;
+	}
+
+	/**
+	 * \brief The location of an edge of the vertex being processed
+	 *        in `run(vertex_program &, const page_vertex &)`.
+	 */
+	size_t get_loc(const page_vertex &vertex, edge_type type,
+			size_t idx) const {
+		return get_loc(vertex.get_id(), type, idx);
+	}
+
+	T &get(size_t loc) {
+		assert(loc < num_vals);
+		return vals[loc];
+	}
+
+	const T &get(size_t loc) const {
+		assert(loc < num_vals);
+		return vals[loc];
+	}
+
+	T &get(vertex_id_t id, edge_type type, size_t idx) {
+		return get(get_loc(id, type, idx));
+	}
+
+	const T &get(vertex_id_t id, edge_type type, size_t idx) const {
+		return get(get_loc(id, type, idx));
+	}
+};
+
+#endif
@@ -39,6 +39,8 @@ class graph_config
 	int index_file_weight;
 	bool _in_mem_index;
 	bool _in_mem_graph;
+	bool _numa_graph;
+	bool _huge_page_graph;
 	int num_vparts;
 	int min_vpart_degree;
 	bool serial_run;
@@ -56,6 +58,8 @@ public:
 		index_file_weight = 10;
 		_in_mem_index = false;
 		_in_mem_graph = false;
+		_numa_graph = false;
+		_huge_page_graph = false;
 		num_vparts = 1;
 		min_vpart_degree = std::numeric_limits<int>::max();
 		serial_run = false;
@@ -162,6 +166,24 @@ public:
 		return _in_mem_graph;
 	}
 
+	/**
+	 * \brief Determine whether to split the in-memory graph data among
+	 * NUMA nodes.
+	 * \return true if the in-memory graph data of the vertices is stored
+	 * on the NUMA nodes of the worker threads that own the vertices.
+	 */
+	bool use_numa_graph() const {
+		return _numa_graph;
+	}
+
+	/**
+	 * \brief Determine whether to store the in-memory graph data in huge pages.
+	 * \return true if the in-memory graph data uses transparent huge pages.
+	 */
+	bool use_huge_page_graph() const {
+		return _huge_page_graph;
+	}
+
 	/**
 	 * \brief Determine whether to run the user code on a vertex in serial.
 	 * \return true if the graph engine runs the user code on a vertex in serial.
@@ -200,6 +222,8 @@ inline void graph_config::print_help()
 	printf("\tindex_file_weight: the weight for the graph index file\n");
 	printf("\tin_mem_index: indicate whether to use in-mem vertex index\n");
 	printf("\tin_mem_graph: indicate whether to load the entire graph to memory in advance\n");
+	printf("\tnuma_graph: split the in-memory graph among NUMA nodes by vertex partitions\n");
+	printf("\thuge_page_graph: store the in-memory graph in huge pages\n");
 	printf("\tnum_vparts: the number of vertical partitions\n");
 	printf("\tmin_vpart_degree: the min degree of a vertex to perform vertical partitioning\n");
 	printf("\tserial_run: run the user code on a vertex in serial\n");
@@ -218,6 +242,8 @@ inline void graph_config::print()
 	BOOST_LOG_TRIVIAL(info) << "\tindex_file_weight: " << index_file_weight;
 	BOOST_LOG_TRIVIAL(info) << "\tin_mem_index: " << _in_mem_index;
 	BOOST_LOG_TRIVIAL(info) << "\tin_mem_graph: " << _in_mem_graph;
+	BOOST_LOG_TRIVIAL(info) << "\tnuma_graph: " << _numa_graph;
+	BOOST_LOG_TRIVIAL(info) << "\thuge_page_graph: " << _huge_page_graph;
 	BOOST_LOG_TRIVIAL(info) << "\tnum_vparts: " << num_vparts;
 	BOOST_LOG_TRIVIAL(info) << "\tmin_vpart_degree: " << min_vpart_degree;
 	BOOST_LOG_TRIVIAL(info) << "\tserial_run: " << serial_run;
@@ -237,6 +263,8 @@ inline void graph_config::init(config_map::ptr map)
 	map->read_option_int("index_file_weight", index_file_weight);
 	map->read_option_bool("in_mem_index", _in_mem_index);
 	map->read_option_bool("in_mem_graph", _in_mem_graph);
+	map->read_option_bool("numa_graph", _numa_graph);
+	map->read_option_bool("huge_page_graph", _huge_page_graph);
 	map->read_option_int("num_vparts", num_vparts);
 	map->read_option_int("min_vpart_degree", min_vpart_degree);
 	map->read_option_bool("serial_run", serial_run);
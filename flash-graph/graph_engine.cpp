@@ -217,6 +217,14 @@ bool request_self(directed_vertex_request reqs[], size_t num, vertex_id_t self)
 		return false;
 }
 
+static bool request_edge_data(directed_vertex_request reqs[], size_t num)
+{
+	for (size_t i = 0; i < num; i++)
+		if (reqs[i].get_part() != request_part::TOPOLOGY)
+			return true;
+	return false;
+}
+
 void compute_vertex::request_vertices(vertex_id_t ids[], size_t num)
 {
 	worker_thread *curr = (worker_thread *) thread::get_curr_thread();
@@ -257,7 +265,10 @@ void compute_directed_vertex::request_partial_vertices(
 	worker_thread *curr = (worker_thread *) thread::get_curr_thread();
 	vertex_id_t id = curr->get_vertex_program(false).get_vertex_id(*this);
 	curr->request_on_vertex(id);
-	if (request_self(reqs, num, id)) {
+	// The edge data in an edge data column can only be read by
+	// the general vertex requests.
+	if (request_self(reqs, num, id) && !(curr->get_graph().has_edge_data_column()
+				&& request_edge_data(reqs, num))) {
 		for (size_t i = 0; i < num; i++)
 			curr->get_index_reader().request_vertex(reqs[i]);
 	}
@@ -594,6 +605,7 @@ graph_engine::graph_engine(FG_graph &graph, graph_index::ptr index)
 
 	// Init graph data.
 	graph_factory = graph.get_graph_io_factory(GLOBAL_CACHE_ACCESS);
+	graph_data = graph.get_graph_data();
 	// Construct the in-memory compressed vertex index.
 	vindex = in_mem_query_vertex_index::create(graph.get_index_data(),
 			!graph_conf.use_in_mem_index());
@@ -601,11 +613,12 @@ graph_engine::graph_engine(FG_graph &graph, graph_index::ptr index)
 	header = graph.get_graph_header();
 	header.verify();
 	out_part_off = 0;
-	if (header.is_directed_graph()) {
-		assert(sizeof(vertex_index) == sizeof(header));
-		vertex_index *idx = (vertex_index *) &header;
+	assert(sizeof(vertex_index) == sizeof(header));
+	vertex_index *idx = (vertex_index *) &header;
+	if (header.is_directed_graph())
 		out_part_off = idx->get_out_part_loc();
-	}
+	edge_data_loc = idx->get_edge_data_loc();
+	edge_data_col_size = idx->get_edge_data_col_size();
 
 	init(index);
 
@@ -624,11 +637,6 @@ graph_engine::~graph_engine()
 	destroy_flash_graph();
 }
 
-static inline int get_node_id(int thread_idx, int num_nodes)
-{
-	return thread_idx % num_nodes;
-}
-
 void graph_engine::init_threads(vertex_program_creater::ptr creater)
 {
 	std::vector<std::shared_ptr<slab_allocator> > msg_allocs(num_nodes);
@@ -660,16 +668,16 @@ void graph_engine::init_threads(vertex_program_creater::ptr creater)
 		worker_thread *t = new worker_thread(this, graph_factory,
 				file_io_factory::shared_ptr(),
 				new_prog, vertices->create_def_part_vertex_program(),
-				get_node_id(i, num_nodes), i, num_threads, scheduler,
-				msg_allocs[get_node_id(i, num_nodes)]);
+				get_node_id(i), i, num_threads, scheduler,
+				msg_allocs[get_node_id(i)]);
 		assert(worker_threads[i] == NULL);
 		worker_threads[i] = t;
 		vprograms[i] = new_prog;
 	}
 	for (int i = 0; i < num_threads; i++) {
 		worker_threads[i]->init_messaging(worker_threads,
-				msg_allocs[get_node_id(i, num_nodes)],
-				flush_msg_allocs[get_node_id(i, num_nodes)]);
+				msg_allocs[get_node_id(i)],
+				flush_msg_allocs[get_node_id(i)]);
 	}
 }
 
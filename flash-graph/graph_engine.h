@@ -330,6 +330,9 @@ class graph_engine
 	// The location of the out-part of the graph. It's valid only
 	// in a directed graph.
 	off_t out_part_off;
+	// The location and the element size of the edge data column.
+	off_t edge_data_loc;
+	int edge_data_col_size;
 
 	graph_index::ptr vertices;
 	in_mem_query_vertex_index::ptr vindex;
@@ -591,6 +594,14 @@ public:
 	int get_num_threads() const {
 		return worker_threads.size();
 	}
+
+    /**\internal
+     * The partition of vertices processed by a worker thread is stored
+     * on the NUMA node of the thread.
+     */
+	int get_node_id(int part_id) const {
+		return part_id % num_nodes;
+	}
     
     /**\internal */
 	worker_thread *get_thread(int idx) const {
@@ -623,6 +634,13 @@ public:
 		return vindex;
 	}
 
+	/**
+	 * \internal Get the adjacency lists of the graph if they are in memory.
+	 */
+	std::shared_ptr<in_mem_graph> get_graph_data() const {
+		return graph_data;
+	}
+
 	void set_max_processing_vertices(int max) {
 		max_processing_vertices = max;
 	}
@@ -639,6 +657,37 @@ public:
 		return out_part_off;
 	}
 
+	/**
+	 * \brief Determine whether the edge data of the graph is stored in
+	 *        a column separated from the adjacency lists.
+	 * In this case, a vertex has to request the edge data explicitly.
+	 * \return true if the graph has an edge data column.
+	 */
+	bool has_edge_data_column() const {
+		return edge_data_loc > 0;
+	}
+
+	/**
+	 * \internal
+	 * The location of the edge data column in the graph file.
+	 */
+	off_t get_edge_data_loc() const {
+		return edge_data_loc;
+	}
+
+	/**
+	 * \brief Get the size of the data attached to an edge, no matter
+	 *        whether it is stored with the adjacency lists or in
+	 *        an edge data column.
+	 * \return The size of edge data. It's 0 if edges don't have data.
+	 */
+	size_t get_edge_data_size() const {
+		if (has_edge_data_column())
+			return edge_data_col_size;
+		else
+			return header.get_edge_data_size();
+	}
+
 	vsize_t cal_num_edges(vsize_t vertex_size) const {
 		return ext_mem_undirected_vertex::vsize2num_edges(vertex_size,
 				header.get_edge_data_size());
@@ -166,6 +166,9 @@ public:
 	}
 
 	void init() {
+		// A small graph may leave some partitions without vertices.
+		if (num_vertices == 0)
+			return;
 		vertex_arr = (vertex_type *) malloc_large(
 				sizeof(vertex_arr[0]) * num_vertices);
 		assert(vertex_arr);
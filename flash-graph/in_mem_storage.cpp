@@ -19,6 +19,14 @@
 
 #include <stdlib.h>
 #include <malloc.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <numa.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
 
 #include <boost/format.hpp>
 
@@ -30,71 +38,9 @@
 
 #include "in_mem_storage.h"
 #include "graph_file_header.h"
-
-class in_mem_byte_array: public page_byte_array
-{
-	off_t off;
-	size_t size;
-	const char *pages;
-
-	void assign(in_mem_byte_array &arr) {
-		this->off = arr.off;
-		this->size = arr.size;
-		this->pages = arr.pages;
-	}
-
-	in_mem_byte_array(in_mem_byte_array &arr) {
-		assign(arr);
-	}
-
-	in_mem_byte_array &operator=(in_mem_byte_array &arr) {
-		assign(arr);
-		return *this;
-	}
-public:
-	in_mem_byte_array(byte_array_allocator &alloc): page_byte_array(alloc) {
-		off = 0;
-		size = 0;
-		pages = NULL;
-	}
-
-	in_mem_byte_array(const io_request &req, char *pages,
-			byte_array_allocator &alloc): page_byte_array(alloc) {
-		this->off = req.get_offset();
-		this->size = req.get_size();
-		this->pages = pages;
-	}
-
-	virtual off_t get_offset() const {
-		return off;
-	}
-
-	virtual off_t get_offset_in_first_page() const {
-		return off % PAGE_SIZE;
-	}
-
-	virtual const char *get_page(int pg_idx) const {
-		return pages + pg_idx * PAGE_SIZE;
-	}
-
-	virtual size_t get_size() const {
-		return size;
-	}
-
-	void lock() {
-		ABORT_MSG("lock isn't implemented");
-	}
-
-	void unlock() {
-		ABORT_MSG("unlock isn't implemented");
-	}
-
-	page_byte_array *clone() {
-		in_mem_byte_array *arr = (in_mem_byte_array *) get_allocator().alloc();
-		*arr = *this;
-		return arr;
-	}
-};
+#include "graph_config.h"
+#include "partitioner.h"
+#include "vertex_index.h"
 
 class in_mem_byte_array_allocator: public byte_array_allocator
 {
@@ -137,6 +83,11 @@ public:
 	}
 };
 
+byte_array_allocator *in_mem_byte_array::create_allocator(thread *t)
+{
+	return new in_mem_byte_array_allocator(t);
+}
+
 class in_mem_io: public io_interface
 {
 	const in_mem_graph &graph;
@@ -155,7 +106,7 @@ public:
 				true), incomp_computes(get_node_id(), 1024, true) {
 		this->file_id = file_id;
 		array_allocator = std::unique_ptr<byte_array_allocator>(
-				new in_mem_byte_array_allocator(t));
+				in_mem_byte_array::create_allocator(t));
 	}
 
 	virtual int get_file_id() const {
@@ -175,7 +126,7 @@ public:
 	virtual io_status access(char *buf, off_t off, ssize_t size,
 			int access_method) {
 		assert(access_method == READ);
-		memcpy(buf, graph.graph_data + off, size);
+		graph.read(buf, off, size);
 		return IO_OK;
 	}
 
@@ -199,9 +150,9 @@ enum
 void in_mem_io::process_req(const io_request &req)
 {
 	assert(req.get_req_type() == io_request::USER_COMPUTE);
-	in_mem_byte_array byte_arr(req,
-			graph.graph_data + ROUND_PAGE(req.get_offset()), *array_allocator);
 	user_compute *compute = req.get_compute();
+	in_mem_byte_array byte_arr(graph, req.get_offset(), req.get_size(),
+			*array_allocator);
 	compute->run(byte_arr);
 	// If the user compute hasn't completed and it's not in the queue,
 	// add it to the queue.
@@ -285,6 +236,236 @@ public:
 	}
 };
 
+namespace
+{
+
+/*
+ * The graph file is read in large requests, so they are striped to all
+ * disks in the RAID.
+ */
+const size_t LOAD_CHUNK_SIZE = 64 * 1024 * 1024;
+// The number of requests that a loading thread keeps outstanding in SAFS.
+const int MAX_PENDING_LOADS = 4;
+
+/*
+ * A part of the graph file that is read to memory.
+ */
+struct load_task
+{
+	char *buf;
+	off_t off;
+	size_t size;
+};
+
+/*
+ * The tasks of a NUMA node are only processed by the loading threads on
+ * the node. The memory for the graph data isn't touched before it's
+ * loaded, so the pages are allocated on the node that reads them first.
+ */
+class load_task_queue
+{
+	struct node_tasks
+	{
+		std::vector<load_task> tasks;
+		std::atomic<size_t> fetch_idx;
+
+		node_tasks(): fetch_idx(0) {
+		}
+	};
+	std::vector<std::unique_ptr<node_tasks> > nodes;
+public:
+	load_task_queue(int num_nodes) {
+		for (int i = 0; i < num_nodes; i++)
+			nodes.emplace_back(new node_tasks());
+	}
+
+	/*
+	 * Split the data in [off, off + size) into tasks on the node.
+	 * `buf' has to be page aligned.
+	 */
+	void add(int node_id, char *buf, off_t off, size_t size) {
+		for (size_t done = 0; done < size; done += LOAD_CHUNK_SIZE) {
+			load_task task;
+			task.buf = buf + done;
+			task.off = off + done;
+			task.size = std::min(LOAD_CHUNK_SIZE, size - done);
+			nodes[node_id]->tasks.push_back(task);
+		}
+	}
+
+	bool fetch(int node_id, load_task &task) {
+		node_tasks &node = *nodes[node_id];
+		size_t idx = node.fetch_idx.fetch_add(1);
+		if (idx >= node.tasks.size())
+			return false;
+		task = node.tasks[idx];
+		return true;
+	}
+};
+
+class graph_load_thread: public thread
+{
+	load_task_queue &tasks;
+	file_io_factory::shared_ptr safs_factory;
+	int fd;
+	bool direct;
+	bool success;
+
+	bool read_task(const load_task &task);
+public:
+	graph_load_thread(load_task_queue &_tasks, int node_id,
+			file_io_factory::shared_ptr safs_factory, int fd,
+			bool direct): thread("graph-load-thread", node_id), tasks(_tasks) {
+		this->safs_factory = safs_factory;
+		this->fd = fd;
+		this->direct = direct;
+		success = true;
+	}
+
+	bool is_success() const {
+		return success;
+	}
+
+	virtual void run();
+};
+
+bool graph_load_thread::read_task(const load_task &task)
+{
+	// Direct I/O has to read entire pages. The buffer always has
+	// the space for the last page of the file.
+	size_t req_size = direct ? ROUNDUP_PAGE(task.size) : task.size;
+	size_t done = 0;
+	while (done < task.size) {
+		ssize_t ret = pread(fd, task.buf + done, req_size - done,
+				task.off + done);
+		if (ret < 0) {
+			perror("pread");
+			return false;
+		}
+		if (ret == 0) {
+			BOOST_LOG_TRIVIAL(error) << boost::format(
+					"the graph file ends at %1%") % (task.off + done);
+			return false;
+		}
+		done += ret;
+	}
+	return true;
+}
+
+void graph_load_thread::run()
+{
+	io_interface::ptr io;
+	if (safs_factory)
+		io = safs_factory->create_io(this);
+	load_task task;
+	while (success && tasks.fetch(get_node_id(), task)) {
+		if (io) {
+			data_loc_t loc(safs_factory->get_file_id(), task.off);
+			io_request req(task.buf, loc, task.size, READ);
+			io->access(&req, 1);
+			if (io->num_pending_ios() >= MAX_PENDING_LOADS)
+				io->wait4complete(1);
+		}
+		else
+			success = read_task(task);
+	}
+	if (io) {
+		while (io->num_pending_ios() > 0)
+			io->wait4complete(io->num_pending_ios());
+	}
+	this->stop();
+}
+
+}
+
+void in_mem_graph::alloc_graph_data()
+{
+	graph_map_size = ROUNDUP_PAGE(graph_size);
+	// We try the reserved huge pages first, and then the transparent
+	// huge pages.
+	void *addr = MAP_FAILED;
+	if (graph_conf.use_huge_page_graph()) {
+		const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+		size_t huge_size = ROUNDUP(graph_size, HUGE_PAGE_SIZE);
+		addr = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (addr != MAP_FAILED)
+			graph_map_size = huge_size;
+	}
+	if (addr == MAP_FAILED) {
+		addr = mmap(NULL, graph_map_size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (addr != MAP_FAILED && graph_conf.use_huge_page_graph())
+			madvise(addr, graph_map_size, MADV_HUGEPAGE);
+	}
+	if (addr == MAP_FAILED) {
+		graph_map_size = 0;
+		throw io_exception(boost::str(boost::format(
+						"can't allocate %1% bytes for the graph") % graph_size));
+	}
+	graph_data = (char *) addr;
+}
+
+void in_mem_graph::parallel_load(file_io_factory::shared_ptr safs_factory)
+{
+	int num_nodes = params.get_num_nodes();
+	load_task_queue tasks(num_nodes);
+	if (segs.empty()) {
+		// The chunks are interleaved among the NUMA nodes.
+		for (size_t off = 0, i = 0; off < graph_size;
+				off += LOAD_CHUNK_SIZE, i++)
+			tasks.add(i % num_nodes, graph_data + off, off,
+					std::min(LOAD_CHUNK_SIZE, graph_size - off));
+	}
+	else {
+		for (size_t i = 0; i < segs.size(); i++) {
+			off_t start = ROUND_PAGE(segs[i].off);
+			off_t end = std::min((size_t) ROUNDUP_PAGE(segs[i].off
+						+ segs[i].size), graph_size);
+			tasks.add(segs[i].node_id, segs[i].pages, start, end - start);
+		}
+	}
+
+	int fd = -1;
+	bool direct = false;
+	if (safs_factory == NULL) {
+		// We bypass the page cache if the file system allows.
+		fd = open(graph_file_name.c_str(), O_RDONLY | O_DIRECT);
+		direct = fd >= 0;
+		if (fd < 0)
+			fd = open(graph_file_name.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw io_exception(std::string("can't open ") + graph_file_name);
+	}
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	int num_threads = std::max(graph_conf.get_num_threads(), num_nodes);
+	std::vector<graph_load_thread *> threads(num_threads);
+	for (int i = 0; i < num_threads; i++) {
+		threads[i] = new graph_load_thread(tasks, i % num_nodes,
+				safs_factory, fd, direct);
+		threads[i]->start();
+	}
+	bool success = true;
+	for (int i = 0; i < num_threads; i++) {
+		threads[i]->join();
+		success = success && threads[i]->is_success();
+		delete threads[i];
+	}
+	if (fd >= 0)
+		close(fd);
+	if (!success)
+		throw io_exception(std::string("can't read from ") + graph_file_name);
+	gettimeofday(&end, NULL);
+
+	double secs = time_diff(start, end);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"It takes %1% seconds to load %2% bytes with %3% threads (%4% GB/s)")
+		% secs % graph_size % num_threads
+		% (secs > 0 ? graph_size / secs / (1024 * 1024 * 1024) : 0);
+}
+
 in_mem_graph::ptr in_mem_graph::load_graph(const std::string &file_name)
 {
 	native_file local_f(file_name);
@@ -293,18 +474,11 @@ in_mem_graph::ptr in_mem_graph::load_graph(const std::string &file_name)
 
 	in_mem_graph::ptr graph = in_mem_graph::ptr(new in_mem_graph());
 	graph->graph_size = size;
-	graph->graph_data = (char *) malloc(size);
-	assert(graph->graph_data);
 	graph->graph_file_name = file_name;
+	graph->alloc_graph_data();
 	BOOST_LOG_TRIVIAL(info) << boost::format("load a graph of %1% bytes")
 		% graph->graph_size;
-
-	FILE *fd = fopen(file_name.c_str(), "r");
-	if (fd == NULL)
-		throw io_exception(std::string("can't open ") + file_name);
-	if (fread(graph->graph_data, size, 1, fd) != 1)
-		throw io_exception(std::string("can't read from ") + file_name);
-	fclose(fd);
+	graph->parallel_load(file_io_factory::shared_ptr());
 
 	graph_header *header = (graph_header *) graph->graph_data;
 	header->verify();
@@ -319,25 +493,15 @@ in_mem_graph::ptr in_mem_graph::load_safs_graph(const std::string &file_name)
 
 	in_mem_graph::ptr graph = in_mem_graph::ptr(new in_mem_graph());
 	graph->graph_size = io_factory->get_file_size();
-	size_t num_pages = ROUNDUP_PAGE(graph->graph_size) / PAGE_SIZE;
-	graph->graph_data = (char *) memalign(PAGE_SIZE, num_pages * PAGE_SIZE);
-	assert(graph->graph_data);
 	graph->graph_file_name = file_name;
+	graph->alloc_graph_data();
 
 	BOOST_LOG_TRIVIAL(info) << boost::format("load a graph of %1% bytes")
 		% graph->graph_size;
 #if 0
 	graph->graph_file_id = io_factory->get_file_id();
 #endif
-	io_interface::ptr io = io_factory->create_io(thread::get_curr_thread());
-	const size_t MAX_IO_SIZE = 256 * 1024 * 1024;
-	for (off_t off = 0; (size_t) off < graph->graph_size; off += MAX_IO_SIZE) {
-		data_loc_t loc(io_factory->get_file_id(), off);
-		size_t req_size = min(MAX_IO_SIZE, graph->graph_size - off);
-		io_request req(graph->graph_data + off, loc, req_size, READ);
-		io->access(&req, 1);
-		io->wait4complete(1);
-	}
+	graph->parallel_load(io_factory);
 
 	graph_header *header = (graph_header *) graph->graph_data;
 	header->verify();
@@ -345,6 +509,194 @@ in_mem_graph::ptr in_mem_graph::load_safs_graph(const std::string &file_name)
 	return graph;
 }
 
+in_mem_graph::~in_mem_graph()
+{
+	if (graph_map_size > 0)
+		munmap(graph_data, graph_map_size);
+	else if (segs.empty())
+		free(graph_data);
+	for (size_t i = 0; i < node_bufs.size(); i++) {
+		if (node_bufs[i].first)
+			numa_free(node_bufs[i].first, node_bufs[i].second);
+	}
+}
+
+const in_mem_graph::segment &in_mem_graph::get_segment(off_t off) const
+{
+	class comp_off {
+	public:
+		bool operator()(off_t off, const segment &seg) const {
+			return off < seg.off;
+		}
+	};
+	std::vector<segment>::const_iterator it = std::upper_bound(segs.begin(),
+			segs.end(), off, comp_off());
+	assert(it != segs.begin());
+	return *(it - 1);
+}
+
+void in_mem_graph::read(char *buf, off_t off, size_t size) const
+{
+	if (segs.empty()) {
+		memcpy(buf, graph_data + off, size);
+		return;
+	}
+
+	while (size > 0) {
+		const segment &seg = get_segment(off);
+		size_t seg_size = std::min(size, seg.off + seg.size - off);
+		memcpy(buf, seg.pages + (off - ROUND_PAGE(seg.off)), seg_size);
+		buf += seg_size;
+		off += seg_size;
+		size -= seg_size;
+	}
+}
+
+void in_mem_graph::dump(const std::string &file) const
+{
+	FILE *f = fopen(file.c_str(), "w");
+	if (f == NULL) {
+		perror("fopen");
+		abort();
+	}
+	const size_t BUF_SIZE = 64 * 1024 * 1024;
+	std::unique_ptr<char[]> buf(new char[std::min(BUF_SIZE, graph_size)]);
+	for (size_t off = 0; off < graph_size; off += BUF_SIZE) {
+		size_t size = std::min(BUF_SIZE, graph_size - off);
+		read(buf.get(), off, size);
+		BOOST_VERIFY(fwrite(buf.get(), size, 1, f) == 1);
+	}
+	fclose(f);
+}
+
+/*
+ * The vertices are assigned to the worker threads with the range
+ * partitioner, and a worker thread runs on the NUMA node `part_id %
+ * num_nodes'. A range of vertices is stored contiguously in the in-edge
+ * part and in the out-edge part of a directed graph (and in the edge data
+ * column if there is one), so we split the graph data at the start of
+ * every range and merge the adjacent ranges on the same node.
+ */
+void in_mem_graph::init_segments(vertex_index::ptr index, int num_parts,
+		int num_nodes)
+{
+	in_mem_query_vertex_index::ptr query_index
+		= in_mem_query_vertex_index::create(index, true);
+	range_graph_partitioner partitioner(num_parts);
+	size_t num_vertices = index->get_num_vertices();
+	size_t range_size = 1UL << graph_conf.get_part_range_size_log();
+
+	std::vector<std::pair<off_t, int> > in_starts;
+	std::vector<std::pair<off_t, int> > out_starts;
+	for (vertex_id_t id = 0; id < num_vertices; id += range_size) {
+		int node_id = partitioner.map(id) % num_nodes;
+		if (index->get_graph_header().is_directed_graph()) {
+			directed_vertex_entry e = in_mem_cdirected_vertex_index::cast(
+					query_index)->get_vertex(id);
+			in_starts.push_back(std::pair<off_t, int>(e.get_in_off(), node_id));
+			out_starts.push_back(std::pair<off_t, int>(e.get_out_off(),
+						node_id));
+		}
+		else {
+			vertex_offset e = in_mem_cundirected_vertex_index::cast(
+					query_index)->get_vertex(id);
+			in_starts.push_back(std::pair<off_t, int>(e.get_off(), node_id));
+		}
+	}
+	// The graph header is stored with the first range.
+	if (!in_starts.empty())
+		in_starts[0].first = 0;
+	std::vector<std::pair<off_t, int> > starts = in_starts;
+	starts.insert(starts.end(), out_starts.begin(), out_starts.end());
+	if (index->get_edge_data_loc() > 0) {
+		size_t num_topo_starts = starts.size();
+		for (size_t i = 0; i < num_topo_starts; i++)
+			starts.push_back(std::pair<off_t, int>(
+						starts[i].first + index->get_edge_data_loc(),
+						starts[i].second));
+	}
+
+	segs.clear();
+	for (size_t i = 0; i < starts.size(); i++) {
+		if (!segs.empty() && segs.back().off == starts[i].first)
+			segs.pop_back();
+		if (segs.empty() || segs.back().node_id != starts[i].second) {
+			segment seg;
+			seg.off = starts[i].first;
+			seg.size = 0;
+			seg.node_id = starts[i].second;
+			seg.pages = NULL;
+			segs.push_back(seg);
+		}
+	}
+	for (size_t i = 0; i < segs.size(); i++) {
+		off_t end = i + 1 < segs.size() ? segs[i + 1].off : graph_size;
+		segs[i].size = end - segs[i].off;
+	}
+}
+
+in_mem_graph::ptr in_mem_graph::load_numa_graph(const std::string &file_name,
+		vertex_index::ptr index, bool safs)
+{
+	file_io_factory::shared_ptr safs_factory;
+	in_mem_graph::ptr graph = in_mem_graph::ptr(new in_mem_graph());
+	if (safs) {
+		safs_factory = ::create_io_factory(file_name, REMOTE_ACCESS);
+		graph->graph_size = safs_factory->get_file_size();
+	}
+	else {
+		native_file local_f(file_name);
+		graph->graph_size = local_f.get_size();
+	}
+	assert(graph->graph_size > 0);
+	graph->graph_file_name = file_name;
+
+	int num_nodes = params.get_num_nodes();
+	graph->init_segments(index, graph_conf.get_num_threads(), num_nodes);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"load a graph of %1% bytes in %2% segments on %3% nodes")
+		% graph->graph_size % graph->segs.size() % num_nodes;
+
+	// The segments of a node are stored contiguously in the memory
+	// of the node.
+	graph->node_bufs.resize(num_nodes, std::pair<char *, size_t>(NULL, 0));
+	std::vector<size_t> buf_sizes(num_nodes);
+	for (size_t i = 0; i < graph->segs.size(); i++) {
+		const segment &seg = graph->segs[i];
+		buf_sizes[seg.node_id] += ROUNDUP_PAGE(seg.off + seg.size)
+			- ROUND_PAGE(seg.off);
+	}
+	for (int i = 0; i < num_nodes; i++) {
+		if (buf_sizes[i] == 0)
+			continue;
+		char *buf = (char *) numa_alloc_onnode(buf_sizes[i], i);
+		if (buf == NULL)
+			throw io_exception(boost::str(boost::format(
+							"can't allocate %1% bytes on node %2%")
+						% buf_sizes[i] % i));
+		if (graph_conf.use_huge_page_graph())
+			madvise(buf, buf_sizes[i], MADV_HUGEPAGE);
+		graph->node_bufs[i] = std::pair<char *, size_t>(buf, buf_sizes[i]);
+	}
+	std::vector<char *> node_ptrs(num_nodes);
+	for (int i = 0; i < num_nodes; i++)
+		node_ptrs[i] = graph->node_bufs[i].first;
+	for (size_t i = 0; i < graph->segs.size(); i++) {
+		segment &seg = graph->segs[i];
+		seg.pages = node_ptrs[seg.node_id];
+		node_ptrs[seg.node_id] += ROUNDUP_PAGE(seg.off + seg.size)
+			- ROUND_PAGE(seg.off);
+	}
+
+	graph->parallel_load(safs_factory);
+
+	graph_header header;
+	graph->read((char *) &header, 0, sizeof(header));
+	header.verify();
+
+	return graph;
+}
+
 file_io_factory::shared_ptr in_mem_graph::create_io_factory() const
 {
 	return file_io_factory::shared_ptr(new in_mem_io_factory(*this,
@@ -20,23 +20,90 @@
  * limitations under the License.
  */
 
+#include <vector>
+
 #include "io_interface.h"
+#include "cache.h"
 
 class in_mem_io;
 class thread_safe_page;
+class vertex_index;
 
 class in_mem_graph
 {
+	/*
+	 * In the NUMA mode, the graph data is split into segments along
+	 * the boundaries of the vertex partitions, and a segment is stored
+	 * in the memory of the NUMA node whose worker threads own the vertices
+	 * in it. A segment keeps all pages that overlap with its part of
+	 * the graph file, so the data in a segment has the same page layout
+	 * as in the file.
+	 */
+	struct segment
+	{
+		off_t off;
+		size_t size;
+		int node_id;
+		// The data of the page that contains the first byte.
+		char *pages;
+	};
+
 	size_t graph_size;
 	char *graph_data;
+	// The size of the memory mapped for the graph data. It's 0 if
+	// the graph data is allocated with malloc.
+	size_t graph_map_size;
 	int graph_file_id;
 	std::string graph_file_name;
+	// The segments are sorted by their offsets.
+	std::vector<segment> segs;
+	// The memory allocated on each NUMA node to store the segments.
+	std::vector<std::pair<char *, size_t> > node_bufs;
 
 	in_mem_graph() {
 		graph_data = NULL;
 		graph_size = 0;
+		graph_map_size = 0;
 		graph_file_id = -1;
 	}
+
+	const segment &get_segment(off_t off) const;
+	void init_segments(std::shared_ptr<vertex_index> index, int num_parts,
+			int num_nodes);
+	void alloc_graph_data();
+	/*
+	 * Read the graph file to the graph data or to the segments with
+	 * many threads in parallel.
+	 */
+	void parallel_load(file_io_factory::shared_ptr safs_factory);
+
+	/*
+	 * Get the page that contains the byte at `off'. The pages behind it
+	 * are stored contiguously until `off + size'. It returns NULL if
+	 * the data is in multiple segments.
+	 */
+	const char *get_pages(off_t off, size_t size) const {
+		if (segs.empty())
+			return graph_data + ROUND_PAGE(off);
+		const segment &seg = get_segment(off);
+		if (off + (off_t) size > seg.off + (off_t) seg.size)
+			return NULL;
+		return seg.pages + (ROUND_PAGE(off) - ROUND_PAGE(seg.off));
+	}
+
+	/*
+	 * Get a single page. A segment keeps the entire pages at its both
+	 * ends, so any segment that overlaps with the page has the whole page.
+	 */
+	const char *get_page(off_t page_off) const {
+		assert(page_off == ROUND_PAGE(page_off));
+		if (segs.empty())
+			return graph_data + page_off;
+		const segment &seg = get_segment(page_off);
+		return seg.pages + (page_off - ROUND_PAGE(seg.off));
+	}
+
+	void read(char *buf, off_t off, size_t size) const;
 public:
 	typedef std::shared_ptr<in_mem_graph> ptr;
 
@@ -55,14 +122,111 @@ public:
 
 	static ptr load_graph(const std::string &graph_file);
 	static ptr load_safs_graph(const std::string &graph_file);
+	/*
+	 * Load the graph data to the memory of the NUMA nodes. The vertices are
+	 * assigned to NUMA nodes in the same way as the graph engine assigns
+	 * them to worker threads, so the index of the graph is required.
+	 */
+	static ptr load_numa_graph(const std::string &graph_file,
+			std::shared_ptr<vertex_index> index, bool safs);
 
-	~in_mem_graph() {
-		free(graph_data);
-	}
+	~in_mem_graph();
+
+	/*
+	 * Write the graph data to a file in the local filesystem.
+	 */
+	void dump(const std::string &file) const;
 
 	file_io_factory::shared_ptr create_io_factory() const;
 
 	friend class in_mem_io;
+	friend class in_mem_byte_array;
+};
+
+/*
+ * The byte array that refers to the graph data in memory directly.
+ */
+class in_mem_byte_array: public page_byte_array
+{
+	off_t off;
+	size_t size;
+	const char *pages;
+	// If the data isn't stored contiguously in memory, we have to locate
+	// every page in the graph.
+	const in_mem_graph *graph;
+
+	void assign(in_mem_byte_array &arr) {
+		this->off = arr.off;
+		this->size = arr.size;
+		this->pages = arr.pages;
+		this->graph = arr.graph;
+	}
+
+	in_mem_byte_array(in_mem_byte_array &arr) {
+		assign(arr);
+	}
+
+	in_mem_byte_array &operator=(in_mem_byte_array &arr) {
+		assign(arr);
+		return *this;
+	}
+public:
+	in_mem_byte_array(byte_array_allocator &alloc): page_byte_array(alloc) {
+		off = 0;
+		size = 0;
+		pages = NULL;
+		graph = NULL;
+	}
+
+	/*
+	 * The byte array on the data in [off, off + size) of the graph file.
+	 */
+	in_mem_byte_array(const in_mem_graph &graph, off_t off, size_t size,
+			byte_array_allocator &alloc): page_byte_array(alloc) {
+		this->off = off;
+		this->size = size;
+		// The data may be in multiple NUMA nodes if the graph engine merges
+		// the requests of vertices with small gaps between them.
+		this->pages = graph.get_pages(off, size);
+		this->graph = pages ? NULL : &graph;
+	}
+
+	/*
+	 * The allocator is only used to clone the byte arrays.
+	 */
+	static byte_array_allocator *create_allocator(thread *t);
+
+	virtual off_t get_offset() const {
+		return off;
+	}
+
+	virtual off_t get_offset_in_first_page() const {
+		return off % PAGE_SIZE;
+	}
+
+	virtual const char *get_page(int pg_idx) const {
+		if (graph)
+			return graph->get_page(ROUND_PAGE(off) + pg_idx * PAGE_SIZE);
+		return pages + pg_idx * PAGE_SIZE;
+	}
+
+	virtual size_t get_size() const {
+		return size;
+	}
+
+	void lock() {
+		ABORT_MSG("lock isn't implemented");
+	}
+
+	void unlock() {
+		ABORT_MSG("unlock isn't implemented");
+	}
+
+	page_byte_array *clone() {
+		in_mem_byte_array *arr = (in_mem_byte_array *) get_allocator().alloc();
+		*arr = *this;
+		return arr;
+	}
 };
 
 #endif
@@ -0,0 +1,78 @@
+#ifndef __ALG_UTILS_H__
+#define __ALG_UTILS_H__
+
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "graph_engine.h"
+
+/**
+ * The helpers shared by the graph algorithms.
+ */
+
+/*
+ * The finalizer of MurmurHash3. It mixes the bits of a 64-bit key, so it
+ * gives a vertex or an edge a pseudo-random value that doesn't depend on
+ * the order in which vertices are processed.
+ */
+static inline uint64_t hash64(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdUL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53UL;
+	h ^= h >> 33;
+	return h;
+}
+
+/*
+ * Get the sorted neighbors of a vertex. A neighbor appears once even if
+ * there are edges in both directions, and the vertex itself isn't included.
+ *
+ * IN_EDGE and OUT_EDGE are the same edges in an undirected vertex, so only
+ * the out-edges are read in an undirected graph. The algorithms that treat
+ * a directed graph as undirected read both kinds of edges of a directed
+ * vertex and only the out-edges of an undirected vertex in the same way.
+ */
+static inline void get_neighbors(const graph_engine &graph,
+		const page_vertex &vertex, std::vector<vertex_id_t> &neighs)
+{
+	neighs.clear();
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+	while (it.has_next())
+		neighs.push_back(it.next());
+	if (graph.is_directed()) {
+		it = vertex.get_neigh_seq_it(edge_type::IN_EDGE);
+		while (it.has_next())
+			neighs.push_back(it.next());
+		std::sort(neighs.begin(), neighs.end());
+	}
+	neighs.erase(std::unique(neighs.begin(), neighs.end()), neighs.end());
+	std::vector<vertex_id_t>::iterator self = std::lower_bound(neighs.begin(),
+			neighs.end(), vertex.get_id());
+	if (self != neighs.end() && *self == vertex.get_id())
+		neighs.erase(self);
+}
+
+#endif
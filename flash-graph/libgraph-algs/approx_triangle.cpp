@@ -0,0 +1,737 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <math.h>
+
+#include <limits>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include <boost/math/distributions/normal.hpp>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FG_vector.h"
+#include "FGlib.h"
+#include "edge_state.h"
+#include "alg_utils.h"
+
+/*
+ * This estimates transitivity and triangle counts by sampling.
+ * Edge direction is ignored.
+ *
+ * Wedge sampling: a wedge is a path of two edges, and the transitivity
+ * is the fraction of the wedges that are closed by a third edge.
+ * For the global transitivity, the wedges are sampled uniformly: the number
+ * of samples at a vertex is drawn in proportion to the number of wedges
+ * centered at it. The number of neighbors isn't known before the adjacency
+ * list is read because of duplicate edges and edges in both directions, so
+ * the number of edges is used instead, and a center rejects a sample with
+ * the probability that compensates for the difference. For the local
+ * transitivity, every vertex samples the same number of wedges, or checks
+ * all of its wedges if it doesn't have more. Only the vertices with samples
+ * are started by a vertex filter. A center sends a wedge to one of its two
+ * ends, which reads its adjacency list in the next iteration to check
+ * whether the other end is its neighbor.
+ *
+ * DOULION: every edge is kept with probability p, and the triangles in
+ * the sparsified graph are counted and scaled by 1 / p^3. Whether an edge is
+ * kept is decided by a hash of its endpoints, so both endpoints agree on it.
+ * A triangle is counted by its vertex with the smallest ID, which reads
+ * the adjacency lists of its neighbors connected by the kept edges.
+ * The variance of the estimate depends on the number of pairs of triangles
+ * that share an edge, so the triangles of every edge in the sparsified
+ * graph are counted in an edge state array.
+ */
+
+namespace {
+
+// The number of wedges sampled at a vertex.
+std::unique_ptr<std::atomic<uint32_t>[]> num_samples;
+bool local_samples;
+double edge_prob;
+uint64_t rand_seed;
+
+bool keep_edge(vertex_id_t id1, vertex_id_t id2)
+{
+	if (edge_prob >= 1)
+		return true;
+	if (id1 > id2)
+		std::swap(id1, id2);
+	uint64_t h = hash64(rand_seed ^ ((((uint64_t) id1) << 32) + id2));
+	return h < edge_prob * std::numeric_limits<uint64_t>::max();
+}
+
+/*
+ * The number of edges of a vertex, which is an upper bound of the number
+ * of its neighbors.
+ */
+size_t get_max_degree(const graph_engine &graph, vertex_id_t id)
+{
+	return graph.get_num_edges(id, graph.is_directed()
+			? edge_type::BOTH_EDGES : edge_type::OUT_EDGE);
+}
+
+double get_z(double confidence)
+{
+	boost::math::normal dist;
+	return boost::math::quantile(dist, (1 + confidence) / 2);
+}
+
+class wedge_message: public vertex_message
+{
+	vertex_id_t center;
+	vertex_id_t other;
+public:
+	/*
+	 * A center sends a wedge to one of its ends, and the query activates
+	 * the end. The end replies to the center if the wedge is closed and
+	 * the center needs to know it.
+	 */
+	wedge_message(vertex_id_t center, vertex_id_t other): vertex_message(
+			sizeof(wedge_message), true) {
+		this->center = center;
+		this->other = other;
+	}
+
+	wedge_message(): vertex_message(sizeof(wedge_message), false) {
+		this->center = INVALID_VERTEX_ID;
+		this->other = INVALID_VERTEX_ID;
+	}
+
+	bool is_reply() const {
+		return center == INVALID_VERTEX_ID;
+	}
+
+	vertex_id_t get_center() const {
+		return center;
+	}
+
+	vertex_id_t get_other() const {
+		return other;
+	}
+};
+
+class wedge_vertex: public compute_directed_vertex
+{
+	// The wedges sent by the centers: the center and the other end.
+	std::vector<std::pair<vertex_id_t, vertex_id_t> > queries;
+	uint32_t num_wedges;
+	uint32_t num_closed;
+
+	void sample_wedges(vertex_program &prog, vertex_id_t id,
+			const std::vector<vertex_id_t> &neighs);
+	void check_wedges(vertex_program &prog,
+			const std::vector<vertex_id_t> &neighs);
+public:
+	wedge_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		num_wedges = 0;
+		num_closed = 0;
+	}
+
+	float get_result() const {
+		return num_wedges > 0 ? ((float) num_closed) / num_wedges : 0;
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (num_samples[id].load(std::memory_order_relaxed) == 0
+				&& queries.empty())
+			return;
+		if (prog.get_graph().is_directed()) {
+			directed_vertex_request req(id, edge_type::BOTH_EDGES);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &, const vertex_message &msg1) {
+		const wedge_message &msg = (const wedge_message &) msg1;
+		if (msg.is_reply())
+			num_closed++;
+		else
+			queries.push_back(std::pair<vertex_id_t, vertex_id_t>(
+						msg.get_center(), msg.get_other()));
+	}
+};
+
+class wedge_vertex_program: public vertex_program_impl<wedge_vertex>
+{
+	std::mt19937 gen;
+	std::vector<vertex_id_t> neighs;
+	size_t num_accepted;
+	size_t num_closed;
+public:
+	typedef std::shared_ptr<wedge_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<wedge_vertex_program, vertex_program>(
+				prog);
+	}
+
+	wedge_vertex_program(unsigned seed): gen(seed) {
+		num_accepted = 0;
+		num_closed = 0;
+	}
+
+	double rand_real() {
+		return std::uniform_real_distribution<double>(0, 1)(gen);
+	}
+
+	size_t rand_index(size_t num) {
+		return std::uniform_int_distribution<size_t>(0, num - 1)(gen);
+	}
+
+	std::vector<vertex_id_t> &get_neigh_buf() {
+		return neighs;
+	}
+
+	void add_accepted() {
+		num_accepted++;
+	}
+
+	void add_closed() {
+		num_closed++;
+	}
+
+	size_t get_num_accepted() const {
+		return num_accepted;
+	}
+
+	size_t get_num_closed() const {
+		return num_closed;
+	}
+};
+
+class wedge_vertex_program_creater: public vertex_program_creater
+{
+	mutable unsigned seed;
+public:
+	wedge_vertex_program_creater(unsigned seed) {
+		this->seed = seed;
+	}
+
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new wedge_vertex_program(seed++));
+	}
+};
+
+class sampled_filter: public vertex_filter
+{
+public:
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		return num_samples[prog.get_vertex_id(v)].load(
+				std::memory_order_relaxed) > 0;
+	}
+};
+
+void wedge_vertex::sample_wedges(vertex_program &prog, vertex_id_t id,
+		const std::vector<vertex_id_t> &neighs)
+{
+	wedge_vertex_program &wprog = (wedge_vertex_program &) prog;
+	uint32_t num = num_samples[id].load(std::memory_order_relaxed);
+	num_samples[id].store(0, std::memory_order_relaxed);
+	size_t num_neighs = neighs.size();
+	if (num_neighs < 2)
+		return;
+
+	size_t max_wedges = num_neighs * (num_neighs - 1) / 2;
+	if (local_samples && max_wedges <= num) {
+		num_wedges = max_wedges;
+		for (size_t i = 0; i < num_neighs; i++) {
+			for (size_t j = i + 1; j < num_neighs; j++) {
+				wedge_message msg(id, neighs[j]);
+				prog.send_msg(neighs[i], msg);
+			}
+		}
+		return;
+	}
+
+	// Reject samples in global sampling, so every wedge in the graph is
+	// sampled with the same probability.
+	double accept = 1;
+	if (!local_samples) {
+		size_t max_degree = get_max_degree(prog.get_graph(), id);
+		accept = ((double) num_neighs * (num_neighs - 1))
+			/ ((double) max_degree * (max_degree - 1));
+	}
+	for (uint32_t i = 0; i < num; i++) {
+		if (accept < 1 && wprog.rand_real() >= accept)
+			continue;
+		size_t idx1 = wprog.rand_index(num_neighs);
+		size_t idx2 = wprog.rand_index(num_neighs - 1);
+		if (idx2 >= idx1)
+			idx2++;
+		num_wedges++;
+		wprog.add_accepted();
+		wedge_message msg(id, neighs[idx2]);
+		prog.send_msg(neighs[idx1], msg);
+	}
+}
+
+void wedge_vertex::check_wedges(vertex_program &prog,
+		const std::vector<vertex_id_t> &neighs)
+{
+	wedge_vertex_program &wprog = (wedge_vertex_program &) prog;
+	for (size_t i = 0; i < queries.size(); i++) {
+		if (!std::binary_search(neighs.begin(), neighs.end(),
+					queries[i].second))
+			continue;
+		if (local_samples) {
+			wedge_message reply;
+			prog.send_msg(queries[i].first, reply);
+		}
+		else
+			wprog.add_closed();
+	}
+	std::vector<std::pair<vertex_id_t, vertex_id_t> >().swap(queries);
+}
+
+void wedge_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	std::vector<vertex_id_t> &neighs
+		= ((wedge_vertex_program &) prog).get_neigh_buf();
+	get_neighbors(prog.get_graph(), vertex, neighs);
+	// The centers only sample in the first iteration, and the wedges are
+	// checked in the next iteration.
+	vertex_id_t id = vertex.get_id();
+	if (num_samples[id].load(std::memory_order_relaxed) > 0)
+		sample_wedges(prog, id, neighs);
+	else
+		check_wedges(prog, neighs);
+}
+
+typedef std::pair<vertex_id_t, size_t> neigh_loc_t;
+
+// The number of triangles that contain an edge in the sparsified graph.
+// An edge is counted in the adjacency list of the endpoint with
+// the smaller ID.
+edge_state_array<std::atomic<uint32_t> >::ptr edge_triangles;
+
+bool neigh_less(const neigh_loc_t &n1, const neigh_loc_t &n2)
+{
+	return n1.first < n2.first;
+}
+
+bool neigh_eq(const neigh_loc_t &n1, const neigh_loc_t &n2)
+{
+	return n1.first == n2.first;
+}
+
+void add_neighbor_locs(const page_vertex &vertex, edge_type type,
+		std::vector<neigh_loc_t> &neighs)
+{
+	vertex_id_t id = vertex.get_id();
+	size_t loc = edge_triangles->get_begin(id, type);
+	edge_seq_iterator it = vertex.get_neigh_seq_it(type);
+	while (it.has_next()) {
+		vertex_id_t neigh = it.next();
+		if (neigh != id)
+			neighs.push_back(neigh_loc_t(neigh, loc));
+		loc++;
+	}
+}
+
+/*
+ * Get the sorted neighbors of a vertex and the locations of the edges to
+ * them. If there are multiple edges to a neighbor, the first out-edge is
+ * used, so the location of an edge is the same wherever it's looked up.
+ */
+void get_neighbor_locs(const graph_engine &graph, const page_vertex &vertex,
+		std::vector<neigh_loc_t> &neighs)
+{
+	neighs.clear();
+	add_neighbor_locs(vertex, edge_type::OUT_EDGE, neighs);
+	if (graph.is_directed()) {
+		size_t num_out = neighs.size();
+		add_neighbor_locs(vertex, edge_type::IN_EDGE, neighs);
+		std::inplace_merge(neighs.begin(), neighs.begin() + num_out,
+				neighs.end(), neigh_less);
+	}
+	neighs.erase(std::unique(neighs.begin(), neighs.end(), neigh_eq),
+			neighs.end());
+}
+
+class doulion_vertex: public compute_directed_vertex
+{
+	// The neighbors with larger IDs connected by the kept edges.
+	std::vector<neigh_loc_t> kept_neighs;
+
+	void count_triangles(vertex_program &prog, const page_vertex &vertex);
+public:
+	doulion_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (prog.get_graph().is_directed()) {
+			directed_vertex_request req(id, edge_type::BOTH_EDGES);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &, const vertex_message &) {
+	}
+};
+
+class doulion_vertex_program: public vertex_program_impl<doulion_vertex>
+{
+	std::vector<neigh_loc_t> neighs;
+	size_t num_triangles;
+public:
+	typedef std::shared_ptr<doulion_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<doulion_vertex_program, vertex_program>(
+				prog);
+	}
+
+	doulion_vertex_program() {
+		num_triangles = 0;
+	}
+
+	std::vector<neigh_loc_t> &get_neigh_buf() {
+		return neighs;
+	}
+
+	void add_triangles(size_t num) {
+		num_triangles += num;
+	}
+
+	size_t get_num_triangles() const {
+		return num_triangles;
+	}
+};
+
+class doulion_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new doulion_vertex_program());
+	}
+};
+
+class degree_filter: public vertex_filter
+{
+public:
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		return get_max_degree(prog.get_graph(), prog.get_vertex_id(v)) >= 2;
+	}
+};
+
+void doulion_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	if (vertex.get_id() != id) {
+		count_triangles(prog, vertex);
+		return;
+	}
+
+	std::vector<neigh_loc_t> &neighs
+		= ((doulion_vertex_program &) prog).get_neigh_buf();
+	get_neighbor_locs(prog.get_graph(), vertex, neighs);
+	for (size_t i = 0; i < neighs.size(); i++)
+		if (neighs[i].first > id && keep_edge(id, neighs[i].first))
+			kept_neighs.push_back(neighs[i]);
+	if (kept_neighs.size() < 2) {
+		std::vector<neigh_loc_t>().swap(kept_neighs);
+		return;
+	}
+
+	// The neighbor with the largest ID doesn't have a larger neighbor
+	// in the list.
+	size_t num_reqs = kept_neighs.size() - 1;
+	if (prog.get_graph().is_directed()) {
+		std::vector<directed_vertex_request> reqs(num_reqs);
+		for (size_t i = 0; i < num_reqs; i++)
+			reqs[i] = directed_vertex_request(kept_neighs[i].first,
+					edge_type::BOTH_EDGES);
+		request_partial_vertices(reqs.data(), num_reqs);
+	}
+	else {
+		std::vector<vertex_id_t> ids(num_reqs);
+		for (size_t i = 0; i < num_reqs; i++)
+			ids[i] = kept_neighs[i].first;
+		request_vertices(ids.data(), num_reqs);
+	}
+}
+
+/*
+ * Count the triangles of the vertex, its neighbor and a common neighbor
+ * with a larger ID than the neighbor.
+ */
+void doulion_vertex::count_triangles(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	doulion_vertex_program &dprog = (doulion_vertex_program &) prog;
+	std::vector<neigh_loc_t> &neighs = dprog.get_neigh_buf();
+	get_neighbor_locs(prog.get_graph(), vertex, neighs);
+	vertex_id_t neigh_id = vertex.get_id();
+	neigh_loc_t key(neigh_id, 0);
+	std::vector<neigh_loc_t>::const_iterator neigh_it = std::lower_bound(
+			kept_neighs.begin(), kept_neighs.end(), key, neigh_less);
+	assert(neigh_it != kept_neighs.end() && neigh_it->first == neigh_id);
+	std::vector<neigh_loc_t>::const_iterator it = neigh_it + 1;
+	std::vector<neigh_loc_t>::const_iterator it2 = std::upper_bound(
+			neighs.begin(), neighs.end(), key, neigh_less);
+	size_t num = 0;
+	while (it != kept_neighs.end() && it2 != neighs.end()) {
+		if (it->first < it2->first)
+			it++;
+		else if (it2->first < it->first)
+			it2++;
+		else {
+			if (keep_edge(neigh_id, it2->first)) {
+				num++;
+				edge_triangles->get(neigh_it->second).fetch_add(1);
+				edge_triangles->get(it->second).fetch_add(1);
+				edge_triangles->get(it2->second).fetch_add(1);
+			}
+			it++;
+			it2++;
+		}
+	}
+	dprog.add_triangles(num);
+}
+
+void start_profiler()
+{
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+}
+
+void stop_profiler()
+{
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+}
+
+void run_wedge_sampling(graph_engine::ptr graph)
+{
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	start_profiler();
+	graph->start(std::shared_ptr<vertex_filter>(new sampled_filter()),
+			vertex_program_creater::ptr(
+				new wedge_vertex_program_creater(rand_seed)));
+	graph->wait4complete();
+	stop_profiler();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"wedge sampling takes %1% seconds") % time_diff(start, end);
+	num_samples.reset();
+}
+
+void init_samples(size_t num_vertices)
+{
+	num_samples = std::unique_ptr<std::atomic<uint32_t>[]>(
+			new std::atomic<uint32_t>[num_vertices]);
+#pragma omp parallel for
+	for (size_t i = 0; i < num_vertices; i++)
+		num_samples[i].store(0, std::memory_order_relaxed);
+}
+
+}
+
+#include "save_result.h"
+
+approx_estimate estimate_transitivity(FG_graph::ptr fg, size_t num_wedges,
+		double confidence)
+{
+	approx_estimate ret = {0, 0, 0};
+	graph_index::ptr index = NUMA_graph_index<wedge_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	size_t num_vertices = graph->get_num_vertices();
+	rand_seed = time(NULL);
+	local_samples = false;
+
+	// The wedges of a vertex are at the locations between its offset and
+	// the offset of the next vertex.
+	std::vector<size_t> wedge_offs(num_vertices + 1);
+	wedge_offs[0] = 0;
+#pragma omp parallel for
+	for (size_t i = 0; i < num_vertices; i++) {
+		size_t degree = get_max_degree(*graph, i);
+		wedge_offs[i + 1] = degree * (degree - std::min(degree, 1UL)) / 2;
+	}
+	for (size_t i = 0; i < num_vertices; i++)
+		wedge_offs[i + 1] += wedge_offs[i];
+	size_t max_num_wedges = wedge_offs.back();
+	if (max_num_wedges == 0 || num_wedges == 0) {
+		BOOST_LOG_TRIVIAL(error) << "there aren't wedges to sample";
+		return ret;
+	}
+
+	init_samples(num_vertices);
+	std::mt19937_64 gen(rand_seed);
+	std::uniform_int_distribution<size_t> dist(0, max_num_wedges - 1);
+	for (size_t i = 0; i < num_wedges; i++) {
+		size_t loc = dist(gen);
+		size_t id = std::upper_bound(wedge_offs.begin(), wedge_offs.end(),
+				loc) - wedge_offs.begin() - 1;
+		num_samples[id].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"wedge sampling starts with %1% samples and seed %2%")
+		% num_wedges % rand_seed;
+	run_wedge_sampling(graph);
+
+	size_t num_accepted = 0;
+	size_t num_closed = 0;
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		wedge_vertex_program::ptr wprog = wedge_vertex_program::cast2(vprog);
+		num_accepted += wprog->get_num_accepted();
+		num_closed += wprog->get_num_closed();
+	}
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"%1% wedges are accepted, and %2% of them are closed")
+		% num_accepted % num_closed;
+	if (num_accepted == 0)
+		return ret;
+
+	// The Wilson score interval of a binomial proportion.
+	double n = num_accepted;
+	double z = get_z(confidence);
+	double p = num_closed / n;
+	double denom = 1 + z * z / n;
+	double center = (p + z * z / (2 * n)) / denom;
+	double half = z * sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / denom;
+	ret.estimate = p;
+	ret.lower = std::max(0.0, center - half);
+	ret.upper = std::min(1.0, center + half);
+	return ret;
+}
+
+FG_vector<float>::ptr estimate_local_transitivity(FG_graph::ptr fg,
+		size_t num_wedges)
+{
+	graph_index::ptr index = NUMA_graph_index<wedge_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	size_t num_vertices = graph->get_num_vertices();
+	rand_seed = time(NULL);
+	local_samples = true;
+
+	uint32_t num = std::min(num_wedges,
+			(size_t) std::numeric_limits<uint32_t>::max());
+	init_samples(num_vertices);
+#pragma omp parallel for
+	for (size_t i = 0; i < num_vertices; i++)
+		if (get_max_degree(*graph, i) >= 2)
+			num_samples[i].store(num, std::memory_order_relaxed);
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"local wedge sampling starts with %1% samples per vertex and seed %2%")
+		% num % rand_seed;
+	run_wedge_sampling(graph);
+
+	FG_vector<float>::ptr vec = FG_vector<float>::create(graph);
+	graph->query_on_all(vertex_query::ptr(
+				new save_query<float, wedge_vertex>(vec)));
+	return vec;
+}
+
+approx_estimate estimate_triangles(FG_graph::ptr fg, double prob,
+		double confidence)
+{
+	approx_estimate ret = {0, 0, 0};
+	if (prob <= 0 || prob > 1) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"the edge probability %1% isn't in (0, 1]") % prob;
+		return ret;
+	}
+
+	graph_index::ptr index = NUMA_graph_index<doulion_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	rand_seed = time(NULL);
+	edge_prob = prob;
+	edge_triangles = edge_state_array<std::atomic<uint32_t> >::create(*graph,
+			edge_type::BOTH_EDGES);
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"DOULION starts with edge probability %1% and seed %2%")
+		% prob % rand_seed;
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	start_profiler();
+	graph->start(std::shared_ptr<vertex_filter>(new degree_filter()),
+			vertex_program_creater::ptr(new doulion_vertex_program_creater()));
+	graph->wait4complete();
+	stop_profiler();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"DOULION takes %1% seconds") % time_diff(start, end);
+
+	size_t num_triangles = 0;
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs)
+		num_triangles += doulion_vertex_program::cast2(vprog)->get_num_triangles();
+
+	// The number of pairs of triangles that share an edge.
+	size_t num_pairs = 0;
+#pragma omp parallel for reduction(+:num_pairs)
+	for (int i = 0; i < edge_triangles->get_num_parts(); i++) {
+		size_t end = edge_triangles->get_part_end(i);
+		for (size_t loc = edge_triangles->get_part_begin(i); loc < end; loc++) {
+			size_t num = edge_triangles->get(loc).load();
+			num_pairs += num * (num - std::min(num, 1UL)) / 2;
+		}
+	}
+	edge_triangles.reset();
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"the sparsified graph has %1% triangles and %2% pairs of triangles sharing edges")
+		% num_triangles % num_pairs;
+
+	// A triangle is kept with probability p^3, and two triangles that share
+	// an edge are both kept with probability p^5. The variance of
+	// the estimate is T (1 / p^3 - 1) + 2 K (1 / p - 1), where T and K are
+	// estimated from the numbers of triangles and pairs in the sparsified
+	// graph.
+	double p3 = prob * prob * prob;
+	double p5 = p3 * prob * prob;
+	double est = num_triangles / p3;
+	double var = est * (1 / p3 - 1) + 2 * (num_pairs / p5) * (1 / prob - 1);
+	double half = get_z(confidence) * sqrt(var);
+	ret.estimate = est;
+	ret.lower = std::max(0.0, est - half);
+	ret.upper = est + half;
+	return ret;
+}
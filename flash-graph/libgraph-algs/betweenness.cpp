@@ -0,0 +1,541 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <limits>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FG_vector.h"
+#include "FGlib.h"
+
+/*
+ * This computes betweenness centrality with Brandes' algorithm. The sources
+ * are processed in batches of up to 64, and each batch runs the graph
+ * engine twice:
+ *
+ * In the forward phase, the BFS of all sources in the batch run together.
+ * A vertex in the frontier of some BFS reads its edge list once and sends
+ * a single message with its number of shortest paths (sigma) for each of
+ * these BFS to its neighbors.
+ *
+ * In the backward phase, the vertices run in the decreasing order of
+ * their depth. A vertex at depth `d' of some BFS sends (1 + delta) / sigma
+ * of these BFS to its predecessors, which accumulate their dependency
+ * (delta). A custom vertex scheduler keeps the vertices in buckets of
+ * depths, so a vertex that is at different depths in different BFS
+ * runs once for each depth.
+ *
+ * The depth, sigma and delta of all BFS in a batch are stored in arrays
+ * indexed by the vertex ID and the BFS ID, instead of in the vertices.
+ * They are allocated once and reused by all batches.
+ */
+
+namespace {
+
+const int MAX_BATCH_SIZE = 64;
+const uint32_t UNVISITED = std::numeric_limits<uint32_t>::max();
+
+enum bc_phase_type
+{
+	FORWARD,
+	BACKWARD,
+};
+
+bc_phase_type bc_phase;
+bool directed_graph;
+int batch_size;
+// The largest depth of the BFS in the current batch.
+uint32_t batch_max_depth;
+double bc_scale;
+
+std::unique_ptr<uint32_t[]> depths;
+std::unique_ptr<double[]> sigmas;
+std::unique_ptr<double[]> deltas;
+
+size_t get_state_idx(vertex_id_t id, int bfs_id)
+{
+	return ((size_t) id) * batch_size + bfs_id;
+}
+
+/*
+ * The message carries a value for each BFS in `bfs_ids'. It only has
+ * room for the values in the message, so its size varies.
+ */
+class bc_message: public vertex_message
+{
+	uint64_t bfs_ids;
+	uint32_t depth;
+	double vals[0];
+
+	bc_message(uint64_t bfs_ids, uint32_t depth, bool activate): vertex_message(
+			get_msg_size(bfs_ids), activate) {
+		this->bfs_ids = bfs_ids;
+		this->depth = depth;
+	}
+public:
+	static size_t get_msg_size(uint64_t bfs_ids) {
+		return sizeof(bc_message) + __builtin_popcountl(bfs_ids) * sizeof(double);
+	}
+
+	/*
+	 * Construct a message in the buffer. The buffer has to be large
+	 * enough to keep the values of all BFS in `bfs_ids'.
+	 */
+	static bc_message *create(void *buf, uint64_t bfs_ids, uint32_t depth,
+			bool activate) {
+		return new (buf) bc_message(bfs_ids, depth, activate);
+	}
+
+	uint64_t get_bfs_ids() const {
+		return bfs_ids;
+	}
+
+	// The depth of the sender.
+	uint32_t get_depth() const {
+		return depth;
+	}
+
+	double *get_vals() {
+		return vals;
+	}
+
+	const double *get_vals() const {
+		return vals;
+	}
+};
+
+// The buffer large enough for a message of all BFS in a batch.
+const size_t MSG_BUF_WORDS = (sizeof(bc_message)
+		+ MAX_BATCH_SIZE * sizeof(double)) / sizeof(uint64_t) + 1;
+
+class bc_vertex: public compute_directed_vertex
+{
+	// The BFS that reached the vertex in the previous level.
+	uint64_t frontier;
+	// The BFS that reach the vertex in the current level.
+	uint64_t next;
+	// The depth the vertex runs at in the backward phase.
+	uint32_t back_depth;
+	double bc;
+
+	void run_forward(vertex_program &prog, const page_vertex &vertex);
+	void run_backward(vertex_program &prog, const page_vertex &vertex);
+	void forward_msg(vertex_program &prog, const bc_message &msg);
+	void backward_msg(vertex_program &prog, const bc_message &msg);
+public:
+	bc_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		frontier = 0;
+		next = 0;
+		back_depth = 0;
+		bc = 0;
+	}
+
+	void init_frontier(uint64_t frontier) {
+		this->frontier = frontier;
+		this->next = 0;
+	}
+
+	void set_back_depth(uint32_t depth) {
+		back_depth = depth;
+	}
+
+	double get_result() const {
+		return bc * bc_scale;
+	}
+
+	void run(vertex_program &prog);
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		if (bc_phase == FORWARD)
+			run_forward(prog, vertex);
+		else
+			run_backward(prog, vertex);
+	}
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg1) {
+		const bc_message &msg = (const bc_message &) msg1;
+		if (bc_phase == FORWARD)
+			forward_msg(prog, msg);
+		else
+			backward_msg(prog, msg);
+	}
+
+	void notify_iteration_end(vertex_program &prog) {
+		frontier = next;
+		next = 0;
+	}
+};
+
+class bc_vertex_program: public vertex_program_impl<bc_vertex>
+{
+	// The largest depth of the vertices owned by this thread in
+	// the forward phase.
+	uint32_t max_depth;
+	// The vertices owned by this thread in the buckets of their depths
+	// in the backward phase.
+	std::vector<std::vector<compute_vertex_pointer> > buckets;
+	uint32_t curr_depth;
+	bool first_level;
+public:
+	typedef std::shared_ptr<bc_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<bc_vertex_program, vertex_program>(
+				prog);
+	}
+
+	bc_vertex_program() {
+		max_depth = 0;
+		curr_depth = 0;
+		first_level = true;
+	}
+
+	void update_max_depth(uint32_t depth) {
+		max_depth = std::max(max_depth, depth);
+	}
+
+	uint32_t get_max_depth() const {
+		return max_depth;
+	}
+
+	void schedule(std::vector<compute_vertex_pointer> &vertices);
+};
+
+void bc_vertex_program::schedule(std::vector<compute_vertex_pointer> &vertices)
+{
+	// The first level gets all vertices reached by the BFS. A vertex is
+	// added to the bucket of each depth it has.
+	if (first_level) {
+		first_level = false;
+		curr_depth = batch_max_depth;
+		buckets.resize(curr_depth + 1);
+		BOOST_FOREACH(compute_vertex_pointer v, vertices) {
+			vertex_id_t id = get_vertex_id(v);
+			for (int i = 0; i < batch_size; i++) {
+				uint32_t depth = depths[get_state_idx(id, i)];
+				if (depth == UNVISITED || depth == 0)
+					continue;
+				if (buckets[depth].empty()
+						|| buckets[depth].back().get() != v.get())
+					buckets[depth].push_back(v);
+			}
+		}
+	}
+
+	// The vertices were added in the order of their IDs, so each bucket
+	// is still sorted. The sources at depth 0 don't need to run.
+	vertices.clear();
+	if (curr_depth == 0)
+		return;
+	BOOST_FOREACH(compute_vertex_pointer v, buckets[curr_depth]) {
+		((bc_vertex &) *v.get()).set_back_depth(curr_depth);
+	}
+	vertices.swap(buckets[curr_depth]);
+	std::vector<compute_vertex_pointer>().swap(buckets[curr_depth]);
+	curr_depth--;
+}
+
+class bc_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new bc_vertex_program());
+	}
+};
+
+class depth_scheduler: public vertex_scheduler
+{
+public:
+	void schedule(vertex_program &prog,
+			std::vector<compute_vertex_pointer> &vertices) {
+		((bc_vertex_program &) prog).schedule(vertices);
+	}
+};
+
+void bc_vertex::run(vertex_program &prog)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	if (bc_phase == FORWARD) {
+		if (frontier == 0)
+			return;
+		if (directed_graph) {
+			directed_vertex_request req(id, edge_type::OUT_EDGE);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+		return;
+	}
+
+	// The dependencies of the vertex at this depth are complete now.
+	for (int i = 0; i < batch_size; i++) {
+		size_t idx = get_state_idx(id, i);
+		if (depths[idx] == back_depth)
+			bc += deltas[idx];
+	}
+	if (directed_graph) {
+		directed_vertex_request req(id, edge_type::IN_EDGE);
+		request_partial_vertices(&req, 1);
+	}
+	else
+		request_vertices(&id, 1);
+}
+
+void bc_vertex::run_forward(vertex_program &prog, const page_vertex &vertex)
+{
+	vertex_id_t id = vertex.get_id();
+	uint64_t buf[MSG_BUF_WORDS];
+	// All BFS in the frontier reached the vertex at the same depth.
+	uint32_t depth = depths[get_state_idx(id, __builtin_ctzl(frontier))];
+	bc_message *msg = bc_message::create(buf, frontier, depth, true);
+	double *vals = msg->get_vals();
+	for (uint64_t ids = frontier; ids; ids &= ids - 1)
+		*vals++ = sigmas[get_state_idx(id, __builtin_ctzl(ids))];
+
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+	prog.multicast_msg(it, *msg);
+}
+
+void bc_vertex::run_backward(vertex_program &prog, const page_vertex &vertex)
+{
+	vertex_id_t id = vertex.get_id();
+	uint64_t bfs_ids = 0;
+	for (int i = 0; i < batch_size; i++) {
+		if (depths[get_state_idx(id, i)] == back_depth)
+			bfs_ids |= 1UL << i;
+	}
+	uint64_t buf[MSG_BUF_WORDS];
+	bc_message *msg = bc_message::create(buf, bfs_ids, back_depth, false);
+	double *vals = msg->get_vals();
+	for (uint64_t ids = bfs_ids; ids; ids &= ids - 1) {
+		size_t idx = get_state_idx(id, __builtin_ctzl(ids));
+		*vals++ = (1 + deltas[idx]) / sigmas[idx];
+	}
+
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::IN_EDGE);
+	prog.multicast_msg(it, *msg);
+}
+
+void bc_vertex::forward_msg(vertex_program &prog, const bc_message &msg)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	uint32_t depth = msg.get_depth() + 1;
+	const double *vals = msg.get_vals();
+	for (uint64_t ids = msg.get_bfs_ids(); ids; ids &= ids - 1, vals++) {
+		int bfs_id = __builtin_ctzl(ids);
+		size_t idx = get_state_idx(id, bfs_id);
+		if (depths[idx] == UNVISITED) {
+			depths[idx] = depth;
+			sigmas[idx] = *vals;
+			next |= 1UL << bfs_id;
+		}
+		else if (depths[idx] == depth)
+			sigmas[idx] += *vals;
+	}
+	if (next)
+		((bc_vertex_program &) prog).update_max_depth(depth);
+	// The vertex is activated by the message, so its frontier has to be
+	// updated even if no new BFS reaches it.
+	prog.request_notify_iter_end(*this);
+}
+
+void bc_vertex::backward_msg(vertex_program &prog, const bc_message &msg)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	// Only the predecessors in the BFS accumulate the dependency.
+	uint32_t depth = msg.get_depth() - 1;
+	const double *vals = msg.get_vals();
+	for (uint64_t ids = msg.get_bfs_ids(); ids; ids &= ids - 1, vals++) {
+		size_t idx = get_state_idx(id, __builtin_ctzl(ids));
+		if (depths[idx] == depth)
+			deltas[idx] += sigmas[idx] * *vals;
+	}
+}
+
+class source_initializer: public vertex_initializer
+{
+	graph_engine &graph;
+public:
+	source_initializer(graph_engine &_graph): graph(_graph) {
+	}
+
+	void init(compute_vertex &v) {
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		uint64_t frontier = 0;
+		for (int i = 0; i < batch_size; i++) {
+			if (depths[get_state_idx(id, i)] == 0)
+				frontier |= 1UL << i;
+		}
+		((bc_vertex &) v).init_frontier(frontier);
+	}
+};
+
+class reached_filter: public vertex_filter
+{
+public:
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		vertex_id_t id = prog.get_vertex_id(v);
+		for (int i = 0; i < batch_size; i++) {
+			uint32_t depth = depths[get_state_idx(id, i)];
+			if (depth != UNVISITED && depth > 0)
+				return true;
+		}
+		return false;
+	}
+};
+
+void run_batch(graph_engine::ptr graph, const vertex_id_t sources[],
+		int num_sources)
+{
+	size_t num_entries = graph->get_num_vertices() * batch_size;
+#pragma omp parallel for
+	for (size_t i = 0; i < num_entries; i++) {
+		depths[i] = UNVISITED;
+		sigmas[i] = 0;
+		deltas[i] = 0;
+	}
+	for (int i = 0; i < num_sources; i++) {
+		size_t idx = get_state_idx(sources[i], i);
+		depths[idx] = 0;
+		sigmas[idx] = 1;
+	}
+
+	bc_phase = FORWARD;
+	graph->set_vertex_scheduler(vertex_scheduler::ptr());
+	graph->start(sources, num_sources, vertex_initializer::ptr(
+				new source_initializer(*graph)), vertex_program_creater::ptr(
+				new bc_vertex_program_creater()));
+	graph->wait4complete();
+
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	batch_max_depth = 0;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		batch_max_depth = std::max(batch_max_depth,
+				bc_vertex_program::cast2(vprog)->get_max_depth());
+	}
+	// No source has edges.
+	if (batch_max_depth == 0)
+		return;
+
+	bc_phase = BACKWARD;
+	graph->set_vertex_scheduler(vertex_scheduler::ptr(new depth_scheduler()));
+	graph->start(std::shared_ptr<vertex_filter>(new reached_filter()),
+			vertex_program_creater::ptr(new bc_vertex_program_creater()));
+	graph->wait4complete();
+}
+
+/*
+ * Sample distinct vertices uniformly at random.
+ */
+void sample_sources(size_t num_vertices, size_t num_samples,
+		std::vector<vertex_id_t> &sources)
+{
+	std::unordered_set<vertex_id_t> sampled;
+	while (sampled.size() < num_samples) {
+		size_t r = (((size_t) random()) << 31) | random();
+		sampled.insert(r % num_vertices);
+	}
+	sources.assign(sampled.begin(), sampled.end());
+	std::sort(sources.begin(), sources.end());
+}
+
+}
+
+#include "save_result.h"
+
+FG_vector<double>::ptr compute_betweenness(FG_graph::ptr fg,
+		size_t num_samples, int batch)
+{
+	if (batch <= 0 || batch > MAX_BATCH_SIZE) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"the batch size has to be between 1 and %1%") % MAX_BATCH_SIZE;
+		return FG_vector<double>::ptr();
+	}
+	graph_index::ptr index = NUMA_graph_index<bc_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	directed_graph = fg->get_graph_header().is_directed_graph();
+	batch_size = batch;
+
+	size_t num_vertices = graph->get_num_vertices();
+	std::vector<vertex_id_t> sources;
+	if (num_samples == 0 || num_samples >= num_vertices) {
+		// A vertex without out-edges doesn't contribute to betweenness
+		// as a source.
+		for (vertex_id_t id = 0; id < num_vertices; id++) {
+			if (graph->get_num_edges(id, edge_type::OUT_EDGE) > 0)
+				sources.push_back(id);
+		}
+		bc_scale = 1;
+	}
+	else {
+		sample_sources(num_vertices, num_samples, sources);
+		bc_scale = ((double) num_vertices) / num_samples;
+	}
+	// Each pair of vertices is counted twice in an undirected graph.
+	if (!directed_graph)
+		bc_scale /= 2;
+
+	size_t num_entries = num_vertices * batch_size;
+	depths = std::unique_ptr<uint32_t[]>(new uint32_t[num_entries]);
+	sigmas = std::unique_ptr<double[]>(new double[num_entries]);
+	deltas = std::unique_ptr<double[]>(new double[num_entries]);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"betweenness from %1% sources in batches of %2% uses %3%MB for the BFS states")
+		% sources.size() % batch_size % (num_entries * (sizeof(uint32_t)
+					+ 2 * sizeof(double)) / 1024 / 1024);
+
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	for (size_t i = 0; i < sources.size(); i += batch_size) {
+		int num = std::min(sources.size() - i, (size_t) batch_size);
+		run_batch(graph, &sources[i], num);
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"%1% sources are done, the max depth of the last batch is %2%")
+			% (i + num) % batch_max_depth;
+	}
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"betweenness takes %1% seconds") % time_diff(start, end);
+
+	depths.reset();
+	sigmas.reset();
+	deltas.reset();
+
+	FG_vector<double>::ptr vec = FG_vector<double>::create(graph);
+	graph->query_on_all(vertex_query::ptr(
+				new save_query<double, bc_vertex>(vec)));
+	return vec;
+}
@@ -0,0 +1,437 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <vector>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "bitmap.h"
+#include "FG_vector.h"
+#include "FGlib.h"
+
+/*
+ * This is the direction-optimizing BFS. A level is expanded in one of
+ * the two directions:
+ *	top-down (push): the vertices in the frontier read their edges in
+ *		the traversal direction and activate the neighbors that haven't
+ *		been visited.
+ *	bottom-up (pull): all vertices that haven't been visited read their
+ *		edges in the opposite direction and stop at the first neighbor
+ *		that has been visited.
+ * Top-down expands many levels in a single run of the graph engine.
+ * It stops once the edges of the frontier exceed a fraction of all edges
+ * in the graph. Each bottom-up level runs the graph engine once. We switch
+ * back to top-down when the frontier becomes small.
+ */
+
+namespace {
+
+/*
+ * Switch to bottom-up when the number of edges in the frontier exceeds
+ * 1/ALPHA of the edges in the graph. Switch back to top-down when
+ * the number of vertices in the frontier falls under 1/BETA of the vertices
+ * in the graph.
+ */
+const size_t ALPHA = 15;
+const size_t BETA = 20;
+
+edge_type push_edge = edge_type::OUT_EDGE;
+edge_type pull_edge = edge_type::IN_EDGE;
+bool directed_graph = true;
+
+std::unique_ptr<thread_safe_bitmap> visited;
+bool pull_mode = false;
+// The maximal number of edges in the frontier processed top-down.
+size_t max_push_edges;
+// The engine level and the BFS depth when the current run starts.
+int start_level;
+int start_depth;
+
+class bfs_vertex: public compute_directed_vertex
+{
+	int depth;
+
+	void request_edges(vertex_id_t id, edge_type type) {
+		if (directed_graph) {
+			directed_vertex_request req(id, type);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run_push(vertex_program &prog, const page_vertex &vertex);
+	void run_pull(vertex_program &prog, const page_vertex &vertex);
+public:
+	bfs_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		depth = -1;
+	}
+
+	int get_result() const {
+		return depth;
+	}
+
+	void run(vertex_program &prog);
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		if (pull_mode)
+			run_pull(prog, vertex);
+		else
+			run_push(prog, vertex);
+	}
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+	}
+};
+
+/*
+ * The number of vertices and edges in the frontier of a level.
+ */
+struct frontier_stat
+{
+	int level;
+	size_t num_vertices;
+	size_t num_edges;
+
+	frontier_stat() {
+		level = -1;
+		num_vertices = 0;
+		num_edges = 0;
+	}
+};
+
+class bfs_vertex_program: public vertex_program_impl<bfs_vertex>
+{
+	// The frontier discovered by this thread in the current and the next
+	// level when we traverse top-down. They are read by all threads at
+	// the beginning of the next level to decide whether to switch to
+	// bottom-up, so there aren't conflicts between the readers and
+	// the writer.
+	frontier_stat stats[2];
+	int checked_level;
+	bool switch_pull;
+
+	// The frontier returned to compute_bfs() when the engine stops.
+	std::vector<vertex_id_t> frontier;
+	size_t frontier_edges;
+	int frontier_depth;
+public:
+	typedef std::shared_ptr<bfs_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<bfs_vertex_program, vertex_program>(
+				prog);
+	}
+
+	bfs_vertex_program() {
+		checked_level = -1;
+		switch_pull = false;
+		frontier_edges = 0;
+		frontier_depth = -1;
+	}
+
+	void add_next_frontier(vertex_id_t id, int level) {
+		frontier_stat &stat = stats[level % 2];
+		if (stat.level != level) {
+			stat.level = level;
+			stat.num_vertices = 0;
+			stat.num_edges = 0;
+		}
+		stat.num_vertices++;
+		stat.num_edges += get_graph().get_num_edges(id, push_edge);
+	}
+
+	void get_frontier_stat(int level, size_t &num_vertices,
+			size_t &num_edges) const {
+		const frontier_stat &stat = stats[level % 2];
+		if (stat.level == level) {
+			num_vertices += stat.num_vertices;
+			num_edges += stat.num_edges;
+		}
+	}
+
+	/*
+	 * Decide whether the level should be expanded bottom-up.
+	 * All threads get the same decision because the frontier of the level
+	 * was discovered in the previous level.
+	 */
+	bool is_switch_pull(int level);
+
+	void add_frontier(vertex_id_t id, int depth) {
+		frontier.push_back(id);
+		frontier_edges += get_graph().get_num_edges(id, push_edge);
+		frontier_depth = depth;
+	}
+
+	void get_frontier(std::vector<vertex_id_t> &vertices, size_t &num_edges,
+			int &depth) {
+		vertices.insert(vertices.end(), frontier.begin(), frontier.end());
+		num_edges += frontier_edges;
+		depth = std::max(depth, frontier_depth);
+		frontier.clear();
+		frontier_edges = 0;
+	}
+};
+
+bool bfs_vertex_program::is_switch_pull(int level)
+{
+	// The first level is always traversed top-down. compute_bfs() has
+	// made the decision.
+	if (level == start_level)
+		return false;
+	if (checked_level == level)
+		return switch_pull;
+
+	std::vector<vertex_program::ptr> vprogs;
+	get_graph().get_vertex_programs(vprogs);
+	size_t num_vertices = 0;
+	size_t num_edges = 0;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		cast2(vprog)->get_frontier_stat(level, num_vertices, num_edges);
+	}
+	checked_level = level;
+	switch_pull = num_edges > max_push_edges;
+	return switch_pull;
+}
+
+class bfs_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new bfs_vertex_program());
+	}
+};
+
+void bfs_vertex::run(vertex_program &prog)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	if (pull_mode) {
+		assert(!visited->get(id));
+		request_edges(id, pull_edge);
+		return;
+	}
+
+	bfs_vertex_program &bfs_vprog = (bfs_vertex_program &) prog;
+	int level = prog.get_graph().get_curr_level();
+	if (depth < 0)
+		depth = start_depth + level - start_level;
+	// The frontier is too large. We stop here and let compute_bfs()
+	// expand the next level bottom-up.
+	if (bfs_vprog.is_switch_pull(level))
+		bfs_vprog.add_frontier(id, depth);
+	else
+		request_edges(id, push_edge);
+}
+
+void bfs_vertex::run_push(vertex_program &prog, const page_vertex &vertex)
+{
+	bfs_vertex_program &bfs_vprog = (bfs_vertex_program &) prog;
+	int next_level = prog.get_graph().get_curr_level() + 1;
+	std::vector<vertex_id_t> dests;
+	// On an undirected graph, both edge types return the same edge list.
+	if (directed_graph && push_edge == edge_type::BOTH_EDGES) {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::IN_EDGE);
+		PAGE_FOREACH(vertex_id_t, neigh, it) {
+			if (!visited->test_and_set(neigh))
+				dests.push_back(neigh);
+		} PAGE_FOREACH_END
+		it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+		PAGE_FOREACH(vertex_id_t, neigh, it) {
+			if (!visited->test_and_set(neigh))
+				dests.push_back(neigh);
+		} PAGE_FOREACH_END
+	}
+	else {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(push_edge);
+		PAGE_FOREACH(vertex_id_t, neigh, it) {
+			if (!visited->test_and_set(neigh))
+				dests.push_back(neigh);
+		} PAGE_FOREACH_END
+	}
+	if (dests.empty())
+		return;
+
+	BOOST_FOREACH(vertex_id_t id, dests) {
+		bfs_vprog.add_next_frontier(id, next_level);
+	}
+	prog.activate_vertices(dests.data(), dests.size());
+}
+
+bool has_visited_neigh(const page_vertex &vertex, edge_type type)
+{
+	edge_seq_iterator it = vertex.get_neigh_seq_it(type);
+	while (it.has_next()) {
+		if (visited->get(it.next()))
+			return true;
+	}
+	return false;
+}
+
+void bfs_vertex::run_pull(vertex_program &prog, const page_vertex &vertex)
+{
+	bool found;
+	if (directed_graph && pull_edge == edge_type::BOTH_EDGES)
+		found = has_visited_neigh(vertex, edge_type::IN_EDGE)
+			|| has_visited_neigh(vertex, edge_type::OUT_EDGE);
+	else
+		found = has_visited_neigh(vertex, pull_edge);
+	// We can't mark the vertex in the visited bitmap now. Otherwise,
+	// other vertices in this level may see it as a parent. compute_bfs()
+	// marks the frontier after the level completes.
+	if (found) {
+		depth = start_depth;
+		((bfs_vertex_program &) prog).add_frontier(
+				prog.get_vertex_id(*this), depth);
+	}
+}
+
+class unvisited_filter: public vertex_filter
+{
+public:
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		vertex_id_t id = prog.get_vertex_id(v);
+		return !visited->get(id)
+			&& prog.get_graph().get_num_edges(id, pull_edge) > 0;
+	}
+};
+
+size_t get_frontier(graph_engine::ptr graph,
+		std::vector<vertex_id_t> &frontier, size_t &num_edges, int &depth)
+{
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	frontier.clear();
+	num_edges = 0;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		bfs_vertex_program::cast2(vprog)->get_frontier(frontier, num_edges,
+				depth);
+	}
+	return frontier.size();
+}
+
+}
+
+#include "save_result.h"
+
+FG_vector<int>::ptr compute_bfs(FG_graph::ptr fg, vertex_id_t start_vertex,
+		edge_type traverse_edge)
+{
+	graph_index::ptr index = NUMA_graph_index<bfs_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	if (start_vertex > graph->get_max_vertex_id()) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"the start vertex %1% doesn't exist") % start_vertex;
+		return FG_vector<int>::ptr();
+	}
+
+	directed_graph = graph->is_directed();
+	push_edge = traverse_edge;
+	switch (traverse_edge) {
+		case edge_type::IN_EDGE:
+			pull_edge = edge_type::OUT_EDGE;
+			break;
+		case edge_type::OUT_EDGE:
+			pull_edge = edge_type::IN_EDGE;
+			break;
+		case edge_type::BOTH_EDGES:
+			pull_edge = edge_type::BOTH_EDGES;
+			break;
+		default:
+			ABORT_MSG("wrong edge type");
+	}
+	size_t num_edges = fg->get_graph_header().get_num_edges();
+	if (directed_graph && traverse_edge == edge_type::BOTH_EDGES)
+		num_edges *= 2;
+	max_push_edges = num_edges / ALPHA;
+	size_t min_pull_vertices = graph->get_num_vertices() / BETA;
+	visited = std::unique_ptr<thread_safe_bitmap>(new thread_safe_bitmap(
+				graph->get_max_vertex_id() + 1, 0));
+
+	BOOST_LOG_TRIVIAL(info) << "direction-optimizing BFS starts";
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+
+	std::vector<vertex_id_t> frontier(1, start_vertex);
+	size_t frontier_edges = graph->get_num_edges(start_vertex, push_edge);
+	visited->set(start_vertex);
+	int depth = 0;
+	size_t num_pull_levels = 0;
+	// The first level is always expanded top-down.
+	pull_mode = false;
+	while (!frontier.empty()) {
+		if (pull_mode) {
+			start_depth = depth + 1;
+			graph->start(std::shared_ptr<vertex_filter>(new unvisited_filter()),
+					vertex_program_creater::ptr(new bfs_vertex_program_creater()));
+			graph->wait4complete();
+			get_frontier(graph, frontier, frontier_edges, depth);
+			// Now the vertices in the frontier can become parents.
+			BOOST_FOREACH(vertex_id_t id, frontier) {
+				visited->set(id);
+			}
+			num_pull_levels++;
+			BOOST_LOG_TRIVIAL(info) << boost::format(
+					"bottom-up expands level %1% and visits %2% vertices")
+				% start_depth % frontier.size();
+			pull_mode = frontier.size() >= min_pull_vertices
+				|| frontier_edges > max_push_edges;
+		}
+		else {
+			start_level = graph->get_curr_level();
+			start_depth = depth;
+			graph->start(frontier.data(), frontier.size(),
+					vertex_initializer::ptr(),
+					vertex_program_creater::ptr(new bfs_vertex_program_creater()));
+			graph->wait4complete();
+			// If the top-down traversal stops in the middle, we get
+			// the frontier where it stops.
+			get_frontier(graph, frontier, frontier_edges, depth);
+			BOOST_LOG_TRIVIAL(info) << boost::format(
+					"top-down expands from level %1% to %2%")
+				% start_depth % (start_depth + graph->get_curr_level()
+						- start_level - 1);
+			// The top-down traversal stops only if the frontier is
+			// large, so we continue bottom-up.
+			pull_mode = true;
+		}
+	}
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"BFS takes %1% seconds, %2% levels are expanded bottom-up")
+		% time_diff(start, end) % num_pull_levels;
+
+	FG_vector<int>::ptr vec = FG_vector<int>::create(graph);
+	graph->query_on_all(vertex_query::ptr(
+				new save_query<int, bfs_vertex>(vec)));
+	visited.reset();
+	return vec;
+}
@@ -0,0 +1,334 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FG_vector.h"
+#include "FGlib.h"
+#include "alg_utils.h"
+
+/*
+ * This computes a maximal independent set with Luby's algorithm and
+ * a vertex coloring with the Jones-Plassmann algorithm. Edge direction
+ * is ignored.
+ *
+ * Every vertex gets a random priority, which is a hash of the vertex ID
+ * and a random seed, so any vertex can compute the priority of its
+ * neighbors. A vertex makes its decision after all of its neighbors
+ * with higher priorities make theirs:
+ * in MIS, a vertex joins the set if none of these neighbors is in it;
+ * in coloring, a vertex takes the smallest color none of them has.
+ * The result is the same as processing the vertices greedily in
+ * the order of their priorities.
+ *
+ * In the first iteration, every vertex reads its edge list to count its
+ * neighbors with higher priorities, and the vertices without such
+ * neighbors decide right away. A vertex sends its decision to its
+ * neighbors with lower priorities, so it reads its edge list again in
+ * the iteration after it decides. Only the vertices that receive messages
+ * run in an iteration, and only the ones that have just decided read
+ * their edge lists.
+ */
+
+namespace {
+
+enum coloring_type
+{
+	MIS,
+	COLORING,
+};
+
+const vsize_t NO_COLOR = std::numeric_limits<vsize_t>::max();
+const vsize_t UNKNOWN_NUM = std::numeric_limits<vsize_t>::max();
+
+coloring_type coloring_alg;
+uint64_t rand_seed;
+
+uint64_t get_priority(vertex_id_t id)
+{
+	return hash64(rand_seed ^ id);
+}
+
+/*
+ * Ties in priorities are broken by vertex IDs.
+ */
+bool higher_priority(vertex_id_t id1, vertex_id_t id2)
+{
+	uint64_t p1 = get_priority(id1);
+	uint64_t p2 = get_priority(id2);
+	if (p1 != p2)
+		return p1 > p2;
+	return id1 > id2;
+}
+
+class coloring_message: public vertex_message
+{
+	bool self;
+	vsize_t val;
+public:
+	/*
+	 * A vertex sends the number of its neighbors with higher priorities
+	 * to itself, or sends its decision to its neighbors. The message
+	 * activates the vertex in the next iteration, so the vertex can tell
+	 * its neighbors if it makes its decision.
+	 */
+	coloring_message(bool self, vsize_t val): vertex_message(
+			sizeof(coloring_message), true) {
+		this->self = self;
+		this->val = val;
+	}
+
+	bool is_self() const {
+		return self;
+	}
+
+	vsize_t get_val() const {
+		return val;
+	}
+};
+
+class coloring_vertex: public compute_directed_vertex
+{
+	// In MIS, the color is 1 if the vertex is in the set and 0 otherwise.
+	vsize_t color;
+	vsize_t num_higher;
+	vsize_t num_decided;
+	bool read;
+	bool notified;
+	// The colors of the neighbors with higher priorities.
+	std::vector<vsize_t> neigh_colors;
+
+	void notify_neighbors(vertex_program &prog);
+	void decide();
+public:
+	coloring_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		color = NO_COLOR;
+		num_higher = UNKNOWN_NUM;
+		num_decided = 0;
+		read = false;
+		notified = false;
+	}
+
+	vsize_t get_result() const {
+		return color;
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (read && (color == NO_COLOR || notified))
+			return;
+		if (read)
+			notified = true;
+		read = true;
+		if (prog.get_graph().is_directed()) {
+			directed_vertex_request req(id, edge_type::BOTH_EDGES);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg);
+};
+
+class coloring_vertex_program: public vertex_program_impl<coloring_vertex>
+{
+	// The buffers for collecting the neighbors of a vertex.
+	std::vector<vertex_id_t> neighs;
+	std::vector<vertex_id_t> lower_neighs;
+public:
+	typedef std::shared_ptr<coloring_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<coloring_vertex_program, vertex_program>(
+				prog);
+	}
+
+	std::vector<vertex_id_t> &get_neigh_buf() {
+		return neighs;
+	}
+
+	std::vector<vertex_id_t> &get_lower_neigh_buf() {
+		return lower_neighs;
+	}
+};
+
+class coloring_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new coloring_vertex_program());
+	}
+};
+
+/*
+ * Get the neighbors of a vertex with lower priorities. A neighbor appears
+ * once even if there are edges in both directions. It returns the number
+ * of the neighbors with higher priorities.
+ */
+vsize_t get_lower_neighbors(coloring_vertex_program &prog,
+		const page_vertex &vertex)
+{
+	vertex_id_t id = vertex.get_id();
+	std::vector<vertex_id_t> &neighs = prog.get_neigh_buf();
+	get_neighbors(prog.get_graph(), vertex, neighs);
+
+	std::vector<vertex_id_t> &lower_neighs = prog.get_lower_neigh_buf();
+	lower_neighs.clear();
+	vsize_t num_higher = 0;
+	for (size_t i = 0; i < neighs.size(); i++) {
+		if (higher_priority(neighs[i], id))
+			num_higher++;
+		else
+			lower_neighs.push_back(neighs[i]);
+	}
+	return num_higher;
+}
+
+void coloring_vertex::notify_neighbors(vertex_program &prog)
+{
+	std::vector<vertex_id_t> &lower_neighs
+		= ((coloring_vertex_program &) prog).get_lower_neigh_buf();
+	coloring_message msg(false, color);
+	prog.multicast_msg(lower_neighs.data(), lower_neighs.size(), msg);
+}
+
+void coloring_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	vsize_t num = get_lower_neighbors((coloring_vertex_program &) prog, vertex);
+	if (notified) {
+		notify_neighbors(prog);
+		return;
+	}
+
+	// No neighbors send messages to the vertex, so we can decide here.
+	if (num == 0) {
+		num_higher = 0;
+		color = coloring_alg == MIS ? 1 : 0;
+		notified = true;
+		notify_neighbors(prog);
+	}
+	// The messages from the neighbors are processed in the thread that
+	// owns the vertex, so the vertex counts its neighbors there.
+	else {
+		coloring_message msg(true, num);
+		prog.send_msg(vertex.get_id(), msg);
+	}
+}
+
+void coloring_vertex::run_on_message(vertex_program &,
+		const vertex_message &msg1)
+{
+	const coloring_message &msg = (const coloring_message &) msg1;
+	if (color != NO_COLOR)
+		return;
+
+	if (msg.is_self())
+		num_higher = msg.get_val();
+	else {
+		num_decided++;
+		if (coloring_alg == COLORING)
+			neigh_colors.push_back(msg.get_val());
+		// A neighbor with a higher priority is in the set.
+		else if (msg.get_val() == 1)
+			color = 0;
+	}
+	if (color == NO_COLOR && num_decided == num_higher)
+		decide();
+}
+
+void coloring_vertex::decide()
+{
+	if (coloring_alg == MIS) {
+		color = 1;
+		return;
+	}
+
+	std::sort(neigh_colors.begin(), neigh_colors.end());
+	color = 0;
+	for (size_t i = 0; i < neigh_colors.size() && neigh_colors[i] <= color;
+			i++) {
+		if (neigh_colors[i] == color)
+			color++;
+	}
+	std::vector<vsize_t>().swap(neigh_colors);
+}
+
+}
+
+#include "save_result.h"
+
+namespace {
+
+FG_vector<vsize_t>::ptr run_coloring(FG_graph::ptr fg, coloring_type alg)
+{
+	graph_index::ptr index = NUMA_graph_index<coloring_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	coloring_alg = alg;
+	rand_seed = time(NULL);
+
+	BOOST_LOG_TRIVIAL(info) << boost::format("%1% starts with seed %2%")
+		% (alg == MIS ? "MIS" : "coloring") % rand_seed;
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new coloring_vertex_program_creater()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"%1% takes %2% seconds in %3% iterations")
+		% (alg == MIS ? "MIS" : "coloring") % time_diff(start, end)
+		% graph->get_curr_level();
+
+	FG_vector<vsize_t>::ptr vec = FG_vector<vsize_t>::create(graph);
+	graph->query_on_all(vertex_query::ptr(
+				new save_query<vsize_t, coloring_vertex>(vec)));
+	return vec;
+}
+
+}
+
+FG_vector<vsize_t>::ptr compute_mis(FG_graph::ptr fg)
+{
+	return run_coloring(fg, MIS);
+}
+
+FG_vector<vsize_t>::ptr compute_coloring(FG_graph::ptr fg)
+{
+	return run_coloring(fg, COLORING);
+}
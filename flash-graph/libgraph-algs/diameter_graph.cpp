@@ -20,6 +20,7 @@
 #include <gperftools/profiler.h>
 #endif
 
+#include <limits>
 #include <vector>
 #include <set>
 #include <unordered_map>
@@ -453,3 +454,410 @@ size_t estimate_diameter(FG_graph::ptr fg, int num_para_bfs, bool directed)
 
 	return global_max;
 }
+
+/*
+ * This computes the exact diameter and radius with the bounding algorithm
+ * of Takes and Kosters. Every vertex keeps a lower bound and an upper
+ * bound of its eccentricity. After a BFS from v, the bounds of a vertex w
+ * at distance d from v are tightened to
+ *	max(d, ecc(v) - d) <= ecc(w) <= ecc(v) + d.
+ * A vertex is no longer a candidate for the next BFS if its eccentricity
+ * is known, or if it can't change the bounds of the diameter and
+ * the radius. The next BFS alternately starts from the candidate with
+ * the largest upper bound and the one with the smallest lower bound.
+ * All BFS run on the same graph engine, so they share the cached pages.
+ *
+ * Edge direction is ignored. The diameter and the radius are computed in
+ * the connected component of the vertex with the largest degree.
+ */
+
+namespace {
+
+const int INF_ECC = std::numeric_limits<int>::max();
+
+class ecc_vertex: public compute_directed_vertex
+{
+	int depth;
+	int ecc_lower;
+	int ecc_upper;
+	bool in_comp;
+	bool candidate;
+public:
+	ecc_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		depth = -1;
+		ecc_lower = 0;
+		ecc_upper = INF_ECC;
+		in_comp = false;
+		candidate = false;
+	}
+
+	void reset_depth() {
+		depth = -1;
+	}
+
+	int get_depth() const {
+		return depth;
+	}
+
+	bool is_in_comp() const {
+		return in_comp;
+	}
+
+	bool is_candidate() const {
+		return candidate;
+	}
+
+	int get_ecc_lower() const {
+		return ecc_lower;
+	}
+
+	int get_ecc_upper() const {
+		return ecc_upper;
+	}
+
+	/*
+	 * The vertices reached by the first BFS form the component.
+	 */
+	void init_comp() {
+		in_comp = depth >= 0;
+		candidate = in_comp;
+	}
+
+	void update_bounds(int src_ecc) {
+		ecc_lower = std::max(ecc_lower, std::max(depth, src_ecc - depth));
+		ecc_upper = std::min(ecc_upper, src_ecc + depth);
+	}
+
+	void prune(int diam_lower, int radius_upper) {
+		if (ecc_lower == ecc_upper
+				|| (ecc_upper <= diam_lower && ecc_lower >= radius_upper))
+			candidate = false;
+	}
+
+	void run(vertex_program &prog);
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		if (prog.get_graph().is_directed()) {
+			edge_seq_iterator it = vertex.get_neigh_seq_it(IN_EDGE);
+			prog.activate_vertices(it);
+			it = vertex.get_neigh_seq_it(OUT_EDGE);
+			prog.activate_vertices(it);
+		}
+		else {
+			edge_seq_iterator it = vertex.get_neigh_seq_it(OUT_EDGE);
+			prog.activate_vertices(it);
+		}
+	}
+
+	void run_on_message(vertex_program &, const vertex_message &msg) {
+	}
+};
+
+class ecc_vertex_program: public vertex_program_impl<ecc_vertex>
+{
+	int max_depth;
+public:
+	typedef std::shared_ptr<ecc_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<ecc_vertex_program, vertex_program>(
+				prog);
+	}
+
+	ecc_vertex_program() {
+		max_depth = 0;
+	}
+
+	void set_depth(int depth) {
+		max_depth = std::max(max_depth, depth);
+	}
+
+	int get_max_depth() const {
+		return max_depth;
+	}
+};
+
+class ecc_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new ecc_vertex_program());
+	}
+};
+
+void ecc_vertex::run(vertex_program &prog)
+{
+	if (depth >= 0)
+		return;
+	depth = prog.get_graph().get_curr_level() - start_level;
+	((ecc_vertex_program &) prog).set_depth(depth);
+	vertex_id_t id = prog.get_vertex_id(*this);
+	request_vertices(&id, 1);
+}
+
+class ecc_reset: public vertex_initializer
+{
+public:
+	void init(compute_vertex &v) {
+		((ecc_vertex &) v).reset_depth();
+	}
+};
+
+/*
+ * Find the vertex with the largest degree among the candidates that
+ * maximize or minimize a key.
+ */
+class select_vertex
+{
+	bool max_key;
+	int key;
+	vsize_t degree;
+	vertex_id_t id;
+public:
+	select_vertex(bool max_key) {
+		this->max_key = max_key;
+		key = max_key ? std::numeric_limits<int>::min() : INF_ECC;
+		degree = 0;
+		id = INVALID_VERTEX_ID;
+	}
+
+	void add(vertex_id_t id, int key, vsize_t degree) {
+		bool better = max_key ? key > this->key : key < this->key;
+		if (better || (key == this->key && degree > this->degree)) {
+			this->id = id;
+			this->key = key;
+			this->degree = degree;
+		}
+	}
+
+	void merge(const select_vertex &v) {
+		if (v.id != INVALID_VERTEX_ID)
+			add(v.id, v.key, v.degree);
+	}
+
+	vertex_id_t get_id() const {
+		return id;
+	}
+};
+
+class max_degree_vertex_query: public vertex_query
+{
+	select_vertex v;
+public:
+	max_degree_vertex_query(): v(true) {
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		vsize_t degree = graph.get_num_edges(id, edge_type::BOTH_EDGES);
+		this->v.add(id, degree, degree);
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+		v.merge(((max_degree_vertex_query *) q.get())->v);
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new max_degree_vertex_query());
+	}
+
+	vertex_id_t get_vertex() const {
+		return v.get_id();
+	}
+};
+
+class init_comp_query: public vertex_query
+{
+public:
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		((ecc_vertex &) v).init_comp();
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new init_comp_query());
+	}
+};
+
+/*
+ * Tighten the eccentricity bounds with the distances from the BFS source
+ * and compute the bounds of the diameter and the radius.
+ */
+class update_bounds_query: public vertex_query
+{
+	int src_ecc;
+public:
+	int diam_lower;
+	int diam_upper;
+	int radius_lower;
+	int radius_upper;
+
+	update_bounds_query(int src_ecc) {
+		this->src_ecc = src_ecc;
+		diam_lower = 0;
+		diam_upper = 0;
+		radius_lower = INF_ECC;
+		radius_upper = INF_ECC;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		ecc_vertex &ev = (ecc_vertex &) v;
+		if (!ev.is_in_comp())
+			return;
+		ev.update_bounds(src_ecc);
+		diam_lower = std::max(diam_lower, ev.get_ecc_lower());
+		diam_upper = std::max(diam_upper, ev.get_ecc_upper());
+		radius_lower = std::min(radius_lower, ev.get_ecc_lower());
+		radius_upper = std::min(radius_upper, ev.get_ecc_upper());
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+		update_bounds_query *uq = (update_bounds_query *) q.get();
+		diam_lower = std::max(diam_lower, uq->diam_lower);
+		diam_upper = std::max(diam_upper, uq->diam_upper);
+		radius_lower = std::min(radius_lower, uq->radius_lower);
+		radius_upper = std::min(radius_upper, uq->radius_upper);
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new update_bounds_query(src_ecc));
+	}
+};
+
+/*
+ * Remove the vertices that can't change the bounds from the candidates
+ * and find the next source of BFS.
+ */
+class prune_query: public vertex_query
+{
+	int diam_lower;
+	int radius_upper;
+public:
+	size_t num_candidates;
+	select_vertex max_upper;
+	select_vertex min_lower;
+
+	prune_query(int diam_lower, int radius_upper): max_upper(true),
+			min_lower(false) {
+		this->diam_lower = diam_lower;
+		this->radius_upper = radius_upper;
+		num_candidates = 0;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		ecc_vertex &ev = (ecc_vertex &) v;
+		if (!ev.is_candidate())
+			return;
+		ev.prune(diam_lower, radius_upper);
+		if (!ev.is_candidate())
+			return;
+		num_candidates++;
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		vsize_t degree = graph.get_num_edges(id, edge_type::BOTH_EDGES);
+		max_upper.add(id, ev.get_ecc_upper(), degree);
+		min_lower.add(id, ev.get_ecc_lower(), degree);
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+		prune_query *pq = (prune_query *) q.get();
+		num_candidates += pq->num_candidates;
+		max_upper.merge(pq->max_upper);
+		min_lower.merge(pq->min_lower);
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new prune_query(diam_lower, radius_upper));
+	}
+};
+
+int run_ecc_bfs(graph_engine::ptr graph, vertex_id_t source)
+{
+	graph->init_all_vertices(vertex_initializer::ptr(new ecc_reset()));
+	start_level = graph->get_curr_level();
+	graph->start(&source, 1, vertex_initializer::ptr(),
+			vertex_program_creater::ptr(new ecc_vertex_program_creater()));
+	graph->wait4complete();
+
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	int ecc = 0;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		ecc = std::max(ecc, ecc_vertex_program::cast2(vprog)->get_max_depth());
+	}
+	return ecc;
+}
+
+}
+
+size_t compute_exact_diameter(FG_graph::ptr fg, size_t *radius)
+{
+	graph_index::ptr index = NUMA_graph_index<ecc_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+
+	BOOST_LOG_TRIVIAL(info) << "exact diameter starts";
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+
+	vertex_query::ptr mq(new max_degree_vertex_query());
+	graph->query_on_all(mq);
+	vertex_id_t source = ((max_degree_vertex_query *) mq.get())->get_vertex();
+
+	int diam_lower = 0;
+	int diam_upper = INF_ECC;
+	int radius_lower = 0;
+	int radius_upper = INF_ECC;
+	size_t num_bfs = 0;
+	while (true) {
+		int ecc = run_ecc_bfs(graph, source);
+		if (num_bfs == 0)
+			graph->query_on_all(vertex_query::ptr(new init_comp_query()));
+		num_bfs++;
+
+		vertex_query::ptr uq(new update_bounds_query(ecc));
+		graph->query_on_all(uq);
+		update_bounds_query *bounds = (update_bounds_query *) uq.get();
+		diam_lower = bounds->diam_lower;
+		diam_upper = bounds->diam_upper;
+		radius_lower = bounds->radius_lower;
+		radius_upper = bounds->radius_upper;
+
+		// Once a bound is tight, vertices are no longer needed to improve it.
+		bool diam_done = diam_lower == diam_upper;
+		bool radius_done = radius_lower == radius_upper;
+		vertex_query::ptr pq(new prune_query(diam_done ? INF_ECC : diam_lower,
+					radius_done ? 0 : radius_upper));
+		graph->query_on_all(pq);
+		prune_query *candidates = (prune_query *) pq.get();
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"BFS %1% from v%2% (ecc: %3%): diameter in [%4%, %5%], radius in [%6%, %7%], %8% candidates left")
+			% num_bfs % source % ecc % diam_lower % diam_upper % radius_lower
+			% radius_upper % candidates->num_candidates;
+		if ((diam_done && radius_done) || candidates->num_candidates == 0)
+			break;
+		if (num_bfs % 2)
+			source = candidates->max_upper.get_id();
+		else
+			source = candidates->min_lower.get_id();
+	}
+
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"exact diameter takes %1% seconds and %2% BFS")
+		% time_diff(start, end) % num_bfs;
+
+	if (radius)
+		*radius = radius_upper;
+	return diam_lower;
+}
@@ -0,0 +1,415 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <math.h>
+
+#include <limits>
+#include <vector>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FG_vector.h"
+#include "FGlib.h"
+#include "alg_utils.h"
+
+/*
+ * This is HyperANF, which approximates the neighbourhood function of
+ * a graph. Each vertex has a HyperLogLog counter of the vertices within
+ * distance t. In level t, a vertex takes the register-wise max of its
+ * counter and the counters of its in-neighbors, which gives the counter
+ * of the vertices within distance t + 1.
+ *
+ * The counters of all vertices are kept in two arrays. The vertices read
+ * the counters of their neighbors from `curr_regs' and write their own
+ * counters to `next_regs'. A vertex whose counter changes copies it back
+ * to `curr_regs' at the end of the level and activates its out-neighbors,
+ * so the computation stops once all counters are stable.
+ */
+
+namespace {
+
+const int MIN_LOG2_REGS = 4;
+const int MAX_LOG2_REGS = 16;
+
+int log2_regs;
+size_t num_regs;
+int max_levels;
+int start_level;
+bool directed_graph;
+
+std::unique_ptr<uint8_t[]> curr_regs;
+std::unique_ptr<uint8_t[]> next_regs;
+// 2^-i for all possible register values.
+double inv_pow2[66];
+
+uint8_t *get_curr_regs(vertex_id_t id)
+{
+	return curr_regs.get() + id * num_regs;
+}
+
+uint8_t *get_next_regs(vertex_id_t id)
+{
+	return next_regs.get() + id * num_regs;
+}
+
+void init_regs(vertex_id_t id, uint8_t *regs)
+{
+	memset(regs, 0, num_regs);
+	uint64_t h = hash64(id);
+	size_t idx = h >> (64 - log2_regs);
+	uint64_t w = h << log2_regs;
+	int max_rank = 64 - log2_regs + 1;
+	regs[idx] = w == 0 ? max_rank : std::min(__builtin_clzl(w) + 1, max_rank);
+}
+
+/*
+ * Merge the registers in `src' to `dst' and return true if `dst' changes.
+ * The number of registers is a multiple of 16.
+ */
+bool merge_regs(uint8_t *dst, const uint8_t *src)
+{
+	bool changed = false;
+#ifdef __SSE2__
+	for (size_t i = 0; i < num_regs; i += 16) {
+		__m128i d = _mm_loadu_si128((const __m128i *) (dst + i));
+		__m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+		__m128i m = _mm_max_epu8(d, s);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(m, d)) != 0xFFFF) {
+			_mm_storeu_si128((__m128i *) (dst + i), m);
+			changed = true;
+		}
+	}
+#else
+	for (size_t i = 0; i < num_regs; i++) {
+		if (src[i] > dst[i]) {
+			dst[i] = src[i];
+			changed = true;
+		}
+	}
+#endif
+	return changed;
+}
+
+double estimate_count(const uint8_t *regs)
+{
+	double alpha;
+	switch (num_regs) {
+		case 16: alpha = 0.673; break;
+		case 32: alpha = 0.697; break;
+		case 64: alpha = 0.709; break;
+		default: alpha = 0.7213 / (1 + 1.079 / num_regs);
+	}
+	double sum = 0;
+	size_t num_zeros = 0;
+	for (size_t i = 0; i < num_regs; i++) {
+		sum += inv_pow2[regs[i]];
+		num_zeros += regs[i] == 0;
+	}
+	double m = num_regs;
+	double est = alpha * m * m / sum;
+	// Use linear counting for small cardinalities.
+	if (est <= 2.5 * m && num_zeros > 0)
+		est = m * log(m / num_zeros);
+	return est;
+}
+
+/*
+ * A vertex sends this message to itself when its counter changes,
+ * so its owner thread copies the counter back at the end of the level.
+ */
+class changed_message: public vertex_message
+{
+public:
+	changed_message(): vertex_message(sizeof(changed_message), false) {
+	}
+};
+
+class anf_vertex: public compute_directed_vertex
+{
+	float count;
+	float harmonic;
+public:
+	anf_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		count = 0;
+		harmonic = 0;
+	}
+
+	float get_count() const {
+		return count;
+	}
+
+	float get_harmonic() const {
+		return harmonic;
+	}
+
+	void init(vertex_id_t id) {
+		init_regs(id, get_curr_regs(id));
+		memcpy(get_next_regs(id), get_curr_regs(id), num_regs);
+		count = estimate_count(get_curr_regs(id));
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (directed_graph) {
+			directed_vertex_request req(id, edge_type::BOTH_EDGES);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &) {
+		prog.request_notify_iter_end(*this);
+	}
+
+	void notify_iteration_end(vertex_program &prog);
+};
+
+/*
+ * Each thread sums the changes of the counters of its vertices in
+ * every level, which gives the neighbourhood function.
+ */
+class anf_vertex_program: public vertex_program_impl<anf_vertex>
+{
+	std::vector<double> count_deltas;
+public:
+	typedef std::shared_ptr<anf_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<anf_vertex_program, vertex_program>(
+				prog);
+	}
+
+	void add_delta(int dist, double delta) {
+		if (count_deltas.size() <= (size_t) dist)
+			count_deltas.resize(dist + 1);
+		count_deltas[dist] += delta;
+	}
+
+	const std::vector<double> &get_count_deltas() const {
+		return count_deltas;
+	}
+};
+
+class anf_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new anf_vertex_program());
+	}
+};
+
+void anf_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	vertex_id_t id = vertex.get_id();
+	uint8_t *regs = get_next_regs(id);
+	bool changed = false;
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::IN_EDGE);
+	while (it.has_next()) {
+		vertex_id_t neigh = it.next();
+		if (merge_regs(regs, get_curr_regs(neigh)))
+			changed = true;
+	}
+	if (!changed)
+		return;
+
+	changed_message msg;
+	prog.send_msg(id, msg);
+	if (prog.get_graph().get_curr_level() + 1 - start_level < max_levels) {
+		it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+		prog.activate_vertices(it);
+	}
+}
+
+void anf_vertex::notify_iteration_end(vertex_program &prog)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	memcpy(get_curr_regs(id), get_next_regs(id), num_regs);
+	float new_count = estimate_count(get_curr_regs(id));
+	// The counter may not grow even if some of its registers change.
+	if (new_count <= count)
+		return;
+
+	int dist = prog.get_graph().get_curr_level() + 1 - start_level;
+	double delta = new_count - count;
+	((anf_vertex_program &) prog).add_delta(dist, delta);
+	harmonic += delta / dist;
+	count = new_count;
+}
+
+class anf_initializer: public vertex_initializer
+{
+	graph_engine &graph;
+public:
+	anf_initializer(graph_engine &_graph): graph(_graph) {
+	}
+
+	void init(compute_vertex &v) {
+		anf_vertex &anf_v = (anf_vertex &) v;
+		anf_v.init(graph.get_graph_index().get_vertex_id(v));
+	}
+};
+
+class anf_query: public vertex_query
+{
+	FG_vector<float>::ptr counts;
+	FG_vector<float>::ptr harmonics;
+	double tot_count;
+public:
+	anf_query(FG_vector<float>::ptr counts, FG_vector<float>::ptr harmonics) {
+		this->counts = counts;
+		this->harmonics = harmonics;
+		tot_count = 0;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		anf_vertex &anf_v = (anf_vertex &) v;
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		tot_count += anf_v.get_count();
+		if (counts)
+			counts->set(id, anf_v.get_count());
+		if (harmonics)
+			harmonics->set(id, anf_v.get_harmonic());
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+		tot_count += ((anf_query *) q.get())->tot_count;
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new anf_query(counts, harmonics));
+	}
+
+	double get_tot_count() const {
+		return tot_count;
+	}
+};
+
+}
+
+std::vector<double> compute_hyper_anf(FG_graph::ptr fg, int log2_num_regs,
+		int num_levels, FG_vector<float>::ptr *counts,
+		FG_vector<float>::ptr *harmonics)
+{
+	if (log2_num_regs < MIN_LOG2_REGS || log2_num_regs > MAX_LOG2_REGS) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"The number of registers must be between 2^%1% and 2^%2%")
+			% MIN_LOG2_REGS % MAX_LOG2_REGS;
+		return std::vector<double>();
+	}
+
+	graph_index::ptr index = NUMA_graph_index<anf_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	directed_graph = fg->get_graph_header().is_directed_graph();
+	log2_regs = log2_num_regs;
+	num_regs = 1UL << log2_num_regs;
+	max_levels = num_levels;
+	for (size_t i = 0; i < sizeof(inv_pow2) / sizeof(inv_pow2[0]); i++)
+		inv_pow2[i] = ldexp(1, -i);
+
+	size_t num_vertices = graph->get_num_vertices();
+	curr_regs = std::unique_ptr<uint8_t[]>(new uint8_t[num_vertices * num_regs]);
+	next_regs = std::unique_ptr<uint8_t[]>(new uint8_t[num_vertices * num_regs]);
+	graph->init_all_vertices(vertex_initializer::ptr(new anf_initializer(*graph)));
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"HyperANF starts with %1% registers per vertex") % num_regs;
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	// The counts of all vertices before any level.
+	vertex_query::ptr init_q(new anf_query(FG_vector<float>::ptr(),
+				FG_vector<float>::ptr()));
+	graph->query_on_all(init_q);
+	double init_count = ((anf_query *) init_q.get())->get_tot_count();
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	start_level = graph->get_curr_level();
+	if (max_levels > 0) {
+		graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+					new anf_vertex_program_creater()));
+		graph->wait4complete();
+	}
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	std::vector<double> nf(1, init_count);
+	if (max_levels > 0) {
+		std::vector<vertex_program::ptr> vprogs;
+		graph->get_vertex_programs(vprogs);
+		BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+			const std::vector<double> &deltas
+				= anf_vertex_program::cast2(vprog)->get_count_deltas();
+			if (nf.size() < deltas.size())
+				nf.resize(deltas.size());
+			for (size_t i = 1; i < deltas.size(); i++)
+				nf[i] += deltas[i];
+		}
+		for (size_t i = 1; i < nf.size(); i++)
+			nf[i] += nf[i - 1];
+	}
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"HyperANF takes %1% seconds and %2% levels, and the graph has about %3% reachable pairs")
+		% time_diff(start, end) % (nf.size() - 1) % nf.back();
+
+	if (counts)
+		*counts = FG_vector<float>::create(graph);
+	if (harmonics)
+		*harmonics = FG_vector<float>::create(graph);
+	if (counts || harmonics)
+		graph->query_on_all(vertex_query::ptr(new anf_query(
+						counts ? *counts : FG_vector<float>::ptr(),
+						harmonics ? *harmonics : FG_vector<float>::ptr())));
+	curr_regs.reset();
+	next_regs.reset();
+	return nf;
+}
+
+double compute_effective_diameter(const std::vector<double> &nf,
+		double fraction)
+{
+	if (nf.empty())
+		return 0;
+	double threshold = nf.back() * fraction;
+	for (size_t t = 0; t < nf.size(); t++) {
+		if (nf[t] < threshold)
+			continue;
+		if (t == 0)
+			return 0;
+		// Interpolate between the two levels.
+		return t - 1 + (threshold - nf[t - 1]) / (nf[t] - nf[t - 1]);
+	}
+	return nf.size() - 1;
+}
@@ -22,73 +22,114 @@
 #include <gperftools/profiler.h>
 #endif
 
+#include <limits>
 #include <vector>
+#include <map>
+#include <atomic>
 #include <algorithm>
 
 #include "graph_engine.h"
 #include "graph_config.h"
 #include "FGlib.h"
-#include "save_result.h"
 
-vsize_t CURRENT_K; // Min degree necessary to be part of the k-core graph
-vsize_t PREVIOUS_K; 
-bool all_greater_than_core = true;
+/*
+ * This computes the coreness of all vertices with bucket-based peeling
+ * in a single run of the graph engine.
+ *
+ * Each worker thread keeps its vertices in buckets indexed by their
+ * remaining degree. In each level, only the vertices whose degree is
+ * at most the current core value `K' run. They are deleted, get core `K'
+ * and notify their neighbors, which are moved to lower buckets when
+ * they are activated by the messages. Once no thread has vertices to
+ * delete, all threads move `K' to the lowest non-empty bucket in the graph.
+ *
+ * The threads agree on `K' without extra synchronization: each thread
+ * publishes the number of vertices it schedules and its lowest bucket
+ * when it schedules a level, and reads what all threads published in
+ * the previous level, which is complete after the barrier between levels.
+ */
+
+namespace {
+
+const vsize_t INVALID_DEGREE = std::numeric_limits<vsize_t>::max();
 
-enum kcore_stage_t
+// The range of cores we report. Vertices out of the range get core 0.
+vsize_t min_core;
+vsize_t max_core;
+
+/*
+ * The statistics the threads publish when scheduling a level.
+ * We rotate among three of them, so a thread can reset the one for
+ * the next level while the other threads are still reading the one
+ * of the previous level.
+ */
+struct level_stat
 {
-	INIT_DEGREE,
-	KCORE,
+	std::atomic<size_t> num_deleted;
+	std::atomic<vsize_t> min_degree;
+
+	void reset() {
+		num_deleted = 0;
+		min_degree = INVALID_DEGREE;
+	}
+
+	void add(size_t num, vsize_t degree) {
+		num_deleted += num;
+		vsize_t curr = min_degree.load();
+		while (degree < curr && !min_degree.compare_exchange_weak(curr, degree));
+	}
 };
-kcore_stage_t stage;
+level_stat stats[3];
 
 class kcore_vertex: public compute_vertex
 {
 	bool deleted;
 	vsize_t core;
-	vsize_t degree; 
+	vsize_t degree;
+	// The bucket where the vertex is waiting to be deleted.
+	vsize_t bucket;
 
-	public:
+public:
 	kcore_vertex(vertex_id_t id): compute_vertex(id) {
 		this->deleted = false;
-		this->core = -1;
+		this->core = 0;
 		this->degree = 0;
+		this->bucket = INVALID_DEGREE;
 	}
 
 	bool is_deleted() const {
 		return deleted;
 	}
 
-	void _delete() {
-		this->deleted = true;
+	void init_degree(vsize_t degree) {
+		this->degree = degree;
 	}
 
-	void set_core(vsize_t core) {
-		this->core = core;
+	vsize_t get_degree() const {
+		return degree;
 	}
 
-	const vsize_t get_core() const {
-		return this->core;
+	vsize_t get_bucket() const {
+		return bucket;
 	}
 
-	vsize_t get_degree() {
-		return degree;
+	void set_bucket(vsize_t bucket) {
+		this->bucket = bucket;
 	}
 
 	size_t get_result() const {
-		return get_core();
+		if (!deleted || core < min_core || core > max_core)
+			return 0;
+		return core;
 	}
 
 	void run(vertex_program &prog);
 
 	void run(vertex_program &prog, const page_vertex &vertex);
 
-	void run_on_message(vertex_program &prog, const vertex_message &msg); 
-
-	void run_on_vertex_header(vertex_program &prog, const vertex_header &header) {
-		degree = header.get_num_edges();
-		this->core = degree == 0 ? 0 :
-			degree == 1 ? 1 : -1; // Everyone between kmin < core > kmax will get this core
-		this->deleted = degree == 0 ? true : false; // If your degree you're already deleted
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+		if (!deleted)
+			degree--;
 	}
 };
 
@@ -101,184 +142,189 @@ class deleted_message: public vertex_message
 		}
 };
 
-void multicast_delete_msg(vertex_program &prog, 
-		const page_vertex &vertex, edge_type E)
+class kcore_vertex_program: public vertex_program_impl<kcore_vertex>
 {
-	int num_dests = vertex.get_num_edges(E);
-	edge_seq_iterator it = vertex.get_neigh_seq_it(E, 0, num_dests);
+	// The vertices owned by this thread that haven't been deleted.
+	std::map<vsize_t, std::vector<compute_vertex_pointer> > buckets;
+	// The number of times the scheduler has been invoked.
+	size_t num_levels;
+	vsize_t curr_k;
+	size_t num_deleted;
 
-	// Doesn't matter who sent it, just --degree on reception 
-	deleted_message msg;
-	prog.multicast_msg(it, msg);
-}
+	void add_vertex(compute_vertex_pointer v) {
+		kcore_vertex &kv = (kcore_vertex &) *v.get();
+		// The vertex is already in the bucket. If the vertex is in
+		// another bucket, the old entry becomes invalid because
+		// the vertex's bucket doesn't match it.
+		if (kv.is_deleted() || kv.get_bucket() == kv.get_degree())
+			return;
+		kv.set_bucket(kv.get_degree());
+		buckets[kv.get_degree()].push_back(v);
+	}
 
-void kcore_vertex::run(vertex_program &prog) {
-	vertex_id_t id = prog.get_vertex_id(*this);
-	if (stage == INIT_DEGREE) {
-		request_vertex_headers(&id, 1);
-		return;
+	vsize_t get_min_degree();
+public:
+	typedef std::shared_ptr<kcore_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<kcore_vertex_program, vertex_program>(
+				prog);
 	}
 
-	if ( degree > CURRENT_K ) { 
-		return; 
+	kcore_vertex_program() {
+		num_levels = 0;
+		curr_k = 0;
+		num_deleted = 0;
 	}
 
-	if (!is_deleted()) {
-		request_vertices(&id, 1); // put my edgelist in page cache
+	void schedule(std::vector<compute_vertex_pointer> &vertices);
 
-		if (all_greater_than_core) {
-			all_greater_than_core = false;
-		}
+	vsize_t get_curr_k() const {
+		return curr_k;
 	}
-}
 
-void kcore_vertex::run(vertex_program &prog, const page_vertex &vertex) {
-	if (is_deleted()) {
-		return; // Nothing to be done here
+	void inc_deleted() {
+		num_deleted++;
 	}
 
-	if ( get_degree() < CURRENT_K ) {
-		set_core(CURRENT_K - 1); // This is true because you must make it past CURRENT_K-1 to be here
-		_delete();
-
-		// Send two multicast messages - [IN_EDGE, OUT_EDGE] 
-		multicast_delete_msg(prog, vertex, IN_EDGE);
-		multicast_delete_msg(prog, vertex, OUT_EDGE);
+	size_t get_num_deleted() const {
+		return num_deleted;
 	}
-}
+};
 
-void kcore_vertex::run_on_message(vertex_program &prog, const vertex_message &msg) {
-	if (is_deleted()) {
-		return; // nothing to be done here
+vsize_t kcore_vertex_program::get_min_degree()
+{
+	while (!buckets.empty()) {
+		std::map<vsize_t, std::vector<compute_vertex_pointer> >::iterator it
+			= buckets.begin();
+		BOOST_FOREACH(compute_vertex_pointer v, it->second) {
+			if (((kcore_vertex &) *v.get()).get_bucket() == it->first)
+				return it->first;
+		}
+		buckets.erase(it);
 	}
-	// else
-	degree--;
+	return INVALID_DEGREE;
 }
 
-class count_vertex_query: public vertex_query
+struct vertex_pointer_less
 {
-	size_t num;
-	public:
-	count_vertex_query() {
-		num = 0;
-	}
-
-	virtual void run(graph_engine &graph, compute_vertex &v) {
-		kcore_vertex &kcore_v = (kcore_vertex &) v;
-		if (!kcore_v.is_deleted())
-			num++;
+	bool operator()(const compute_vertex_pointer &v1,
+			const compute_vertex_pointer &v2) const {
+		return v1.get() < v2.get();
 	}
+};
 
-	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
-		count_vertex_query *cvq = (count_vertex_query *) q.get();
-		num += cvq->num;
+void kcore_vertex_program::schedule(std::vector<compute_vertex_pointer> &vertices)
+{
+	// The first level gets all vertices.
+	if (num_levels == 0) {
+		BOOST_FOREACH(compute_vertex_pointer v, vertices) {
+			kcore_vertex &kv = (kcore_vertex &) *v.get();
+			kv.init_degree(get_graph().get_num_edges(get_vertex_id(v),
+						edge_type::BOTH_EDGES));
+		}
 	}
-
-	virtual ptr clone() {
-		return vertex_query::ptr(new count_vertex_query());
+	BOOST_FOREACH(compute_vertex_pointer v, vertices) {
+		add_vertex(v);
 	}
+	vertices.clear();
 
-	size_t get_num() const {
-		return num;
+	// If no thread deleted vertices in the previous level, we have got
+	// the `K'-core and move to the next core.
+	if (num_levels > 0) {
+		level_stat &prev = stats[(num_levels - 1) % 3];
+		if (prev.num_deleted == 0)
+			curr_k = prev.min_degree;
 	}
-};
-
-// Max degree corresponds to the highest core
-class max_degree_query: public vertex_query
-{
-	vsize_t max_degree;
-	public:
-	max_degree_query() {
-		max_degree = 0;
+	stats[(num_levels + 1) % 3].reset();
+	level_stat &curr = stats[num_levels % 3];
+	num_levels++;
+	// We don't need to compute larger cores.
+	if (curr_k > max_core) {
+		buckets.clear();
+		return;
 	}
 
-	virtual void run(graph_engine &graph, compute_vertex &v) {
-		kcore_vertex& kv = (kcore_vertex&) v;
-		if ((kv.get_degree()) > max_degree) {
-			max_degree = kv.get_degree();
+	while (!buckets.empty() && buckets.begin()->first <= curr_k) {
+		std::map<vsize_t, std::vector<compute_vertex_pointer> >::iterator it
+			= buckets.begin();
+		BOOST_FOREACH(compute_vertex_pointer v, it->second) {
+			kcore_vertex &kv = (kcore_vertex &) *v.get();
+			if (kv.get_bucket() == it->first) {
+				kv.set_bucket(INVALID_DEGREE);
+				vertices.push_back(v);
+			}
 		}
+		buckets.erase(it);
 	}
+	curr.add(vertices.size(), get_min_degree());
 
-	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
-		max_degree_query *mdq = (max_degree_query *) q.get();
-		if (max_degree < mdq->max_degree) {
-			max_degree = mdq->max_degree;
-		}
+	// The graph engine stops when no vertices are active. If the thread
+	// has nothing to delete in this level, it runs one of its remaining
+	// vertices, which does nothing, to keep the engine running until
+	// the threads move to the next core.
+	if (vertices.empty() && !buckets.empty()) {
+		vertices.push_back(buckets.begin()->second.back());
+		return;
 	}
+	// The vertices are stored in the order of their IDs. Keep the order
+	// to merge I/O requests.
+	std::sort(vertices.begin(), vertices.end(), vertex_pointer_less());
+}
 
-	virtual ptr clone() {
-		return vertex_query::ptr(new max_degree_query());
+class kcore_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new kcore_vertex_program());
 	}
+};
 
-	vsize_t get_max_degree() const {
-		return max_degree;
+class bucket_scheduler: public vertex_scheduler
+{
+public:
+	void schedule(vertex_program &prog,
+			std::vector<compute_vertex_pointer> &vertices) {
+		((kcore_vertex_program &) prog).schedule(vertices);
 	}
 };
 
-// Figure out the lowest REMAINING degree in the graph
-class min_degree_query: public vertex_query
+void multicast_delete_msg(vertex_program &prog, 
+		const page_vertex &vertex, edge_type E)
 {
-	vsize_t min_degree;
-	public:
-	min_degree_query() {
-		min_degree = std::numeric_limits<vsize_t>::max();
-	}
+	int num_dests = vertex.get_num_edges(E);
+	edge_seq_iterator it = vertex.get_neigh_seq_it(E, 0, num_dests);
 
-	virtual void run(graph_engine &graph, compute_vertex &v) {
-		kcore_vertex kcore_v = (kcore_vertex&) v;
-		if (!kcore_v.is_deleted()) {
-			if (kcore_v.get_degree() < min_degree) {
-				min_degree = kcore_v.get_degree();
-			}
-		}
-	}
+	// Doesn't matter who sent it, just --degree on reception 
+	deleted_message msg;
+	prog.multicast_msg(it, msg);
+}
 
-	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
-		min_degree_query *mdq = (min_degree_query *) q.get();
-		if (min_degree > mdq->min_degree) {
-			min_degree = mdq->min_degree;
-		}
-	}
+void kcore_vertex::run(vertex_program &prog) {
+	kcore_vertex_program &kprog = (kcore_vertex_program &) prog;
+	// The vertex is scheduled to keep the graph engine running.
+	if (deleted || degree > kprog.get_curr_k())
+		return;
 
-	virtual ptr clone() {
-		return vertex_query::ptr(new min_degree_query());
-	}
+	core = kprog.get_curr_k();
+	deleted = true;
+	kprog.inc_deleted();
+	vertex_id_t id = prog.get_vertex_id(*this);
+	request_vertices(&id, 1);
+}
 
-	vsize_t get_min_degree() const {
-		return min_degree;
+void kcore_vertex::run(vertex_program &prog, const page_vertex &vertex) {
+	if (prog.get_graph().is_directed()) {
+		multicast_delete_msg(prog, vertex, IN_EDGE);
+		multicast_delete_msg(prog, vertex, OUT_EDGE);
 	}
-};
-
-// Helpers
-void print_func(vertex_id_t i) {
-	std::cout << " " << i;
-}
-void print_active(std::vector<vertex_id_t> v) {
-	std::cout << "[";
-	for_each (v.begin(), v.end(), print_func);
-	std::cout <<  " ]\n";
+	else
+		multicast_delete_msg(prog, vertex, OUT_EDGE);
 }
-// End Helpers
 
-void set_kmax(graph_engine::ptr graph, size_t& kmax)
-{
-	BOOST_LOG_TRIVIAL(info) << "Computing kmax as max_degree ...";
-	vertex_query::ptr mdq(new max_degree_query());
-	graph->query_on_all(mdq); 
-	kmax = ((max_degree_query *) mdq.get())->get_max_degree();
 }
 
-class activate_k_filter: public vertex_filter {
-	vsize_t min;
-	public:
-	activate_k_filter (vsize_t min) {
-		this->min = min;
-	}
-	bool keep(vertex_program &prog, compute_vertex &v) {
-		kcore_vertex &kcore_v = (kcore_vertex &) v;
-		return kcore_v.get_degree() < min;
-	}
-};
+#include "save_result.h"
 
 FG_vector<size_t>::ptr compute_kcore(FG_graph::ptr fg,
 		size_t k, size_t kmax)
@@ -289,70 +335,46 @@ FG_vector<size_t>::ptr compute_kcore(FG_graph::ptr fg,
 
 	if (k > graph->get_max_vertex_id()) {
 		BOOST_LOG_TRIVIAL(fatal)
-			<< "'k' must be between 2 and the number of nodes in the graph";
+			<< "'k' must not exceed the max vertex ID";
 		exit(-1);
 	}
+	min_core = k;
+	max_core = kmax == 0 ? INVALID_DEGREE - 1 : kmax;
+	for (int i = 0; i < 3; i++)
+		stats[i].reset();
 
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
 	struct timeval start, end;
 	gettimeofday(&start, NULL);
-
-	CURRENT_K = k;
-	BOOST_LOG_TRIVIAL(info) << "Running the init degree stage ...";
-	stage = INIT_DEGREE;
-	graph->start_all(); 
+	graph->set_vertex_scheduler(vertex_scheduler::ptr(new bucket_scheduler()));
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new kcore_vertex_program_creater()));
 	graph->wait4complete();
-	stage = KCORE;
-
-	if (kmax == 0 && k != 0) {
-		set_kmax(graph, kmax);
-	}
-	BOOST_LOG_TRIVIAL(info) << "Setting kmax as " << kmax;
-
-
-	for (; CURRENT_K <= kmax; CURRENT_K++) {
-
-		std::shared_ptr<vertex_filter> filter
-			= std::shared_ptr<vertex_filter>(new activate_k_filter(CURRENT_K));
-
-		graph->start(filter, vertex_program_creater::ptr()); 
-		graph->wait4complete();
-
-		if (all_greater_than_core) { // There's a chance we can hop forward
-			vertex_query::ptr mdq(new min_degree_query());
-			graph->query_on_all(mdq);
-			vsize_t min_degree_remaining = ((min_degree_query *) mdq.get())->get_min_degree();
-
-			if (min_degree_remaining == std::numeric_limits<vsize_t>::max()) {
-				BOOST_LOG_TRIVIAL(info) << "No more active vertices left!";
-				break;
-			}
-
-			BOOST_LOG_TRIVIAL(info)
-				<< "The graphs minimum degree remaining is " << min_degree_remaining;
-			// Effectively jumps us to the CURRENT_K + 1th core
-			CURRENT_K = min_degree_remaining; // NOTE: Careful - messing with the loop variable :/
-
-			if (CURRENT_K > kmax) {
-				BOOST_LOG_TRIVIAL(info) << "Terminating computation at kmax";
-				break;
-			}
-		}
-		all_greater_than_core = true;
-
-#if 1
-		vertex_query::ptr cvq(new count_vertex_query());
-		graph->query_on_all(cvq);
-		size_t in_k_core = ((count_vertex_query *) cvq.get())->get_num();
-		BOOST_LOG_TRIVIAL(info)
-			<< boost::format("%1%-core shows %2% vertices > %3% degree")
-			% CURRENT_K % in_k_core % CURRENT_K;
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
 #endif
-		PREVIOUS_K = CURRENT_K;
-	}
 
-	gettimeofday(&end, NULL);
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	size_t num_deleted = 0;
+	vsize_t max_k = 0;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		kcore_vertex_program::ptr kprog = kcore_vertex_program::cast2(vprog);
+		num_deleted += kprog->get_num_deleted();
+		max_k = std::max(max_k, kprog->get_curr_k());
+	}
+	max_k = std::min(max_k, max_core);
 	BOOST_LOG_TRIVIAL(info)
 		<< boost::format("K-core took %1% sec to complete") % time_diff(start, end);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("%1% vertices are peeled and the largest core is %2%")
+		% num_deleted % max_k;
 
 	FG_vector<size_t>::ptr ret = FG_vector<size_t>::create(
 			graph->get_num_vertices());
@@ -362,4 +384,3 @@ FG_vector<size_t>::ptr compute_kcore(FG_graph::ptr fg,
 
 	return ret;
 }
-
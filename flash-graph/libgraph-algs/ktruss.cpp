@@ -0,0 +1,514 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <limits>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "edge_state.h"
+#include "FG_vector.h"
+#include "FGlib.h"
+#include "scan_graph.h"
+
+/*
+ * This is the truss decomposition of an undirected graph. The support of
+ * an edge is the number of triangles that contain the edge. The k-truss
+ * is the largest subgraph in which every edge has a support of at least
+ * k - 2, and the truss number of an edge is the largest k of the k-trusses
+ * that contain the edge.
+ *
+ * An edge appears in the adjacency lists of both of its endpoints. Its
+ * state is kept in the copy in the adjacency list of the endpoint with
+ * the smaller ID, and the states of all edges are stored in edge state
+ * arrays indexed by the offsets of the edges in the adjacency lists.
+ * The copy in the other adjacency list points to the copy with the state.
+ * Duplicated edges and self-loops don't have state.
+ *
+ * In the first pass, every vertex intersects its neighbor list with the
+ * neighbor lists of its neighbors with larger IDs to get the supports of
+ * its edges. The edges are then peeled in rounds. A round removes all
+ * edges whose supports are below the threshold, and only the removed
+ * edges are intersected again to decrease the supports of the other edges
+ * in their triangles. Only the edges whose supports drop below
+ * the threshold are checked in the next round.
+ */
+
+namespace {
+
+const double BIN_SEARCH_RATIO = 100;
+const int HASH_SEARCH_RATIO = 16;
+const size_t INVALID_LOC = std::numeric_limits<size_t>::max();
+
+enum truss_phase_type
+{
+	COUNT_SUPPORT,
+	PEEL,
+	COLLECT_EDGES,
+};
+
+truss_phase_type truss_phase;
+// The current round of peeling. Rounds start from 1.
+uint32_t curr_round;
+// A removed edge has a support below this threshold.
+int32_t threshold;
+
+// The number of triangles of an edge that haven't been removed.
+edge_state_array<std::atomic<int32_t> >::ptr supports;
+// The location of the copy of an edge that keeps the state.
+edge_state_array<size_t>::ptr state_locs;
+// The round in which an edge is removed. It's 0 if the edge isn't removed.
+edge_state_array<uint32_t>::ptr removed_rounds;
+// The truss number of the edges removed in each round.
+std::vector<vsize_t> round_trusses;
+
+bool has_state(size_t loc)
+{
+	return state_locs->get(loc) == loc;
+}
+
+/*
+ * The neighbor list with the location of the edge to each neighbor.
+ */
+class truss_neighbor_list: public neighbor_list
+{
+	std::vector<size_t> locs;
+public:
+	truss_neighbor_list(const page_vertex &vertex,
+			const std::vector<attributed_neighbor> &neighbors,
+			const std::vector<size_t> &locs): neighbor_list(vertex, neighbors) {
+		this->locs = locs;
+	}
+
+	size_t get_loc_at(size_t idx) const {
+		return locs[idx];
+	}
+
+	size_t get_loc(vertex_id_t id) const {
+		edge_set_t::const_iterator it = neighbor_set->find(id);
+		assert(it != neighbor_set->end());
+		return locs[(*it).get_idx()];
+	}
+
+	void get_common_neighbors(const page_vertex &v,
+			std::vector<vertex_id_t> &common_neighs) const;
+};
+
+/*
+ * This intersects the whole neighbor lists with the same methods that
+ * scan statistics use.
+ */
+void truss_neighbor_list::get_common_neighbors(const page_vertex &v,
+		std::vector<vertex_id_t> &common_neighs) const
+{
+	common_neighs.clear();
+	size_t num_v_edges = v.get_num_edges(edge_type::OUT_EDGE);
+	if (num_v_edges == 0 || this->empty())
+		return;
+
+	page_byte_array::const_iterator<vertex_id_t> other_it
+		= v.get_neigh_begin(edge_type::OUT_EDGE);
+	page_byte_array::const_iterator<vertex_id_t> other_end
+		= v.get_neigh_end(edge_type::OUT_EDGE);
+	if (num_v_edges / this->size() > BIN_SEARCH_RATIO)
+		count_edges_bin_search_other(&v, get_id_begin(), get_id_end(),
+				other_it, other_end, &common_neighs);
+	else if (this->size() / num_v_edges > (size_t) HASH_SEARCH_RATIO)
+		count_edges_hash(&v, other_it, other_end, &common_neighs);
+	else
+		count_edges_scan(&v, get_id_begin(), get_id_end(),
+				v.get_neigh_seq_it(edge_type::OUT_EDGE, 0, num_v_edges),
+				&common_neighs);
+	// A neighbor may be found multiple times if it's duplicated in v.
+	common_neighs.erase(std::unique(common_neighs.begin(),
+				common_neighs.end()), common_neighs.end());
+}
+
+/*
+ * The location of the first edge to a neighbor in an adjacency list.
+ */
+size_t find_loc(const page_vertex &v, vertex_id_t neigh)
+{
+	page_byte_array::const_iterator<vertex_id_t> begin
+		= v.get_neigh_begin(edge_type::OUT_EDGE);
+	page_byte_array::const_iterator<vertex_id_t> end
+		= v.get_neigh_end(edge_type::OUT_EDGE);
+	page_byte_array::const_iterator<vertex_id_t> it
+		= std::lower_bound(begin, end, neigh);
+	assert(it != end && *it == neigh);
+	return supports->get_loc(v.get_id(), edge_type::OUT_EDGE, it - begin);
+}
+
+class truss_vertex: public compute_vertex
+{
+	truss_neighbor_list *neighbors;
+	vsize_t num_joined;
+	vsize_t num_required;
+
+	void run_on_itself(vertex_program &prog, const page_vertex &vertex);
+	void run_on_neighbor(vertex_program &prog, const page_vertex &vertex);
+	void peel_edge(vertex_program &prog, const page_vertex &vertex);
+public:
+	truss_vertex(vertex_id_t id): compute_vertex(id) {
+		neighbors = NULL;
+		num_joined = 0;
+		num_required = 0;
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (prog.get_graph().get_num_edges(id) > 0)
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		if (vertex.get_id() == prog.get_vertex_id(*this))
+			run_on_itself(prog, vertex);
+		else
+			run_on_neighbor(prog, vertex);
+	}
+
+	void run_on_message(vertex_program &, const vertex_message &) {
+	}
+};
+
+class truss_vertex_program: public vertex_program_impl<truss_vertex>
+{
+	// The vertices with edges whose supports drop below the threshold.
+	std::vector<vertex_id_t> below_vertices;
+	std::vector<vertex_id_t> common_neighs;
+	// The edges with their truss numbers.
+	std::vector<edge<vsize_t> > edge_trusses;
+public:
+	typedef std::shared_ptr<truss_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<truss_vertex_program, vertex_program>(
+				prog);
+	}
+
+	std::vector<vertex_id_t> &get_common_buf() {
+		return common_neighs;
+	}
+
+	void dec_support(size_t loc, vertex_id_t owner) {
+		if (supports->get(loc).fetch_sub(1) == threshold)
+			below_vertices.push_back(owner);
+	}
+
+	const std::vector<vertex_id_t> &get_below_vertices() const {
+		return below_vertices;
+	}
+
+	void add_edge_truss(vertex_id_t from, vertex_id_t to, vsize_t truss) {
+		edge_trusses.push_back(edge<vsize_t>(from, to, truss));
+	}
+
+	const std::vector<edge<vsize_t> > &get_edge_trusses() const {
+		return edge_trusses;
+	}
+};
+
+class truss_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new truss_vertex_program());
+	}
+};
+
+void truss_vertex::run_on_itself(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	vertex_id_t id = vertex.get_id();
+	std::vector<attributed_neighbor> neighs;
+	std::vector<size_t> locs;
+	std::vector<vertex_id_t> required;
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+	for (size_t i = 0; it.has_next(); i++) {
+		vertex_id_t neigh = it.next();
+		if (neigh == id || (!neighs.empty() && neighs.back().get_id() == neigh))
+			continue;
+		size_t loc = supports->get_loc(id, edge_type::OUT_EDGE, i);
+		neighs.push_back(attributed_neighbor(neigh));
+		locs.push_back(loc);
+		if (neigh < id)
+			continue;
+		if (truss_phase == COLLECT_EDGES)
+			((truss_vertex_program &) prog).add_edge_truss(id, neigh,
+					round_trusses[removed_rounds->get(loc)]);
+		else if (truss_phase == COUNT_SUPPORT) {
+			state_locs->get(loc) = loc;
+			required.push_back(neigh);
+		}
+		else if (removed_rounds->get(loc) == curr_round)
+			required.push_back(neigh);
+	}
+	if (required.empty())
+		return;
+
+	neighbors = new truss_neighbor_list(vertex, neighs, locs);
+	num_joined = 0;
+	num_required = required.size();
+	request_vertices(required.data(), required.size());
+}
+
+void truss_vertex::run_on_neighbor(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	truss_vertex_program &tprog = (truss_vertex_program &) prog;
+	std::vector<vertex_id_t> &common_neighs = tprog.get_common_buf();
+	neighbors->get_common_neighbors(vertex, common_neighs);
+	size_t loc = neighbors->get_loc(vertex.get_id());
+	if (truss_phase == COUNT_SUPPORT) {
+		supports->get(loc).store(common_neighs.size());
+		state_locs->get(find_loc(vertex, neighbors->get_id())) = loc;
+	}
+	else
+		peel_edge(prog, vertex);
+
+	num_joined++;
+	if (num_joined == num_required) {
+		delete neighbors;
+		neighbors = NULL;
+	}
+}
+
+/*
+ * The edge to the neighbor is removed in this round, so the other edges
+ * in its triangles lose a triangle. If another edge of a triangle is also
+ * removed in this round, the edge with the smaller location decreases
+ * the support of the remaining edge.
+ */
+void truss_vertex::peel_edge(vertex_program &prog, const page_vertex &vertex)
+{
+	truss_vertex_program &tprog = (truss_vertex_program &) prog;
+	const std::vector<vertex_id_t> &common_neighs = tprog.get_common_buf();
+	vertex_id_t id = neighbors->get_id();
+	vertex_id_t neigh_id = vertex.get_id();
+	size_t loc1 = neighbors->get_loc(neigh_id);
+	for (size_t i = 0; i < common_neighs.size(); i++) {
+		vertex_id_t w = common_neighs[i];
+		size_t loc2 = state_locs->get(neighbors->get_loc(w));
+		size_t loc3 = state_locs->get(find_loc(vertex, w));
+		uint32_t round2 = removed_rounds->get(loc2);
+		uint32_t round3 = removed_rounds->get(loc3);
+		// The triangle was removed in a previous round.
+		if ((round2 > 0 && round2 < curr_round)
+				|| (round3 > 0 && round3 < curr_round))
+			continue;
+
+		bool removed2 = round2 == curr_round;
+		bool removed3 = round3 == curr_round;
+		if (!removed2 && !removed3) {
+			tprog.dec_support(loc2, std::min(id, w));
+			tprog.dec_support(loc3, std::min(neigh_id, w));
+		}
+		else if (removed2 && !removed3 && loc1 < loc2)
+			tprog.dec_support(loc3, std::min(neigh_id, w));
+		else if (!removed2 && removed3 && loc1 < loc3)
+			tprog.dec_support(loc2, std::min(id, w));
+	}
+}
+
+/*
+ * Remove the edges of the vertices whose supports are below the threshold.
+ * It returns the vertices with removed edges.
+ */
+size_t remove_edges(const std::vector<vertex_id_t> &vertices,
+		std::vector<vertex_id_t> &removed_vertices)
+{
+	std::vector<char> has_removed(vertices.size());
+	size_t num_removed = 0;
+#pragma omp parallel for reduction(+:num_removed)
+	for (size_t i = 0; i < vertices.size(); i++) {
+		vertex_id_t id = vertices[i];
+		size_t end = supports->get_end(id, edge_type::OUT_EDGE);
+		for (size_t loc = supports->get_begin(id, edge_type::OUT_EDGE);
+				loc < end; loc++) {
+			if (has_state(loc) && removed_rounds->get(loc) == 0
+					&& supports->get(loc).load() < threshold) {
+				removed_rounds->get(loc) = curr_round;
+				has_removed[i] = true;
+				num_removed++;
+			}
+		}
+	}
+	removed_vertices.clear();
+	for (size_t i = 0; i < vertices.size(); i++)
+		if (has_removed[i])
+			removed_vertices.push_back(vertices[i]);
+	return num_removed;
+}
+
+}
+
+FG_vector<vsize_t>::ptr compute_ktruss(FG_graph::ptr fg,
+		std::vector<edge<vsize_t> > *edge_trusses)
+{
+	graph_index::ptr index = NUMA_graph_index<truss_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	if (graph->is_directed()) {
+		BOOST_LOG_TRIVIAL(error) << "k-truss only supports undirected graphs";
+		return FG_vector<vsize_t>::ptr();
+	}
+
+	size_t num_vertices = graph->get_num_vertices();
+	supports = edge_state_array<std::atomic<int32_t> >::create(*graph,
+			edge_type::OUT_EDGE);
+	state_locs = edge_state_array<size_t>::create(*graph, edge_type::OUT_EDGE);
+	removed_rounds = edge_state_array<uint32_t>::create(*graph,
+			edge_type::OUT_EDGE);
+#pragma omp parallel for
+	for (int i = 0; i < state_locs->get_num_parts(); i++) {
+		size_t end = state_locs->get_part_end(i);
+		for (size_t loc = state_locs->get_part_begin(i); loc < end; loc++)
+			state_locs->get(loc) = INVALID_LOC;
+	}
+
+	BOOST_LOG_TRIVIAL(info) << "k-truss starts";
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	truss_phase = COUNT_SUPPORT;
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new truss_vertex_program_creater()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"counting supports takes %1% seconds") % time_diff(start, end);
+
+	round_trusses.clear();
+	round_trusses.push_back(0);
+	std::vector<vertex_id_t> all_vertices(num_vertices);
+	for (size_t i = 0; i < num_vertices; i++)
+		all_vertices[i] = i;
+	truss_phase = PEEL;
+	curr_round = 0;
+	int32_t k = 2;
+	while (true) {
+		// The edges with the minimal support are in the k-truss
+		// with k = support + 2, and they are peeled first.
+		int32_t min_support = std::numeric_limits<int32_t>::max();
+#pragma omp parallel for reduction(min:min_support)
+		for (int i = 0; i < supports->get_num_parts(); i++) {
+			size_t end = supports->get_part_end(i);
+			for (size_t loc = supports->get_part_begin(i); loc < end; loc++) {
+				if (has_state(loc) && removed_rounds->get(loc) == 0)
+					min_support = std::min(min_support,
+							supports->get(loc).load());
+			}
+		}
+		// All edges have been removed.
+		if (min_support == std::numeric_limits<int32_t>::max())
+			break;
+		k = std::max(k + 1, min_support + 3);
+		threshold = k - 2;
+
+		size_t num_level_removed = 0;
+		size_t num_rounds = 0;
+		std::vector<vertex_id_t> vertices = all_vertices;
+		while (true) {
+			curr_round++;
+			round_trusses.push_back(k - 1);
+			std::vector<vertex_id_t> removed_vertices;
+			size_t num_removed = remove_edges(vertices, removed_vertices);
+			if (num_removed == 0)
+				break;
+			num_level_removed += num_removed;
+			num_rounds++;
+
+			graph->start(removed_vertices.data(), removed_vertices.size(),
+					vertex_initializer::ptr(), vertex_program_creater::ptr(
+						new truss_vertex_program_creater()));
+			graph->wait4complete();
+
+			std::vector<vertex_program::ptr> vprogs;
+			graph->get_vertex_programs(vprogs);
+			vertices.clear();
+			BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+				const std::vector<vertex_id_t> &below
+					= truss_vertex_program::cast2(vprog)->get_below_vertices();
+				vertices.insert(vertices.end(), below.begin(), below.end());
+			}
+			std::sort(vertices.begin(), vertices.end());
+			vertices.erase(std::unique(vertices.begin(), vertices.end()),
+					vertices.end());
+		}
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"%1%-truss: %2% edges are removed in %3% rounds")
+			% k % num_level_removed % num_rounds;
+	}
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"k-truss takes %1% seconds") % time_diff(start, end);
+
+	// The truss number of a vertex is the largest truss number of its edges.
+	FG_vector<vsize_t>::ptr vec = FG_vector<vsize_t>::create(graph);
+#pragma omp parallel for
+	for (size_t i = 0; i < num_vertices; i++) {
+		vsize_t truss = 0;
+		size_t end = supports->get_end(i, edge_type::OUT_EDGE);
+		for (size_t loc = supports->get_begin(i, edge_type::OUT_EDGE);
+				loc < end; loc++) {
+			size_t state_loc = state_locs->get(loc);
+			if (state_loc != INVALID_LOC)
+				truss = std::max(truss,
+						round_trusses[removed_rounds->get(state_loc)]);
+		}
+		vec->set(i, truss);
+	}
+
+	// Each edge is collected by its endpoint with the smaller ID, which
+	// keeps the state of the edge.
+	if (edge_trusses) {
+		truss_phase = COLLECT_EDGES;
+		graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+					new truss_vertex_program_creater()));
+		graph->wait4complete();
+
+		std::vector<vertex_program::ptr> vprogs;
+		graph->get_vertex_programs(vprogs);
+		edge_trusses->clear();
+		BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+			const std::vector<edge<vsize_t> > &trusses
+				= truss_vertex_program::cast2(vprog)->get_edge_trusses();
+			edge_trusses->insert(edge_trusses->end(), trusses.begin(),
+					trusses.end());
+		}
+	}
+	supports.reset();
+	state_locs.reset();
+	removed_rounds.reset();
+	return vec;
+}
@@ -0,0 +1,272 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <limits>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FG_vector.h"
+#include "FGlib.h"
+#include "alg_utils.h"
+
+/*
+ * This is label propagation for community detection. Each vertex starts
+ * with its own ID as its label and repeatedly takes the most frequent
+ * label among its neighbors. Edge direction is ignored.
+ *
+ * The labels are kept in an array shared by all threads, so a vertex
+ * sees the labels its neighbors have updated in the current iteration.
+ * A vertex keeps its label if the label is one of the most frequent ones.
+ * Otherwise, ties are broken by a hash of the vertex and the labels,
+ * so they aren't biased towards small labels.
+ *
+ * Only the neighbors of the vertices that change their labels run in
+ * the next iteration, so the computation stops once the labels are stable.
+ */
+
+namespace {
+
+int max_iters;
+int start_level;
+bool directed_graph;
+
+std::unique_ptr<std::atomic<vertex_id_t>[]> labels;
+
+uint32_t tie_break_key(vertex_id_t id, vertex_id_t label)
+{
+	return hash64((((uint64_t) id) << 32) | label);
+}
+
+class label_vertex: public compute_directed_vertex
+{
+	void add_labels(const page_vertex &vertex, edge_type type,
+			std::vector<vertex_id_t> &neigh_labels) const;
+	void activate_neighbors(vertex_program &prog,
+			const page_vertex &vertex) const;
+public:
+	label_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (directed_graph) {
+			directed_vertex_request req(id, edge_type::BOTH_EDGES);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &, const vertex_message &) {
+	}
+};
+
+class label_vertex_program: public vertex_program_impl<label_vertex>
+{
+	// The buffer for collecting the labels of a vertex's neighbors.
+	std::vector<vertex_id_t> neigh_labels;
+	size_t num_changes;
+public:
+	typedef std::shared_ptr<label_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<label_vertex_program, vertex_program>(
+				prog);
+	}
+
+	label_vertex_program() {
+		num_changes = 0;
+	}
+
+	std::vector<vertex_id_t> &get_label_buf() {
+		return neigh_labels;
+	}
+
+	void inc_changes() {
+		num_changes++;
+	}
+
+	size_t get_num_changes() const {
+		return num_changes;
+	}
+};
+
+class label_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new label_vertex_program());
+	}
+};
+
+void label_vertex::add_labels(const page_vertex &vertex, edge_type type,
+		std::vector<vertex_id_t> &neigh_labels) const
+{
+	vertex_id_t id = vertex.get_id();
+	edge_seq_iterator it = vertex.get_neigh_seq_it(type);
+	while (it.has_next()) {
+		vertex_id_t neigh = it.next();
+		if (neigh != id)
+			neigh_labels.push_back(labels[neigh].load(std::memory_order_relaxed));
+	}
+}
+
+void label_vertex::activate_neighbors(vertex_program &prog,
+		const page_vertex &vertex) const
+{
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+	prog.activate_vertices(it);
+	if (directed_graph) {
+		it = vertex.get_neigh_seq_it(edge_type::IN_EDGE);
+		prog.activate_vertices(it);
+	}
+}
+
+void label_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	label_vertex_program &lprog = (label_vertex_program &) prog;
+	std::vector<vertex_id_t> &neigh_labels = lprog.get_label_buf();
+	neigh_labels.clear();
+	add_labels(vertex, edge_type::OUT_EDGE, neigh_labels);
+	if (directed_graph)
+		add_labels(vertex, edge_type::IN_EDGE, neigh_labels);
+	if (neigh_labels.empty())
+		return;
+	std::sort(neigh_labels.begin(), neigh_labels.end());
+
+	vertex_id_t id = vertex.get_id();
+	vertex_id_t curr_label = labels[id].load(std::memory_order_relaxed);
+	vertex_id_t best_label = curr_label;
+	size_t best_count = 0;
+	uint32_t best_key = 0;
+	bool keep_curr = false;
+	for (size_t i = 0; i < neigh_labels.size();) {
+		size_t j = i + 1;
+		while (j < neigh_labels.size() && neigh_labels[j] == neigh_labels[i])
+			j++;
+		size_t count = j - i;
+		vertex_id_t label = neigh_labels[i];
+		uint32_t key = tie_break_key(id, label);
+		if (count > best_count) {
+			best_count = count;
+			best_label = label;
+			best_key = key;
+			keep_curr = label == curr_label;
+		}
+		else if (count == best_count) {
+			if (label == curr_label)
+				keep_curr = true;
+			else if (key < best_key) {
+				best_label = label;
+				best_key = key;
+			}
+		}
+		i = j;
+	}
+	if (keep_curr || best_label == curr_label)
+		return;
+
+	labels[id].store(best_label, std::memory_order_relaxed);
+	lprog.inc_changes();
+	// The neighbors need to check their labels again.
+	if (prog.get_graph().get_curr_level() + 1 - start_level < max_iters)
+		activate_neighbors(prog, vertex);
+}
+
+class label_query: public vertex_query
+{
+	FG_vector<vertex_id_t>::ptr vec;
+public:
+	label_query(FG_vector<vertex_id_t>::ptr vec) {
+		this->vec = vec;
+	}
+
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		vec->set(id, labels[id].load());
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new label_query(vec));
+	}
+};
+
+}
+
+FG_vector<vertex_id_t>::ptr compute_label_propagation(FG_graph::ptr fg,
+		int num_iters)
+{
+	graph_index::ptr index = NUMA_graph_index<label_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	directed_graph = fg->get_graph_header().is_directed_graph();
+	max_iters = num_iters;
+
+	size_t num_vertices = graph->get_num_vertices();
+	labels = std::unique_ptr<std::atomic<vertex_id_t>[]>(
+			new std::atomic<vertex_id_t>[num_vertices]);
+#pragma omp parallel for
+	for (size_t i = 0; i < num_vertices; i++)
+		labels[i].store(i, std::memory_order_relaxed);
+
+	BOOST_LOG_TRIVIAL(info) << "label propagation starts";
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	start_level = graph->get_curr_level();
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new label_vertex_program_creater()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	size_t num_changes = 0;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		num_changes += label_vertex_program::cast2(vprog)->get_num_changes();
+	}
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"label propagation takes %1% seconds in %2% iterations and changes labels %3% times")
+		% time_diff(start, end) % (graph->get_curr_level() - start_level)
+		% num_changes;
+
+	FG_vector<vertex_id_t>::ptr vec = FG_vector<vertex_id_t>::create(graph);
+	graph->query_on_all(vertex_query::ptr(new label_query(vec)));
+	labels.reset();
+	return vec;
+}
@@ -0,0 +1,519 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <limits>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <algorithm>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FG_vector.h"
+#include "FGlib.h"
+#include "utils.h"
+#include "in_mem_storage.h"
+
+/*
+ * This is the Louvain method for community detection, which maximizes
+ * the modularity of the communities. Edge direction is ignored.
+ *
+ * Each level has two phases:
+ * In the local-move phase, every vertex reads its edge list and moves
+ * to the neighboring community that gives the largest modularity gain.
+ * The communities of vertices and the total weights of the communities
+ * are kept in arrays shared by all threads, so the vertices move
+ * asynchronously. Only the neighbors of the vertices that move run
+ * in the next iteration.
+ * In the aggregation phase, every vertex reads its edge list again and
+ * adds the weights of its edges to the pairs of communities they connect.
+ * The communities become the vertices of a new in-memory graph with
+ * the weights as edge counts, and the next level runs on it.
+ *
+ * The graph of a coarsened level is stored as a directed graph with
+ * an edge in each direction between two communities, because only
+ * directed vertices have edge data. The weight inside a community is
+ * stored as a self-loop, which is counted twice like the other edges
+ * inside the community.
+ */
+
+namespace {
+
+typedef int64_t weight_t;
+
+const vertex_id_t INVALID_COMM = std::numeric_limits<vertex_id_t>::max();
+
+enum louvain_phase_type
+{
+	LOCAL_MOVE,
+	AGGREGATE,
+};
+
+louvain_phase_type louvain_phase;
+int max_iters;
+int start_level;
+// In the input graph, a directed graph reads both in-edges and out-edges.
+// In a coarsened graph, it only reads out-edges, which have the weights.
+bool read_both_edges;
+bool weighted;
+// The sum of the weights of all vertices (i.e., 2m).
+double total_weight;
+
+// The weight of each vertex in the current level.
+std::vector<weight_t> vertex_weights;
+std::unique_ptr<std::atomic<vertex_id_t>[]> comms;
+std::unique_ptr<std::atomic<weight_t>[]> comm_weights;
+std::unique_ptr<std::atomic<vsize_t>[]> comm_sizes;
+
+/*
+ * Invoke `func' on each neighbor of a vertex with the weight of the edge.
+ */
+template<class Func>
+void for_each_neighbor(const page_vertex &vertex, edge_type type, Func &func)
+{
+	edge_seq_iterator it = vertex.get_neigh_seq_it(type);
+	if (!weighted) {
+		while (it.has_next())
+			func(it.next(), 1);
+		return;
+	}
+
+	const page_directed_vertex &dvertex = (const page_directed_vertex &) vertex;
+	page_byte_array::seq_const_iterator<edge_count> data_it
+		= dvertex.get_data_seq_it<edge_count>(type);
+	while (it.has_next()) {
+		vertex_id_t neigh = it.next();
+		BOOST_VERIFY(data_it.has_next());
+		func(neigh, data_it.next().get_count());
+	}
+}
+
+template<class Func>
+void for_each_neighbor(const page_vertex &vertex, Func &func)
+{
+	for_each_neighbor(vertex, edge_type::OUT_EDGE, func);
+	if (read_both_edges)
+		for_each_neighbor(vertex, edge_type::IN_EDGE, func);
+}
+
+class louvain_vertex: public compute_directed_vertex
+{
+	void local_move(vertex_program &prog, const page_vertex &vertex);
+	void aggregate(vertex_program &prog, const page_vertex &vertex);
+public:
+	louvain_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		// An isolated vertex stays in its own community.
+		if (vertex_weights[id] == 0)
+			return;
+		if (prog.get_graph().is_directed()) {
+			directed_vertex_request req(id, read_both_edges
+					? edge_type::BOTH_EDGES : edge_type::OUT_EDGE);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		if (louvain_phase == LOCAL_MOVE)
+			local_move(prog, vertex);
+		else
+			aggregate(prog, vertex);
+	}
+
+	void run_on_message(vertex_program &, const vertex_message &) {
+	}
+};
+
+typedef std::pair<vertex_id_t, weight_t> comm_weight_t;
+
+class louvain_vertex_program: public vertex_program_impl<louvain_vertex>
+{
+	// The buffer for collecting the communities of a vertex's neighbors.
+	std::vector<comm_weight_t> neigh_comms;
+	// The weights between pairs of communities in the aggregation phase.
+	std::unordered_map<uint64_t, weight_t> comm_edges;
+	size_t num_moves;
+public:
+	typedef std::shared_ptr<louvain_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<louvain_vertex_program, vertex_program>(
+				prog);
+	}
+
+	louvain_vertex_program() {
+		num_moves = 0;
+	}
+
+	std::vector<comm_weight_t> &get_comm_buf() {
+		return neigh_comms;
+	}
+
+	void add_comm_edge(vertex_id_t from, vertex_id_t to, weight_t weight) {
+		comm_edges[(((uint64_t) from) << 32) | to] += weight;
+	}
+
+	const std::unordered_map<uint64_t, weight_t> &get_comm_edges() const {
+		return comm_edges;
+	}
+
+	void inc_moves() {
+		num_moves++;
+	}
+
+	size_t get_num_moves() const {
+		return num_moves;
+	}
+};
+
+class louvain_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new louvain_vertex_program());
+	}
+};
+
+class add_comm_func
+{
+	vertex_id_t id;
+	std::vector<comm_weight_t> &neigh_comms;
+public:
+	add_comm_func(vertex_id_t id,
+			std::vector<comm_weight_t> &_neigh_comms): neigh_comms(_neigh_comms) {
+		this->id = id;
+	}
+
+	void operator()(vertex_id_t neigh, weight_t weight) {
+		// A self-loop doesn't connect the vertex to any community.
+		if (neigh != id)
+			neigh_comms.push_back(comm_weight_t(
+						comms[neigh].load(std::memory_order_relaxed), weight));
+	}
+};
+
+struct comm_less
+{
+	bool operator()(const comm_weight_t &c1, const comm_weight_t &c2) const {
+		return c1.first < c2.first;
+	}
+};
+
+void louvain_vertex::local_move(vertex_program &prog, const page_vertex &vertex)
+{
+	louvain_vertex_program &lprog = (louvain_vertex_program &) prog;
+	vertex_id_t id = vertex.get_id();
+	std::vector<comm_weight_t> &neigh_comms = lprog.get_comm_buf();
+	neigh_comms.clear();
+	add_comm_func func(id, neigh_comms);
+	for_each_neighbor(vertex, func);
+	std::sort(neigh_comms.begin(), neigh_comms.end(), comm_less());
+
+	// The modularity gain of moving the vertex to community `c' is
+	// proportional to k_{v,c} - tot_c * k_v / 2m, where tot_c
+	// doesn't include the vertex itself.
+	weight_t weight = vertex_weights[id];
+	vertex_id_t curr_comm = comms[id].load(std::memory_order_relaxed);
+	double scale = weight / total_weight;
+	double stay_gain = -(comm_weights[curr_comm].load() - weight) * scale;
+	vertex_id_t best_comm = curr_comm;
+	double best_gain = 0;
+	for (size_t i = 0; i < neigh_comms.size();) {
+		vertex_id_t comm = neigh_comms[i].first;
+		weight_t comm_weight = 0;
+		for (; i < neigh_comms.size() && neigh_comms[i].first == comm; i++)
+			comm_weight += neigh_comms[i].second;
+		if (comm == curr_comm) {
+			stay_gain += comm_weight;
+			continue;
+		}
+		double gain = comm_weight - comm_weights[comm].load() * scale;
+		if (best_comm == curr_comm || gain > best_gain) {
+			best_comm = comm;
+			best_gain = gain;
+		}
+	}
+	// The vertex only moves if it improves modularity.
+	if (best_comm == curr_comm || best_gain <= stay_gain)
+		return;
+	// Two vertices alone in their communities may move to each other's
+	// community at the same time. We only allow the one that moves to
+	// the community with a smaller ID.
+	if (comm_sizes[curr_comm].load() == 1 && comm_sizes[best_comm].load() == 1
+			&& best_comm > curr_comm)
+		return;
+
+	comms[id].store(best_comm, std::memory_order_relaxed);
+	comm_weights[curr_comm] -= weight;
+	comm_weights[best_comm] += weight;
+	comm_sizes[curr_comm]--;
+	comm_sizes[best_comm]++;
+	lprog.inc_moves();
+	// The neighbors may want to move after the vertex moves.
+	if (prog.get_graph().get_curr_level() + 1 - start_level < max_iters) {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+		prog.activate_vertices(it);
+		if (read_both_edges) {
+			it = vertex.get_neigh_seq_it(edge_type::IN_EDGE);
+			prog.activate_vertices(it);
+		}
+	}
+}
+
+class add_comm_edge_func
+{
+	vertex_id_t comm;
+	louvain_vertex_program &prog;
+public:
+	add_comm_edge_func(vertex_id_t comm,
+			louvain_vertex_program &_prog): prog(_prog) {
+		this->comm = comm;
+	}
+
+	void operator()(vertex_id_t neigh, weight_t weight) {
+		prog.add_comm_edge(comm, comms[neigh].load(std::memory_order_relaxed),
+				weight);
+	}
+};
+
+void louvain_vertex::aggregate(vertex_program &prog, const page_vertex &vertex)
+{
+	vertex_id_t comm = comms[vertex.get_id()].load(std::memory_order_relaxed);
+	add_comm_edge_func func(comm, (louvain_vertex_program &) prog);
+	for_each_neighbor(vertex, func);
+}
+
+/*
+ * The communities become the vertices of the coarsened graph. This gets
+ * the new IDs of the communities. The isolated vertices are left out of
+ * the coarsened graph, so they don't get new IDs.
+ */
+size_t renumber_comms(size_t num_vertices, std::vector<vertex_id_t> &new_ids)
+{
+	new_ids.assign(num_vertices, INVALID_COMM);
+	size_t num_comms = 0;
+	for (size_t i = 0; i < num_vertices; i++) {
+		if (comm_weights[i].load() > 0)
+			new_ids[i] = num_comms++;
+	}
+	return num_comms;
+}
+
+void init_level(size_t num_vertices)
+{
+	comms = std::unique_ptr<std::atomic<vertex_id_t>[]>(
+			new std::atomic<vertex_id_t>[num_vertices]);
+	comm_weights = std::unique_ptr<std::atomic<weight_t>[]>(
+			new std::atomic<weight_t>[num_vertices]);
+	comm_sizes = std::unique_ptr<std::atomic<vsize_t>[]>(
+			new std::atomic<vsize_t>[num_vertices]);
+	total_weight = 0;
+#pragma omp parallel for reduction(+:total_weight)
+	for (size_t i = 0; i < num_vertices; i++) {
+		comms[i].store(i);
+		comm_weights[i].store(vertex_weights[i]);
+		comm_sizes[i].store(1);
+		total_weight += vertex_weights[i];
+	}
+}
+
+/*
+ * Run the local-move phase and the aggregation phase on a graph.
+ * It returns the number of moves and the weights between the pairs of
+ * communities sorted by the communities.
+ */
+size_t run_level(FG_graph::ptr fg,
+		std::vector<std::pair<uint64_t, weight_t> > &comm_edges)
+{
+	graph_index::ptr index = NUMA_graph_index<louvain_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	size_t num_vertices = graph->get_num_vertices();
+	// The input graph is unweighted, so the weight of a vertex is its degree.
+	if (!weighted) {
+		vertex_weights.resize(num_vertices);
+#pragma omp parallel for
+		for (size_t i = 0; i < num_vertices; i++)
+			vertex_weights[i] = graph->get_num_edges(i, edge_type::BOTH_EDGES);
+	}
+	init_level(num_vertices);
+	comm_edges.clear();
+	if (total_weight == 0)
+		return 0;
+
+	louvain_phase = LOCAL_MOVE;
+	start_level = graph->get_curr_level();
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new louvain_vertex_program_creater()));
+	graph->wait4complete();
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"local moves run in %1% iterations")
+		% (graph->get_curr_level() - start_level);
+
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	size_t num_moves = 0;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		num_moves += louvain_vertex_program::cast2(vprog)->get_num_moves();
+	}
+
+	louvain_phase = AGGREGATE;
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new louvain_vertex_program_creater()));
+	graph->wait4complete();
+
+	graph->get_vertex_programs(vprogs);
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		const std::unordered_map<uint64_t, weight_t> &edges
+			= louvain_vertex_program::cast2(vprog)->get_comm_edges();
+		comm_edges.insert(comm_edges.end(), edges.begin(), edges.end());
+	}
+	std::sort(comm_edges.begin(), comm_edges.end());
+	// Merge the weights of the same pair of communities from
+	// different threads.
+	size_t num_pairs = 0;
+	for (size_t i = 0; i < comm_edges.size(); i++) {
+		if (num_pairs > 0 && comm_edges[num_pairs - 1].first == comm_edges[i].first)
+			comm_edges[num_pairs - 1].second += comm_edges[i].second;
+		else
+			comm_edges[num_pairs++] = comm_edges[i];
+	}
+	comm_edges.resize(num_pairs);
+	return num_moves;
+}
+
+}
+
+FG_vector<vertex_id_t>::ptr compute_louvain(FG_graph::ptr fg, int num_iters,
+		int max_levels, double *modularity)
+{
+	const graph_header &header = fg->get_graph_header();
+	size_t num_vertices = header.get_num_vertices();
+	// The vertex in the current level each vertex is merged into.
+	FG_vector<vertex_id_t>::ptr membership = FG_vector<vertex_id_t>::create(
+			num_vertices);
+#pragma omp parallel for
+	for (size_t i = 0; i < num_vertices; i++)
+		membership->set(i, i);
+	max_iters = num_iters;
+	read_both_edges = header.is_directed_graph();
+	weighted = false;
+
+	BOOST_LOG_TRIVIAL(info) << "Louvain starts";
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	FG_graph::ptr curr_graph = fg;
+	size_t num_comms = 0;
+	double q = 0;
+	for (int level = 0; level < max_levels; level++) {
+		std::vector<std::pair<uint64_t, weight_t> > comm_edges;
+		size_t num_moves = run_level(curr_graph, comm_edges);
+		if (total_weight == 0)
+			break;
+
+		size_t num_level_vertices = vertex_weights.size();
+		std::vector<vertex_id_t> new_ids;
+		num_comms = renumber_comms(num_level_vertices, new_ids);
+		// The isolated vertices get their community IDs in the end.
+#pragma omp parallel for
+		for (size_t i = 0; i < num_vertices; i++) {
+			vertex_id_t id = membership->get(i);
+			if (id != INVALID_COMM)
+				membership->set(i, new_ids[comms[id].load()]);
+		}
+
+		// Build the coarsened graph. An edge count has only 32 bits,
+		// so we split a large weight into multiple edges.
+		std::vector<vertex_id_t> from;
+		std::vector<vertex_id_t> to;
+		std::vector<edge_count> counts;
+		std::vector<weight_t> new_weights(num_comms);
+		double internal_weight = 0;
+		for (size_t i = 0; i < comm_edges.size(); i++) {
+			vertex_id_t from_id = new_ids[comm_edges[i].first >> 32];
+			vertex_id_t to_id = new_ids[comm_edges[i].first & 0xffffffffUL];
+			weight_t weight = comm_edges[i].second;
+			new_weights[from_id] += weight;
+			if (from_id == to_id)
+				internal_weight += weight;
+			while (weight > 0) {
+				uint32_t count = std::min(weight, (weight_t)
+						std::numeric_limits<uint32_t>::max());
+				from.push_back(from_id);
+				to.push_back(to_id);
+				counts.push_back(edge_count(count));
+				weight -= count;
+			}
+		}
+		q = internal_weight / total_weight;
+		for (size_t i = 0; i < num_comms; i++) {
+			double frac = new_weights[i] / total_weight;
+			q -= frac * frac;
+		}
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"level %1%: %2% moves, %3% communities, modularity: %4%")
+			% level % num_moves % num_comms % q;
+		// The communities don't change any more.
+		if (num_moves == 0 || num_comms == num_level_vertices)
+			break;
+
+		std::string graph_name = (boost::format("louvain-level%1%")
+				% (level + 1)).str();
+		std::pair<in_mem_graph::ptr, vertex_index::ptr> gpair
+			= construct_mem_graph(from, to, counts, graph_name, true,
+					graph_conf.get_num_threads());
+		curr_graph = FG_graph::create(gpair.first, gpair.second, graph_name,
+				fg->get_configs());
+		vertex_weights.swap(new_weights);
+		read_both_edges = false;
+		weighted = true;
+	}
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"Louvain takes %1% seconds") % time_diff(start, end);
+
+	for (size_t i = 0; i < num_vertices; i++) {
+		if (membership->get(i) == INVALID_COMM)
+			membership->set(i, num_comms++);
+	}
+	comms.reset();
+	comm_weights.reset();
+	comm_sizes.reset();
+	std::vector<weight_t>().swap(vertex_weights);
+	if (modularity)
+		*modularity = q;
+	return membership;
+}
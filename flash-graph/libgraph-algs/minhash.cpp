@@ -0,0 +1,469 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+#include "alg_utils.h"
+
+/*
+ * This finds the K most similar vertices of every vertex, where
+ * the similarity of two vertices is the Jaccard similarity of their
+ * neighbors. Edge direction is ignored.
+ *
+ * Every vertex reads its adjacency list once to compute its MinHash
+ * signature. The signature is split into bands, and the vertices whose
+ * signatures are the same in a band become candidate pairs. Only the hash
+ * of a band and the lowest bits of every MinHash value are kept in memory.
+ * The candidates whose similarities estimated from the lowest bits are
+ * below the threshold are dropped. A vertex reads the adjacency lists of
+ * its candidates with larger IDs to compute the exact similarities, and
+ * sends the similarities to both vertices of a pair, which keep the K most
+ * similar vertices.
+ */
+
+namespace {
+
+enum minhash_stage_t
+{
+	SIGNATURE,
+	VERIFY,
+} minhash_stage;
+
+// The number of bits of a MinHash value kept in the signature.
+const int SIG_BITS = 8;
+typedef uint8_t sig_t;
+
+int num_bands;
+int num_rows;
+int topK;
+double min_sim;
+uint64_t rand_seed;
+
+// The hash of every band of the signature of a vertex.
+std::unique_ptr<uint64_t[]> band_keys;
+// The lowest bits of the MinHash values of a vertex.
+std::unique_ptr<sig_t[]> sigs;
+std::unique_ptr<bool[]> has_sig;
+// The candidates of a vertex with larger IDs are between its offset and
+// the offset of the next vertex.
+std::vector<size_t> cand_offs;
+std::vector<vertex_id_t> cands;
+
+int get_num_hashes()
+{
+	return num_bands * num_rows;
+}
+
+size_t get_num_common(const std::vector<vertex_id_t> &neighs1,
+		const std::vector<vertex_id_t> &neighs2)
+{
+	size_t common = 0;
+	size_t i = 0, j = 0;
+	while (i < neighs1.size() && j < neighs2.size()) {
+		vertex_id_t id1 = neighs1[i];
+		vertex_id_t id2 = neighs2[j];
+		common += id1 == id2;
+		i += id1 <= id2;
+		j += id2 <= id1;
+	}
+	return common;
+}
+
+/*
+ * Estimate the Jaccard similarity from the lowest bits of the MinHash
+ * values. Two different MinHash values have the same lowest bits with
+ * the probability of 1 / 2^SIG_BITS.
+ */
+double estimate_sim(vertex_id_t id1, vertex_id_t id2)
+{
+	int num_hashes = get_num_hashes();
+	const sig_t *sig1 = sigs.get() + ((size_t) id1) * num_hashes;
+	const sig_t *sig2 = sigs.get() + ((size_t) id2) * num_hashes;
+	int num_same = 0;
+	for (int i = 0; i < num_hashes; i++)
+		num_same += sig1[i] == sig2[i];
+	double rand_same = 1.0 / (1 << SIG_BITS);
+	return (((double) num_same) / num_hashes - rand_same) / (1 - rand_same);
+}
+
+class sim_message: public vertex_message
+{
+	vertex_id_t other;
+	float sim;
+public:
+	sim_message(vertex_id_t other, float sim): vertex_message(
+			sizeof(sim_message), false) {
+		this->other = other;
+		this->sim = sim;
+	}
+
+	vertex_id_t get_other() const {
+		return other;
+	}
+
+	float get_sim() const {
+		return sim;
+	}
+};
+
+typedef std::pair<float, vertex_id_t> sim_pair_t;
+
+bool more_similar(const sim_pair_t &p1, const sim_pair_t &p2)
+{
+	if (p1.first != p2.first)
+		return p1.first > p2.first;
+	return p1.second < p2.second;
+}
+
+class minhash_vertex: public compute_directed_vertex
+{
+	std::vector<vertex_id_t> *neighbors;
+	vsize_t num_joined;
+	// A heap of the most similar vertices with the least similar at top.
+	std::vector<sim_pair_t> similar;
+
+	void compute_signature(vertex_program &prog, const page_vertex &vertex);
+	void request_candidates(vertex_program &prog, const page_vertex &vertex);
+	void run_on_candidate(vertex_program &prog, const page_vertex &vertex);
+public:
+	minhash_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		neighbors = NULL;
+		num_joined = 0;
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (minhash_stage == VERIFY && cand_offs[id] == cand_offs[id + 1])
+			return;
+		if (prog.get_graph().is_directed()) {
+			directed_vertex_request req(id, edge_type::BOTH_EDGES);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		if (minhash_stage == SIGNATURE)
+			compute_signature(prog, vertex);
+		else if (vertex.get_id() == prog.get_vertex_id(*this))
+			request_candidates(prog, vertex);
+		else
+			run_on_candidate(prog, vertex);
+	}
+
+	void run_on_message(vertex_program &, const vertex_message &msg1) {
+		const sim_message &msg = (const sim_message &) msg1;
+		sim_pair_t pair(msg.get_sim(), msg.get_other());
+		if (similar.size() < (size_t) topK) {
+			similar.push_back(pair);
+			std::push_heap(similar.begin(), similar.end(), more_similar);
+		}
+		else if (more_similar(pair, similar.front())) {
+			std::pop_heap(similar.begin(), similar.end(), more_similar);
+			similar.back() = pair;
+			std::push_heap(similar.begin(), similar.end(), more_similar);
+		}
+	}
+
+	/*
+	 * Get the most similar vertices in the descending order of
+	 * the similarities.
+	 */
+	void get_similar(std::vector<sim_pair_t> &pairs) const {
+		pairs = similar;
+		std::sort(pairs.begin(), pairs.end(), more_similar);
+	}
+};
+
+class minhash_vertex_program: public vertex_program_impl<minhash_vertex>
+{
+	std::vector<vertex_id_t> neighs;
+	std::vector<uint64_t> min_hashes;
+public:
+	std::vector<vertex_id_t> &get_neigh_buf() {
+		return neighs;
+	}
+
+	std::vector<uint64_t> &get_hash_buf() {
+		return min_hashes;
+	}
+};
+
+class minhash_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new minhash_vertex_program());
+	}
+};
+
+void minhash_vertex::compute_signature(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	minhash_vertex_program &mprog = (minhash_vertex_program &) prog;
+	std::vector<vertex_id_t> &neighs = mprog.get_neigh_buf();
+	get_neighbors(prog.get_graph(), vertex, neighs);
+	vertex_id_t id = vertex.get_id();
+	if (neighs.empty())
+		return;
+
+	int num_hashes = get_num_hashes();
+	std::vector<uint64_t> &min_hashes = mprog.get_hash_buf();
+	min_hashes.assign(num_hashes, std::numeric_limits<uint64_t>::max());
+	for (size_t i = 0; i < neighs.size(); i++) {
+		uint64_t h = hash64(rand_seed ^ neighs[i]);
+		// The other hash functions are derived from the first one.
+		for (int j = 0; j < num_hashes; j++) {
+			uint64_t hj = hash64(h + j);
+			min_hashes[j] = std::min(min_hashes[j], hj);
+		}
+	}
+
+	sig_t *sig = sigs.get() + ((size_t) id) * num_hashes;
+	for (int j = 0; j < num_hashes; j++)
+		sig[j] = min_hashes[j];
+	uint64_t *keys = band_keys.get() + ((size_t) id) * num_bands;
+	for (int i = 0; i < num_bands; i++) {
+		uint64_t key = 0;
+		for (int j = 0; j < num_rows; j++)
+			key = hash64(key ^ min_hashes[i * num_rows + j]);
+		keys[i] = key;
+	}
+	has_sig[id] = true;
+}
+
+void minhash_vertex::request_candidates(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	vertex_id_t id = vertex.get_id();
+	neighbors = new std::vector<vertex_id_t>();
+	get_neighbors(prog.get_graph(), vertex, *neighbors);
+	num_joined = 0;
+
+	size_t num_cands = cand_offs[id + 1] - cand_offs[id];
+	vertex_id_t *ids = cands.data() + cand_offs[id];
+	if (prog.get_graph().is_directed()) {
+		std::vector<directed_vertex_request> reqs(num_cands);
+		for (size_t i = 0; i < num_cands; i++)
+			reqs[i] = directed_vertex_request(ids[i], edge_type::BOTH_EDGES);
+		request_partial_vertices(reqs.data(), num_cands);
+	}
+	else
+		request_vertices(ids, num_cands);
+}
+
+void minhash_vertex::run_on_candidate(vertex_program &prog,
+		const page_vertex &vertex)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	std::vector<vertex_id_t> &neighs
+		= ((minhash_vertex_program &) prog).get_neigh_buf();
+	get_neighbors(prog.get_graph(), vertex, neighs);
+	size_t common = get_num_common(*neighbors, neighs);
+	double sim = ((double) common) / (neighbors->size() + neighs.size()
+			- common);
+	if (sim > 0 && sim >= min_sim) {
+		sim_message msg1(vertex.get_id(), sim);
+		prog.send_msg(id, msg1);
+		sim_message msg2(id, sim);
+		prog.send_msg(vertex.get_id(), msg2);
+	}
+
+	num_joined++;
+	if (num_joined == cand_offs[id + 1] - cand_offs[id]) {
+		delete neighbors;
+		neighbors = NULL;
+	}
+}
+
+typedef std::pair<uint64_t, vertex_id_t> band_entry_t;
+
+/*
+ * Add the pairs of vertices in a bucket to the candidates. The vertices
+ * in a large bucket are only paired with the next vertices in the bucket,
+ * so a popular band doesn't generate a quadratic number of pairs.
+ */
+void add_bucket_pairs(std::vector<band_entry_t>::const_iterator begin,
+		std::vector<band_entry_t>::const_iterator end, size_t max_bucket_size,
+		std::vector<uint64_t> &pairs)
+{
+	for (std::vector<band_entry_t>::const_iterator it1 = begin; it1 != end;
+			it1++) {
+		std::vector<band_entry_t>::const_iterator it2 = it1 + 1;
+		for (size_t i = 0; it2 != end && i < max_bucket_size; it2++, i++) {
+			vertex_id_t id1 = std::min(it1->second, it2->second);
+			vertex_id_t id2 = std::max(it1->second, it2->second);
+			if (estimate_sim(id1, id2) >= min_sim)
+				pairs.push_back((((uint64_t) id1) << 32) + id2);
+		}
+	}
+}
+
+void gen_candidates(size_t num_vertices, size_t max_bucket_size)
+{
+	std::vector<std::vector<uint64_t> > band_pairs(num_bands);
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < num_bands; i++) {
+		std::vector<band_entry_t> entries;
+		for (size_t id = 0; id < num_vertices; id++)
+			if (has_sig[id])
+				entries.push_back(band_entry_t(
+							band_keys[id * num_bands + i], id));
+		std::sort(entries.begin(), entries.end());
+		std::vector<band_entry_t>::const_iterator begin = entries.begin();
+		while (begin != entries.end()) {
+			std::vector<band_entry_t>::const_iterator end = begin + 1;
+			while (end != entries.end() && end->first == begin->first)
+				end++;
+			add_bucket_pairs(begin, end, max_bucket_size, band_pairs[i]);
+			begin = end;
+		}
+		std::sort(band_pairs[i].begin(), band_pairs[i].end());
+		band_pairs[i].erase(std::unique(band_pairs[i].begin(),
+					band_pairs[i].end()), band_pairs[i].end());
+	}
+
+	std::vector<uint64_t> pairs;
+	for (int i = 0; i < num_bands; i++) {
+		pairs.insert(pairs.end(), band_pairs[i].begin(), band_pairs[i].end());
+		std::vector<uint64_t>().swap(band_pairs[i]);
+	}
+	std::sort(pairs.begin(), pairs.end());
+	pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+	cand_offs.assign(num_vertices + 1, 0);
+	cands.resize(pairs.size());
+	for (size_t i = 0; i < pairs.size(); i++) {
+		cand_offs[(pairs[i] >> 32) + 1]++;
+		cands[i] = pairs[i] & 0xffffffffUL;
+	}
+	for (size_t i = 0; i < num_vertices; i++)
+		cand_offs[i + 1] += cand_offs[i];
+}
+
+void write_similar(graph_engine &graph, const std::string &file)
+{
+	FILE *f = fopen(file.c_str(), "w");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't open %1%: %2%")
+			% file % strerror(errno);
+		return;
+	}
+	std::vector<sim_pair_t> pairs;
+	for (size_t id = 0; id < graph.get_num_vertices(); id++) {
+		((minhash_vertex &) graph.get_vertex(id)).get_similar(pairs);
+		if (pairs.empty())
+			continue;
+		fprintf(f, "%ld", id);
+		for (size_t i = 0; i < pairs.size(); i++)
+			fprintf(f, " %u:%g", pairs[i].second, pairs[i].first);
+		fprintf(f, "\n");
+	}
+	fclose(f);
+}
+
+}
+
+void compute_topK_similar(FG_graph::ptr fg, int k, const std::string &file,
+		int bands, int rows, double threshold)
+{
+	if (k <= 0) {
+		BOOST_LOG_TRIVIAL(error) << "k has to be positive";
+		return;
+	}
+	if (bands <= 0 || rows <= 0) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "the numbers of bands and rows have to be positive";
+		return;
+	}
+	graph_index::ptr index = NUMA_graph_index<minhash_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	size_t num_vertices = graph->get_num_vertices();
+	topK = k;
+	num_bands = bands;
+	num_rows = rows;
+	min_sim = threshold;
+	rand_seed = time(NULL);
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"MinHash starts with %1% bands of %2% rows and seed %3%")
+		% bands % rows % rand_seed;
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	band_keys = std::unique_ptr<uint64_t[]>(
+			new uint64_t[num_vertices * num_bands]);
+	sigs = std::unique_ptr<sig_t[]>(
+			new sig_t[num_vertices * get_num_hashes()]);
+	has_sig = std::unique_ptr<bool[]>(new bool[num_vertices]());
+	minhash_stage = SIGNATURE;
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new minhash_vertex_program_creater()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"computing signatures takes %1% seconds") % time_diff(start, end);
+
+	gettimeofday(&start, NULL);
+	// A bucket is expected to have the vertices that are similar to each
+	// other, and more than K of them are only useful for the top K.
+	gen_candidates(num_vertices, k * 4);
+	band_keys.reset();
+	sigs.reset();
+	has_sig.reset();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"generating %1% candidates takes %2% seconds")
+		% cands.size() % time_diff(start, end);
+
+	gettimeofday(&start, NULL);
+	minhash_stage = VERIFY;
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new minhash_vertex_program_creater()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"verifying candidates takes %1% seconds") % time_diff(start, end);
+	std::vector<size_t>().swap(cand_offs);
+	std::vector<vertex_id_t>().swap(cands);
+
+	write_similar(*graph, file);
+}
@@ -0,0 +1,458 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <limits>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+
+/*
+ * This computes the minimum spanning forest with Borůvka's algorithm.
+ * Edge direction is ignored, and the edge count stored as edge data is
+ * the weight of an edge.
+ *
+ * Each round has three steps:
+ * In the selection phase, every vertex finds its lightest edge to
+ * a vertex in another component and sends it to the root of its
+ * component. The root keeps the lightest edge it receives.
+ * In the hooking phase, every root that receives an edge adds it to
+ * the forest and points to the component on the other side of the edge.
+ * Edges are ordered by weight and then by their endpoints, so the only
+ * cycles are two roots that choose the same edge, and the root with
+ * the smaller ID stays a root.
+ * At the end of a round, pointer jumping makes every vertex point to
+ * the root of its new component.
+ *
+ * Components only merge, so an edge inside a component never leaves it.
+ * If the lightest edge of a vertex still leaves its component, it's still
+ * the lightest one in the next round, and the vertex doesn't need to read
+ * its edge list again. A vertex whose edges are all inside its component
+ * doesn't run in any later rounds.
+ */
+
+namespace {
+
+enum msf_phase_type
+{
+	SELECT,
+	HOOK,
+};
+
+msf_phase_type msf_phase;
+bool has_edge_weight;
+
+struct msf_edge
+{
+	vertex_id_t from;
+	vertex_id_t to;
+	uint32_t weight;
+	// The component on the other side of the edge.
+	vertex_id_t comp;
+
+	msf_edge() {
+		from = INVALID_VERTEX_ID;
+		to = INVALID_VERTEX_ID;
+		weight = 0;
+		comp = INVALID_VERTEX_ID;
+	}
+
+	msf_edge(vertex_id_t from, vertex_id_t to, uint32_t weight) {
+		this->from = from;
+		this->to = to;
+		this->weight = weight;
+		this->comp = INVALID_VERTEX_ID;
+	}
+
+	bool is_valid() const {
+		return from != INVALID_VERTEX_ID;
+	}
+
+	vertex_id_t get_other(vertex_id_t id) const {
+		return from == id ? to : from;
+	}
+
+	/*
+	 * Ties in weights are broken by the endpoints, so all edges in
+	 * the graph are totally ordered.
+	 */
+	bool lighter(const msf_edge &e) const {
+		if (weight != e.weight)
+			return weight < e.weight;
+		vertex_id_t min1 = std::min(from, to);
+		vertex_id_t min2 = std::min(e.from, e.to);
+		if (min1 != min2)
+			return min1 < min2;
+		return std::max(from, to) < std::max(e.from, e.to);
+	}
+};
+
+// The root of the component of each vertex.
+std::unique_ptr<std::atomic<vertex_id_t>[]> comps;
+// The lightest edge that leaves a component. Only the entries of
+// the roots are used, and only the thread that owns a root writes it.
+std::vector<msf_edge> root_edges;
+
+class msf_message: public vertex_message
+{
+	msf_edge e;
+public:
+	msf_message(const msf_edge &e): vertex_message(sizeof(msf_message),
+			false) {
+		this->e = e;
+	}
+
+	const msf_edge &get_edge() const {
+		return e;
+	}
+};
+
+class msf_vertex: public compute_directed_vertex
+{
+	// The lightest edge that left the component of the vertex when
+	// the vertex read its edge list last time.
+	msf_edge min_edge;
+	// All edges of the vertex are inside its component.
+	bool done;
+
+	void send_min_edge(vertex_program &prog, vertex_id_t id);
+public:
+	msf_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		done = false;
+	}
+
+	void run(vertex_program &prog);
+	void run(vertex_program &prog, const page_vertex &vertex);
+	void run_on_message(vertex_program &prog, const vertex_message &msg);
+};
+
+class msf_vertex_program: public vertex_program_impl<msf_vertex>
+{
+	// The roots that receive an edge in the selection phase.
+	std::vector<vertex_id_t> roots;
+	// The roots that point to another component in the hooking phase.
+	std::vector<vertex_id_t> hooked_roots;
+	std::vector<edge<edge_count> > forest;
+	size_t num_reads;
+	size_t num_cached;
+public:
+	typedef std::shared_ptr<msf_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<msf_vertex_program, vertex_program>(
+				prog);
+	}
+
+	msf_vertex_program() {
+		num_reads = 0;
+		num_cached = 0;
+	}
+
+	void add_root(vertex_id_t id) {
+		roots.push_back(id);
+	}
+
+	const std::vector<vertex_id_t> &get_roots() const {
+		return roots;
+	}
+
+	void add_forest_edge(vertex_id_t root, const msf_edge &e) {
+		hooked_roots.push_back(root);
+		forest.push_back(edge<edge_count>(e.from, e.to, edge_count(e.weight)));
+	}
+
+	const std::vector<vertex_id_t> &get_hooked_roots() const {
+		return hooked_roots;
+	}
+
+	const std::vector<edge<edge_count> > &get_forest() const {
+		return forest;
+	}
+
+	void inc_reads() {
+		num_reads++;
+	}
+
+	size_t get_num_reads() const {
+		return num_reads;
+	}
+
+	void inc_cached() {
+		num_cached++;
+	}
+
+	size_t get_num_cached() const {
+		return num_cached;
+	}
+};
+
+class msf_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new msf_vertex_program());
+	}
+};
+
+void msf_vertex::send_min_edge(vertex_program &prog, vertex_id_t id)
+{
+	msf_edge e = min_edge;
+	e.comp = comps[e.get_other(id)].load(std::memory_order_relaxed);
+	msf_message msg(e);
+	prog.send_msg(comps[id].load(std::memory_order_relaxed), msg);
+}
+
+void msf_vertex::run(vertex_program &prog)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	if (msf_phase == HOOK) {
+		const msf_edge &e = root_edges[id];
+		// Two roots choose the same edge. The one with the smaller ID
+		// stays a root and the other one adds the edge to the forest.
+		if (root_edges[e.comp].comp == id && id < e.comp)
+			return;
+		comps[id].store(e.comp, std::memory_order_relaxed);
+		((msf_vertex_program &) prog).add_forest_edge(id, e);
+		return;
+	}
+
+	if (done)
+		return;
+	if (min_edge.is_valid()) {
+		vertex_id_t other = min_edge.get_other(id);
+		if (comps[other].load(std::memory_order_relaxed)
+				!= comps[id].load(std::memory_order_relaxed)) {
+			((msf_vertex_program &) prog).inc_cached();
+			send_min_edge(prog, id);
+			return;
+		}
+	}
+	if (prog.get_graph().get_num_edges(id, edge_type::BOTH_EDGES) == 0) {
+		done = true;
+		return;
+	}
+
+	((msf_vertex_program &) prog).inc_reads();
+	if (prog.get_graph().is_directed()) {
+		directed_vertex_request req(id, edge_type::BOTH_EDGES, has_edge_weight
+				? request_part::TOPOLOGY_AND_DATA : request_part::TOPOLOGY);
+		request_partial_vertices(&req, 1);
+	}
+	else
+		request_vertices(&id, 1);
+}
+
+/*
+ * Invoke `func' on each neighbor of a vertex with the weight of the edge.
+ */
+template<class Func>
+void for_each_neighbor(const page_vertex &vertex, edge_type type, Func &func)
+{
+	edge_seq_iterator it = vertex.get_neigh_seq_it(type);
+	if (!has_edge_weight) {
+		while (it.has_next())
+			func(it.next(), type, 1);
+		return;
+	}
+
+	const page_directed_vertex &dvertex = (const page_directed_vertex &) vertex;
+	page_byte_array::seq_const_iterator<edge_count> data_it
+		= dvertex.get_data_seq_it<edge_count>(type);
+	while (it.has_next()) {
+		vertex_id_t neigh = it.next();
+		BOOST_VERIFY(data_it.has_next());
+		func(neigh, type, data_it.next().get_count());
+	}
+}
+
+class min_edge_func
+{
+	vertex_id_t id;
+	vertex_id_t comp;
+	msf_edge &min_edge;
+public:
+	min_edge_func(vertex_id_t id, msf_edge &_min_edge): min_edge(_min_edge) {
+		this->id = id;
+		this->comp = comps[id].load(std::memory_order_relaxed);
+	}
+
+	void operator()(vertex_id_t neigh, edge_type type, uint32_t weight) {
+		if (comps[neigh].load(std::memory_order_relaxed) == comp)
+			return;
+		msf_edge e = type == edge_type::OUT_EDGE ? msf_edge(id, neigh, weight)
+			: msf_edge(neigh, id, weight);
+		if (!min_edge.is_valid() || e.lighter(min_edge))
+			min_edge = e;
+	}
+};
+
+void msf_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	vertex_id_t id = vertex.get_id();
+	min_edge = msf_edge();
+	min_edge_func func(id, min_edge);
+	for_each_neighbor(vertex, edge_type::OUT_EDGE, func);
+	if (prog.get_graph().is_directed())
+		for_each_neighbor(vertex, edge_type::IN_EDGE, func);
+	if (min_edge.is_valid())
+		send_min_edge(prog, id);
+	else
+		done = true;
+}
+
+void msf_vertex::run_on_message(vertex_program &prog,
+		const vertex_message &msg1)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	const msf_edge &e = ((const msf_message &) msg1).get_edge();
+	msf_edge &root_edge = root_edges[id];
+	if (!root_edge.is_valid()) {
+		root_edge = e;
+		((msf_vertex_program &) prog).add_root(id);
+	}
+	else if (e.lighter(root_edge))
+		root_edge = e;
+}
+
+}
+
+void compute_msf(FG_graph::ptr fg, std::vector<edge<edge_count> > &forest)
+{
+	forest.clear();
+	graph_index::ptr index = NUMA_graph_index<msf_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	// The edge data may be stored in an edge data column, so we ask
+	// the graph engine for the size of edge data.
+	if (graph->get_edge_data_size() > 0) {
+		// Only the directed vertex gives us the access to edge data.
+		if (!graph->is_directed()
+				|| graph->get_edge_data_size() != sizeof(edge_count)) {
+			BOOST_LOG_TRIVIAL(error)
+				<< "MSF only supports edge count as edge weight in a directed graph";
+			return;
+		}
+		has_edge_weight = true;
+	}
+	else
+		has_edge_weight = false;
+
+	size_t num_vertices = graph->get_num_vertices();
+	comps = std::unique_ptr<std::atomic<vertex_id_t>[]>(
+			new std::atomic<vertex_id_t>[num_vertices]);
+#pragma omp parallel for
+	for (size_t i = 0; i < num_vertices; i++)
+		comps[i].store(i);
+	root_edges.resize(num_vertices);
+
+	BOOST_LOG_TRIVIAL(info) << "MSF starts";
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	for (int round = 0; ; round++) {
+#pragma omp parallel for
+		for (size_t i = 0; i < num_vertices; i++)
+			root_edges[i] = msf_edge();
+
+		msf_phase = SELECT;
+		graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+					new msf_vertex_program_creater()));
+		graph->wait4complete();
+
+		std::vector<vertex_program::ptr> vprogs;
+		graph->get_vertex_programs(vprogs);
+		std::vector<vertex_id_t> roots;
+		size_t num_reads = 0;
+		size_t num_cached = 0;
+		BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+			msf_vertex_program::ptr msf_vprog = msf_vertex_program::cast2(vprog);
+			const std::vector<vertex_id_t> &vprog_roots = msf_vprog->get_roots();
+			roots.insert(roots.end(), vprog_roots.begin(), vprog_roots.end());
+			num_reads += msf_vprog->get_num_reads();
+			num_cached += msf_vprog->get_num_cached();
+		}
+		// No edges connect two components.
+		if (roots.empty())
+			break;
+
+		msf_phase = HOOK;
+		graph->start(roots.data(), roots.size(), vertex_initializer::ptr(),
+				vertex_program_creater::ptr(new msf_vertex_program_creater()));
+		graph->wait4complete();
+
+		graph->get_vertex_programs(vprogs);
+		std::vector<vertex_id_t> hooked_roots;
+		BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+			msf_vertex_program::ptr msf_vprog = msf_vertex_program::cast2(vprog);
+			const std::vector<vertex_id_t> &vprog_roots
+				= msf_vprog->get_hooked_roots();
+			hooked_roots.insert(hooked_roots.end(), vprog_roots.begin(),
+					vprog_roots.end());
+			const std::vector<edge<edge_count> > &edges = msf_vprog->get_forest();
+			forest.insert(forest.end(), edges.begin(), edges.end());
+		}
+
+		// The hooked roots form trees. Pointer jumping makes them point
+		// to the roots of the trees.
+		bool changed = true;
+		while (changed) {
+			changed = false;
+#pragma omp parallel for reduction(||:changed)
+			for (size_t i = 0; i < hooked_roots.size(); i++) {
+				vertex_id_t id = hooked_roots[i];
+				vertex_id_t parent = comps[id].load(std::memory_order_relaxed);
+				vertex_id_t grandparent = comps[parent].load(
+						std::memory_order_relaxed);
+				if (parent != grandparent) {
+					comps[id].store(grandparent, std::memory_order_relaxed);
+					changed = true;
+				}
+			}
+		}
+		// Every vertex points to a root of the previous round, which now
+		// points to the root of the merged component.
+#pragma omp parallel for
+		for (size_t i = 0; i < num_vertices; i++)
+			comps[i].store(comps[comps[i].load()].load());
+		BOOST_LOG_TRIVIAL(info) << boost::format(
+				"round %1%: %2% vertices read edges, %3% vertices use cached edges, %4% components merge")
+			% round % num_reads % num_cached % hooked_roots.size();
+	}
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"MSF takes %1% seconds and has %2% edges")
+		% time_diff(start, end) % forest.size();
+
+	comps.reset();
+	std::vector<msf_edge>().swap(root_edges);
+}
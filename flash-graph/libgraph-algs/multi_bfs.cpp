@@ -0,0 +1,396 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <vector>
+#include <unordered_map>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FG_vector.h"
+#include "FGlib.h"
+
+/*
+ * This runs BFS from many sources at once. Each vertex keeps a bitset
+ * with a bit for each BFS. A vertex in the frontier of any BFS reads its
+ * edges once and sends the bits of the BFS that reached it in the previous
+ * level to its neighbors in a single message, so all BFS share the I/O.
+ * A vertex gets the distance from a source in the level where the bit of
+ * the source is set for the first time.
+ */
+
+namespace {
+
+const int MAX_NUM_SOURCES = 512;
+
+edge_type traverse_edge = edge_type::OUT_EDGE;
+bool directed_graph = true;
+int start_level;
+// The distances from each source. It's empty if we only count
+// the reachable vertices.
+std::vector<FG_vector<int>::ptr> dists;
+
+/*
+ * The bitset has a fixed number of 64-bit words, so the compiler can
+ * vectorize the loops.
+ */
+template<int NUM_WORDS>
+class bfs_bitset
+{
+	uint64_t words[NUM_WORDS];
+public:
+	bfs_bitset() {
+		clear();
+	}
+
+	void clear() {
+		for (int i = 0; i < NUM_WORDS; i++)
+			words[i] = 0;
+	}
+
+	void set(int idx) {
+		assert(idx < NUM_WORDS * 64);
+		words[idx / 64] |= 1UL << (idx % 64);
+	}
+
+	bool any() const {
+		uint64_t res = 0;
+		for (int i = 0; i < NUM_WORDS; i++)
+			res |= words[i];
+		return res != 0;
+	}
+
+	void merge(const bfs_bitset<NUM_WORDS> &set) {
+		for (int i = 0; i < NUM_WORDS; i++)
+			words[i] |= set.words[i];
+	}
+
+	/*
+	 * Keep the bits that aren't set in `set'.
+	 */
+	void subtract(const bfs_bitset<NUM_WORDS> &set) {
+		for (int i = 0; i < NUM_WORDS; i++)
+			words[i] &= ~set.words[i];
+	}
+
+	template<class Func>
+	void for_each_set(Func &func) const {
+		for (int i = 0; i < NUM_WORDS; i++) {
+			uint64_t word = words[i];
+			while (word) {
+				int bit = __builtin_ctzl(word);
+				func(i * 64 + bit);
+				word &= word - 1;
+			}
+		}
+	}
+};
+
+template<int NUM_WORDS>
+class multi_bfs_message: public vertex_message
+{
+	bfs_bitset<NUM_WORDS> bfs_ids;
+public:
+	multi_bfs_message(const bfs_bitset<NUM_WORDS> &bfs_ids): vertex_message(
+			sizeof(multi_bfs_message<NUM_WORDS>), true) {
+		this->bfs_ids = bfs_ids;
+	}
+
+	const bfs_bitset<NUM_WORDS> &get_bfs_ids() const {
+		return bfs_ids;
+	}
+};
+
+template<int NUM_WORDS>
+class multi_bfs_vertex: public compute_directed_vertex
+{
+	// The BFS that have visited the vertex.
+	bfs_bitset<NUM_WORDS> visited;
+	// The BFS that visited the vertex in the previous level.
+	bfs_bitset<NUM_WORDS> frontier;
+	// The BFS that reach the vertex in the current level.
+	bfs_bitset<NUM_WORDS> next;
+
+	void send_msgs(vertex_program &prog, const page_vertex &vertex,
+			edge_type type) {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(type);
+		multi_bfs_message<NUM_WORDS> msg(frontier);
+		prog.multicast_msg(it, msg);
+	}
+public:
+	multi_bfs_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void init(const bfs_bitset<NUM_WORDS> &sources) {
+		visited = sources;
+		frontier = sources;
+	}
+
+	void run(vertex_program &prog) {
+		if (!frontier.any())
+			return;
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (directed_graph) {
+			directed_vertex_request req(id, traverse_edge);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex) {
+		if (directed_graph && traverse_edge == BOTH_EDGES) {
+			send_msgs(prog, vertex, edge_type::IN_EDGE);
+			send_msgs(prog, vertex, edge_type::OUT_EDGE);
+		}
+		else
+			send_msgs(prog, vertex, traverse_edge);
+	}
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg1) {
+		const multi_bfs_message<NUM_WORDS> &msg
+			= (const multi_bfs_message<NUM_WORDS> &) msg1;
+		next.merge(msg.get_bfs_ids());
+		prog.request_notify_iter_end(*this);
+	}
+
+	void notify_iteration_end(vertex_program &prog);
+};
+
+/*
+ * The number of vertices each BFS reaches and the sum of their distances
+ * to the source. Each thread counts the vertices it owns.
+ */
+template<int NUM_WORDS>
+class multi_bfs_vertex_program: public vertex_program_impl<multi_bfs_vertex<NUM_WORDS> >
+{
+	std::vector<size_t> num_reached;
+	std::vector<size_t> sum_dists;
+public:
+	typedef std::shared_ptr<multi_bfs_vertex_program<NUM_WORDS> > ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<multi_bfs_vertex_program<NUM_WORDS>,
+			   vertex_program>(prog);
+	}
+
+	multi_bfs_vertex_program(): num_reached(NUM_WORDS * 64),
+		sum_dists(NUM_WORDS * 64) {
+	}
+
+	void add_reached(int bfs_id, vertex_id_t id, int dist) {
+		num_reached[bfs_id]++;
+		sum_dists[bfs_id] += dist;
+		if (!dists.empty())
+			dists[bfs_id]->set(id, dist);
+	}
+
+	const std::vector<size_t> &get_num_reached() const {
+		return num_reached;
+	}
+
+	const std::vector<size_t> &get_sum_dists() const {
+		return sum_dists;
+	}
+};
+
+template<int NUM_WORDS>
+class multi_bfs_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new multi_bfs_vertex_program<NUM_WORDS>());
+	}
+};
+
+template<int NUM_WORDS>
+class add_reached_func
+{
+	multi_bfs_vertex_program<NUM_WORDS> &prog;
+	vertex_id_t id;
+	int dist;
+public:
+	add_reached_func(multi_bfs_vertex_program<NUM_WORDS> &_prog,
+			vertex_id_t id, int dist): prog(_prog) {
+		this->id = id;
+		this->dist = dist;
+	}
+
+	void operator()(int bfs_id) {
+		prog.add_reached(bfs_id, id, dist);
+	}
+};
+
+template<int NUM_WORDS>
+void multi_bfs_vertex<NUM_WORDS>::notify_iteration_end(vertex_program &prog)
+{
+	next.subtract(visited);
+	frontier = next;
+	next.clear();
+	if (!frontier.any())
+		return;
+
+	visited.merge(frontier);
+	int dist = prog.get_graph().get_curr_level() + 1 - start_level;
+	add_reached_func<NUM_WORDS> func(
+			(multi_bfs_vertex_program<NUM_WORDS> &) prog,
+			prog.get_vertex_id(*this), dist);
+	frontier.for_each_set(func);
+}
+
+template<int NUM_WORDS>
+class multi_bfs_initializer: public vertex_initializer
+{
+	std::unordered_map<vertex_id_t, bfs_bitset<NUM_WORDS> > start_vertices;
+	graph_engine &graph;
+public:
+	multi_bfs_initializer(
+			const std::unordered_map<vertex_id_t, bfs_bitset<NUM_WORDS> > &vertices,
+			graph_engine &_graph): start_vertices(vertices), graph(_graph) {
+	}
+
+	void init(compute_vertex &v) {
+		multi_bfs_vertex<NUM_WORDS> &bv = (multi_bfs_vertex<NUM_WORDS> &) v;
+		typename std::unordered_map<vertex_id_t,
+				 bfs_bitset<NUM_WORDS> >::const_iterator it
+			= start_vertices.find(graph.get_graph_index().get_vertex_id(v));
+		assert(it != start_vertices.end());
+		bv.init(it->second);
+	}
+};
+
+template<int NUM_WORDS>
+void run_multi_bfs(FG_graph::ptr fg, const std::vector<vertex_id_t> &sources,
+		std::vector<size_t> &num_reached, std::vector<size_t> &sum_dists)
+{
+	graph_index::ptr index = NUMA_graph_index<multi_bfs_vertex<NUM_WORDS> >::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+
+	// A vertex may be the source of multiple BFS.
+	std::unordered_map<vertex_id_t, bfs_bitset<NUM_WORDS> > start_map;
+	for (size_t i = 0; i < sources.size(); i++)
+		start_map[sources[i]].set(i);
+	std::vector<vertex_id_t> start_vertices;
+	for (typename std::unordered_map<vertex_id_t,
+			bfs_bitset<NUM_WORDS> >::const_iterator it = start_map.begin();
+			it != start_map.end(); it++)
+		start_vertices.push_back(it->first);
+
+	for (size_t i = 0; i < dists.size(); i++) {
+		dists[i] = FG_vector<int>::create(graph);
+		dists[i]->init(-1);
+		dists[i]->set(sources[i], 0);
+	}
+
+	start_level = graph->get_curr_level();
+	graph->start(start_vertices.data(), start_vertices.size(),
+			vertex_initializer::ptr(
+				new multi_bfs_initializer<NUM_WORDS>(start_map, *graph)),
+			vertex_program_creater::ptr(
+				new multi_bfs_vertex_program_creater<NUM_WORDS>()));
+	graph->wait4complete();
+
+	// Each source reaches itself.
+	num_reached.assign(sources.size(), 1);
+	sum_dists.assign(sources.size(), 0);
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		typename multi_bfs_vertex_program<NUM_WORDS>::ptr bfs_vprog
+			= multi_bfs_vertex_program<NUM_WORDS>::cast2(vprog);
+		for (size_t i = 0; i < sources.size(); i++) {
+			num_reached[i] += bfs_vprog->get_num_reached()[i];
+			sum_dists[i] += bfs_vprog->get_sum_dists()[i];
+		}
+	}
+}
+
+bool multi_bfs(FG_graph::ptr fg, const std::vector<vertex_id_t> &sources,
+		edge_type type, std::vector<size_t> &num_reached,
+		std::vector<size_t> &sum_dists)
+{
+	if (sources.empty() || sources.size() > MAX_NUM_SOURCES) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"multi-source BFS supports 1 to %1% sources") % MAX_NUM_SOURCES;
+		return false;
+	}
+	const graph_header &header = fg->get_graph_header();
+	BOOST_FOREACH(vertex_id_t id, sources) {
+		if (id >= header.get_num_vertices()) {
+			BOOST_LOG_TRIVIAL(error) << boost::format(
+					"the source vertex %1% doesn't exist") % id;
+			return false;
+		}
+	}
+	directed_graph = header.is_directed_graph();
+	traverse_edge = type;
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"multi-source BFS starts from %1% vertices") % sources.size();
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	// We only keep as many bits in each vertex as we need.
+	if (sources.size() <= 64)
+		run_multi_bfs<1>(fg, sources, num_reached, sum_dists);
+	else if (sources.size() <= 128)
+		run_multi_bfs<2>(fg, sources, num_reached, sum_dists);
+	else if (sources.size() <= 256)
+		run_multi_bfs<4>(fg, sources, num_reached, sum_dists);
+	else
+		run_multi_bfs<8>(fg, sources, num_reached, sum_dists);
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"multi-source BFS takes %1% seconds") % time_diff(start, end);
+	return true;
+}
+
+}
+
+std::vector<FG_vector<int>::ptr> compute_multi_bfs(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources, edge_type traverse_edge)
+{
+	dists.resize(sources.size());
+	std::vector<size_t> num_reached;
+	std::vector<size_t> sum_dists;
+	std::vector<FG_vector<int>::ptr> ret;
+	if (multi_bfs(fg, sources, traverse_edge, num_reached, sum_dists))
+		ret.swap(dists);
+	dists.clear();
+	return ret;
+}
+
+bool count_multi_bfs_reach(FG_graph::ptr fg,
+		const std::vector<vertex_id_t> &sources, edge_type traverse_edge,
+		std::vector<size_t> &num_reached, std::vector<size_t> &sum_dists)
+{
+	dists.clear();
+	return multi_bfs(fg, sources, traverse_edge, num_reached, sum_dists);
+}
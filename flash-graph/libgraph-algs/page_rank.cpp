@@ -21,6 +21,7 @@
 #endif
 
 #include <limits>
+#include <algorithm>
 
 #include "graph_engine.h"
 #include "graph_config.h"
@@ -30,6 +31,9 @@ namespace {
 
 float DAMPING_FACTOR = 0.85;
 float TOLERANCE = 1.0E-2; 
+// The fraction of the vertices with the largest residual that run
+// in an iteration in the priority mode.
+float PRIORITY_FRACTION = 0.25;
 int max_num_iters = INT_MAX;
 
 /*
@@ -145,24 +149,36 @@ class pgrank_vertex2: public compute_directed_vertex
 {
 	float new_pr;
 	float curr_itr_pr; // Current iteration's page rank
+	// Whether the vertex waits in the vertex scheduler.
+	bool queued;
 public:
 	pgrank_vertex2(vertex_id_t id): compute_directed_vertex(id) {
 		this->curr_itr_pr = 1 - DAMPING_FACTOR; // Must be this
 		this->new_pr = curr_itr_pr;
+		this->queued = false;
 	}
 
 	float get_result() const{
 		return new_pr;
 	}
 
-	void run(vertex_program &prog) { 
-		// We perform pagerank for at most `max_num_iters' iterations.
-		if (prog.get_graph().get_curr_level() >= max_num_iters)
-			return;
-		directed_vertex_request req(prog.get_vertex_id(*this),
-				edge_type::OUT_EDGE);
-		request_partial_vertices(&req, 1);
-	};
+	/*
+	 * The accumulated change of PageRank that hasn't been pushed
+	 * to the neighbors.
+	 */
+	float get_residual() const {
+		return std::fabs(new_pr - curr_itr_pr);
+	}
+
+	bool is_queued() const {
+		return queued;
+	}
+
+	void set_queued(bool queued) {
+		this->queued = queued;
+	}
+
+	void run(vertex_program &prog);
 
 	void run(vertex_program &, const page_vertex &vertex);
 
@@ -172,10 +188,172 @@ public:
 	}
 };
 
+class pgrank_vertex_program2: public vertex_program_impl<pgrank_vertex2>
+{
+	pr_schedule_type sched_type;
+	bool first_level;
+	// The vertices that wait for more residual.
+	std::vector<compute_vertex_pointer> pending;
+	size_t num_reads;
+	size_t num_edge_reads;
+
+	void wait(compute_vertex_pointer v) {
+		pgrank_vertex2 &pv = (pgrank_vertex2 &) *v.get();
+		if (!pv.is_queued()) {
+			pv.set_queued(true);
+			pending.push_back(v);
+		}
+	}
+public:
+	typedef std::shared_ptr<pgrank_vertex_program2> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<pgrank_vertex_program2, vertex_program>(
+				prog);
+	}
+
+	pgrank_vertex_program2(pr_schedule_type sched_type) {
+		this->sched_type = sched_type;
+		first_level = true;
+		num_reads = 0;
+		num_edge_reads = 0;
+	}
+
+	void schedule(std::vector<compute_vertex_pointer> &vertices);
+
+	void inc_reads() {
+		num_reads++;
+	}
+
+	void add_edge_reads(size_t num_edges) {
+		num_edge_reads += num_edges;
+	}
+
+	size_t get_num_reads() const {
+		return num_reads;
+	}
+
+	size_t get_num_edge_reads() const {
+		return num_edge_reads;
+	}
+};
+
+struct residual_greater
+{
+	bool operator()(const compute_vertex_pointer &v1,
+			const compute_vertex_pointer &v2) const {
+		return ((pgrank_vertex2 &) *v1.get()).get_residual()
+			> ((pgrank_vertex2 &) *v2.get()).get_residual();
+	}
+};
+
+void pgrank_vertex_program2::schedule(
+		std::vector<compute_vertex_pointer> &vertices)
+{
+	// All vertices push their initial PageRank in the first iteration.
+	if (first_level) {
+		first_level = false;
+		return;
+	}
+
+	// This is called before the graph engine moves to the next level.
+	bool last = get_graph().get_curr_level() + 1 >= max_num_iters;
+	BOOST_FOREACH(compute_vertex_pointer v, vertices) {
+		wait(v);
+	}
+	vertices.clear();
+
+	// Vertices without enough residual don't need to run. They will be
+	// activated again if they receive more messages.
+	double tot_residual = 0;
+	size_t num_pending = 0;
+	for (size_t i = 0; i < pending.size(); i++) {
+		pgrank_vertex2 &pv = (pgrank_vertex2 &) *pending[i].get();
+		if (pv.get_residual() <= TOLERANCE || last)
+			pv.set_queued(false);
+		else {
+			tot_residual += pv.get_residual();
+			pending[num_pending++] = pending[i];
+		}
+	}
+	pending.resize(num_pending);
+	if (pending.empty())
+		return;
+
+	// In the async mode, only the vertices whose residual is above
+	// the average run. In the priority mode, only the vertices with
+	// the largest residual run. The others keep accumulating residual,
+	// so they push the deltas of multiple iterations at once.
+	float min_residual;
+	if (sched_type == PR_ASYNC_SCHED)
+		min_residual = tot_residual / pending.size();
+	else {
+		size_t num_runs = std::ceil(pending.size() * PRIORITY_FRACTION);
+		std::nth_element(pending.begin(), pending.begin() + num_runs - 1,
+				pending.end(), residual_greater());
+		min_residual = ((pgrank_vertex2 &) *pending[num_runs - 1].get())
+			.get_residual();
+	}
+	num_pending = 0;
+	for (size_t i = 0; i < pending.size(); i++) {
+		pgrank_vertex2 &pv = (pgrank_vertex2 &) *pending[i].get();
+		if (pv.get_residual() >= min_residual) {
+			pv.set_queued(false);
+			vertices.push_back(pending[i]);
+		}
+		else
+			pending[num_pending++] = pending[i];
+	}
+	pending.resize(num_pending);
+	// The vertices with larger residual run first, so the vertices that
+	// run later in the iteration can push the residual they receive
+	// from them in the same iteration.
+	std::sort(vertices.begin(), vertices.end(), residual_greater());
+}
+
+class pgrank_vertex_program2_creater: public vertex_program_creater
+{
+	pr_schedule_type sched_type;
+public:
+	pgrank_vertex_program2_creater(pr_schedule_type sched_type) {
+		this->sched_type = sched_type;
+	}
+
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new pgrank_vertex_program2(sched_type));
+	}
+};
+
+class residual_scheduler: public vertex_scheduler
+{
+public:
+	void schedule(vertex_program &prog,
+			std::vector<compute_vertex_pointer> &vertices) {
+		((pgrank_vertex_program2 &) prog).schedule(vertices);
+	}
+};
+
+void pgrank_vertex2::run(vertex_program &prog)
+{
+	// We perform pagerank for at most `max_num_iters' iterations.
+	int level = prog.get_graph().get_curr_level();
+	if (level >= max_num_iters)
+		return;
+	// A vertex is activated by every message it receives. If it doesn't
+	// have enough residual to push, we don't need to read its edges.
+	if (level > 0 && get_residual() <= TOLERANCE)
+		return;
+	directed_vertex_request req(prog.get_vertex_id(*this),
+			edge_type::OUT_EDGE);
+	request_partial_vertices(&req, 1);
+	((pgrank_vertex_program2 &) prog).inc_reads();
+}
+
 void pgrank_vertex2::run(vertex_program &prog, const page_vertex &vertex)
 {
 	int num_dests = vertex.get_num_edges(OUT_EDGE);
 	edge_seq_iterator it = vertex.get_neigh_seq_it(OUT_EDGE, 0, num_dests);
+	((pgrank_vertex_program2 &) prog).add_edge_reads(num_dests);
 
 	// If this is the first iteration.
 	if (prog.get_graph().get_curr_level() == 0) {
@@ -242,7 +420,8 @@ FG_vector<float>::ptr compute_pagerank(FG_graph::ptr fg, int num_iters,
 }
 
 FG_vector<float>::ptr compute_pagerank2(FG_graph::ptr fg, int num_iters,
-		float damping_factor)
+		float damping_factor, pr_schedule_type sched_type,
+		size_t *num_edge_reads)
 {
 	DAMPING_FACTOR = damping_factor;
 	if (DAMPING_FACTOR < 0 || DAMPING_FACTOR > 1) {
@@ -266,10 +445,29 @@ FG_vector<float>::ptr compute_pagerank2(FG_graph::ptr fg, int num_iters,
 		ProfilerStart(graph_conf.get_prof_file().c_str());
 #endif
 
-	graph->start_all(); 
+	if (sched_type != PR_DEFAULT_SCHED)
+		graph->set_vertex_scheduler(vertex_scheduler::ptr(
+					new residual_scheduler()));
+	graph->start_all(vertex_initializer::ptr(), vertex_program_creater::ptr(
+				new pgrank_vertex_program2_creater(sched_type)));
 	graph->wait4complete();
 	gettimeofday(&end, NULL);
 
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	size_t num_reads = 0;
+	size_t tot_edge_reads = 0;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		num_reads += pgrank_vertex_program2::cast2(vprog)->get_num_reads();
+		tot_edge_reads
+			+= pgrank_vertex_program2::cast2(vprog)->get_num_edge_reads();
+	}
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("%1% vertices read %2% edges") % num_reads
+		% tot_edge_reads;
+	if (num_edge_reads)
+		*num_edge_reads = tot_edge_reads;
+
 	FG_vector<float>::ptr ret = FG_vector<float>::create(
 			graph->get_num_vertices());
 	graph->query_on_all(vertex_query::ptr(
@@ -0,0 +1,634 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+
+/*
+ * This computes personalized PageRank for many seed sets.
+ *
+ * The forward push method computes the PageRank of a batch of seed sets
+ * together. Each vertex has an estimate and a residual for every seed
+ * set in the batch. A vertex whose residual of a seed set is larger than
+ * epsilon times its out-degree moves (1 - d) of the residual to its
+ * estimate and pushes the rest to its out-neighbors evenly. A vertex reads
+ * its adjacency list once to push the residuals of all seed sets in
+ * the batch. The residuals of vertices without out-edges are dropped.
+ *
+ * The Monte Carlo method runs random walks from the seeds. A walk stops
+ * at every vertex with the probability of (1 - d), and the PageRank of
+ * a vertex is estimated by the fraction of the walks that stop at it.
+ * It only needs the memory for the walks, so it works for a very large
+ * number of seed sets.
+ */
+
+namespace {
+
+const int MAX_BATCH_SIZE = 64;
+
+float damping_factor;
+bool directed_graph;
+
+void request_out_edges(compute_directed_vertex &v, vertex_id_t id)
+{
+	if (directed_graph) {
+		directed_vertex_request req(id, edge_type::OUT_EDGE);
+		v.request_partial_vertices(&req, 1);
+	}
+	else
+		v.request_vertices(&id, 1);
+}
+
+/*
+ * The states of forward push.
+ */
+double push_epsilon;
+int batch_size;
+// The estimates and residuals of all vertices. The state of a seed set
+// of a vertex is at `id * batch_size + set'.
+std::unique_ptr<float[]> estimates;
+std::unique_ptr<float[]> residuals;
+// The residuals received in the current level.
+std::unique_ptr<float[]> in_residuals;
+
+size_t get_state_idx(vertex_id_t id, int set)
+{
+	return ((size_t) id) * batch_size + set;
+}
+
+class push_message: public vertex_message
+{
+	uint64_t sets;
+	float vals[0];
+
+	push_message(uint64_t sets): vertex_message(get_msg_size(sets), true) {
+		this->sets = sets;
+	}
+public:
+	static size_t get_msg_size(uint64_t sets) {
+		return sizeof(push_message) + __builtin_popcountl(sets) * sizeof(float);
+	}
+
+	/*
+	 * Construct a message in the buffer. The buffer has to be large
+	 * enough to keep the values of all seed sets in `sets'.
+	 */
+	static push_message *create(void *buf, uint64_t sets) {
+		return new (buf) push_message(sets);
+	}
+
+	uint64_t get_sets() const {
+		return sets;
+	}
+
+	float *get_vals() {
+		return vals;
+	}
+
+	const float *get_vals() const {
+		return vals;
+	}
+};
+
+// The buffer large enough for a message of all seed sets in a batch.
+const size_t MSG_BUF_WORDS = (sizeof(push_message)
+		+ MAX_BATCH_SIZE * sizeof(float)) / sizeof(uint64_t) + 1;
+
+class push_vertex: public compute_directed_vertex
+{
+	/*
+	 * The seed sets whose residuals on the vertex should be pushed.
+	 */
+	uint64_t get_push_sets(vertex_id_t id, size_t num_edges) const {
+		double threshold = push_epsilon * std::max(num_edges, 1UL);
+		uint64_t sets = 0;
+		for (int i = 0; i < batch_size; i++) {
+			if (residuals[get_state_idx(id, i)] > threshold)
+				sets |= 1UL << i;
+		}
+		return sets;
+	}
+public:
+	push_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (get_push_sets(id, prog.get_graph().get_num_edges(id,
+						edge_type::OUT_EDGE)) == 0)
+			return;
+		request_out_edges(*this, id);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg1) {
+		const push_message &msg = (const push_message &) msg1;
+		vertex_id_t id = prog.get_vertex_id(*this);
+		const float *vals = msg.get_vals();
+		for (uint64_t sets = msg.get_sets(); sets; sets &= sets - 1)
+			in_residuals[get_state_idx(id, __builtin_ctzl(sets))] += *vals++;
+		prog.request_notify_iter_end(*this);
+	}
+
+	void notify_iteration_end(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		for (int i = 0; i < batch_size; i++) {
+			size_t idx = get_state_idx(id, i);
+			residuals[idx] += in_residuals[idx];
+			in_residuals[idx] = 0;
+		}
+	}
+};
+
+void push_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	vertex_id_t id = vertex.get_id();
+	size_t num_edges = vertex.get_num_edges(edge_type::OUT_EDGE);
+	uint64_t sets = get_push_sets(id, num_edges);
+	uint64_t buf[MSG_BUF_WORDS];
+	push_message *msg = push_message::create(buf, sets);
+	float *vals = msg->get_vals();
+	for (uint64_t s = sets; s; s &= s - 1) {
+		size_t idx = get_state_idx(id, __builtin_ctzl(s));
+		estimates[idx] += (1 - damping_factor) * residuals[idx];
+		*vals++ = damping_factor * residuals[idx] / std::max(num_edges, 1UL);
+		residuals[idx] = 0;
+	}
+	if (num_edges == 0)
+		return;
+
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+	prog.multicast_msg(it, *msg);
+}
+
+/*
+ * The states of the Monte Carlo method.
+ */
+int num_walks;
+// The walks that stop at a vertex. The first is the seed set of a walk.
+typedef std::pair<uint32_t, vertex_id_t> walk_end_t;
+
+class walk_message: public vertex_message
+{
+	uint32_t set;
+public:
+	walk_message(uint32_t set): vertex_message(sizeof(walk_message), true) {
+		this->set = set;
+	}
+
+	uint32_t get_set() const {
+		return set;
+	}
+};
+
+class mc_vertex: public compute_directed_vertex
+{
+	// The walks to move in the current level.
+	std::vector<uint32_t> curr_walks;
+	// The walks that arrive in the current level.
+	std::vector<uint32_t> next_walks;
+public:
+	mc_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void add_walk(uint32_t set) {
+		curr_walks.push_back(set);
+	}
+
+	void clear() {
+		std::vector<uint32_t>().swap(curr_walks);
+		std::vector<uint32_t>().swap(next_walks);
+	}
+
+	void run(vertex_program &prog);
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+		next_walks.push_back(((const walk_message &) msg).get_set());
+		prog.request_notify_iter_end(*this);
+	}
+
+	void notify_iteration_end(vertex_program &prog) {
+		curr_walks.swap(next_walks);
+		next_walks.clear();
+	}
+};
+
+class mc_vertex_program: public vertex_program_impl<mc_vertex>
+{
+	std::mt19937 gen;
+	std::vector<walk_end_t> walk_ends;
+public:
+	typedef std::shared_ptr<mc_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<mc_vertex_program, vertex_program>(
+				prog);
+	}
+
+	mc_vertex_program(unsigned seed): gen(seed) {
+	}
+
+	bool rand_stop() {
+		return std::uniform_real_distribution<float>(0, 1)(gen)
+			>= damping_factor;
+	}
+
+	size_t rand_index(size_t num) {
+		return std::uniform_int_distribution<size_t>(0, num - 1)(gen);
+	}
+
+	void add_walk_end(uint32_t set, vertex_id_t id) {
+		walk_ends.push_back(walk_end_t(set, id));
+	}
+
+	const std::vector<walk_end_t> &get_walk_ends() const {
+		return walk_ends;
+	}
+};
+
+class mc_vertex_program_creater: public vertex_program_creater
+{
+	mutable unsigned seed;
+public:
+	mc_vertex_program_creater(unsigned seed) {
+		this->seed = seed;
+	}
+
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new mc_vertex_program(seed++));
+	}
+};
+
+void mc_vertex::run(vertex_program &prog)
+{
+	mc_vertex_program &wprog = (mc_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	// The walks that stop here don't need the adjacency list.
+	size_t num_moves = 0;
+	for (size_t i = 0; i < curr_walks.size(); i++) {
+		if (wprog.rand_stop())
+			wprog.add_walk_end(curr_walks[i], id);
+		else
+			curr_walks[num_moves++] = curr_walks[i];
+	}
+	curr_walks.resize(num_moves);
+	if (curr_walks.empty())
+		return;
+	request_out_edges(*this, id);
+}
+
+void mc_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	mc_vertex_program &wprog = (mc_vertex_program &) prog;
+	size_t num_edges = vertex.get_num_edges(edge_type::OUT_EDGE);
+	// The walks that can't move from a vertex without out-edges are
+	// dropped, as the residuals in forward push.
+	if (num_edges > 0) {
+		BOOST_FOREACH(uint32_t set, curr_walks) {
+			size_t idx = wprog.rand_index(num_edges);
+			edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE,
+					idx, idx + 1);
+			walk_message msg(set);
+			prog.send_msg(it.next(), msg);
+		}
+	}
+	curr_walks.clear();
+}
+
+/*
+ * Put the residuals of the seed sets on their seed vertices.
+ */
+class push_initializer: public vertex_initializer
+{
+	graph_engine &graph;
+	// The seed sets on each seed vertex, sorted by vertex ID.
+	const std::vector<std::pair<vertex_id_t, uint32_t> > &seeds;
+	// The initial residual of a seed in each seed set.
+	const std::vector<float> &weights;
+public:
+	push_initializer(graph_engine &_graph,
+			const std::vector<std::pair<vertex_id_t, uint32_t> > &_seeds,
+			const std::vector<float> &_weights): graph(_graph), seeds(
+				_seeds), weights(_weights) {
+	}
+
+	void init(compute_vertex &v) {
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		std::vector<std::pair<vertex_id_t, uint32_t> >::const_iterator it
+			= std::lower_bound(seeds.begin(), seeds.end(),
+					std::pair<vertex_id_t, uint32_t>(id, 0));
+		for (; it != seeds.end() && it->first == id; it++)
+			residuals[get_state_idx(id, it->second)] += weights[it->second];
+	}
+};
+
+/*
+ * Put the walks of the seed sets on their seed vertices.
+ */
+class mc_initializer: public vertex_initializer
+{
+	graph_engine &graph;
+	// The seed sets on each seed vertex, sorted by vertex ID.
+	const std::vector<std::pair<vertex_id_t, uint32_t> > &seeds;
+	// The number of walks from each seed in `seeds'.
+	const std::vector<size_t> &seed_walks;
+public:
+	mc_initializer(graph_engine &_graph,
+			const std::vector<std::pair<vertex_id_t, uint32_t> > &_seeds,
+			const std::vector<size_t> &_seed_walks): graph(_graph), seeds(
+				_seeds), seed_walks(_seed_walks) {
+	}
+
+	void init(compute_vertex &v) {
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		std::vector<std::pair<vertex_id_t, uint32_t> >::const_iterator it
+			= std::lower_bound(seeds.begin(), seeds.end(),
+					std::pair<vertex_id_t, uint32_t>(id, 0));
+		for (; it != seeds.end() && it->first == id; it++) {
+			for (size_t i = 0; i < seed_walks[it - seeds.begin()]; i++)
+				((mc_vertex &) v).add_walk(it->second);
+		}
+	}
+};
+
+class mc_clear: public vertex_initializer
+{
+public:
+	void init(compute_vertex &v) {
+		((mc_vertex &) v).clear();
+	}
+};
+
+void get_start_vertices(
+		const std::vector<std::pair<vertex_id_t, uint32_t> > &seeds,
+		std::vector<vertex_id_t> &ids)
+{
+	for (size_t i = 0; i < seeds.size(); i++) {
+		if (ids.empty() || ids.back() != seeds[i].first)
+			ids.push_back(seeds[i].first);
+	}
+}
+
+bool check_seed_sets(const std::vector<std::vector<vertex_id_t> > &seed_sets,
+		size_t num_vertices)
+{
+	for (size_t i = 0; i < seed_sets.size(); i++) {
+		if (seed_sets[i].empty()) {
+			BOOST_LOG_TRIVIAL(error) << boost::format("seed set %1% is empty")
+				% i;
+			return false;
+		}
+		for (size_t j = 0; j < seed_sets[i].size(); j++) {
+			if (seed_sets[i][j] >= num_vertices) {
+				BOOST_LOG_TRIVIAL(error) << boost::format(
+						"seed %1% in seed set %2% doesn't exist")
+					% seed_sets[i][j] % i;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+ * Keep the top K vertices of a PageRank vector.
+ */
+void get_topK(ppr_vector &vec, size_t topK)
+{
+	struct comp_score {
+		bool operator()(const std::pair<vertex_id_t, float> &v1,
+				const std::pair<vertex_id_t, float> &v2) const {
+			return v1.second > v2.second
+				|| (v1.second == v2.second && v1.first < v2.first);
+		}
+	};
+	if (topK > 0 && vec.size() > topK) {
+		std::partial_sort(vec.begin(), vec.begin() + topK, vec.end(),
+				comp_score());
+		vec.resize(topK);
+	}
+	else
+		std::sort(vec.begin(), vec.end(), comp_score());
+}
+
+}
+
+std::vector<ppr_vector> compute_personalized_pagerank(FG_graph::ptr fg,
+		const std::vector<std::vector<vertex_id_t> > &seed_sets,
+		float damping, double epsilon, size_t topK, int num_sets_per_batch)
+{
+	if (num_sets_per_batch < 1 || num_sets_per_batch > MAX_BATCH_SIZE) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"The batch size must be between 1 and %1%") % MAX_BATCH_SIZE;
+		return std::vector<ppr_vector>();
+	}
+	graph_index::ptr index = NUMA_graph_index<push_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	size_t num_vertices = graph->get_num_vertices();
+	if (!check_seed_sets(seed_sets, num_vertices))
+		return std::vector<ppr_vector>();
+
+	damping_factor = damping;
+	directed_graph = fg->get_graph_header().is_directed_graph();
+	push_epsilon = epsilon;
+	batch_size = num_sets_per_batch;
+	size_t num_states = num_vertices * batch_size;
+	estimates = std::unique_ptr<float[]>(new float[num_states]);
+	residuals = std::unique_ptr<float[]>(new float[num_states]);
+	in_residuals = std::unique_ptr<float[]>(new float[num_states]);
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"personalized PageRank starts: %1% seed sets, %2% per batch")
+		% seed_sets.size() % batch_size;
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	std::vector<ppr_vector> results(seed_sets.size());
+	for (size_t batch_start = 0; batch_start < seed_sets.size();
+			batch_start += batch_size) {
+		size_t num_sets = std::min((size_t) batch_size,
+				seed_sets.size() - batch_start);
+#pragma omp parallel for
+		for (size_t i = 0; i < num_states; i++) {
+			estimates[i] = 0;
+			residuals[i] = 0;
+			in_residuals[i] = 0;
+		}
+		std::vector<std::pair<vertex_id_t, uint32_t> > seeds;
+		std::vector<float> weights(num_sets);
+		for (size_t i = 0; i < num_sets; i++) {
+			const std::vector<vertex_id_t> &set = seed_sets[batch_start + i];
+			for (size_t j = 0; j < set.size(); j++)
+				seeds.push_back(std::pair<vertex_id_t, uint32_t>(set[j], i));
+			weights[i] = 1.0 / set.size();
+		}
+		std::sort(seeds.begin(), seeds.end());
+		std::vector<vertex_id_t> ids;
+		get_start_vertices(seeds, ids);
+
+		graph->start(ids.data(), ids.size(), vertex_initializer::ptr(
+					new push_initializer(*graph, seeds, weights)));
+		graph->wait4complete();
+
+#pragma omp parallel for
+		for (size_t i = 0; i < num_sets; i++) {
+			ppr_vector &vec = results[batch_start + i];
+			for (size_t id = 0; id < num_vertices; id++) {
+				float est = estimates[get_state_idx(id, i)];
+				if (est > 0)
+					vec.push_back(std::pair<vertex_id_t, float>(id, est));
+			}
+			get_topK(vec, topK);
+		}
+	}
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"personalized PageRank takes %1% seconds") % time_diff(start, end);
+	estimates.reset();
+	residuals.reset();
+	in_residuals.reset();
+	return results;
+}
+
+std::vector<ppr_vector> compute_mc_personalized_pagerank(FG_graph::ptr fg,
+		const std::vector<std::vector<vertex_id_t> > &seed_sets,
+		float damping, int walks_per_set, size_t topK, size_t max_walks)
+{
+	if (walks_per_set < 1 || (size_t) walks_per_set > max_walks) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"The number of walks of a seed set must be between 1 and %1%")
+			% max_walks;
+		return std::vector<ppr_vector>();
+	}
+	graph_index::ptr index = NUMA_graph_index<mc_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	if (!check_seed_sets(seed_sets, graph->get_num_vertices()))
+		return std::vector<ppr_vector>();
+
+	damping_factor = damping;
+	directed_graph = fg->get_graph_header().is_directed_graph();
+	num_walks = walks_per_set;
+	size_t sets_per_batch = max_walks / num_walks;
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"Monte Carlo personalized PageRank starts: %1% seed sets, %2% walks per set")
+		% seed_sets.size() % num_walks;
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	std::vector<ppr_vector> results(seed_sets.size());
+	unsigned seed = time(NULL);
+	std::mt19937 sample_gen(seed);
+	for (size_t batch_start = 0; batch_start < seed_sets.size();
+			batch_start += sets_per_batch) {
+		size_t num_sets = std::min(sets_per_batch,
+				seed_sets.size() - batch_start);
+		// The walks of a seed set are spread over its seeds evenly.
+		// If a set has more seeds than walks, the walks start from
+		// a uniform random sample of the seeds, so every seed is
+		// equally likely to get a walk.
+		std::vector<std::pair<vertex_id_t, uint32_t> > seeds;
+		std::vector<vertex_id_t> sample;
+		for (size_t i = 0; i < num_sets; i++) {
+			const std::vector<vertex_id_t> &set = seed_sets[batch_start + i];
+			if (set.size() > (size_t) num_walks) {
+				sample = set;
+				for (size_t j = 0; j < (size_t) num_walks; j++) {
+					std::uniform_int_distribution<size_t> dist(j,
+							sample.size() - 1);
+					std::swap(sample[j], sample[dist(sample_gen)]);
+				}
+				sample.resize(num_walks);
+			}
+			const std::vector<vertex_id_t> &walk_seeds
+				= set.size() > (size_t) num_walks ? sample : set;
+			for (size_t j = 0; j < walk_seeds.size(); j++)
+				seeds.push_back(std::pair<vertex_id_t, uint32_t>(
+							walk_seeds[j], i));
+		}
+		std::sort(seeds.begin(), seeds.end());
+		std::vector<size_t> seed_walks(seeds.size());
+		std::vector<size_t> num_seeds(num_sets);
+		for (size_t i = 0; i < seeds.size(); i++)
+			num_seeds[seeds[i].second]++;
+		std::vector<size_t> seed_idxs(num_sets);
+		for (size_t i = 0; i < seeds.size(); i++) {
+			uint32_t set = seeds[i].second;
+			seed_walks[i] = num_walks / num_seeds[set]
+				+ (seed_idxs[set]++ < num_walks % num_seeds[set]);
+		}
+		std::vector<vertex_id_t> ids;
+		get_start_vertices(seeds, ids);
+
+		graph->start(ids.data(), ids.size(), vertex_initializer::ptr(
+					new mc_initializer(*graph, seeds, seed_walks)),
+				vertex_program_creater::ptr(
+					new mc_vertex_program_creater(seed)));
+		graph->wait4complete();
+		seed += graph->get_num_threads();
+
+		std::vector<walk_end_t> walk_ends;
+		std::vector<vertex_program::ptr> vprogs;
+		graph->get_vertex_programs(vprogs);
+		BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+			const std::vector<walk_end_t> &ends
+				= mc_vertex_program::cast2(vprog)->get_walk_ends();
+			walk_ends.insert(walk_ends.end(), ends.begin(), ends.end());
+		}
+		std::sort(walk_ends.begin(), walk_ends.end());
+		for (size_t i = 0; i < walk_ends.size();) {
+			size_t j = i + 1;
+			while (j < walk_ends.size() && walk_ends[j] == walk_ends[i])
+				j++;
+			results[batch_start + walk_ends[i].first].push_back(
+					std::pair<vertex_id_t, float>(walk_ends[i].second,
+						((float) (j - i)) / num_walks));
+			i = j;
+		}
+#pragma omp parallel for
+		for (size_t i = 0; i < num_sets; i++)
+			get_topK(results[batch_start + i], topK);
+	}
+	gettimeofday(&end, NULL);
+	graph->init_all_vertices(vertex_initializer::ptr(new mc_clear()));
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"Monte Carlo personalized PageRank takes %1% seconds")
+		% time_diff(start, end);
+	return results;
+}
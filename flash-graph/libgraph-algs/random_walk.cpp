@@ -0,0 +1,458 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <stdio.h>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FGlib.h"
+
+/*
+ * This generates random walks for DeepWalk and node2vec. The walkers are
+ * messages: a vertex collects the walkers sent to it in a level and reads
+ * its adjacency list once in the next level to advance all of them.
+ * A walk follows the out-edges in a directed graph.
+ *
+ * For node2vec, the next vertex depends on the previous vertex of
+ * a walker. A vertex keeps a copy of its own neighbors in memory and
+ * requests the adjacency lists of the previous vertices of its walkers.
+ * It samples a neighbor uniformly and accepts it with the probability
+ * proportional to 1/p if it's the previous vertex, 1 if it's a neighbor
+ * of the previous vertex and 1/q otherwise.
+ *
+ * The walks are generated in batches, and the walks in a batch are
+ * written to the output file when the batch is complete, so the memory
+ * usage is bounded by the batch size.
+ */
+
+namespace {
+
+int walk_length;
+double return_weight;
+double inout_weight;
+bool second_order;
+bool directed_graph;
+
+// The walks in the current batch.
+std::unique_ptr<vertex_id_t[]> walks;
+std::unique_ptr<int[]> walk_lens;
+
+struct walker
+{
+	uint32_t idx;
+	vertex_id_t prev;
+
+	walker(uint32_t idx, vertex_id_t prev) {
+		this->idx = idx;
+		this->prev = prev;
+	}
+};
+
+class walker_message: public vertex_message
+{
+	walker w;
+public:
+	walker_message(uint32_t idx, vertex_id_t prev): vertex_message(
+			sizeof(walker_message), true), w(idx, prev) {
+	}
+
+	const walker &get_walker() const {
+		return w;
+	}
+};
+
+class walk_vertex_program;
+
+class walk_vertex: public compute_directed_vertex
+{
+	// The walkers to advance in the current level.
+	std::vector<walker> curr_walkers;
+	// The walkers that arrive in the current level.
+	std::vector<walker> next_walkers;
+	// The neighbors of the vertex, which are kept until the adjacency
+	// lists of all previous vertices are processed.
+	std::vector<vertex_id_t> neighs;
+	size_t num_pending_prevs;
+
+	void request_edges(vertex_id_t ids[], size_t num) {
+		if (directed_graph) {
+			std::vector<directed_vertex_request> reqs;
+			for (size_t i = 0; i < num; i++)
+				reqs.push_back(directed_vertex_request(ids[i],
+							edge_type::OUT_EDGE));
+			request_partial_vertices(reqs.data(), reqs.size());
+		}
+		else
+			request_vertices(ids, num);
+	}
+
+	void move(walk_vertex_program &prog, const walker &w, vertex_id_t to);
+	void advance_first_order(walk_vertex_program &prog,
+			const page_vertex &vertex);
+	void advance_second_order(walk_vertex_program &prog, vertex_id_t prev,
+			const std::vector<vertex_id_t> &prev_neighs);
+public:
+	walk_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		num_pending_prevs = 0;
+	}
+
+	void add_walker(const walker &w) {
+		curr_walkers.push_back(w);
+	}
+
+	void clear() {
+		std::vector<walker>().swap(curr_walkers);
+		std::vector<walker>().swap(next_walkers);
+		std::vector<vertex_id_t>().swap(neighs);
+	}
+
+	void run(vertex_program &prog) {
+		if (curr_walkers.empty())
+			return;
+		vertex_id_t id = prog.get_vertex_id(*this);
+		request_edges(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &prog, const vertex_message &msg) {
+		next_walkers.push_back(((const walker_message &) msg).get_walker());
+		prog.request_notify_iter_end(*this);
+	}
+
+	void notify_iteration_end(vertex_program &prog) {
+		curr_walkers.swap(next_walkers);
+		next_walkers.clear();
+	}
+};
+
+class walk_vertex_program: public vertex_program_impl<walk_vertex>
+{
+	std::mt19937 gen;
+	std::vector<vertex_id_t> neigh_buf;
+	size_t num_steps;
+public:
+	typedef std::shared_ptr<walk_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<walk_vertex_program, vertex_program>(
+				prog);
+	}
+
+	walk_vertex_program(unsigned seed): gen(seed) {
+		num_steps = 0;
+	}
+
+	size_t rand_index(size_t num) {
+		return std::uniform_int_distribution<size_t>(0, num - 1)(gen);
+	}
+
+	double rand_real(double max) {
+		return std::uniform_real_distribution<double>(0, max)(gen);
+	}
+
+	std::vector<vertex_id_t> &get_neigh_buf() {
+		return neigh_buf;
+	}
+
+	void inc_steps() {
+		num_steps++;
+	}
+
+	size_t get_num_steps() const {
+		return num_steps;
+	}
+};
+
+class walk_vertex_program_creater: public vertex_program_creater
+{
+	mutable unsigned seed;
+public:
+	walk_vertex_program_creater(unsigned seed) {
+		this->seed = seed;
+	}
+
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new walk_vertex_program(seed++));
+	}
+};
+
+void walk_vertex::move(walk_vertex_program &prog, const walker &w,
+		vertex_id_t to)
+{
+	int len = walk_lens[w.idx];
+	walks[((size_t) w.idx) * walk_length + len] = to;
+	walk_lens[w.idx] = len + 1;
+	prog.inc_steps();
+	if (len + 1 < walk_length) {
+		walker_message msg(w.idx, prog.get_vertex_id(*this));
+		prog.send_msg(to, msg);
+	}
+}
+
+void walk_vertex::advance_first_order(walk_vertex_program &prog,
+		const page_vertex &vertex)
+{
+	std::vector<vertex_id_t> &buf = prog.get_neigh_buf();
+	buf.clear();
+	edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+	while (it.has_next())
+		buf.push_back(it.next());
+	BOOST_FOREACH(const walker &w, curr_walkers) {
+		move(prog, w, buf[prog.rand_index(buf.size())]);
+	}
+}
+
+void walk_vertex::advance_second_order(walk_vertex_program &prog,
+		vertex_id_t prev, const std::vector<vertex_id_t> &prev_neighs)
+{
+	double max_weight = std::max(1.0, std::max(return_weight, inout_weight));
+	BOOST_FOREACH(const walker &w, curr_walkers) {
+		if (w.prev != prev)
+			continue;
+		// Rejection sampling, which doesn't need the weights of all edges.
+		while (true) {
+			vertex_id_t next = neighs[prog.rand_index(neighs.size())];
+			double weight;
+			if (next == prev)
+				weight = return_weight;
+			else if (std::binary_search(prev_neighs.begin(), prev_neighs.end(),
+						next))
+				weight = 1;
+			else
+				weight = inout_weight;
+			if (prog.rand_real(max_weight) < weight) {
+				move(prog, w, next);
+				break;
+			}
+		}
+	}
+}
+
+void walk_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	walk_vertex_program &wprog = (walk_vertex_program &) prog;
+	vertex_id_t id = prog.get_vertex_id(*this);
+	if (vertex.get_id() != id) {
+		std::vector<vertex_id_t> &buf = wprog.get_neigh_buf();
+		buf.clear();
+		edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+		while (it.has_next())
+			buf.push_back(it.next());
+		advance_second_order(wprog, vertex.get_id(), buf);
+		num_pending_prevs--;
+	}
+	// A vertex without edges ends all walks on it.
+	else if (vertex.get_num_edges(edge_type::OUT_EDGE) == 0)
+		curr_walkers.clear();
+	else if (!second_order) {
+		advance_first_order(wprog, vertex);
+		curr_walkers.clear();
+	}
+	else {
+		edge_seq_iterator it = vertex.get_neigh_seq_it(edge_type::OUT_EDGE);
+		while (it.has_next())
+			neighs.push_back(it.next());
+
+		std::vector<vertex_id_t> prevs;
+		BOOST_FOREACH(const walker &w, curr_walkers) {
+			// The first step of a walk doesn't depend on the previous vertex.
+			if (w.prev == INVALID_VERTEX_ID)
+				move(wprog, w, neighs[wprog.rand_index(neighs.size())]);
+			else if (w.prev != id)
+				prevs.push_back(w.prev);
+		}
+		advance_second_order(wprog, id, neighs);
+		std::sort(prevs.begin(), prevs.end());
+		prevs.erase(std::unique(prevs.begin(), prevs.end()), prevs.end());
+		num_pending_prevs = prevs.size();
+		if (!prevs.empty())
+			request_edges(prevs.data(), prevs.size());
+	}
+
+	if (second_order && num_pending_prevs == 0) {
+		curr_walkers.clear();
+		neighs.clear();
+	}
+}
+
+/*
+ * Place the walkers of a batch on their start vertices.
+ */
+class walk_initializer: public vertex_initializer
+{
+	graph_engine &graph;
+	// The start vertex of each walker in the batch, sorted by vertex ID.
+	const std::vector<std::pair<vertex_id_t, uint32_t> > &starts;
+public:
+	walk_initializer(graph_engine &_graph,
+			const std::vector<std::pair<vertex_id_t, uint32_t> > &_starts): graph(
+				_graph), starts(_starts) {
+	}
+
+	void init(compute_vertex &v) {
+		walk_vertex &wv = (walk_vertex &) v;
+		vertex_id_t id = graph.get_graph_index().get_vertex_id(v);
+		std::vector<std::pair<vertex_id_t, uint32_t> >::const_iterator it
+			= std::lower_bound(starts.begin(), starts.end(),
+					std::pair<vertex_id_t, uint32_t>(id, 0));
+		for (; it != starts.end() && it->first == id; it++)
+			wv.add_walker(walker(it->second, INVALID_VERTEX_ID));
+	}
+};
+
+class walk_clear: public vertex_initializer
+{
+public:
+	void init(compute_vertex &v) {
+		((walk_vertex &) v).clear();
+	}
+};
+
+size_t write_walks(FILE *f, size_t num_walks)
+{
+	size_t num_written = 0;
+	for (size_t i = 0; i < num_walks; i++) {
+		const vertex_id_t *walk = walks.get() + i * walk_length;
+		for (int j = 0; j < walk_lens[i]; j++) {
+			int ret = fprintf(f, j == 0 ? "%u" : " %u", walk[j]);
+			if (ret < 0)
+				return num_written;
+		}
+		if (fprintf(f, "\n") < 0)
+			return num_written;
+		num_written++;
+	}
+	return num_written;
+}
+
+}
+
+size_t compute_random_walks(FG_graph::ptr fg, const std::string &out_file,
+		int num_walks, int length, double p, double q, size_t batch_size)
+{
+	if (length < 1 || num_walks < 1 || p <= 0 || q <= 0 || batch_size == 0) {
+		BOOST_LOG_TRIVIAL(error) << "invalid random walk parameters";
+		return 0;
+	}
+	FILE *f = fopen(out_file.c_str(), "w");
+	if (f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't open %1%: %2%")
+			% out_file % strerror(errno);
+		return 0;
+	}
+
+	graph_index::ptr index = NUMA_graph_index<walk_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	directed_graph = fg->get_graph_header().is_directed_graph();
+	walk_length = length;
+	return_weight = 1 / p;
+	inout_weight = 1 / q;
+	second_order = p != 1 || q != 1;
+
+	// Walks start from the vertices with edges.
+	std::vector<vertex_id_t> start_vertices;
+	size_t num_vertices = graph->get_num_vertices();
+	for (size_t i = 0; i < num_vertices; i++) {
+		if (graph->get_num_edges(i, edge_type::OUT_EDGE) > 0)
+			start_vertices.push_back(i);
+	}
+	size_t tot_walks = start_vertices.size() * num_walks;
+	batch_size = std::min(batch_size, tot_walks);
+	walks = std::unique_ptr<vertex_id_t[]>(
+			new vertex_id_t[batch_size * walk_length]);
+	walk_lens = std::unique_ptr<int[]>(new int[batch_size]);
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"random walk starts: %1% walks of length %2%, p: %3%, q: %4%")
+		% tot_walks % walk_length % p % q;
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	size_t num_written = 0;
+	size_t num_steps = 0;
+	unsigned seed = time(NULL);
+	for (size_t batch_start = 0; batch_start < tot_walks;
+			batch_start += batch_size) {
+		size_t num = std::min(batch_size, tot_walks - batch_start);
+		// The walks of a vertex are spread over batches.
+		std::vector<std::pair<vertex_id_t, uint32_t> > starts(num);
+		for (size_t i = 0; i < num; i++) {
+			vertex_id_t v = start_vertices[(batch_start + i)
+				% start_vertices.size()];
+			starts[i] = std::pair<vertex_id_t, uint32_t>(v, i);
+			walks[i * walk_length] = v;
+			walk_lens[i] = 1;
+		}
+		std::sort(starts.begin(), starts.end());
+		std::vector<vertex_id_t> ids;
+		for (size_t i = 0; i < num; i++) {
+			if (ids.empty() || ids.back() != starts[i].first)
+				ids.push_back(starts[i].first);
+		}
+
+		if (walk_length > 1) {
+			graph->start(ids.data(), ids.size(), vertex_initializer::ptr(
+						new walk_initializer(*graph, starts)),
+					vertex_program_creater::ptr(
+						new walk_vertex_program_creater(seed)));
+			graph->wait4complete();
+			seed += graph->get_num_threads();
+
+			std::vector<vertex_program::ptr> vprogs;
+			graph->get_vertex_programs(vprogs);
+			BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+				num_steps += walk_vertex_program::cast2(vprog)->get_num_steps();
+			}
+		}
+		size_t ret = write_walks(f, num);
+		num_written += ret;
+		if (ret < num) {
+			BOOST_LOG_TRIVIAL(error) << boost::format("can't write %1%: %2%")
+				% out_file % strerror(errno);
+			break;
+		}
+	}
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	fclose(f);
+	graph->init_all_vertices(vertex_initializer::ptr(new walk_clear()));
+	walks.reset();
+	walk_lens.reset();
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"random walk takes %1% seconds to write %2% walks with %3% steps")
+		% time_diff(start, end) % num_written % num_steps;
+	return num_written;
+}
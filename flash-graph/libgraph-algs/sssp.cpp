@@ -0,0 +1,334 @@
+/**
+ * Copyright 2014 Open Connectome Project (http://openconnecto.me)
+ * Written by Da Zheng (zhengda1936@gmail.com)
+ *
+ * This file is part of FlashGraph.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef PROFILER
+#include <gperftools/profiler.h>
+#endif
+
+#include <limits>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "graph_engine.h"
+#include "graph_config.h"
+#include "FG_vector.h"
+#include "FGlib.h"
+
+/*
+ * This is delta-stepping SSSP. The edge weight is the edge count stored
+ * as edge data. If the graph doesn't have edge data, all edges have
+ * weight 1.
+ *
+ * A vertex is put into bucket `dist / delta' when its distance is reduced.
+ * The vertex scheduler of each worker thread only runs the vertices in
+ * the lowest non-empty bucket of the thread and keeps the others for
+ * later levels. As a result, the relaxation through light edges, which
+ * lands in the same bucket, is done before we move to the next bucket.
+ * Each thread moves to the next bucket independently. This may relax
+ * a vertex more than once, but the distance is always correct because
+ * a vertex is scheduled again whenever its distance is reduced.
+ */
+
+namespace {
+
+typedef double dist_t;
+
+const dist_t INF_DIST = std::numeric_limits<dist_t>::infinity();
+const size_t INVALID_BUCKET = std::numeric_limits<size_t>::max();
+
+dist_t DELTA = 1;
+edge_type traverse_edge = edge_type::OUT_EDGE;
+bool has_edge_weight = false;
+
+class dist_message: public vertex_message
+{
+	dist_t dist;
+public:
+	dist_message(dist_t dist): vertex_message(sizeof(dist_message), true) {
+		this->dist = dist;
+	}
+
+	dist_t get_dist() const {
+		return dist;
+	}
+};
+
+class sssp_vertex: public compute_directed_vertex
+{
+	dist_t dist;
+	// The distance when the vertex relaxed its edges last time.
+	dist_t relaxed_dist;
+	// The bucket where the vertex is waiting to be scheduled.
+	size_t bucket;
+
+	void relax_edges(vertex_program &prog, const page_vertex &vertex,
+			edge_type type);
+public:
+	sssp_vertex(vertex_id_t id): compute_directed_vertex(id) {
+		dist = INF_DIST;
+		relaxed_dist = INF_DIST;
+		bucket = INVALID_BUCKET;
+	}
+
+	void init(dist_t dist) {
+		this->dist = dist;
+	}
+
+	dist_t get_result() const {
+		return dist;
+	}
+
+	bool has_reduced_dist() const {
+		return dist < relaxed_dist;
+	}
+
+	size_t get_bucket() const {
+		return bucket;
+	}
+
+	void set_bucket(size_t bucket) {
+		this->bucket = bucket;
+	}
+
+	void run(vertex_program &prog) {
+		if (!has_reduced_dist())
+			return;
+
+		relaxed_dist = dist;
+		vertex_id_t id = prog.get_vertex_id(*this);
+		if (prog.get_graph().is_directed()) {
+			directed_vertex_request req(id, traverse_edge, has_edge_weight
+					? request_part::TOPOLOGY_AND_DATA : request_part::TOPOLOGY);
+			request_partial_vertices(&req, 1);
+		}
+		else
+			request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &, const vertex_message &msg1) {
+		const dist_message &msg = (const dist_message &) msg1;
+		if (msg.get_dist() < dist)
+			dist = msg.get_dist();
+	}
+};
+
+void sssp_vertex::relax_edges(vertex_program &prog, const page_vertex &vertex,
+		edge_type type)
+{
+	edge_seq_iterator it = vertex.get_neigh_seq_it(type);
+	if (!has_edge_weight) {
+		dist_message msg(relaxed_dist + 1);
+		prog.multicast_msg(it, msg);
+		return;
+	}
+
+	const page_directed_vertex &dvertex = (const page_directed_vertex &) vertex;
+	page_byte_array::seq_const_iterator<edge_count> data_it
+		= dvertex.get_data_seq_it<edge_count>(type);
+	while (it.has_next()) {
+		vertex_id_t neigh = it.next();
+		BOOST_VERIFY(data_it.has_next());
+		edge_count weight = data_it.next();
+		dist_message msg(relaxed_dist + weight.get_count());
+		prog.send_msg(neigh, msg);
+	}
+}
+
+void sssp_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	if (prog.get_graph().is_directed() && traverse_edge == BOTH_EDGES) {
+		relax_edges(prog, vertex, edge_type::IN_EDGE);
+		relax_edges(prog, vertex, edge_type::OUT_EDGE);
+	}
+	else
+		relax_edges(prog, vertex, traverse_edge);
+}
+
+class sssp_vertex_program: public vertex_program_impl<sssp_vertex>
+{
+	// The vertices owned by this thread that wait for being scheduled.
+	std::map<size_t, std::vector<compute_vertex_pointer> > buckets;
+	size_t num_scheduled;
+public:
+	typedef std::shared_ptr<sssp_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<sssp_vertex_program, vertex_program>(
+				prog);
+	}
+
+	sssp_vertex_program() {
+		num_scheduled = 0;
+	}
+
+	void schedule(std::vector<compute_vertex_pointer> &vertices);
+
+	size_t get_num_scheduled() const {
+		return num_scheduled;
+	}
+};
+
+struct vertex_pointer_less
+{
+	bool operator()(const compute_vertex_pointer &v1,
+			const compute_vertex_pointer &v2) const {
+		return v1.get() < v2.get();
+	}
+};
+
+void sssp_vertex_program::schedule(std::vector<compute_vertex_pointer> &vertices)
+{
+	BOOST_FOREACH(compute_vertex_pointer v, vertices) {
+		assert(!v.is_part());
+		sssp_vertex &sv = (sssp_vertex &) *v.get();
+		// The vertex is activated by a message that doesn't reduce
+		// its distance.
+		if (!sv.has_reduced_dist())
+			continue;
+		size_t bucket = sv.get_result() / DELTA;
+		// The vertex is already in the bucket.
+		if (sv.get_bucket() == bucket)
+			continue;
+		// If the vertex is in another bucket, the old entry becomes
+		// invalid because the vertex's bucket doesn't match it.
+		sv.set_bucket(bucket);
+		buckets[bucket].push_back(v);
+	}
+
+	vertices.clear();
+	while (vertices.empty() && !buckets.empty()) {
+		std::map<size_t, std::vector<compute_vertex_pointer> >::iterator it
+			= buckets.begin();
+		BOOST_FOREACH(compute_vertex_pointer v, it->second) {
+			sssp_vertex &sv = (sssp_vertex &) *v.get();
+			if (sv.get_bucket() == it->first) {
+				sv.set_bucket(INVALID_BUCKET);
+				vertices.push_back(v);
+			}
+		}
+		buckets.erase(it);
+	}
+	// The vertices are stored in the order of their IDs. Keep the order
+	// to merge I/O requests.
+	std::sort(vertices.begin(), vertices.end(), vertex_pointer_less());
+	num_scheduled += vertices.size();
+}
+
+class sssp_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new sssp_vertex_program());
+	}
+};
+
+class bucket_scheduler: public vertex_scheduler
+{
+public:
+	void schedule(vertex_program &prog,
+			std::vector<compute_vertex_pointer> &vertices) {
+		((sssp_vertex_program &) prog).schedule(vertices);
+	}
+};
+
+class sssp_initializer: public vertex_initializer
+{
+public:
+	void init(compute_vertex &v) {
+		sssp_vertex &sv = (sssp_vertex &) v;
+		sv.init(0);
+	}
+};
+
+}
+
+#include "save_result.h"
+
+FG_vector<double>::ptr compute_sssp(FG_graph::ptr fg, vertex_id_t start_vertex,
+		double delta, edge_type type)
+{
+	if (delta <= 0) {
+		BOOST_LOG_TRIVIAL(error) << "delta has to be positive";
+		return FG_vector<double>::ptr();
+	}
+	graph_index::ptr index = NUMA_graph_index<sssp_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	if (start_vertex > graph->get_max_vertex_id()) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"the start vertex %1% doesn't exist") % start_vertex;
+		return FG_vector<double>::ptr();
+	}
+	// The edge data may be stored in an edge data column, so we ask
+	// the graph engine for the size of edge data.
+	if (graph->get_edge_data_size() > 0) {
+		// Only the directed vertex gives us the access to edge data.
+		if (!graph->is_directed()
+				|| graph->get_edge_data_size() != sizeof(edge_count)) {
+			BOOST_LOG_TRIVIAL(error)
+				<< "SSSP only supports edge count as edge weight in a directed graph";
+			return FG_vector<double>::ptr();
+		}
+		has_edge_weight = true;
+	}
+	else
+		has_edge_weight = false;
+	DELTA = delta;
+	traverse_edge = type;
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"SSSP starts from vertex %1% with delta %2%") % start_vertex % delta;
+	BOOST_LOG_TRIVIAL(info) << "prof_file: " << graph_conf.get_prof_file();
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	// The scheduler sees the start vertex before the graph engine runs
+	// the initializer, so we have to initialize it first.
+	graph->init_vertices(&start_vertex, 1,
+			vertex_initializer::ptr(new sssp_initializer()));
+	graph->set_vertex_scheduler(vertex_scheduler::ptr(new bucket_scheduler()));
+	graph->start(&start_vertex, 1, vertex_initializer::ptr(),
+			vertex_program_creater::ptr(new sssp_vertex_program_creater()));
+	graph->wait4complete();
+	gettimeofday(&end, NULL);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	size_t num_scheduled = 0;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		num_scheduled += sssp_vertex_program::cast2(vprog)->get_num_scheduled();
+	}
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"SSSP takes %1% seconds and relaxes %2% vertices")
+		% time_diff(start, end) % num_scheduled;
+
+	FG_vector<double>::ptr vec = FG_vector<double>::create(graph);
+	graph->query_on_all(vertex_query::ptr(
+				new save_query<double, sssp_vertex>(vec)));
+	return vec;
+}
@@ -24,6 +24,8 @@
 
 #include <set>
 #include <vector>
+#include <atomic>
+#include <algorithm>
 
 #include "graph_engine.h"
 #include "graph_config.h"
@@ -36,11 +38,31 @@ namespace {
 time_t timestamp;
 time_t time_interval = 1;
 int num_time_intervals = 1;
+// In the sliding mode, the window moves forward by one interval at a time
+// and vertices keep their local scans between windows.
+bool sliding = false;
+// Whether a vertex has the same edges in the latest interval of the current
+// window as in the latest interval of the previous window. Vertices set
+// them for the next window while they run in the current window.
+std::vector<char> same_edges;
+std::vector<char> next_same_edges;
+std::atomic<size_t> num_reused;
+std::atomic<size_t> num_skipped;
+std::atomic<size_t> num_recomputed;
+std::atomic<size_t> num_neigh_reads;
 
 class scan_vertex: public compute_vertex
 {
 	// The number of vertices that have joined with the vertex.
 	int num_joined;
+	// The number of neighbors requested by the vertex.
+	int num_required;
+	// The number of the latest time intervals whose local scans are
+	// counted in the neighbors.
+	int num_new_intervals;
+	// Whether the requested neighbors only update the local scan in
+	// the latest interval with the change of their edges.
+	bool count_change;
 	// Local scan in its neighborhood in different timestamps.
 	std::vector<size_t> *local_scans;
 	// All neighbors (in both in-edges and out-edges)
@@ -52,6 +74,17 @@ class scan_vertex: public compute_vertex
 public:
 	scan_vertex(vertex_id_t id): compute_vertex(id) {
 		num_joined = 0;
+		num_required = 0;
+		num_new_intervals = 0;
+		count_change = false;
+		local_scans = NULL;
+		neighbors = NULL;
+		result = 0;
+	}
+
+	void release_scans() {
+		delete local_scans;
+		delete neighbors;
 		local_scans = NULL;
 		neighbors = NULL;
 	}
@@ -81,6 +114,7 @@ public:
 
 	void run_on_itself(vertex_program &prog, const page_directed_vertex &vertex);
 	void run_on_neighbor(vertex_program &prog, const page_directed_vertex &vertex);
+	void compute_result();
 
 	void run_on_message(vertex_program &prog, const vertex_message &msg) {
 	}
@@ -187,11 +221,52 @@ size_t get_neighbors(const page_directed_vertex &v, edge_type type, time_t time_
 	return ret;
 }
 
+/*
+ * Test if a vertex has the same edges in an interval as in the previous
+ * interval. The edges are given in the interval.
+ */
+bool has_same_edges(const page_directed_vertex &v, edge_type type,
+		time_t time_start, const std::vector<vertex_id_t> &edges)
+{
+	std::vector<vertex_id_t> prev_edges;
+	get_neighbors(v, type, time_start - time_interval, time_interval,
+			prev_edges);
+	std::sort(prev_edges.begin(), prev_edges.end());
+	return prev_edges == edges;
+}
+
+/*
+ * The number of edges of a vertex in an interval, excluding loops.
+ */
+size_t get_num_edges(const page_directed_vertex &v, time_t time_start)
+{
+	std::vector<vertex_id_t> edges;
+	get_neighbors(v, edge_type::IN_EDGE, time_start, time_interval, edges);
+	get_neighbors(v, edge_type::OUT_EDGE, time_start, time_interval, edges);
+	return edges.size() - std::count(edges.begin(), edges.end(), v.get_id());
+}
+
 void scan_vertex::run_on_itself(vertex_program &prog,
 		const page_directed_vertex &vertex)
 {
-	assert(neighbors == NULL);
 	assert(num_joined == 0);
+	result = 0;
+
+	vertex_id_t curr_id = prog.get_vertex_id(*this);
+	if (sliding) {
+		std::vector<vertex_id_t> in_neighbors;
+		std::vector<vertex_id_t> out_neighbors;
+		time_t next_timestamp = timestamp + time_interval;
+		get_neighbors(vertex, edge_type::IN_EDGE, next_timestamp,
+				time_interval, in_neighbors);
+		get_neighbors(vertex, edge_type::OUT_EDGE, next_timestamp,
+				time_interval, out_neighbors);
+		std::sort(in_neighbors.begin(), in_neighbors.end());
+		std::sort(out_neighbors.begin(), out_neighbors.end());
+		next_same_edges[curr_id] = has_same_edges(vertex, edge_type::IN_EDGE,
+				next_timestamp, in_neighbors) && has_same_edges(vertex,
+				edge_type::OUT_EDGE, next_timestamp, out_neighbors);
+	}
 
 	std::vector<vertex_id_t> in_neighbors;
 	std::vector<vertex_id_t> out_neighbors;
@@ -201,11 +276,12 @@ void scan_vertex::run_on_itself(vertex_program &prog,
 			out_neighbors);
 	std::sort(in_neighbors.begin(), in_neighbors.end());
 	std::sort(out_neighbors.begin(), out_neighbors.end());
-	if (in_neighbors.size() + out_neighbors.size() == 0)
+	if (in_neighbors.size() + out_neighbors.size() == 0) {
+		release_scans();
 		return;
+	}
 
-	local_scans = new std::vector<size_t>(num_time_intervals);
-	neighbors = new std::vector<vertex_id_t>(
+	std::vector<vertex_id_t> *curr_neighbors = new std::vector<vertex_id_t>(
 			in_neighbors.size() + out_neighbors.size());
 
 	class skip_self {
@@ -220,13 +296,12 @@ void scan_vertex::run_on_itself(vertex_program &prog,
 		}
 	};
 
-	vertex_id_t curr_id = prog.get_vertex_id(*this);
 	int num_neighbors = unique_merge(
 			in_neighbors.begin(), in_neighbors.end(),
 			out_neighbors.begin(), out_neighbors.end(),
 			skip_self(vertex.get_id()),
-			neighbors->begin());
-	neighbors->resize(num_neighbors);
+			curr_neighbors->begin());
+	curr_neighbors->resize(num_neighbors);
 
 	size_t lscan = 0;
 	BOOST_FOREACH(vertex_id_t id, in_neighbors) {
@@ -237,16 +312,57 @@ void scan_vertex::run_on_itself(vertex_program &prog,
 		if (id != curr_id)
 			lscan++;
 	}
-	local_scans->at(0) = lscan;
 
-	if (neighbors->size() == 0) {
-		delete local_scans;
-		delete neighbors;
-		local_scans = NULL;
-		neighbors = NULL;
+	if (curr_neighbors->empty()) {
+		delete curr_neighbors;
+		release_scans();
 		return;
 	}
 
+	// The vertex has the same neighbors as in the previous window, so
+	// the local scans in the previous window are still valid and they
+	// only need to move by one interval. The local scan in the latest
+	// interval is the one in the previous interval with the change of
+	// the edges, so we only need to read the neighbors whose edges change.
+	if (neighbors && *neighbors == *curr_neighbors) {
+		delete curr_neighbors;
+		size_t prev_scan = local_scans->front();
+		local_scans->pop_back();
+		local_scans->insert(local_scans->begin(),
+				prev_scan - get_num_edges(vertex, timestamp - time_interval)
+				+ lscan);
+		num_reused++;
+
+		std::vector<vertex_id_t> changed;
+		BOOST_FOREACH(vertex_id_t id, *neighbors) {
+			if (!same_edges[id])
+				changed.push_back(id);
+		}
+		if (changed.empty()) {
+			num_skipped++;
+			compute_result();
+			return;
+		}
+		num_new_intervals = 1;
+		count_change = true;
+		num_required = changed.size();
+		num_neigh_reads += changed.size();
+		request_vertices(changed.data(), changed.size());
+		return;
+	}
+
+	release_scans();
+	neighbors = curr_neighbors;
+	local_scans = new std::vector<size_t>(num_time_intervals);
+	local_scans->at(0) = lscan;
+	num_new_intervals = num_time_intervals;
+	count_change = false;
+	num_required = neighbors->size();
+	if (sliding) {
+		num_recomputed++;
+		num_neigh_reads += neighbors->size();
+	}
+
 	// Count the degree of the vertex in other time intervals.
 	for (int ts_idx = 1; ts_idx < num_time_intervals
 			&& timestamp >= ts_idx * time_interval; ts_idx++) {
@@ -288,48 +404,76 @@ void scan_vertex::run_on_neighbor(vertex_program &prog,
 {
 	num_joined++;
 	assert(neighbors);
-	for (int j = 0; j < num_time_intervals
-			&& timestamp >= j * time_interval; j++) {
-		size_t ret = count_edges(prog, vertex, neighbors,
-				timestamp - j * time_interval, time_interval);
-		if (ret > 0)
-			local_scans->at(j) += ret;
+	if (count_change) {
+		local_scans->at(0) += count_edges(prog, vertex, neighbors, timestamp,
+				time_interval);
+		local_scans->at(0) -= count_edges(prog, vertex, neighbors,
+				timestamp - time_interval, time_interval);
+	}
+	else {
+		for (int j = 0; j < num_new_intervals
+				&& timestamp >= j * time_interval; j++) {
+			size_t ret = count_edges(prog, vertex, neighbors,
+					timestamp - j * time_interval, time_interval);
+			if (ret > 0)
+				local_scans->at(j) += ret;
+		}
 	}
 
 	// If we have seen all required neighbors, we have complete
 	// the computation. We can release the memory now.
-	if (num_joined == (int) neighbors->size()) {
-		double avg = 0;
-		if (num_time_intervals - 1 > 0) {
-			double sum = 0;
-			for (int i = 1; i < num_time_intervals; i++)
-				sum += local_scans->at(i);
-			avg = sum / (num_time_intervals - 1);
-		}
+	if (num_joined == num_required) {
+		num_joined = 0;
+		compute_result();
+	}
+}
 
-		double deviation;
-		if (num_time_intervals - 1 <= 1)
-			deviation = 1;
-		else {
-			double sum = 0;
-			for (int i = 1; i < num_time_intervals; i++) {
-				sum += (local_scans->at(i)
-						- avg) * (local_scans->at(i) - avg);
-			}
-			sum = sum / (num_time_intervals - 2);
-			deviation = sqrt(sum);
-			if (deviation < 1)
-				deviation = 1;
-		}
-		result = (local_scans->at(0) - avg) / deviation;
+void scan_vertex::compute_result()
+{
+	double avg = 0;
+	if (num_time_intervals - 1 > 0) {
+		double sum = 0;
+		for (int i = 1; i < num_time_intervals; i++)
+			sum += local_scans->at(i);
+		avg = sum / (num_time_intervals - 1);
+	}
 
-		delete local_scans;
-		delete neighbors;
-		local_scans = NULL;
-		neighbors = NULL;
+	double deviation;
+	if (num_time_intervals - 1 <= 1)
+		deviation = 1;
+	else {
+		double sum = 0;
+		for (int i = 1; i < num_time_intervals; i++) {
+			sum += (local_scans->at(i)
+					- avg) * (local_scans->at(i) - avg);
+		}
+		sum = sum / (num_time_intervals - 2);
+		deviation = sqrt(sum);
+		if (deviation < 1)
+			deviation = 1;
 	}
+	result = (local_scans->at(0) - avg) / deviation;
+
+	// The local scans are used in the next window in the sliding mode.
+	if (!sliding)
+		release_scans();
 }
 
+class release_query: public vertex_query
+{
+public:
+	virtual void run(graph_engine &graph, compute_vertex &v) {
+		((scan_vertex &) v).release_scans();
+	}
+
+	virtual void merge(graph_engine &graph, vertex_query::ptr q) {
+	}
+
+	virtual ptr clone() {
+		return vertex_query::ptr(new release_query());
+	}
+};
+
 }
 
 #include "save_result.h"
@@ -370,3 +514,70 @@ FG_vector<float>::ptr compute_sstsg(FG_graph::ptr fg, time_t start_time,
 	graph->query_on_all(vertex_query::ptr(new save_query<float, scan_vertex>(vec)));
 	return vec;
 }
+
+std::vector<FG_vector<float>::ptr> compute_sstsg_sliding(FG_graph::ptr fg,
+		time_t start_time, time_t interval, int num_intervals, int num_windows)
+{
+	time_interval = interval;
+	num_time_intervals = num_intervals;
+
+	graph_index::ptr index = NUMA_graph_index<scan_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	if (graph->get_graph_header().get_graph_type() != graph_type::DIRECTED
+			|| !graph->get_graph_header().has_edge_data()) {
+		BOOST_LOG_TRIVIAL(error)
+			<< "scan statistics requires a directed time-series graph";
+		return std::vector<FG_vector<float>::ptr>();
+	}
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("sliding scan statistics starts, start: %1%, interval: %2%, #interval: %3%, #windows: %4%")
+		% start_time % time_interval % num_time_intervals % num_windows;
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	sliding = true;
+	same_edges.assign(graph->get_num_vertices(), 0);
+	next_same_edges.assign(graph->get_num_vertices(), 0);
+	std::vector<FG_vector<float>::ptr> res;
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	for (int i = 0; i < num_windows; i++) {
+		timestamp = start_time + i * interval;
+		num_reused = 0;
+		num_skipped = 0;
+		num_recomputed = 0;
+		num_neigh_reads = 0;
+		struct timeval win_start, win_end;
+		gettimeofday(&win_start, NULL);
+		graph->start_all();
+		graph->wait4complete();
+		gettimeofday(&win_end, NULL);
+		same_edges.swap(next_same_edges);
+		BOOST_LOG_TRIVIAL(info)
+			<< boost::format("window %1% takes %2% seconds, %3% vertices reuse local scans (%4% without reading neighbors), %5% vertices recompute them, %6% neighbors are read")
+			% timestamp % time_diff(win_start, win_end) % num_reused.load()
+			% num_skipped.load() % num_recomputed.load()
+			% num_neigh_reads.load();
+
+		FG_vector<float>::ptr vec = FG_vector<float>::create(graph);
+		graph->query_on_all(vertex_query::ptr(
+					new save_query<float, scan_vertex>(vec)));
+		res.push_back(vec);
+	}
+	gettimeofday(&end, NULL);
+	sliding = false;
+	same_edges.clear();
+	next_same_edges.clear();
+	graph->query_on_all(vertex_query::ptr(new release_query()));
+
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+	BOOST_LOG_TRIVIAL(info)
+			<< boost::format("It takes %1% seconds") % time_diff(start, end);
+	return res;
+}
@@ -22,6 +22,8 @@
 
 #include <vector>
 #include <unordered_map>
+#include <atomic>
+#include <memory>
 
 #include "graph_engine.h"
 #include "graph_config.h"
@@ -314,6 +316,200 @@ void ts_wcc_vertex::run(vertex_program &prog, const page_vertex &vertex)
 	prog.multicast_msg(out_it, msg);
 }
 
+/*
+ * This is the sampling-based WCC similar to Afforest. The components are
+ * kept in an in-memory union-find forest where a tree always points from
+ * a larger vertex ID to a smaller one, so the root of a tree is
+ * the smallest vertex in the component, as in the other WCC.
+ *
+ * Reading a few neighbors of a vertex costs as much I/O as reading its
+ * whole edge list, so we sample vertices instead of edges: the vertices
+ * with at most `max_sample_degree' edges link with all of their neighbors
+ * first. Most vertices in the giant component are linked with it through
+ * these cheap vertices. The remaining vertices outside the giant component
+ * then read their edge lists and link with all of their neighbors. The
+ * vertices in the giant component, which own most of the edges, are never
+ * read in the second phase. An edge between a vertex in the giant
+ * component and another vertex is linked when the other vertex is read.
+ */
+std::unique_ptr<std::atomic<vertex_id_t>[]> comp;
+size_t num_comp_vertices;
+
+void link(vertex_id_t u, vertex_id_t v)
+{
+	vertex_id_t p1 = comp[u].load(std::memory_order_relaxed);
+	vertex_id_t p2 = comp[v].load(std::memory_order_relaxed);
+	while (p1 != p2) {
+		vertex_id_t high = std::max(p1, p2);
+		vertex_id_t low = std::min(p1, p2);
+		vertex_id_t p_high = comp[high].load(std::memory_order_relaxed);
+		// Someone else has linked the two trees.
+		if (p_high == low)
+			break;
+		// `high' is a root. Hang it under `low'.
+		if (p_high == high && comp[high].compare_exchange_strong(p_high, low))
+			break;
+		p1 = comp[comp[high].load(std::memory_order_relaxed)].load(
+				std::memory_order_relaxed);
+		p2 = comp[low].load(std::memory_order_relaxed);
+	}
+}
+
+/*
+ * Point every vertex to the root of its tree.
+ */
+void compress()
+{
+#pragma omp parallel for
+	for (size_t i = 0; i < num_comp_vertices; i++) {
+		vertex_id_t p = comp[i].load(std::memory_order_relaxed);
+		while (p != comp[p].load(std::memory_order_relaxed))
+			p = comp[p].load(std::memory_order_relaxed);
+		comp[i].store(p, std::memory_order_relaxed);
+	}
+}
+
+/*
+ * Find the largest component from a sample of vertices.
+ */
+vertex_id_t sample_frequent_comp(graph_engine &graph, size_t num_samples)
+{
+	std::unordered_map<vertex_id_t, size_t> counts;
+	for (size_t i = 0; i < num_samples; i++) {
+		vertex_id_t id = random() % num_comp_vertices;
+		// Empty vertices are singletons, which can't be the giant component.
+		if (graph.get_num_edges(id, edge_type::BOTH_EDGES) > 0)
+			counts[comp[id].load(std::memory_order_relaxed)]++;
+	}
+	vertex_id_t max_comp = INVALID_VERTEX_ID;
+	size_t max_count = 0;
+	for (std::unordered_map<vertex_id_t, size_t>::const_iterator it
+			= counts.begin(); it != counts.end(); it++) {
+		if (it->second > max_count) {
+			max_count = it->second;
+			max_comp = it->first;
+		}
+	}
+	return max_comp;
+}
+
+class sampled_wcc_vertex: public compute_vertex
+{
+public:
+	sampled_wcc_vertex(vertex_id_t id): compute_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &prog, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &, const vertex_message &msg) {
+	}
+};
+
+class sampled_wcc_vertex_program: public vertex_program_impl<sampled_wcc_vertex>
+{
+	size_t num_read_edges;
+public:
+	typedef std::shared_ptr<sampled_wcc_vertex_program> ptr;
+
+	static ptr cast2(vertex_program::ptr prog) {
+		return std::static_pointer_cast<sampled_wcc_vertex_program,
+			   vertex_program>(prog);
+	}
+
+	sampled_wcc_vertex_program() {
+		num_read_edges = 0;
+	}
+
+	void add_read_edges(size_t num) {
+		num_read_edges += num;
+	}
+
+	size_t get_num_read_edges() const {
+		return num_read_edges;
+	}
+};
+
+class sampled_wcc_vertex_program_creater: public vertex_program_creater
+{
+public:
+	vertex_program::ptr create() const {
+		return vertex_program::ptr(new sampled_wcc_vertex_program());
+	}
+};
+
+void link_neighbors(vertex_id_t id, const page_vertex &vertex, edge_type type)
+{
+	edge_seq_iterator it = vertex.get_neigh_seq_it(type);
+	while (it.has_next())
+		link(id, it.next());
+}
+
+void sampled_wcc_vertex::run(vertex_program &prog, const page_vertex &vertex)
+{
+	vertex_id_t id = vertex.get_id();
+	if (prog.get_graph().is_directed()) {
+		link_neighbors(id, vertex, edge_type::IN_EDGE);
+		link_neighbors(id, vertex, edge_type::OUT_EDGE);
+	}
+	else
+		link_neighbors(id, vertex, edge_type::OUT_EDGE);
+	((sampled_wcc_vertex_program &) prog).add_read_edges(
+			vertex.get_num_edges(edge_type::BOTH_EDGES));
+}
+
+class sample_degree_filter: public vertex_filter
+{
+	vsize_t max_degree;
+public:
+	sample_degree_filter(vsize_t max_degree) {
+		this->max_degree = max_degree;
+	}
+
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		vsize_t degree = prog.get_graph().get_num_edges(prog.get_vertex_id(v),
+				edge_type::BOTH_EDGES);
+		return degree > 0 && degree <= max_degree;
+	}
+};
+
+class non_giant_filter: public vertex_filter
+{
+	vsize_t max_degree;
+	vertex_id_t giant;
+public:
+	non_giant_filter(vsize_t max_degree, vertex_id_t giant) {
+		this->max_degree = max_degree;
+		this->giant = giant;
+	}
+
+	bool keep(vertex_program &prog, compute_vertex &v) {
+		vertex_id_t id = prog.get_vertex_id(v);
+		vsize_t degree = prog.get_graph().get_num_edges(id,
+				edge_type::BOTH_EDGES);
+		// The vertices that have been read in the sampling phase have
+		// been linked with all of their neighbors.
+		return degree > max_degree
+			&& comp[id].load(std::memory_order_relaxed) != giant;
+	}
+};
+
+size_t get_num_read_edges(graph_engine::ptr graph)
+{
+	std::vector<vertex_program::ptr> vprogs;
+	graph->get_vertex_programs(vprogs);
+	size_t num_read_edges = 0;
+	BOOST_FOREACH(vertex_program::ptr vprog, vprogs) {
+		num_read_edges
+			+= sampled_wcc_vertex_program::cast2(vprog)->get_num_read_edges();
+	}
+	return num_read_edges;
+}
+
 }
 
 #include "save_result.h"
@@ -415,3 +611,67 @@ FG_vector<vertex_id_t>::ptr compute_ts_wcc(FG_graph::ptr fg,
 				new save_query<vertex_id_t, wcc_vertex>(vec)));
 	return vec;
 }
+
+FG_vector<vertex_id_t>::ptr compute_sampled_wcc(FG_graph::ptr fg,
+		vsize_t max_sample_degree)
+{
+	// The number of vertices we sample to find the giant component.
+	const size_t NUM_COMP_SAMPLES = 1024;
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	graph_index::ptr index = NUMA_graph_index<sampled_wcc_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	BOOST_LOG_TRIVIAL(info) << "sampling-based weakly connected components starts";
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStart(graph_conf.get_prof_file().c_str());
+#endif
+
+	num_comp_vertices = graph->get_num_vertices();
+	comp = std::unique_ptr<std::atomic<vertex_id_t>[]>(
+			new std::atomic<vertex_id_t>[num_comp_vertices]);
+#pragma omp parallel for
+	for (size_t i = 0; i < num_comp_vertices; i++)
+		comp[i].store(i, std::memory_order_relaxed);
+
+	graph->start(std::shared_ptr<vertex_filter>(
+				new sample_degree_filter(max_sample_degree)),
+			vertex_program_creater::ptr(new sampled_wcc_vertex_program_creater()));
+	graph->wait4complete();
+	size_t num_sample_edges = get_num_read_edges(graph);
+	compress();
+
+	vertex_id_t giant = sample_frequent_comp(*graph, NUM_COMP_SAMPLES);
+	graph->start(std::shared_ptr<vertex_filter>(
+				new non_giant_filter(max_sample_degree, giant)),
+			vertex_program_creater::ptr(new sampled_wcc_vertex_program_creater()));
+	graph->wait4complete();
+	size_t num_finish_edges = get_num_read_edges(graph);
+	compress();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("WCC takes %1% seconds in total")
+		% time_diff(start, end);
+#ifdef PROFILER
+	if (!graph_conf.get_prof_file().empty())
+		ProfilerStop();
+#endif
+
+	FG_vector<vertex_id_t>::ptr vec = FG_vector<vertex_id_t>::create(graph);
+	size_t tot_edges = 0;
+	for (size_t i = 0; i < num_comp_vertices; i++) {
+		vsize_t num_edges = graph->get_num_edges(i, edge_type::BOTH_EDGES);
+		tot_edges += num_edges;
+		if (num_edges > 0)
+			vec->set(i, comp[i].load(std::memory_order_relaxed));
+		else
+			vec->set(i, INVALID_VERTEX_ID);
+	}
+	comp.reset();
+	BOOST_LOG_TRIVIAL(info)
+		<< boost::format("WCC reads %1% edges in sampling and %2% edges outside the giant component, out of %3% edges")
+		% num_sample_edges % num_finish_edges % tot_edges;
+	return vec;
+}
@@ -23,16 +23,13 @@
 #include "graph_engine.h"
 #include "FGlib.h"
 
-class matrix_vertex: public compute_vertex
+class matrix_vertex: public compute_directed_vertex
 {
 public:
-	matrix_vertex(vertex_id_t id): compute_vertex(id) {
+	matrix_vertex(vertex_id_t id): compute_directed_vertex(id) {
 	}
 
-	void run(vertex_program &prog) {
-		vertex_id_t id = prog.get_vertex_id(*this);
-		request_vertices(&id, 1);
-	}
+	void run(vertex_program &prog);
 
 	void run(vertex_program &prog, const page_vertex &vertex) {
 	}
@@ -41,10 +38,40 @@ public:
 	}
 };
 
+/**
+ * The vertex programs on a sparse matrix.
+ */
+class matrix_vertex_program: public vertex_program_impl<matrix_vertex>
+{
+public:
+	/**
+	 * The edges whose data the program reads. It's NONE if the program
+	 * doesn't read edge data.
+	 */
+	virtual edge_type get_data_type() const {
+		return edge_type::NONE;
+	}
+};
+
+inline void matrix_vertex::run(vertex_program &prog)
+{
+	vertex_id_t id = prog.get_vertex_id(*this);
+	edge_type type = ((matrix_vertex_program &) prog).get_data_type();
+	// The edge data in an edge data column is read only on request.
+	if (type != edge_type::NONE && prog.get_graph().has_edge_data_column()) {
+		directed_vertex_request req(id, type,
+				request_part::TOPOLOGY_AND_DATA);
+		request_partial_vertices(&req, 1);
+	}
+	else
+		request_vertices(&id, 1);
+}
+
 class adj_get_edge_iter
 {
 public:
 	typedef int value_type;
+	static const bool has_edge_data = false;
 
 	class iterator {
 		page_byte_array::seq_const_iterator<vertex_id_t> it;
@@ -80,6 +107,7 @@ class general_get_edge_iter
 {
 public:
 	typedef T value_type;
+	static const bool has_edge_data = true;
 
 	class iterator {
 		page_byte_array::seq_const_iterator<vertex_id_t> n_it;
@@ -134,7 +162,7 @@ inline static edge_type reverse_dir(edge_type type)
  * on the adjacency matrix.
  */
 template<class ResType>
-class SPMV_vertex_program: public vertex_program_impl<matrix_vertex>
+class SPMV_vertex_program: public matrix_vertex_program
 {
 	edge_type type;
 	const FG_vector<ResType> &input;
@@ -180,7 +208,7 @@ public:
  * and aggregates rows or columns in each group.
  */
 template<class AggOp, class GetEdgeIterator>
-class groupby_vertex_program: public vertex_program_impl<matrix_vertex>
+class groupby_vertex_program: public matrix_vertex_program
 {
 public:
 	typedef std::map<int, typename FG_vector<AggOp>::ptr> agg_map_t;
@@ -209,6 +237,11 @@ public:
 			return reverse_dir(row_type);
 	}
 
+	virtual edge_type get_data_type() const {
+		return GetEdgeIterator::has_edge_data
+			? get_edge_type() : edge_type::NONE;
+	}
+
 	template<class T>
 	void aggregate(int label, vertex_id_t id, T v) {
 		typename agg_map_t::const_iterator it = agg_results.find(label);
@@ -260,7 +293,7 @@ public:
 };
 
 template<class Func, class GetEdgeIterator>
-class apply_vertex_program: public vertex_program_impl<matrix_vertex>
+class apply_vertex_program: public matrix_vertex_program
 {
 	Func &func;
 	edge_type etype;
@@ -275,6 +308,10 @@ public:
 		this->ncol = ncol;
 	}
 
+	virtual edge_type get_data_type() const {
+		return GetEdgeIterator::has_edge_data ? etype : edge_type::NONE;
+	}
+
 	virtual void run(compute_vertex &, const page_vertex &vertex) {
 		if (vertex.get_id() >= nrow)
 			return;
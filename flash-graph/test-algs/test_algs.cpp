@@ -22,11 +22,24 @@
 #include <gperftools/profiler.h>
 #endif
 
+#include <limits>
+
 #include "FGlib.h"
 #include "ts_graph.h"
 
 void print_usage();
 
+/*
+ * A vector is written in binary if the output file name ends with ".bin".
+ * It can be read back with FG_vector::from_file.
+ */
+static bool is_binary_output(const std::string &file)
+{
+	const std::string suffix = ".bin";
+	return file.size() > suffix.size() && file.compare(
+			file.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
 void int_handler(int sig_num)
 {
 #ifdef PROFILER
@@ -66,11 +79,98 @@ void run_cycle_triangle(FG_graph::ptr graph, int argc, char *argv[])
 
 void run_triangle(FG_graph::ptr graph, int argc, char *argv[])
 {
+	int opt;
+	int num_opts = 0;
+	double edge_prob = 0;
+	double confidence = 0.95;
+
+	while ((opt = getopt(argc, argv, "p:c:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'p':
+				edge_prob = atof(optarg);
+				num_opts++;
+				break;
+			case 'c':
+				confidence = atof(optarg);
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	if (edge_prob > 0) {
+		approx_estimate est = estimate_triangles(graph, edge_prob, confidence);
+		printf("There are about %.0f triangles (%g%% CI: [%.0f, %.0f])\n",
+				est.estimate, confidence * 100, est.lower, est.upper);
+		return;
+	}
 	FG_vector<size_t>::ptr triangles;
 	triangles = compute_undirected_triangles(graph);
 	printf("There are %ld triangles\n", triangles->sum());
 }
 
+void run_transitivity(FG_graph::ptr graph, int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	size_t num_samples = 0;
+	double max_error = 0.01;
+	double confidence = 0.95;
+	bool local = false;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "s:e:c:lo:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 's':
+				num_samples = atol(optarg);
+				num_opts++;
+				break;
+			case 'e':
+				max_error = atof(optarg);
+				num_opts++;
+				break;
+			case 'c':
+				confidence = atof(optarg);
+				num_opts++;
+				break;
+			case 'l':
+				local = true;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	if (local) {
+		if (num_samples == 0)
+			num_samples = 100;
+		FG_vector<float>::ptr trans = estimate_local_transitivity(graph,
+				num_samples);
+		printf("The average local transitivity is %f\n",
+				trans->sum() / trans->get_size());
+		if (!output_file.empty())
+			trans->to_file(output_file, is_binary_output(output_file));
+		return;
+	}
+
+	// The standard error with n samples is at most 1 / (2 * sqrt(n)), and
+	// the error within the confidence level is about 2 standard errors.
+	if (num_samples == 0)
+		num_samples = ceil(1 / (max_error * max_error));
+	approx_estimate est = estimate_transitivity(graph, num_samples, confidence);
+	printf("The transitivity is about %f (%g%% CI: [%f, %f])\n",
+			est.estimate, confidence * 100, est.lower, est.upper);
+}
+
 void run_local_scan(FG_graph::ptr graph, int argc, char *argv[])
 {
 	FG_vector<size_t>::ptr scan = compute_local_scan(graph);
@@ -122,13 +222,18 @@ void run_wcc(FG_graph::ptr graph, int argc, char *argv[])
 	int opt;
 	int num_opts = 0;
 	bool sync = false;
+	vsize_t max_sample_degree = 0;
 	std::string output_file;
-	while ((opt = getopt(argc, argv, "so:")) != -1) {
+	while ((opt = getopt(argc, argv, "so:a:")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 's':
 				sync = true;
 				break;
+			case 'a':
+				max_sample_degree = atoi(optarg);
+				num_opts++;
+				break;
 			case 'o':
 				output_file = optarg;
 				num_opts++;
@@ -141,6 +246,8 @@ void run_wcc(FG_graph::ptr graph, int argc, char *argv[])
 	FG_vector<vertex_id_t>::ptr comp_ids;
 	if (sync)
 		comp_ids = compute_sync_wcc(graph);
+	else if (max_sample_degree > 0)
+		comp_ids = compute_sampled_wcc(graph, max_sample_degree);
 	else
 		comp_ids = compute_wcc(graph);
 	if (!output_file.empty()) {
@@ -168,10 +275,14 @@ void run_diameter(FG_graph::ptr graph, int argc, char *argv[])
 
 	int num_para_bfs = 1;
 	bool directed = false;
+	bool exact = false;
 
-	while ((opt = getopt(argc, argv, "p:ds:")) != -1) {
+	while ((opt = getopt(argc, argv, "p:ds:e")) != -1) {
 		num_opts++;
 		switch (opt) {
+			case 'e':
+				exact = true;
+				break;
 			case 'p':
 				num_para_bfs = atoi(optarg);
 				num_opts++;
@@ -185,10 +296,333 @@ void run_diameter(FG_graph::ptr graph, int argc, char *argv[])
 		}
 	}
 
+	if (exact) {
+		size_t radius = 0;
+		size_t diameter = compute_exact_diameter(graph, &radius);
+		printf("The diameter is %ld and the radius is %ld\n", diameter, radius);
+		return;
+	}
+
 	size_t diameter = estimate_diameter(graph, num_para_bfs, directed);
 	printf("The estimated diameter is %ld\n", diameter);
 }
 
+void run_hyper_anf(FG_graph::ptr graph, int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	int log2_num_regs = 6;
+	int num_levels = INT_MAX;
+	std::string output_file;
+	std::string harmonic_file;
+
+	while ((opt = getopt(argc, argv, "r:l:o:h:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'r':
+				log2_num_regs = atoi(optarg);
+				num_opts++;
+				break;
+			case 'l':
+				num_levels = atoi(optarg);
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			case 'h':
+				harmonic_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	FG_vector<float>::ptr counts;
+	FG_vector<float>::ptr harmonics;
+	std::vector<double> nf = compute_hyper_anf(graph, log2_num_regs,
+			num_levels, output_file.empty() ? NULL : &counts,
+			harmonic_file.empty() ? NULL : &harmonics);
+	if (nf.empty())
+		return;
+	for (size_t i = 0; i < nf.size(); i++)
+		printf("N(%ld) = %f\n", i, nf[i]);
+	printf("The effective diameter is %f\n", compute_effective_diameter(nf));
+	if (!output_file.empty())
+		counts->to_file(output_file, is_binary_output(output_file));
+	if (!harmonic_file.empty())
+		harmonics->to_file(harmonic_file, is_binary_output(harmonic_file));
+}
+
+void run_bfs(FG_graph::ptr graph, int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	edge_type traverse_edge = edge_type::OUT_EDGE;
+	std::string output_file;
+
+	if (argc < 2) {
+		fprintf(stderr, "bfs requires start_vertex\n");
+		exit(-1);
+	}
+	vertex_id_t start_vertex = atol(argv[1]);
+
+	while ((opt = getopt(argc, argv, "bo:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'b':
+				traverse_edge = edge_type::BOTH_EDGES;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	FG_vector<int>::ptr depths = compute_bfs(graph, start_vertex,
+			traverse_edge);
+	if (depths == NULL)
+		return;
+	size_t num_visited = 0;
+	int max_depth = 0;
+	for (size_t i = 0; i < depths->get_size(); i++) {
+		if (depths->get(i) >= 0) {
+			num_visited++;
+			max_depth = std::max(max_depth, depths->get(i));
+		}
+	}
+	printf("BFS from vertex %u visits %ld vertices in %d levels\n",
+			start_vertex, num_visited, max_depth + 1);
+	if (!output_file.empty())
+		depths->to_file(output_file, is_binary_output(output_file));
+}
+
+void run_multi_bfs(FG_graph::ptr graph, int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	edge_type traverse_edge = edge_type::OUT_EDGE;
+	size_t num_sources = 64;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "bn:o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'b':
+				traverse_edge = edge_type::BOTH_EDGES;
+				break;
+			case 'n':
+				num_sources = atoi(optarg);
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	std::vector<vertex_id_t> sources;
+	size_t num_vertices = graph->get_graph_header().get_num_vertices();
+	while (sources.size() < num_sources)
+		sources.push_back(random() % num_vertices);
+
+	std::vector<size_t> num_reached;
+	std::vector<size_t> sum_dists;
+	if (output_file.empty()) {
+		if (!count_multi_bfs_reach(graph, sources, traverse_edge,
+					num_reached, sum_dists))
+			return;
+	}
+	else {
+		std::vector<FG_vector<int>::ptr> depths = compute_multi_bfs(graph,
+				sources, traverse_edge);
+		if (depths.empty())
+			return;
+		FILE *f = fopen(output_file.c_str(), "w");
+		if (f == NULL) {
+			perror("fopen");
+			return;
+		}
+		for (size_t i = 0; i < depths.size(); i++) {
+			size_t num = 0;
+			size_t sum = 0;
+			for (size_t j = 0; j < depths[i]->get_size(); j++) {
+				int depth = depths[i]->get(j);
+				fprintf(f, "%d ", depth);
+				if (depth >= 0) {
+					num++;
+					sum += depth;
+				}
+			}
+			fprintf(f, "\n");
+			num_reached.push_back(num);
+			sum_dists.push_back(sum);
+		}
+		fclose(f);
+	}
+	for (size_t i = 0; i < sources.size(); i++)
+		printf("BFS from vertex %u reaches %ld vertices, avg dist: %f\n",
+				sources[i], num_reached[i],
+				((double) sum_dists[i]) / num_reached[i]);
+}
+
+void run_sssp(FG_graph::ptr graph, int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	edge_type traverse_edge = edge_type::OUT_EDGE;
+	double delta = 1;
+	std::string output_file;
+
+	if (argc < 2) {
+		fprintf(stderr, "sssp requires start_vertex\n");
+		exit(-1);
+	}
+	vertex_id_t start_vertex = atol(argv[1]);
+
+	while ((opt = getopt(argc, argv, "bd:o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'b':
+				traverse_edge = edge_type::BOTH_EDGES;
+				break;
+			case 'd':
+				delta = atof(optarg);
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	FG_vector<double>::ptr dists = compute_sssp(graph, start_vertex, delta,
+			traverse_edge);
+	if (dists == NULL)
+		return;
+	size_t num_reached = 0;
+	double max_dist = 0;
+	for (size_t i = 0; i < dists->get_size(); i++) {
+		if (dists->get(i) != std::numeric_limits<double>::infinity()) {
+			num_reached++;
+			max_dist = std::max(max_dist, dists->get(i));
+		}
+	}
+	printf("SSSP from vertex %u reaches %ld vertices. The max distance is %f\n",
+			start_vertex, num_reached, max_dist);
+	if (!output_file.empty())
+		dists->to_file(output_file, is_binary_output(output_file));
+}
+
+void run_betweenness(FG_graph::ptr graph, int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	size_t num_samples = 0;
+	int batch_size = 64;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "s:b:o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 's':
+				num_samples = atol(optarg);
+				num_opts++;
+				break;
+			case 'b':
+				batch_size = atoi(optarg);
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	FG_vector<double>::ptr bc = compute_betweenness(graph, num_samples,
+			batch_size);
+	if (bc == NULL)
+		return;
+	vertex_id_t max_v = 0;
+	for (size_t i = 1; i < bc->get_size(); i++) {
+		if (bc->get(i) > bc->get(max_v))
+			max_v = i;
+	}
+	printf("Vertex %u has the largest betweenness %f\n", max_v,
+			bc->get(max_v));
+	if (!output_file.empty())
+		bc->to_file(output_file, is_binary_output(output_file));
+}
+
+void run_random_walk(FG_graph::ptr graph, int argc, char *argv[])
+{
+	int opt;
+	int num_opts = 0;
+	int num_walks = 10;
+	int length = 80;
+	double p = 1;
+	double q = 1;
+	size_t batch_size = 1024 * 1024;
+
+	if (argc < 2) {
+		fprintf(stderr, "random_walk requires output_file\n");
+		exit(-1);
+	}
+	std::string output_file = argv[1];
+
+	while ((opt = getopt(argc, argv, "n:l:p:q:b:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'n':
+				num_walks = atoi(optarg);
+				num_opts++;
+				break;
+			case 'l':
+				length = atoi(optarg);
+				num_opts++;
+				break;
+			case 'p':
+				p = atof(optarg);
+				num_opts++;
+				break;
+			case 'q':
+				q = atof(optarg);
+				num_opts++;
+				break;
+			case 'b':
+				batch_size = atol(optarg);
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	size_t num_written = compute_random_walks(graph, output_file, num_walks,
+			length, p, q, batch_size);
+	printf("%ld walks are written to %s\n", num_written, output_file.c_str());
+}
+
 void run_pagerank(FG_graph::ptr graph, int argc, char *argv[], int version)
 {
 	int opt;
@@ -196,8 +630,9 @@ void run_pagerank(FG_graph::ptr graph, int argc, char *argv[], int version)
 
 	int num_iters = 30;
 	float damping_factor = 0.85;
+	pr_schedule_type sched_type = PR_DEFAULT_SCHED;
 
-	while ((opt = getopt(argc, argv, "i:D:")) != -1) {
+	while ((opt = getopt(argc, argv, "i:D:s:")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 'i':
@@ -208,6 +643,17 @@ void run_pagerank(FG_graph::ptr graph, int argc, char *argv[], int version)
 				damping_factor = atof(optarg);
 				num_opts++;
 				break;
+			case 's':
+				if (std::string(optarg) == "priority")
+					sched_type = PR_PRIORITY_SCHED;
+				else if (std::string(optarg) == "async")
+					sched_type = PR_ASYNC_SCHED;
+				else {
+					print_usage();
+					abort();
+				}
+				num_opts++;
+				break;
 			default:
 				print_usage();
 				abort();
@@ -215,12 +661,15 @@ void run_pagerank(FG_graph::ptr graph, int argc, char *argv[], int version)
 	}
 
 	FG_vector<float>::ptr pr;
+	size_t num_edge_reads;
 	switch (version) {
 		case 1:
 			pr = compute_pagerank(graph, num_iters, damping_factor);
 			break;
 		case 2:
-			pr = compute_pagerank2(graph, num_iters, damping_factor);
+			pr = compute_pagerank2(graph, num_iters, damping_factor, sched_type,
+					&num_edge_reads);
+			printf("%ld edges are read\n", num_edge_reads);
 			break;
 		default:
 			abort();
@@ -240,12 +689,13 @@ void run_sstsg(FG_graph::ptr graph, int argc, char *argv[])
 	int num_time_intervals = 1;
 	long time_interval = 1;
 	bool compute_all = false;
+	int num_windows = 0;
 	time_t start_time = -1;
 
 	int opt;
 	int num_opts = 0;
 
-	while ((opt = getopt(argc, argv, "n:u:o:t:l:a")) != -1) {
+	while ((opt = getopt(argc, argv, "n:u:o:t:l:aw:")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 'n':
@@ -275,6 +725,10 @@ void run_sstsg(FG_graph::ptr graph, int argc, char *argv[])
 			case 'a':
 				compute_all = true;
 				break;
+			case 'w':
+				num_windows = atoi(optarg);
+				num_opts++;
+				break;
 			default:
 				print_usage();
 				abort();
@@ -315,6 +769,32 @@ void run_sstsg(FG_graph::ptr graph, int argc, char *argv[])
 			printf("v%ld has max scan %f\n", p.second, p.first);
 		}
 	}
+	else if (num_windows > 0) {
+		printf("start time: %ld, interval: %ld, #windows: %d\n", start_time,
+				time_interval, num_windows);
+		std::vector<FG_vector<float>::ptr> res = compute_sstsg_sliding(graph,
+				start_time, time_interval, num_time_intervals, num_windows);
+		FILE *f = NULL;
+		if (!output_file.empty()) {
+			f = fopen(output_file.c_str(), "w");
+			if (f == NULL) {
+				perror("fopen");
+				return;
+			}
+		}
+		for (size_t i = 0; i < res.size(); i++) {
+			std::pair<float, off_t> p = res[i]->max_val_loc();
+			printf("window %ld: v%ld has max scan %f\n",
+					start_time + i * time_interval, p.second, p.first);
+			if (f) {
+				for (size_t j = 0; j < res[i]->get_size(); j++)
+					fprintf(f, "%ld \"%ld\" %f\n",
+							start_time + i * time_interval, j, res[i]->get(j));
+			}
+		}
+		if (f)
+			fclose(f);
+	}
 	else {
 		printf("start time: %ld, interval: %ld\n", start_time, time_interval);
 		FG_vector<float>::ptr res = compute_sstsg(graph, start_time,
@@ -415,21 +895,237 @@ void run_kcore(FG_graph::ptr graph, int argc, char* argv[])
 		}
 	}
 
-	if (k < 2) {
-		fprintf(stderr, "[Error]: kmin cannot be < 2\n");
-		exit(-1);
-	}
-
 	FG_vector<size_t>::ptr kcorev = compute_kcore(graph, k, kmax);
 	if (!write_out.empty())
-		kcorev->to_file(write_out);
+		kcorev->to_file(write_out, is_binary_output(write_out));
 }
 
-int read_vertices(const std::string &file, std::vector<vertex_id_t> &vertices)
+void run_ktruss(FG_graph::ptr graph, int argc, char* argv[])
 {
-	FILE *f = fopen(file.c_str(), "r");
-	assert(f);
-	ssize_t ret;
+	int opt;
+	int num_opts = 0;
+	std::string output_file;
+	std::string edge_file;
+
+	while ((opt = getopt(argc, argv, "o:e:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			case 'e':
+				edge_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	std::vector<edge<vsize_t> > edge_trusses;
+	FG_vector<vsize_t>::ptr trusses = compute_ktruss(graph,
+			edge_file.empty() ? NULL : &edge_trusses);
+	if (trusses == NULL)
+		return;
+	vsize_t max_truss = trusses->max();
+	size_t num_max = 0;
+	for (size_t i = 0; i < trusses->get_size(); i++)
+		if (trusses->get(i) == max_truss)
+			num_max++;
+	printf("The max truss is %u, and %ld vertices are in the %u-truss\n",
+			max_truss, num_max, max_truss);
+	if (!output_file.empty())
+		trusses->to_file(output_file, is_binary_output(output_file));
+	if (!edge_file.empty()) {
+		FILE *f = fopen(edge_file.c_str(), "w");
+		if (f == NULL) {
+			perror("fopen");
+			return;
+		}
+		for (size_t i = 0; i < edge_trusses.size(); i++)
+			fprintf(f, "%u %u %u\n", edge_trusses[i].get_from(),
+					edge_trusses[i].get_to(), edge_trusses[i].get_data());
+		fclose(f);
+	}
+}
+
+void run_label_prop(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	int num_iters = 100;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "i:o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'i':
+				num_iters = atoi(optarg);
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	FG_vector<vertex_id_t>::ptr labels = compute_label_propagation(graph,
+			num_iters);
+	count_map<vertex_id_t> map;
+	labels->count_unique(map);
+	std::pair<vertex_id_t, size_t> max_comm = map.get_max_count();
+	printf("There are %ld communities, and largest comm has %ld vertices\n",
+			map.get_size(), max_comm.second);
+	if (!output_file.empty())
+		labels->to_file(output_file, is_binary_output(output_file));
+}
+
+void run_louvain(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	int num_iters = 20;
+	int max_levels = 20;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "i:l:o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'i':
+				num_iters = atoi(optarg);
+				num_opts++;
+				break;
+			case 'l':
+				max_levels = atoi(optarg);
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	double modularity = 0;
+	FG_vector<vertex_id_t>::ptr comms = compute_louvain(graph, num_iters,
+			max_levels, &modularity);
+	if (comms == NULL)
+		return;
+	count_map<vertex_id_t> map;
+	comms->count_unique(map);
+	std::pair<vertex_id_t, size_t> max_comm = map.get_max_count();
+	printf("There are %ld communities with modularity %f, and largest comm has %ld vertices\n",
+			map.get_size(), modularity, max_comm.second);
+	if (!output_file.empty())
+		comms->to_file(output_file, is_binary_output(output_file));
+}
+
+void run_msf(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	std::vector<edge<edge_count> > forest;
+	compute_msf(graph, forest);
+	size_t total_weight = 0;
+	for (size_t i = 0; i < forest.size(); i++)
+		total_weight += forest[i].get_data().get_count();
+	size_t num_vertices = graph->get_graph_header().get_num_vertices();
+	printf("The minimum spanning forest has %ld trees and %ld edges with total weight %ld\n",
+			num_vertices - forest.size(), forest.size(), total_weight);
+	if (!output_file.empty()) {
+		FILE *f = fopen(output_file.c_str(), "w");
+		if (f == NULL) {
+			perror("fopen");
+			return;
+		}
+		for (size_t i = 0; i < forest.size(); i++)
+			fprintf(f, "%u %u %u\n", forest[i].get_from(), forest[i].get_to(),
+					forest[i].get_data().get_count());
+		fclose(f);
+	}
+}
+
+void run_mis(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	FG_vector<vsize_t>::ptr in_set = compute_mis(graph);
+	printf("The maximal independent set has %ld vertices\n",
+			(size_t) in_set->sum());
+	if (!output_file.empty())
+		in_set->to_file(output_file, is_binary_output(output_file));
+}
+
+void run_coloring(FG_graph::ptr graph, int argc, char* argv[])
+{
+	int opt;
+	int num_opts = 0;
+	std::string output_file;
+
+	while ((opt = getopt(argc, argv, "o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	FG_vector<vsize_t>::ptr colors = compute_coloring(graph);
+	printf("The vertices are colored with %u colors\n",
+			colors->max() + 1);
+	if (!output_file.empty())
+		colors->to_file(output_file, is_binary_output(output_file));
+}
+
+int read_vertices(const std::string &file, std::vector<vertex_id_t> &vertices)
+{
+	FILE *f = fopen(file.c_str(), "r");
+	assert(f);
+	ssize_t ret;
 	char *line = NULL;
 	size_t line_size = 0;
 	while ((ret = getline(&line, &line_size, f)) > 0) {
@@ -443,6 +1139,109 @@ int read_vertices(const std::string &file, std::vector<vertex_id_t> &vertices)
 	return vertices.size();
 }
 
+/*
+ * Each line of the file is a seed set.
+ */
+int read_seed_sets(const std::string &file,
+		std::vector<std::vector<vertex_id_t> > &seed_sets)
+{
+	FILE *f = fopen(file.c_str(), "r");
+	assert(f);
+	ssize_t ret;
+	char *line = NULL;
+	size_t line_size = 0;
+	while ((ret = getline(&line, &line_size, f)) > 0) {
+		std::vector<vertex_id_t> set;
+		char *saveptr = NULL;
+		for (char *tok = strtok_r(line, " \t\n", &saveptr); tok;
+				tok = strtok_r(NULL, " \t\n", &saveptr))
+			set.push_back(atol(tok));
+		if (!set.empty())
+			seed_sets.push_back(set);
+	}
+	free(line);
+	fclose(f);
+	return seed_sets.size();
+}
+
+void run_ppr(FG_graph::ptr graph, int argc, char* argv[])
+{
+	if (argc < 2) {
+		fprintf(stderr, "ppr requires seed_file\n");
+		exit(-1);
+	}
+	std::string seed_file = argv[1];
+
+	int opt;
+	int num_opts = 0;
+	std::string output_file;
+	float damping_factor = 0.85;
+	double epsilon = 1e-6;
+	size_t topK = 100;
+	int batch_size = 32;
+	int num_walks = 0;
+	while ((opt = getopt(argc, argv, "d:e:k:b:w:o:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'd':
+				damping_factor = atof(optarg);
+				num_opts++;
+				break;
+			case 'e':
+				epsilon = atof(optarg);
+				num_opts++;
+				break;
+			case 'k':
+				topK = atol(optarg);
+				num_opts++;
+				break;
+			case 'b':
+				batch_size = atoi(optarg);
+				num_opts++;
+				break;
+			case 'w':
+				num_walks = atoi(optarg);
+				num_opts++;
+				break;
+			case 'o':
+				output_file = optarg;
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	std::vector<std::vector<vertex_id_t> > seed_sets;
+	read_seed_sets(seed_file, seed_sets);
+	std::vector<ppr_vector> pprs;
+	if (num_walks > 0)
+		pprs = compute_mc_personalized_pagerank(graph, seed_sets,
+				damping_factor, num_walks, topK);
+	else
+		pprs = compute_personalized_pagerank(graph, seed_sets, damping_factor,
+				epsilon, topK, batch_size);
+	if (pprs.empty())
+		return;
+	for (size_t i = 0; i < pprs.size() && i < 10; i++) {
+		if (!pprs[i].empty())
+			printf("seed set %ld: vertex %u has the largest PageRank %f\n", i,
+					pprs[i][0].first, pprs[i][0].second);
+	}
+
+	if (!output_file.empty()) {
+		FILE *fout = fopen(output_file.c_str(), "w");
+		assert(fout);
+		for (size_t i = 0; i < pprs.size(); i++) {
+			for (size_t j = 0; j < pprs[i].size(); j++)
+				fprintf(fout, "%ld %u %g\n", i, pprs[i][j].first,
+						pprs[i][j].second);
+		}
+		fclose(fout);
+	}
+}
+
 void run_overlap(FG_graph::ptr graph, int argc, char* argv[])
 {
 	std::string output_file;
@@ -499,20 +1298,85 @@ void run_overlap(FG_graph::ptr graph, int argc, char* argv[])
 	}
 }
 
+void run_similar(FG_graph::ptr graph, int argc, char* argv[])
+{
+	if (argc < 2) {
+		fprintf(stderr, "similar requires output_file\n");
+		exit(-1);
+	}
+	std::string output_file = argv[1];
+
+	int opt;
+	int num_opts = 0;
+	int k = 10;
+	int num_bands = 64;
+	int num_rows = 2;
+	double min_sim = 0.1;
+	while ((opt = getopt(argc, argv, "k:b:r:t:")) != -1) {
+		num_opts++;
+		switch (opt) {
+			case 'k':
+				k = atoi(optarg);
+				num_opts++;
+				break;
+			case 'b':
+				num_bands = atoi(optarg);
+				num_opts++;
+				break;
+			case 'r':
+				num_rows = atoi(optarg);
+				num_opts++;
+				break;
+			case 't':
+				min_sim = atof(optarg);
+				num_opts++;
+				break;
+			default:
+				print_usage();
+				abort();
+		}
+	}
+
+	if (k <= 0) {
+		fprintf(stderr, "similar requires a positive k\n");
+		exit(-1);
+	}
+	if (num_bands <= 0 || num_rows <= 0) {
+		fprintf(stderr, "similar requires positive numbers of bands and rows\n");
+		exit(-1);
+	}
+	compute_topK_similar(graph, k, output_file, num_bands, num_rows, min_sim);
+}
+
 std::string supported_algs[] = {
 	"cycle_triangle",
 	"triangle",
+	"transitivity",
 	"local_scan",
 	"topK_scan",
 	"wcc",
 	"scc",
 	"diameter",
+	"hyper_anf",
+	"bfs",
+	"sssp",
+	"multi_bfs",
+	"betweenness",
 	"pagerank",
 	"pagerank2",
+	"ppr",
+	"random_walk",
 	"sstsg",
 	"ts_wcc",
 	"kcore",
+	"ktruss",
+	"label_prop",
+	"louvain",
+	"msf",
+	"mis",
+	"coloring",
 	"overlap",
+	"similar",
 };
 int num_supported = sizeof(supported_algs) / sizeof(supported_algs[0]);
 
@@ -520,6 +1384,8 @@ void print_usage()
 {
 	fprintf(stderr,
 			"test_algs conf_file graph_file index_file algorithm [alg-options]\n");
+	fprintf(stderr,
+			"an output file whose name ends with .bin gets the raw values of the vector\n");
 	fprintf(stderr, "scan-statistics:\n");
 	fprintf(stderr, "-K topK: topK vertices in topK scan\n");
 	fprintf(stderr, "\n");
@@ -527,10 +1393,52 @@ void print_usage()
 	fprintf(stderr, "-p num_para_bfs: the number of parallel bfs to estimate diameter\n");
 	fprintf(stderr, "-d: whether we respect the direction of edges\n");
 	fprintf(stderr, "-s num: the number of sweeps performed in diameter estimation\n");
+	fprintf(stderr, "-e: compute the exact diameter and radius\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "hyper_anf:\n");
+	fprintf(stderr, "-r num: the log2 of the number of registers per counter\n");
+	fprintf(stderr, "-l num: the maximum number of levels\n");
+	fprintf(stderr, "-o output: the file for the reachability counts\n");
+	fprintf(stderr, "-h output: the file for the harmonic centrality\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "bfs start_vertex\n");
+	fprintf(stderr, "-b: traverse with both in-edges and out-edges\n");
+	fprintf(stderr, "-o output: the output file\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "sssp start_vertex\n");
+	fprintf(stderr, "-b: traverse with both in-edges and out-edges\n");
+	fprintf(stderr, "-d delta: the width of a bucket in delta-stepping\n");
+	fprintf(stderr, "-o output: the output file\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "multi_bfs\n");
+	fprintf(stderr, "-b: traverse with both in-edges and out-edges\n");
+	fprintf(stderr, "-n num: the number of random sources (at most 512)\n");
+	fprintf(stderr, "-o output: the output file of the depths from each source\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "betweenness\n");
+	fprintf(stderr, "-s num: the number of sampled sources (exact if it's 0)\n");
+	fprintf(stderr, "-b size: the number of sources in a batch (at most 64)\n");
+	fprintf(stderr, "-o output: the output file\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "pagerank\n");
 	fprintf(stderr, "-i num: the maximum number of iterations\n");
 	fprintf(stderr, "-D v: damping factor\n");
+	fprintf(stderr, "-s sched: priority or async scheduling for pagerank2\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "ppr seed_file\n");
+	fprintf(stderr, "-d v: damping factor\n");
+	fprintf(stderr, "-e epsilon: the residual threshold per edge in forward push\n");
+	fprintf(stderr, "-k topK: the number of vertices kept for each seed set\n");
+	fprintf(stderr, "-b size: the number of seed sets computed together\n");
+	fprintf(stderr, "-w num: use the number of random walks per seed set instead of forward push\n");
+	fprintf(stderr, "-o output: the output file\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "random_walk output_file\n");
+	fprintf(stderr, "-n num: the number of walks from each vertex\n");
+	fprintf(stderr, "-l length: the maximal length of a walk\n");
+	fprintf(stderr, "-p p: the return parameter of node2vec\n");
+	fprintf(stderr, "-q q: the in-out parameter of node2vec\n");
+	fprintf(stderr, "-b size: the maximal number of walks in memory\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "sstsg\n");
 	fprintf(stderr, "-n num: the number of time intervals\n");
@@ -538,6 +1446,7 @@ void print_usage()
 	fprintf(stderr, "-o output: the output file\n");
 	fprintf(stderr, "-t time: the start time\n");
 	fprintf(stderr, "-l time: the length of time interval\n");
+	fprintf(stderr, "-w num: slide the window forward by an interval for the number of times\n");
 	fprintf(stderr, "\n");
 	fprintf(stderr, "ts_wcc\n");
 	fprintf(stderr, "-u unit: time unit (hour, day, month, etc)\n");
@@ -549,13 +1458,50 @@ void print_usage()
 	fprintf(stderr, "-m kmax: the maximum k value to compute\n");
 	fprintf(stderr, "-w output: the file name for a vector written to filen");
 	fprintf(stderr, "\n");
+	fprintf(stderr, "ktruss:\n");
+	fprintf(stderr, "-o output: the output file\n");
+	fprintf(stderr, "-e output: the file for the truss number of each edge\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "label_prop:\n");
+	fprintf(stderr, "-i num: the maximum number of iterations\n");
+	fprintf(stderr, "-o output: the output file\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "louvain:\n");
+	fprintf(stderr, "-i num: the maximum number of iterations in a level\n");
+	fprintf(stderr, "-l num: the maximum number of levels\n");
+	fprintf(stderr, "-o output: the output file\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "msf:\n");
+	fprintf(stderr, "-o output: the output file for the edges in the forest\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "mis:\n");
+	fprintf(stderr, "-o output: the output file\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "coloring:\n");
+	fprintf(stderr, "-o output: the output file\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "triangle\n");
+	fprintf(stderr, "-p prob: estimate with DOULION that keeps edges with the probability\n");
+	fprintf(stderr, "-c confidence: the confidence level of the interval\n");
+	fprintf(stderr, "transitivity\n");
+	fprintf(stderr, "-s num: the number of sampled wedges\n");
+	fprintf(stderr, "-e error: the error of the estimate if -s isn't given\n");
+	fprintf(stderr, "-c confidence: the confidence level of the interval\n");
+	fprintf(stderr, "-l: estimate the local transitivity of each vertex\n");
+	fprintf(stderr, "-o output: the output file of the local transitivity\n");
 	fprintf(stderr, "cycle_triangle\n");
 	fprintf(stderr, "-f: run the fast implementation\n");
 	fprintf(stderr, "wcc\n");
 	fprintf(stderr, "-s: run wcc synchronously\n");
+	fprintf(stderr, "-a degree: run sampling-based wcc that links vertices with at most degree edges first\n");
 	fprintf(stderr, "overlap vertex_file\n");
 	fprintf(stderr, "-o output: the output file\n");
 	fprintf(stderr, "-t threshold: the threshold for printing the overlaps\n");
+	fprintf(stderr, "similar output_file\n");
+	fprintf(stderr, "-k k: the number of similar vertices of each vertex\n");
+	fprintf(stderr, "-b num: the number of bands in a MinHash signature\n");
+	fprintf(stderr, "-r num: the number of rows in a band\n");
+	fprintf(stderr, "-t threshold: the minimal similarity\n");
 
 	fprintf(stderr, "supported graph algorithms:\n");
 	for (int i = 0; i < num_supported; i++)
@@ -594,6 +1540,9 @@ int main(int argc, char *argv[])
 	else if (alg == "triangle") {
 		run_triangle(graph, argc, argv);
 	}
+	else if (alg == "transitivity") {
+		run_transitivity(graph, argc, argv);
+	}
 	else if (alg == "local_scan") {
 		run_local_scan(graph, argc, argv);
 	}
@@ -603,6 +1552,21 @@ int main(int argc, char *argv[])
 	else if (alg == "diameter") {
 		run_diameter(graph, argc, argv);
 	}
+	else if (alg == "hyper_anf") {
+		run_hyper_anf(graph, argc, argv);
+	}
+	else if (alg == "bfs") {
+		run_bfs(graph, argc, argv);
+	}
+	else if (alg == "sssp") {
+		run_sssp(graph, argc, argv);
+	}
+	else if (alg == "multi_bfs") {
+		run_multi_bfs(graph, argc, argv);
+	}
+	else if (alg == "betweenness") {
+		run_betweenness(graph, argc, argv);
+	}
 	else if (alg == "pagerank") {
 		run_pagerank(graph, argc, argv, 1);
 	}
@@ -615,6 +1579,12 @@ int main(int argc, char *argv[])
 	else if (alg == "scc") {
 		run_scc(graph, argc, argv);
 	}
+	else if (alg == "ppr") {
+		run_ppr(graph, argc, argv);
+	}
+	else if (alg == "random_walk") {
+		run_random_walk(graph, argc, argv);
+	}
 	else if (alg == "sstsg") {
 		run_sstsg(graph, argc, argv);
 	}
@@ -624,7 +1594,28 @@ int main(int argc, char *argv[])
 	else if (alg == "kcore") {
 		run_kcore(graph, argc, argv);
 	}
+	else if (alg == "ktruss") {
+		run_ktruss(graph, argc, argv);
+	}
+	else if (alg == "label_prop") {
+		run_label_prop(graph, argc, argv);
+	}
+	else if (alg == "louvain") {
+		run_louvain(graph, argc, argv);
+	}
+	else if (alg == "msf") {
+		run_msf(graph, argc, argv);
+	}
+	else if (alg == "mis") {
+		run_mis(graph, argc, argv);
+	}
+	else if (alg == "coloring") {
+		run_coloring(graph, argc, argv);
+	}
 	else if (alg == "overlap") {
 		run_overlap(graph, argc, argv);
 	}
+	else if (alg == "similar") {
+		run_similar(graph, argc, argv);
+	}
 }
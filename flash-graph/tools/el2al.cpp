@@ -46,6 +46,28 @@ static inline int conv_edge_type_str2int(const std::string &type_str)
 
 static bool check_graph = false;
 
+/*
+ * Binary edge lists are converted to edges directly and text edge lists
+ * are parsed.
+ */
+static edge_graph::ptr load_edge_lists(const std::vector<std::string> &files,
+		const bin_edge_schema *schema, int edge_attr_type, bool directed,
+		int num_threads, bool in_mem)
+{
+	edge_graph::ptr edge_g;
+	if (schema)
+		edge_g = parse_bin_edge_lists(files, *schema, directed, num_threads,
+				in_mem);
+	else
+		edge_g = parse_edge_lists(files, edge_attr_type, directed, num_threads,
+				in_mem);
+	if (edge_g == NULL) {
+		fprintf(stderr, "can't load the edge lists\n");
+		exit(-1);
+	}
+	return edge_g;
+}
+
 void print_usage()
 {
 	fprintf(stderr, "convert an edge list to adjacency lists\n");
@@ -62,6 +84,9 @@ void print_usage()
 	fprintf(stderr, "-w: write the graph to a file\n");
 	fprintf(stderr, "-T: the number of threads to process in parallel\n");
 	fprintf(stderr, "-d: store intermediate data on disks\n");
+	fprintf(stderr, "-c: store edge data in a column behind the adjacency lists\n");
+	fprintf(stderr, "-b schema: binary edge lists whose records are \"ids[,data]\".\n");
+	fprintf(stderr, "\tids: u32 or u64; data: u32 (count) or i64 (timestamp)\n");
 }
 
 int main(int argc, char *argv[])
@@ -74,7 +99,9 @@ int main(int argc, char *argv[])
 	bool merge_graph = false;
 	bool write_graph = false;
 	bool on_disk = false;
-	while ((opt = getopt(argc, argv, "uvt:mwT:d")) != -1) {
+	bool edge_data_column = false;
+	char *schema_str = NULL;
+	while ((opt = getopt(argc, argv, "uvt:mwT:dcb:")) != -1) {
 		num_opts++;
 		switch (opt) {
 			case 'u':
@@ -100,6 +127,13 @@ int main(int argc, char *argv[])
 			case 'd':
 				on_disk = true;
 				break;
+			case 'c':
+				edge_data_column = true;
+				break;
+			case 'b':
+				schema_str = optarg;
+				num_opts++;
+				break;
 			default:
 				print_usage();
 		}
@@ -115,6 +149,21 @@ int main(int argc, char *argv[])
 	if (type_str) {
 		edge_attr_type = conv_edge_type_str2int(type_str);
 	}
+	bin_edge_schema schema;
+	if (schema_str) {
+		if (!schema.parse(schema_str)) {
+			fprintf(stderr, "invalid binary edge list schema: %s\n", schema_str);
+			print_usage();
+			exit(-1);
+		}
+		// The type of edge data is determined by the schema.
+		if (type_str && edge_attr_type != schema.get_edge_attr_type()) {
+			fprintf(stderr, "edge data type %s doesn't match schema %s\n",
+					type_str, schema_str);
+			exit(-1);
+		}
+		edge_attr_type = schema.get_edge_attr_type();
+	}
 
 	std::string adjacency_list_file = argv[0];
 	adjacency_list_file += std::string("-v") + itoa(CURR_VERSION);
@@ -141,8 +190,9 @@ int main(int argc, char *argv[])
 		printf("edge list file: %s\n", edge_list_files[i].c_str());
 
 	if (merge_graph) {
-		edge_graph::ptr edge_g = parse_edge_lists(edge_list_files, edge_attr_type,
-				directed, num_threads, !on_disk);
+		edge_graph::ptr edge_g = load_edge_lists(edge_list_files,
+				schema_str ? &schema : NULL, edge_attr_type, directed,
+				num_threads, !on_disk);
 		disk_serial_graph::ptr g
 			= std::static_pointer_cast<disk_serial_graph, serial_graph>(
 					construct_graph(edge_g, work_dir, num_threads));
@@ -163,6 +213,13 @@ int main(int argc, char *argv[])
 			printf("verifying a graph takes %.2f seconds\n",
 					time_diff(start, end));
 		}
+		// The graph is verified before its edge data is moved to a column.
+		if (write_graph && edge_data_column
+				&& !store_edge_data_column(adjacency_list_file, index_file)) {
+			fprintf(stderr, "can't store edge data in a column of %s\n",
+					adjacency_list_file.c_str());
+			exit(-1);
+		}
 	}
 	else {
 		std::vector<std::string> graph_files;
@@ -183,8 +240,9 @@ int main(int argc, char *argv[])
 			std::vector<std::string> files(1);
 			files[0] = edge_list_files[i];
 
-			edge_graph::ptr edge_g = parse_edge_lists(files, edge_attr_type,
-					directed, num_threads, !on_disk);
+			edge_graph::ptr edge_g = load_edge_lists(files,
+					schema_str ? &schema : NULL, edge_attr_type, directed,
+					num_threads, !on_disk);
 			disk_serial_graph::ptr g
 				= std::static_pointer_cast<disk_serial_graph, serial_graph>(
 						construct_graph(edge_g, work_dir, num_threads));
@@ -205,6 +263,12 @@ int main(int argc, char *argv[])
 				printf("verifying a graph takes %.2f seconds\n",
 						time_diff(start, end));
 			}
+			if (write_graph && edge_data_column
+					&& !store_edge_data_column(graph_files[i], index_files[i])) {
+				fprintf(stderr, "can't store edge data in a column of %s\n",
+						graph_files[i].c_str());
+				exit(-1);
+			}
 		}
 	}
 }
@@ -0,0 +1,45 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "FG_vector.h"
+
+const size_t num_eles = 100000;
+
+template<class T>
+void test_binary_file(const std::string &file)
+{
+	typename FG_vector<T>::ptr vec = FG_vector<T>::create(num_eles);
+	for (size_t i = 0; i < num_eles; i++)
+		vec->set(i, (T) random());
+	vec->to_file(file, true);
+
+	typename FG_vector<T>::ptr vec1 = FG_vector<T>::from_file(file);
+	assert(vec1);
+	assert(vec1->get_size() == vec->get_size());
+	for (size_t i = 0; i < num_eles; i++)
+		assert(vec1->get(i) == vec->get(i));
+	unlink(file.c_str());
+}
+
+void test_bad_file(const std::string &file)
+{
+	FG_vector<uint32_t>::ptr vec = FG_vector<uint32_t>::create(3);
+	vec->to_file(file, true);
+	// 12 bytes aren't a multiple of 8-byte elements.
+	assert(FG_vector<double>::from_file(file) == NULL);
+	unlink(file.c_str());
+	assert(FG_vector<double>::from_file(file) == NULL);
+}
+
+int main()
+{
+	std::string file = "test-FG_vector.bin";
+	printf("test a binary vector of uint32_t\n");
+	test_binary_file<uint32_t>(file);
+	printf("test a binary vector of float\n");
+	test_binary_file<float>(file);
+	printf("test a binary vector of double\n");
+	test_binary_file<double>(file);
+	printf("test a file that isn't a binary vector\n");
+	test_bad_file(file);
+}
@@ -57,4 +57,21 @@ BOOST_AUTO_TEST_CASE (test1)
 	}
 }
 
+BOOST_AUTO_TEST_CASE (test_and_set)
+{
+	int num = 100000;
+	thread_safe_bitmap map1(max_bits, 0);
+	std::set<size_t> elements;
+
+	for (int i = 0; i < num; i++) {
+		int v = random() % max_bits;
+		bool inserted = elements.insert(v).second;
+		BOOST_CHECK(map1.test_and_set(v) != inserted);
+		BOOST_CHECK(map1.get(v));
+	}
+	for (std::set<size_t>::const_iterator it = elements.begin();
+			it != elements.end(); it++)
+		BOOST_CHECK(map1.test_and_set(*it));
+}
+
 BOOST_AUTO_TEST_SUITE_END( )
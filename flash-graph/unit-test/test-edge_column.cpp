@@ -0,0 +1,241 @@
+#include "io_interface.h"
+#include "safs_file.h"
+
+#include "test_env.h"
+
+const size_t num_vertices = 1000;
+const size_t num_edges = 20000;
+
+/*
+ * What a vertex gets for the edges in one direction.
+ */
+struct edge_stat
+{
+	bool read;
+	bool has_topology;
+	size_t num;
+	size_t neigh_sum;
+	size_t data_sum;
+
+	edge_stat() {
+		read = false;
+		has_topology = false;
+		num = 0;
+		neigh_sum = 0;
+		data_sum = 0;
+	}
+};
+
+edge_type req_type;
+request_part req_part;
+
+class column_vertex: public compute_directed_vertex
+{
+public:
+	// The in-edges and the out-edges.
+	edge_stat stats[2];
+
+	column_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		stats[0] = edge_stat();
+		stats[1] = edge_stat();
+		directed_vertex_request req(prog.get_vertex_id(*this), req_type,
+				req_part);
+		request_partial_vertices(&req, 1);
+	}
+
+	void run(vertex_program &, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &, const vertex_message &) {
+	}
+};
+
+void column_vertex::run(vertex_program &, const page_vertex &vertex)
+{
+	const page_directed_vertex &dvertex = (const page_directed_vertex &) vertex;
+	for (int i = 0; i < 2; i++) {
+		edge_type type = i == 0 ? edge_type::IN_EDGE : edge_type::OUT_EDGE;
+		if (req_type != edge_type::BOTH_EDGES && req_type != type)
+			continue;
+		edge_stat &stat = stats[i];
+		assert(!stat.read);
+		stat.read = true;
+		stat.num = dvertex.get_num_edges(type);
+		page_byte_array::seq_const_iterator<edge_count> data_it
+			= dvertex.get_data_seq_it<edge_count>(type);
+		while (data_it.has_next())
+			stat.data_sum += data_it.next().get_count();
+		// Only the edge data is read if the adjacency list isn't requested.
+		size_t size = i == 0 ? dvertex.get_in_size() : dvertex.get_out_size();
+		stat.has_topology = size > 0;
+		if (stat.has_topology) {
+			edge_seq_iterator it = dvertex.get_neigh_seq_it(type);
+			while (it.has_next())
+				stat.neigh_sum += it.next();
+		}
+	}
+}
+
+/*
+ * Each vertex requests its own edges, and the edges of vertex `id' are
+ * at `2 * id' (in-edges) and `2 * id + 1' (out-edges).
+ */
+std::vector<edge_stat> read_edges(graph_engine &graph, edge_type type,
+		request_part part)
+{
+	req_type = type;
+	req_part = part;
+	graph.start_all();
+	graph.wait4complete();
+	std::vector<edge_stat> stats(graph.get_num_vertices() * 2);
+	for (vertex_id_t id = 0; id < graph.get_num_vertices(); id++) {
+		column_vertex &v = (column_vertex &) graph.get_vertex(id);
+		stats[id * 2] = v.stats[0];
+		stats[id * 2 + 1] = v.stats[1];
+	}
+	return stats;
+}
+
+/*
+ * The edges read in each part are the same as the edges read from
+ * the graph that stores edge data in the adjacency lists.
+ */
+void test_parts(graph_engine &graph, const std::vector<edge_stat> &expected)
+{
+	edge_type types[] = {edge_type::IN_EDGE, edge_type::OUT_EDGE,
+		edge_type::BOTH_EDGES};
+	request_part parts[] = {request_part::EDGE_DATA,
+		request_part::TOPOLOGY_AND_DATA};
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 2; j++) {
+			std::vector<edge_stat> stats = read_edges(graph, types[i],
+					parts[j]);
+			// Without an edge data column, the edge data is always read
+			// with the adjacency lists.
+			bool has_topology = parts[j] == request_part::TOPOLOGY_AND_DATA
+				|| !graph.has_edge_data_column();
+			for (size_t k = 0; k < stats.size(); k++) {
+				edge_type type = k % 2 == 0
+					? edge_type::IN_EDGE : edge_type::OUT_EDGE;
+				if (types[i] != edge_type::BOTH_EDGES && types[i] != type) {
+					assert(!stats[k].read);
+					continue;
+				}
+				assert(stats[k].read);
+				assert(stats[k].num == expected[k].num);
+				assert(stats[k].num == graph.get_num_edges(k / 2, type));
+				assert(stats[k].data_sum == expected[k].data_sum);
+				assert(stats[k].has_topology == has_topology);
+				if (has_topology)
+					assert(stats[k].neigh_sum == expected[k].neigh_sum);
+			}
+		}
+	}
+}
+
+/*
+ * Copy a file in the local filesystem to SAFS.
+ */
+void load2safs(const std::string &ext_file, const std::string &safs_name)
+{
+	FILE *f = fopen(ext_file.c_str(), "r");
+	assert(f);
+	BOOST_VERIFY(fseek(f, 0, SEEK_END) == 0);
+	size_t size = ftell(f);
+	BOOST_VERIFY(fseek(f, 0, SEEK_SET) == 0);
+	// Loading a vertex index from SAFS reads the first two pages.
+	size_t safs_size = std::max((size_t) ROUNDUP_PAGE(size),
+			(size_t) PAGE_SIZE * 2);
+	char *buf = (char *) valloc(safs_size);
+	assert(buf);
+	memset(buf, 0, safs_size);
+	BOOST_VERIFY(fread(buf, size, 1, f) == 1);
+	fclose(f);
+
+	safs_file file(get_sys_RAID_conf(), safs_name);
+	assert(!file.exist());
+	BOOST_VERIFY(file.create_file(safs_size));
+	file_io_factory::shared_ptr factory = create_io_factory(safs_name,
+			REMOTE_ACCESS);
+	assert(factory);
+	io_interface::ptr io = factory->create_io(thread::get_curr_thread());
+	data_loc_t loc(io->get_file_id(), 0);
+	io_request req(buf, loc, safs_size, WRITE);
+	io->access(&req, 1);
+	io->wait4complete(1);
+	io->cleanup();
+	free(buf);
+}
+
+graph_engine::ptr create_engine(FG_graph::ptr fg)
+{
+	graph_index::ptr index = NUMA_graph_index<column_vertex>::create(
+			fg->get_graph_header());
+	return fg->create_engine(index);
+}
+
+int main()
+{
+	test_env env = create_test_env("test-edge_column", "threads=2 writable=1");
+	config_map::ptr configs = env.configs;
+
+	std::vector<vertex_id_t> from;
+	std::vector<vertex_id_t> to;
+	std::vector<edge_count> counts;
+	random_edges(num_vertices, num_edges, test_seed, from, to, counts);
+	size_t tot_count = 0;
+	for (size_t i = 0; i < num_edges; i++)
+		tot_count += counts[i].get_count();
+	std::pair<in_mem_graph::ptr, vertex_index::ptr> g = construct_mem_graph(
+			from, to, counts, "test", true, 1);
+
+	printf("test the edge data in the adjacency lists\n");
+	graph_engine::ptr graph = create_engine(FG_graph::create(g.first,
+				g.second, "test", configs));
+	assert(!graph->has_edge_data_column());
+	std::vector<edge_stat> expected = read_edges(*graph,
+			edge_type::BOTH_EDGES, request_part::TOPOLOGY_AND_DATA);
+	size_t in_count = 0;
+	size_t out_count = 0;
+	for (size_t i = 0; i < expected.size(); i += 2) {
+		in_count += expected[i].data_sum;
+		out_count += expected[i + 1].data_sum;
+	}
+	assert(in_count == tot_count);
+	assert(out_count == tot_count);
+	test_parts(*graph, expected);
+	graph.reset();
+
+	std::string adj_file = env.dir_name + "/test.adj";
+	std::string index_file = env.dir_name + "/test.index";
+	g.first->dump(adj_file);
+	g.second->dump(index_file);
+	g = std::pair<in_mem_graph::ptr, vertex_index::ptr>();
+	BOOST_VERIFY(store_edge_data_column(adj_file, index_file));
+
+	printf("test an edge data column in memory\n");
+	graph = create_engine(FG_graph::create(in_mem_graph::load_graph(adj_file),
+				vertex_index::load(index_file), "test-column", configs));
+	assert(graph->has_edge_data_column());
+	assert(graph->get_graph_data());
+	test_parts(*graph, expected);
+	graph.reset();
+
+	printf("test an edge data column in SAFS\n");
+	load2safs(adj_file, "test-column.adj");
+	load2safs(index_file, "test-column.index");
+	graph = create_engine(FG_graph::create("test-column.adj",
+				"test-column.index", configs));
+	assert(graph->has_edge_data_column());
+	assert(graph->get_graph_data() == NULL);
+	test_parts(*graph, expected);
+	graph.reset();
+
+	safs_file(get_sys_RAID_conf(), "test-column.adj").delete_file();
+	safs_file(get_sys_RAID_conf(), "test-column.index").delete_file();
+	unlink(adj_file.c_str());
+	unlink(index_file.c_str());
+	destroy_test_env(env);
+}
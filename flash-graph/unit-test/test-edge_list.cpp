@@ -0,0 +1,311 @@
+#include <zlib.h>
+
+#include <set>
+
+#include "test_env.h"
+
+const size_t num_vertices = 100000;
+// The size of a block of text parsed by a task.
+const size_t block_size = 16 * 1024 * 1024;
+
+/*
+ * The edges of a vertex in one direction. The edge data is stored as
+ * integers.
+ */
+struct edge_list
+{
+	std::vector<vertex_id_t> neighs;
+	std::vector<int64_t> data;
+
+	bool operator==(const edge_list &list) const {
+		return neighs == list.neighs && data == list.data;
+	}
+};
+
+int edge_attr_type;
+
+class list_vertex: public compute_directed_vertex
+{
+public:
+	// The in-edges and the out-edges.
+	edge_list lists[2];
+
+	list_vertex(vertex_id_t id): compute_directed_vertex(id) {
+	}
+
+	void run(vertex_program &prog) {
+		vertex_id_t id = prog.get_vertex_id(*this);
+		request_vertices(&id, 1);
+	}
+
+	void run(vertex_program &, const page_vertex &vertex);
+
+	void run_on_message(vertex_program &, const vertex_message &) {
+	}
+};
+
+void list_vertex::run(vertex_program &, const page_vertex &vertex)
+{
+	const page_directed_vertex &dvertex = (const page_directed_vertex &) vertex;
+	for (int i = 0; i < 2; i++) {
+		edge_type type = i == 0 ? edge_type::IN_EDGE : edge_type::OUT_EDGE;
+		edge_list &list = lists[i];
+		edge_seq_iterator it = dvertex.get_neigh_seq_it(type);
+		while (it.has_next())
+			list.neighs.push_back(it.next());
+		if (edge_attr_type == EDGE_COUNT) {
+			page_byte_array::seq_const_iterator<edge_count> data_it
+				= dvertex.get_data_seq_it<edge_count>(type);
+			while (data_it.has_next())
+				list.data.push_back(data_it.next().get_count());
+		}
+		else if (edge_attr_type == EDGE_TIMESTAMP) {
+			page_byte_array::seq_const_iterator<ts_edge_data> data_it
+				= dvertex.get_data_seq_it<ts_edge_data>(type);
+			while (data_it.has_next())
+				list.data.push_back(data_it.next().get_timestamp());
+		}
+	}
+}
+
+/*
+ * Construct a graph from the edges and get the edge lists of all vertices.
+ * The in-edges of vertex `id' are at `2 * id' and the out-edges are at
+ * `2 * id + 1'.
+ */
+std::vector<edge_list> get_edge_lists(edge_graph::ptr edge_g,
+		config_map::ptr configs)
+{
+	assert(edge_g);
+	std::pair<in_mem_graph::ptr, vertex_index::ptr> g = construct_mem_graph(
+			edge_g, "test", 2);
+	FG_graph::ptr fg = FG_graph::create(g.first, g.second, "test", configs);
+	graph_index::ptr index = NUMA_graph_index<list_vertex>::create(
+			fg->get_graph_header());
+	graph_engine::ptr graph = fg->create_engine(index);
+	graph->start_all();
+	graph->wait4complete();
+	std::vector<edge_list> lists(graph->get_num_vertices() * 2);
+	for (vertex_id_t id = 0; id < graph->get_num_vertices(); id++) {
+		list_vertex &v = (list_vertex &) graph->get_vertex(id);
+		lists[id * 2] = v.lists[0];
+		lists[id * 2 + 1] = v.lists[1];
+	}
+	return lists;
+}
+
+static void write_file(const std::string &file, const std::string &text)
+{
+	FILE *f = fopen(file.c_str(), "w");
+	assert(f);
+	BOOST_VERIFY(text.empty() || fwrite(text.data(), text.size(), 1, f) == 1);
+	fclose(f);
+}
+
+static void write_gz_file(const std::string &file, const std::string &text)
+{
+	gzFile f = gzopen(file.c_str(), "wb");
+	assert(f);
+	BOOST_VERIFY(gzwrite(f, text.data(), text.size()) == (int) text.size());
+	gzclose(f);
+}
+
+/*
+ * Generate the text of random edges without duplicates. The lines use
+ * all the variations the parsers accept: '\n' and "\r\n", ' ', ',' and
+ * '\t' separators, comments, blank lines and a last line without '\n'.
+ */
+std::string gen_edge_text(size_t num_edges, size_t &num_lines)
+{
+	std::set<std::pair<vertex_id_t, vertex_id_t> > edges;
+	std::string text;
+	const char seps[] = {' ', ',', '\t'};
+	char line[128];
+	num_lines = 0;
+	while (edges.size() < num_edges) {
+		vertex_id_t from = random() % num_vertices;
+		vertex_id_t to = random() % num_vertices;
+		if (!edges.insert(std::pair<vertex_id_t, vertex_id_t>(from,
+						to)).second)
+			continue;
+		size_t i = edges.size();
+		const char *eol = i % 2 == 0 ? "\n" : "\r\n";
+		if (i % 1000 == 0)
+			text += std::string("# a comment line ") + eol;
+		else if (i % 1000 == 500)
+			text += std::string(i % 3 == 0 ? " \t" : "") + eol;
+		char sep = seps[i % 3];
+		if (edge_attr_type == EDGE_COUNT)
+			snprintf(line, sizeof(line), "%u%c%u%c%ld", from, sep, to, sep,
+					random() % 1000);
+		else if (edge_attr_type == EDGE_TIMESTAMP)
+			snprintf(line, sizeof(line), "%u%c%u%c%ld", from, sep, to, sep,
+					1300000000 + random() % 100000000);
+		else
+			snprintf(line, sizeof(line), "%u%c%u", from, sep, to);
+		text += line;
+		if (edges.size() < num_edges)
+			text += eol;
+		num_lines++;
+	}
+	return text;
+}
+
+/*
+ * An uncompressed edge list is parsed in place in memory-mapped blocks.
+ * The same text split into two compressed files is parsed by the old
+ * parser, one file per task.
+ */
+void test_text(const test_env &env, int type, size_t num_edges,
+		bool multi_block)
+{
+	edge_attr_type = type;
+	size_t num_lines = 0;
+	std::string text = gen_edge_text(num_edges, num_lines);
+	printf("test %ld edges of type %d in %ld bytes\n", num_edges, type,
+			text.size());
+	assert(multi_block == (text.size() > block_size));
+
+	std::string file = env.dir_name + "/edges.txt";
+	write_file(file, text);
+	std::vector<std::string> files(1, file);
+	std::vector<edge_list> lists = get_edge_lists(parse_edge_lists(files,
+				type, true, 2, true), env.configs);
+
+	size_t split = text.find('\n', text.size() / 2) + 1;
+	std::vector<std::string> gz_files;
+	gz_files.push_back(env.dir_name + "/edges1.txt.gz");
+	gz_files.push_back(env.dir_name + "/edges2.txt.gz");
+	write_gz_file(gz_files[0], text.substr(0, split));
+	write_gz_file(gz_files[1], text.substr(split));
+	std::vector<edge_list> expected = get_edge_lists(parse_edge_lists(gz_files,
+				type, true, 2, true), env.configs);
+
+	assert(lists.size() == expected.size());
+	size_t tot_edges = 0;
+	for (size_t i = 0; i < lists.size(); i++) {
+		assert(lists[i] == expected[i]);
+		if (i % 2 == 1)
+			tot_edges += lists[i].neighs.size();
+	}
+	assert(tot_edges == num_lines);
+
+	unlink(file.c_str());
+	unlink(gz_files[0].c_str());
+	unlink(gz_files[1].c_str());
+}
+
+/*
+ * Append an integer to a binary record in the native byte order.
+ */
+template<class T>
+static void append_bin(std::string &buf, T v)
+{
+	buf.append((const char *) &v, sizeof(v));
+}
+
+static void append_bin_field(std::string &buf,
+		bin_edge_schema::field_type type, int64_t v)
+{
+	switch (type) {
+		case bin_edge_schema::U32:
+			append_bin<uint32_t>(buf, v);
+			break;
+		case bin_edge_schema::U64:
+			append_bin<uint64_t>(buf, v);
+			break;
+		case bin_edge_schema::I64:
+			append_bin<int64_t>(buf, v);
+			break;
+		default:
+			assert(0);
+	}
+}
+
+/*
+ * A binary edge list is parsed to the same graph as the text edge list
+ * with the same edges.
+ */
+void test_bin(const test_env &env, const std::string &schema_str,
+		size_t num_edges)
+{
+	bin_edge_schema schema;
+	BOOST_VERIFY(schema.parse(schema_str));
+	edge_attr_type = schema.get_edge_attr_type();
+	printf("test %ld binary edges with schema %s\n", num_edges,
+			schema_str.c_str());
+
+	std::set<std::pair<vertex_id_t, vertex_id_t> > edges;
+	std::string text;
+	std::string bin;
+	char line[128];
+	while (edges.size() < num_edges) {
+		vertex_id_t from = random() % num_vertices;
+		vertex_id_t to = random() % num_vertices;
+		if (!edges.insert(std::pair<vertex_id_t, vertex_id_t>(from,
+						to)).second)
+			continue;
+		append_bin_field(bin, schema.id_type, from);
+		append_bin_field(bin, schema.id_type, to);
+		if (edge_attr_type == DEFAULT_TYPE) {
+			snprintf(line, sizeof(line), "%u\t%u\n", from, to);
+		}
+		else {
+			int64_t data = edge_attr_type == EDGE_COUNT ? random() % 1000
+				: 1300000000 + random() % 100000000;
+			append_bin_field(bin, schema.data_type, data);
+			snprintf(line, sizeof(line), "%u\t%u\t%ld\n", from, to, data);
+		}
+		text += line;
+	}
+	assert(bin.size() == num_edges * schema.get_record_size());
+
+	std::string bin_file = env.dir_name + "/edges.bin";
+	write_file(bin_file, bin);
+	std::vector<std::string> files(1, bin_file);
+	std::vector<edge_list> lists = get_edge_lists(parse_bin_edge_lists(files,
+				schema, true, 2, true), env.configs);
+
+	std::string text_file = env.dir_name + "/edges.txt";
+	write_file(text_file, text);
+	files[0] = text_file;
+	std::vector<edge_list> expected = get_edge_lists(parse_edge_lists(files,
+				edge_attr_type, true, 2, true), env.configs);
+
+	assert(lists.size() == expected.size());
+	size_t tot_edges = 0;
+	for (size_t i = 0; i < lists.size(); i++) {
+		assert(lists[i] == expected[i]);
+		if (i % 2 == 1)
+			tot_edges += lists[i].neighs.size();
+	}
+	assert(tot_edges == num_edges);
+
+	unlink(bin_file.c_str());
+	unlink(text_file.c_str());
+}
+
+int main()
+{
+	test_env env = create_test_env("test-edge_list", "threads=2");
+	srandom(test_seed);
+	printf("random seed: %u\n", test_seed);
+
+	test_text(env, DEFAULT_TYPE, 10000, false);
+	test_text(env, EDGE_COUNT, 10000, false);
+	test_text(env, EDGE_TIMESTAMP, 10000, false);
+	// The text is split into blocks at line boundaries.
+	test_text(env, EDGE_COUNT, 1200000, true);
+	test_text(env, DEFAULT_TYPE, 1500000, true);
+
+	const char *schemas[] = {"u32", "u64", "u32,u32", "u64,u32", "u32,i64",
+		"u64,i64"};
+	for (size_t i = 0; i < sizeof(schemas) / sizeof(schemas[0]); i++)
+		test_bin(env, schemas[i], 10000);
+	// Float weights can't be stored in edge counts without rounding.
+	bin_edge_schema schema;
+	assert(!schema.parse("u32,f32"));
+	assert(!schema.parse("u64,u64"));
+
+	destroy_test_env(env);
+}
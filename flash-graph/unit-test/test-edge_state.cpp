@@ -0,0 +1,175 @@
+#include <algorithm>
+
+#include "edge_state.h"
+#include "test_env.h"
+
+const size_t num_vertices = 1000;
+const size_t num_edges = 20000;
+
+class test_vertex: public compute_vertex
+{
+public:
+	test_vertex(vertex_id_t id): compute_vertex(id) {
+	}
+
+	void run(vertex_program &) {
+	}
+
+	void run(vertex_program &, const page_vertex &) {
+	}
+
+	void run_on_message(vertex_program &, const vertex_message &) {
+	}
+};
+
+/*
+ * A value type that isn't trivially constructible.
+ */
+struct init_val
+{
+	int val;
+
+	init_val() {
+		val = 7;
+	}
+};
+
+graph_engine::ptr create_graph(config_map::ptr configs, bool directed,
+		bool has_data)
+{
+	std::pair<in_mem_graph::ptr, vertex_index::ptr> g = random_mem_graph(
+			num_vertices, num_edges, test_seed, directed, has_data);
+	FG_graph::ptr fg = FG_graph::create(g.first, g.second, "test", configs);
+	graph_index::ptr index = NUMA_graph_index<test_vertex>::create(
+			fg->get_graph_header());
+	return fg->create_engine(index);
+}
+
+/*
+ * The locations of the edges of all vertices are in the array and
+ * don't overlap, and each edge has its own value.
+ */
+void test_offsets(const graph_engine &graph, edge_type type)
+{
+	edge_state_array<size_t>::ptr arr = edge_state_array<size_t>::create(
+			graph, type);
+	std::vector<edge_type> types;
+	if (!graph.is_directed() || type != edge_type::IN_EDGE)
+		types.push_back(edge_type::OUT_EDGE);
+	if (graph.is_directed() && type != edge_type::OUT_EDGE)
+		types.push_back(edge_type::IN_EDGE);
+
+	std::vector<std::pair<size_t, size_t> > ranges;
+	size_t tot_edges = 0;
+	for (size_t i = 0; i < types.size(); i++) {
+		for (vertex_id_t id = 0; id < graph.get_num_vertices(); id++) {
+			size_t begin = arr->get_begin(id, types[i]);
+			size_t end = arr->get_end(id, types[i]);
+			assert(end - begin == graph.get_num_edges(id, types[i]));
+			assert(end <= arr->get_size());
+			ranges.push_back(std::pair<size_t, size_t>(begin, end));
+			tot_edges += end - begin;
+			for (size_t j = 0; j < end - begin; j++) {
+				assert(arr->get_loc(id, types[i], j) == begin + j);
+				assert(arr->get(begin + j) == 0);
+				arr->get(id, types[i], j) = begin + j + 1;
+			}
+		}
+	}
+	std::sort(ranges.begin(), ranges.end());
+	for (size_t i = 1; i < ranges.size(); i++)
+		assert(ranges[i - 1].second <= ranges[i].first);
+	// Padding in the adjacency lists leaves at most one unused location
+	// per adjacency list.
+	assert(arr->get_size() >= tot_edges);
+	assert(arr->get_size() <= tot_edges + ranges.size());
+	for (size_t i = 0; i < ranges.size(); i++)
+		for (size_t loc = ranges[i].first; loc < ranges[i].second; loc++)
+			assert(arr->get(loc) == loc + 1);
+
+	size_t num_locs = 0;
+	for (int i = 0; i < arr->get_num_parts(); i++) {
+		assert(arr->get_part_begin(i) == num_locs);
+		num_locs = arr->get_part_end(i);
+	}
+	assert(num_locs == arr->get_size());
+
+	// A part holds the locations of a range of vertices in a direction,
+	// and the in-edges come before the out-edges.
+	size_t range_size = 1UL << graph_conf.get_part_range_size_log();
+	size_t num_ranges = (graph.get_num_vertices() + range_size - 1)
+		/ range_size;
+	assert((size_t) arr->get_num_parts() == num_ranges * types.size());
+	for (size_t i = 0; i < types.size(); i++) {
+		size_t dir_idx = types.size() == 1 || types[i] == edge_type::IN_EDGE
+			? 0 : 1;
+		for (vertex_id_t id = 0; id < graph.get_num_vertices(); id++) {
+			int part_id = dir_idx * num_ranges + id / range_size;
+			assert(arr->get_begin(id, types[i]) >= arr->get_part_begin(part_id));
+			assert(arr->get_end(id, types[i]) <= arr->get_part_end(part_id));
+			if (id % range_size == 0)
+				assert(arr->get_begin(id, types[i])
+						== arr->get_part_begin(part_id));
+			assert(arr->get_part_node(part_id) == graph.get_node_id(
+						graph.get_partitioner()->map(id)));
+		}
+	}
+	printf("%ld edges take %ld locations\n", tot_edges, arr->get_size());
+}
+
+/*
+ * The values are stored in SAFS if they don't fit in the memory budget.
+ */
+void test_spill(const graph_engine &graph)
+{
+	edge_state_array<uint32_t>::ptr arr = edge_state_array<uint32_t>::create(
+			graph, edge_type::BOTH_EDGES, 0);
+	assert(arr->is_spilled());
+	for (size_t loc = 0; loc < arr->get_size(); loc++)
+		assert(arr->get(loc) == 0);
+	for (size_t loc = 0; loc < arr->get_size(); loc++)
+		arr->get(loc) = loc * 3;
+	for (size_t loc = 0; loc < arr->get_size(); loc++)
+		assert(arr->get(loc) == loc * 3);
+
+	edge_state_array<init_val>::ptr arr1 = edge_state_array<init_val>::create(
+			graph, edge_type::BOTH_EDGES, 0);
+	assert(arr1->is_spilled());
+	for (size_t loc = 0; loc < arr1->get_size(); loc++)
+		assert(arr1->get(loc).val == 7);
+
+	edge_state_array<uint32_t>::ptr arr2 = edge_state_array<uint32_t>::create(
+			graph, edge_type::BOTH_EDGES);
+	assert(!arr2->is_spilled());
+	assert(arr2->get_size() == arr->get_size());
+}
+
+int main()
+{
+	test_env env = create_test_env("test-edge_state",
+			"threads=2 part_range_size_log=6");
+	config_map::ptr configs = env.configs;
+
+	printf("test a directed graph\n");
+	graph_engine::ptr graph = create_graph(configs, true, false);
+	test_offsets(*graph, edge_type::IN_EDGE);
+	test_offsets(*graph, edge_type::OUT_EDGE);
+	test_offsets(*graph, edge_type::BOTH_EDGES);
+	test_spill(*graph);
+	graph.reset();
+
+	printf("test a directed graph with edge data\n");
+	graph = create_graph(configs, true, true);
+	test_offsets(*graph, edge_type::BOTH_EDGES);
+	test_spill(*graph);
+	graph.reset();
+
+	printf("test an undirected graph\n");
+	graph = create_graph(configs, false, false);
+	test_offsets(*graph, edge_type::OUT_EDGE);
+	test_offsets(*graph, edge_type::BOTH_EDGES);
+	test_spill(*graph);
+	graph.reset();
+
+	destroy_test_env(env);
+}
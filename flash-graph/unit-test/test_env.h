@@ -0,0 +1,103 @@
+#ifndef __TEST_ENV_H__
+#define __TEST_ENV_H__
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "FGlib.h"
+#include "in_mem_storage.h"
+#include "utils.h"
+
+/*
+ * The seed of random() in the unit tests, so a failing run can be
+ * reproduced.
+ */
+const unsigned test_seed = 1;
+
+/*
+ * A temporary directory that SAFS uses as its only disk, and the configs
+ * that run the graph engine on it.
+ */
+struct test_env
+{
+	std::string dir_name;
+	std::string root_conf;
+	config_map::ptr configs;
+};
+
+/*
+ * Create the environment of a unit test. `options' are added to
+ * the configs besides `root_conf'.
+ */
+static inline test_env create_test_env(const std::string &test_name,
+		const std::string &options)
+{
+	std::string dir_tmpl = "/tmp/" + test_name + ".XXXXXX";
+	std::vector<char> dir_name(dir_tmpl.begin(), dir_tmpl.end());
+	dir_name.push_back(0);
+	BOOST_VERIFY(mkdtemp(dir_name.data()));
+
+	test_env env;
+	env.dir_name = dir_name.data();
+	env.root_conf = env.dir_name + "/root.conf";
+	FILE *f = fopen(env.root_conf.c_str(), "w");
+	assert(f);
+	fprintf(f, "0:%s\n", env.dir_name.c_str());
+	fclose(f);
+	env.configs = config_map::create();
+	env.configs->add_options(options + " root_conf=" + env.root_conf);
+	return env;
+}
+
+/*
+ * Destroy the graph engine and remove the directory of the environment.
+ * The test has to remove the files it created in the directory.
+ */
+static inline void destroy_test_env(const test_env &env)
+{
+	graph_engine::destroy_flash_graph();
+	unlink(env.root_conf.c_str());
+	rmdir(env.dir_name.c_str());
+}
+
+/*
+ * Generate random edges with edge counts in [0, 100). The same seed
+ * generates the same edges.
+ */
+static inline void random_edges(size_t num_vertices, size_t num_edges,
+		unsigned seed, std::vector<vertex_id_t> &from,
+		std::vector<vertex_id_t> &to, std::vector<edge_count> &counts)
+{
+	printf("generate %ld random edges with seed %u\n", num_edges, seed);
+	srandom(seed);
+	from.resize(num_edges);
+	to.resize(num_edges);
+	counts.resize(num_edges);
+	for (size_t i = 0; i < num_edges; i++) {
+		from[i] = random() % num_vertices;
+		to[i] = random() % num_vertices;
+		counts[i] = edge_count(random() % 100);
+	}
+}
+
+/*
+ * Construct an in-memory graph on random edges.
+ */
+static inline std::pair<in_mem_graph::ptr, vertex_index::ptr> random_mem_graph(
+		size_t num_vertices, size_t num_edges, unsigned seed, bool directed,
+		bool has_data)
+{
+	std::vector<vertex_id_t> from;
+	std::vector<vertex_id_t> to;
+	std::vector<edge_count> counts;
+	random_edges(num_vertices, num_edges, seed, from, to, counts);
+	if (has_data)
+		return construct_mem_graph(from, to, counts, "test", directed, 1);
+	else
+		return construct_mem_graph(from, to, "test", DEFAULT_TYPE, directed, 1);
+}
+
+#endif
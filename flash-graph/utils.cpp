@@ -18,6 +18,9 @@
  */
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #ifdef USE_GZIP
 #include <zlib.h>
 #endif
@@ -471,6 +474,20 @@ class directed_vertex_info: public in_mem_vertex
 	size_t num_in_edges;
 	size_t num_out_edges;
 public:
+	/*
+	 * This describes a directed vertex whose adjacency lists don't
+	 * contain edge data.
+	 */
+	directed_vertex_info(vertex_id_t id, size_t num_in_edges,
+			size_t num_out_edges) {
+		this->id = id;
+		this->edge_data_size = 0;
+		this->num_in_edges = num_in_edges;
+		this->num_out_edges = num_out_edges;
+		in_size = ext_mem_undirected_vertex::num_edges2vsize(num_in_edges, 0);
+		out_size = ext_mem_undirected_vertex::num_edges2vsize(num_out_edges, 0);
+	}
+
 	directed_vertex_info(const in_mem_vertex &v) {
 		id = v.get_id();
 		if (v.has_edge_data())
@@ -1044,7 +1061,8 @@ class undirected_edge_graph: public edge_graph
 	vertex_id_t get_max_vertex_id() const {
 		vertex_id_t max_id = 0;
 		for (size_t i = 0; i < edge_lists.size(); i++)
-			max_id = std::max(edge_lists[i]->back().get_from(), max_id);
+			if (!edge_lists[i]->empty())
+				max_id = std::max(edge_lists[i]->back().get_from(), max_id);
 		return max_id;
 	}
 
@@ -1061,7 +1079,8 @@ public:
 	 */
 	undirected_edge_graph(
 			std::vector<std::shared_ptr<edge_vector<edge_data_type> > > &edge_lists,
-			bool has_data): edge_graph(has_data) {
+			bool has_data): edge_graph(
+				has_data ? sizeof(edge_data_type) : 0) {
 		this->edge_lists = edge_lists;
 	}
 
@@ -1125,7 +1144,8 @@ public:
 	 */
 	directed_edge_graph(
 			std::vector<std::shared_ptr<edge_vector<edge_data_type> > > &edge_lists,
-			bool has_data): edge_graph(has_data) {
+			bool has_data): edge_graph(
+				has_data ? sizeof(edge_data_type) : 0) {
 		this->in_edge_lists = edge_lists;
 		this->out_edge_lists.resize(edge_lists.size());
 		for (size_t i = 0; i < edge_lists.size(); i++)
@@ -1521,6 +1541,220 @@ void disk_serial_graph::dump(const std::string &index_file,
 			"It takes %1% seconds to dump the index") % time_diff(start, end);
 }
 
+static bool append_file(FILE *from, size_t from_size, FILE *to)
+{
+	const size_t BUF_SIZE = 128 * 1024 * 1024;
+	std::unique_ptr<char[]> buf = std::unique_ptr<char[]>(
+			new char[std::min(from_size, BUF_SIZE)]);
+	size_t remain_size = from_size;
+	while (remain_size > 0) {
+		size_t read_size = std::min(remain_size, BUF_SIZE);
+		if (fread(buf.get(), read_size, 1, from) != 1
+				|| fwrite(buf.get(), read_size, 1, to) != 1)
+			return false;
+		remain_size -= read_size;
+	}
+	return true;
+}
+
+/*
+ * Split the adjacency lists in `in_f' into the lists without edge data in
+ * `topo_f' and the edge data column in `col_f', and append the column to
+ * `topo_f' at the page boundary `edge_data_loc'.
+ */
+static bool split_edge_data(FILE *in_f, const graph_header &new_header,
+		FILE *topo_f, FILE *col_f, std::vector<vsize_t> &num_in_edges,
+		std::vector<vsize_t> &num_out_edges, off_t &topo_size,
+		off_t &edge_data_loc)
+{
+	if (fwrite(&new_header, sizeof(new_header), 1, topo_f) != 1)
+		return false;
+	// The edge data column starts with a copy of the graph header, so
+	// a vertex has the same location in the column and in the adjacency lists.
+	if (fwrite(&new_header, sizeof(new_header), 1, col_f) != 1)
+		return false;
+
+	// The in-edge lists of all vertices are followed by the out-edge lists.
+	size_t num_vertices = new_header.get_num_vertices();
+	num_in_edges.resize(num_vertices);
+	num_out_edges.resize(num_vertices);
+	std::vector<char> buf;
+	const size_t header_size = ext_mem_undirected_vertex::get_header_size();
+	for (int part = 0; part < 2; part++) {
+		std::vector<vsize_t> &num_edges = part == 0 ? num_in_edges : num_out_edges;
+		for (size_t i = 0; i < num_vertices; i++) {
+			ext_mem_undirected_vertex v(0, 0, 0);
+			if (fread(&v, header_size, 1, in_f) != 1)
+				return false;
+			assert(v.get_id() == i);
+			size_t size = ext_mem_undirected_vertex::num_edges2vsize(
+					v.get_num_edges(), v.get_edge_data_size());
+			buf.resize(size);
+			if (size > header_size && fread(buf.data() + header_size,
+						size - header_size, 1, in_f) != 1)
+				return false;
+			num_edges[i] = v.get_num_edges();
+
+			ext_mem_undirected_vertex new_v(v.get_id(), v.get_num_edges(), 0);
+			size_t ids_size = v.get_num_edges() * sizeof(vertex_id_t);
+			if (fwrite(&new_v, header_size, 1, topo_f) != 1
+					|| fwrite(&new_v, header_size, 1, col_f) != 1)
+				return false;
+			if (ids_size > 0) {
+				off_t data_off = ext_mem_undirected_vertex::get_edge_data_offset(
+						v.get_num_edges(), v.get_edge_data_size());
+				if (fwrite(buf.data() + header_size, ids_size, 1, topo_f) != 1
+						|| fwrite(buf.data() + data_off, ids_size, 1,
+							col_f) != 1)
+					return false;
+			}
+		}
+	}
+
+	// Put the edge data column behind the adjacency lists.
+	// The column is aligned to pages, so reading the edge data of a vertex
+	// touches as many pages as reading its adjacency list.
+	topo_size = ftell(topo_f);
+	edge_data_loc = ROUNDUP_PAGE(topo_size);
+	size_t col_size = ftell(col_f);
+	if (fseek(topo_f, edge_data_loc, SEEK_SET) != 0
+			|| fseek(col_f, 0, SEEK_SET) != 0)
+		return false;
+	return append_file(col_f, col_size, topo_f) && fflush(topo_f) == 0;
+}
+
+/*
+ * Write the vertex index of the graph whose edge data column starts at
+ * `edge_data_loc'.
+ */
+static bool write_column_index(const std::string &new_index_file,
+		const std::string &index_file, const graph_header &new_header,
+		const std::vector<vsize_t> &num_in_edges,
+		const std::vector<vsize_t> &num_out_edges, off_t edge_data_loc,
+		size_t edge_data_size)
+{
+	directed_in_mem_vertex_index index;
+	for (size_t i = 0; i < num_in_edges.size(); i++)
+		index.add_vertex(directed_vertex_info(i, num_in_edges[i],
+					num_out_edges[i]));
+	vertex_index::ptr orig_index = vertex_index::load(index_file);
+	index.dump(new_index_file, new_header, orig_index->is_compressed());
+
+	// Record the location of the edge data column in the index.
+	FILE *index_f = fopen(new_index_file.c_str(), "r+");
+	if (index_f == NULL)
+		return false;
+	std::unique_ptr<char[]> index_header(
+			new char[vertex_index::get_header_size()]);
+	bool ret = fread(index_header.get(), vertex_index::get_header_size(), 1,
+			index_f) == 1;
+	if (ret) {
+		((vertex_index *) index_header.get())->set_edge_data_column(
+				edge_data_loc, edge_data_size);
+		ret = fseek(index_f, 0, SEEK_SET) == 0
+			&& fwrite(index_header.get(), vertex_index::get_header_size(), 1,
+					index_f) == 1;
+	}
+	return fclose(index_f) == 0 && ret;
+}
+
+bool store_edge_data_column(const std::string &adj_file,
+		const std::string &index_file)
+{
+	FILE *in_f = fopen(adj_file.c_str(), "r");
+	if (in_f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't open %1%: %2%")
+			% adj_file % strerror(errno);
+		return false;
+	}
+	graph_header header;
+	if (fread(&header, sizeof(header), 1, in_f) != 1) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't read the header of %1%")
+			% adj_file;
+		fclose(in_f);
+		return false;
+	}
+	header.verify();
+	// The edge data column mirrors the adjacency lists, so the edge data
+	// has to have the same size as vertex IDs.
+	if (!header.is_directed_graph() || header.get_graph_type() == TS_DIRECTED
+			|| header.get_edge_data_size() != sizeof(vertex_id_t)) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"an edge data column requires a directed graph with %1%-byte edge data")
+			% sizeof(vertex_id_t);
+		fclose(in_f);
+		return false;
+	}
+
+	// The new graph and index are written to temporary files, which replace
+	// the original files only after both are complete.
+	std::string topo_file = adj_file + ".topology";
+	std::string col_file = adj_file + ".column";
+	std::string new_index_file = index_file + ".column";
+	FILE *topo_f = fopen(topo_file.c_str(), "w+");
+	FILE *col_f = fopen(col_file.c_str(), "w+");
+	if (topo_f == NULL || col_f == NULL) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't create %1%: %2%")
+			% (topo_f == NULL ? topo_file : col_file) % strerror(errno);
+		if (topo_f) {
+			fclose(topo_f);
+			unlink(topo_file.c_str());
+		}
+		if (col_f) {
+			fclose(col_f);
+			unlink(col_file.c_str());
+		}
+		fclose(in_f);
+		return false;
+	}
+	graph_header new_header(header.get_graph_type(), header.get_num_vertices(),
+			header.get_num_edges(), 0);
+	std::vector<vsize_t> num_in_edges;
+	std::vector<vsize_t> num_out_edges;
+	off_t topo_size = 0;
+	off_t edge_data_loc = 0;
+	bool ret = split_edge_data(in_f, new_header, topo_f, col_f, num_in_edges,
+			num_out_edges, topo_size, edge_data_loc);
+	fclose(in_f);
+	fclose(col_f);
+	unlink(col_file.c_str());
+	if (fclose(topo_f) != 0)
+		ret = false;
+	if (!ret)
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"can't split the edge data of %1% into %2%") % adj_file % topo_file;
+	else if (!write_column_index(new_index_file, index_file, new_header,
+				num_in_edges, num_out_edges, edge_data_loc,
+				header.get_edge_data_size())) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't write %1%: %2%")
+			% new_index_file % strerror(errno);
+		ret = false;
+	}
+	if (!ret) {
+		unlink(topo_file.c_str());
+		unlink(new_index_file.c_str());
+		return false;
+	}
+
+	if (rename(topo_file.c_str(), adj_file.c_str()) < 0) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't rename %1% to %2%: %3%")
+			% topo_file % adj_file % strerror(errno);
+		unlink(topo_file.c_str());
+		unlink(new_index_file.c_str());
+		return false;
+	}
+	if (rename(new_index_file.c_str(), index_file.c_str()) < 0) {
+		BOOST_LOG_TRIVIAL(error) << boost::format("can't rename %1% to %2%: %3%")
+			% new_index_file % index_file % strerror(errno);
+		unlink(new_index_file.c_str());
+		return false;
+	}
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"the adjacency lists take %1% bytes and the edge data column starts at %2%")
+		% topo_size % edge_data_loc;
+	return true;
+}
+
 template<class edge_data_type = empty_data>
 edge_graph::ptr par_load_edge_list_text(
 		const std::vector<std::string> &files, bool has_edge_data,
@@ -1754,9 +1988,18 @@ struct edge_line parse_line(char *line)
 	}
 }
 
+/*
+ * A line without an edge is blank or a comment.
+ */
+static bool is_edge_line(const char *line)
+{
+	for (; *line == ' ' || *line == '\t'; line++);
+	return *line != 0 && *line != '#';
+}
+
 size_t parse_edge_list_line(char *line, edge<ts_edge_data> &e)
 {
-	if (line[0] == '#')
+	if (!is_edge_line(line))
 		return 0;
 	struct edge_line res = parse_line(line);
 	if (!isdigit(res.data[0]))
@@ -1770,7 +2013,7 @@ size_t parse_edge_list_line(char *line, edge<ts_edge_data> &e)
 
 int parse_edge_list_line(char *line, edge<edge_count> &e)
 {
-	if (line[0] == '#')
+	if (!is_edge_line(line))
 		return 0;
 	struct edge_line res = parse_line(line);
 	if (!isdigit(res.data[0]))
@@ -1783,13 +2026,185 @@ int parse_edge_list_line(char *line, edge<edge_count> &e)
 
 int parse_edge_list_line(char *line, edge<> &e)
 {
-	if (line[0] == '#')
+	if (!is_edge_line(line))
 		return 0;
 	struct edge_line res = parse_line(line);
 	e = edge<>(res.from, res.to);
 	return 1;
 }
 
+/*
+ * The fast path of parsing edge lists. It parses the text in place without
+ * copying lines or calling the locale-aware functions, so it can parse
+ * the text in a memory-mapped file.
+ */
+
+static inline void skip_blank(const char *&p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+}
+
+/*
+ * Skip the separator between two entries. Like the old parser, it accepts
+ * any single non-digit character, e.g., ',', and then skips the blanks.
+ */
+static inline void skip_separator(const char *&p, const char *end)
+{
+	if (p < end && !isdigit(*p))
+		p++;
+	skip_blank(p, end);
+}
+
+/*
+ * Parse a non-negative integer. It returns false if there isn't a digit
+ * at `p'.
+ */
+static inline bool parse_uint(const char *&p, const char *end, size_t &val)
+{
+	unsigned d;
+	if (p == end || (d = (unsigned) (*p - '0')) > 9)
+		return false;
+	size_t v = 0;
+	do {
+		v = v * 10 + d;
+		p++;
+	} while (p < end && (d = (unsigned) (*p - '0')) <= 9);
+	val = v;
+	return true;
+}
+
+static inline void parse_edge_data(const char *p, const char *line_end,
+		vertex_id_t from, vertex_id_t to, edge<> &e)
+{
+	e = edge<>(from, to);
+}
+
+static inline void parse_edge_data(const char *p, const char *line_end,
+		vertex_id_t from, vertex_id_t to, edge<edge_count> &e)
+{
+	size_t count;
+	if (!parse_uint(p, line_end, count))
+		throw format_error(std::string("the third entry isn't a number: ")
+				+ std::string(p, line_end));
+	e = edge<edge_count>(from, to, edge_count(count));
+}
+
+static inline void parse_edge_data(const char *p, const char *line_end,
+		vertex_id_t from, vertex_id_t to, edge<ts_edge_data> &e)
+{
+	size_t timestamp;
+	if (!parse_uint(p, line_end, timestamp))
+		throw format_error(std::string("the third entry isn't a number: ")
+				+ std::string(p, line_end));
+	e = edge<ts_edge_data>(from, to, ts_edge_data(timestamp));
+}
+
+/*
+ * Parse the line that starts at `p' and move `p' to the next line.
+ * It returns false if the line doesn't have an edge.
+ */
+template<class edge_data_type>
+static bool parse_edge_list_line(const char *&p, const char *end,
+		edge<edge_data_type> &e)
+{
+	const char *line = p;
+	const char *line_end = (const char *) memchr(p, '\n', end - p);
+	if (line_end == NULL)
+		line_end = end;
+	p = line_end == end ? end : line_end + 1;
+	if (line_end > line && *(line_end - 1) == '\r')
+		line_end--;
+
+	skip_blank(line, line_end);
+	if (line == line_end || *line == '#')
+		return false;
+	size_t from, to;
+	if (!parse_uint(line, line_end, from))
+		throw format_error(std::string("the first entry isn't a number: ")
+				+ std::string(line, line_end));
+	skip_separator(line, line_end);
+	if (!parse_uint(line, line_end, to))
+		throw format_error(std::string("the second entry isn't a number: ")
+				+ std::string(line, line_end));
+	assert(from < MAX_VERTEX_ID && to < MAX_VERTEX_ID);
+	skip_separator(line, line_end);
+	parse_edge_data(line, line_end, from, to, e);
+	return true;
+}
+
+/*
+ * An edge list file mapped to memory. It's unmapped after all tasks
+ * parsing it are done.
+ */
+class mapped_edge_file
+{
+	const char *data;
+	size_t size;
+
+	mapped_edge_file() {
+		data = NULL;
+		size = 0;
+	}
+public:
+	typedef std::shared_ptr<mapped_edge_file> ptr;
+
+	static ptr create(const std::string &file_name);
+
+	~mapped_edge_file() {
+		if (data)
+			munmap((void *) data, size);
+	}
+
+	const char *get_data() const {
+		return data;
+	}
+
+	size_t get_size() const {
+		return size;
+	}
+
+	/*
+	 * The location of the first line that starts at or after `off'.
+	 */
+	size_t get_line_start(size_t off) const {
+		if (off == 0 || off >= size)
+			return std::min(off, size);
+		const char *p = (const char *) memchr(data + off - 1, '\n',
+				size - off + 1);
+		return p ? p - data + 1 : size;
+	}
+};
+
+mapped_edge_file::ptr mapped_edge_file::create(const std::string &file_name)
+{
+	int fd = open(file_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		perror("open");
+		return ptr();
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		perror("fstat");
+		close(fd);
+		return ptr();
+	}
+	ptr f = ptr(new mapped_edge_file());
+	f->size = st.st_size;
+	if (f->size > 0) {
+		void *addr = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED) {
+			perror("mmap");
+			close(fd);
+			return ptr();
+		}
+		madvise(addr, f->size, MADV_SEQUENTIAL);
+		f->data = (const char *) addr;
+	}
+	close(fd);
+	return f;
+}
+
 static std::unique_ptr<char[]> read_file(const std::string &file_name,
 		size_t &size)
 {
@@ -1797,8 +2212,11 @@ static std::unique_ptr<char[]> read_file(const std::string &file_name,
 	size = local_f.get_size();
 	FILE *f = fopen(file_name.c_str(), "r");
 	assert(f);
-	char *buf = new char[size];
-	BOOST_VERIFY(fread(buf, size, 1, f) == 1);
+	// The text is parsed as a string, so it has to end with '\0'.
+	char *buf = new char[size + 1];
+	BOOST_VERIFY(size == 0 || fread(buf, size, 1, f) == 1);
+	buf[size] = 0;
+	fclose(f);
 	return std::unique_ptr<char[]>(buf);
 }
 
@@ -1822,7 +2240,8 @@ static std::unique_ptr<char[]> read_gz_file(const std::string &file_name,
 			"get %1% bytes from %2%") % out_size % file_name;
 
 	size = out_size;
-	char *out_buf = new char[out_size];
+	char *out_buf = new char[out_size + 1];
+	out_buf[out_size] = 0;
 	std::unique_ptr<char[]> ret_buf(out_buf);
 	for (size_t i = 0; i < bufs.size(); i++) {
 		char *buf = bufs[i].get();
@@ -1852,7 +2271,7 @@ size_t parse_edge_list_text(char *line_buf, size_t size,
 	while ((line_end = strchr(line, '\n'))) {
 		assert(line_end - line_buf <= (ssize_t) size);
 		*line_end = 0;
-		if (*(line_end - 1) == '\r')
+		if (line_end > line && *(line_end - 1) == '\r')
 			*(line_end - 1) = 0;
 		edge<edge_data_type> e;
 		int num = parse_edge_list_line(line, e);
@@ -1902,13 +2321,150 @@ public:
 	}
 };
 
+/*
+ * Parse the lines in [begin, end) of a mapped edge list file.
+ * `begin' and `end' are at the start of lines.
+ */
+template<class edge_data_type>
+class mapped_edge_task: public thread_task
+{
+	mapped_edge_file::ptr file;
+	size_t begin;
+	size_t end;
+	bool directed;
+public:
+	mapped_edge_task(mapped_edge_file::ptr file, size_t begin, size_t end,
+			bool directed) {
+		this->file = file;
+		this->begin = begin;
+		this->end = end;
+		this->directed = directed;
+	}
+
+	void run() {
+		std::vector<edge<edge_data_type> > edges;
+		const char *p = file->get_data() + begin;
+		const char *text_end = file->get_data() + end;
+		while (p < text_end) {
+			edge<edge_data_type> e;
+			if (parse_edge_list_line(p, text_end, e))
+				edges.push_back(e);
+		}
+		edge_vector<edge_data_type> *local_edge_buf
+			= (edge_vector<edge_data_type> *) thread::get_curr_thread()->get_user_data();
+		local_edge_buf->append(edges);
+
+		// For an undirected graph, we need to store each edge twice
+		// and each copy is the reverse of the original edge.
+		if (!directed) {
+			BOOST_FOREACH(edge<edge_data_type> e, edges) {
+				e.reverse_dir();
+				local_edge_buf->push_back(e);
+			}
+		}
+	}
+};
+
+static inline vertex_id_t read_bin_id(const char *p,
+		bin_edge_schema::field_type type)
+{
+	size_t id;
+	if (type == bin_edge_schema::U32) {
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		id = v;
+	}
+	else {
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		id = v;
+	}
+	assert(id < MAX_VERTEX_ID);
+	return id;
+}
+
+static inline void read_bin_edge_data(const char *p,
+		bin_edge_schema::field_type type, vertex_id_t from, vertex_id_t to,
+		edge<> &e)
+{
+	e = edge<>(from, to);
+}
+
+static inline void read_bin_edge_data(const char *p,
+		bin_edge_schema::field_type type, vertex_id_t from, vertex_id_t to,
+		edge<edge_count> &e)
+{
+	uint32_t count;
+	memcpy(&count, p, sizeof(count));
+	e = edge<edge_count>(from, to, edge_count(count));
+}
+
+static inline void read_bin_edge_data(const char *p,
+		bin_edge_schema::field_type type, vertex_id_t from, vertex_id_t to,
+		edge<ts_edge_data> &e)
+{
+	int64_t timestamp;
+	memcpy(&timestamp, p, sizeof(timestamp));
+	e = edge<ts_edge_data>(from, to, ts_edge_data(timestamp));
+}
+
+/*
+ * Convert the records in [begin, end) of a mapped binary edge list file
+ * to edges.
+ */
+template<class edge_data_type>
+class bin_edge_task: public thread_task
+{
+	mapped_edge_file::ptr file;
+	size_t begin;
+	size_t end;
+	bin_edge_schema schema;
+	bool directed;
+public:
+	bin_edge_task(mapped_edge_file::ptr file, size_t begin, size_t end,
+			const bin_edge_schema &schema, bool directed) {
+		this->file = file;
+		this->begin = begin;
+		this->end = end;
+		this->schema = schema;
+		this->directed = directed;
+	}
+
+	void run() {
+		size_t rec_size = schema.get_record_size();
+		size_t id_size = schema.id_type == bin_edge_schema::U32 ? 4 : 8;
+		std::vector<edge<edge_data_type> > edges((end - begin) / rec_size);
+		const char *rec = file->get_data() + begin;
+		for (size_t i = 0; i < edges.size(); i++, rec += rec_size) {
+			vertex_id_t from = read_bin_id(rec, schema.id_type);
+			vertex_id_t to = read_bin_id(rec + id_size, schema.id_type);
+			read_bin_edge_data(rec + id_size * 2, schema.data_type, from, to,
+					edges[i]);
+		}
+		edge_vector<edge_data_type> *local_edge_buf
+			= (edge_vector<edge_data_type> *) thread::get_curr_thread()->get_user_data();
+		local_edge_buf->append(edges);
+
+		// For an undirected graph, we need to store each edge twice
+		// and each copy is the reverse of the original edge.
+		if (!directed) {
+			BOOST_FOREACH(edge<edge_data_type> e, edges) {
+				e.reverse_dir();
+				local_edge_buf->push_back(e);
+			}
+		}
+	}
+};
+
 template<class edge_data_type>
 class text_edge_file_task: public thread_task
 {
 	std::string file_name;
+	bool directed;
 public:
-	text_edge_file_task(const std::string file_name) {
+	text_edge_file_task(const std::string file_name, bool directed) {
 		this->file_name = file_name;
+		this->directed = directed;
 	}
 
 	void run() {
@@ -1932,6 +2488,15 @@ public:
 		edge_vector<edge_data_type> *local_edge_buf
 			= (edge_vector<edge_data_type> *) thread::get_curr_thread()->get_user_data();
 		local_edge_buf->append(edges);
+
+		// For an undirected graph, we need to store each edge twice
+		// and each copy is the reverse of the original edge.
+		if (!directed) {
+			BOOST_FOREACH(edge<edge_data_type> e, edges) {
+				e.reverse_dir();
+				local_edge_buf->push_back(e);
+			}
+		}
 		std::cout << boost::format("There are %1% edges in thread %2%\n")
 			% local_edge_buf->size() % thread::get_curr_thread()->get_id();
 	}
@@ -2276,16 +2841,13 @@ serial_graph::ptr directed_edge_graph<edge_data_type>::serialize_graph(
 	return g;
 }
 
-/**
- * This function loads edge lists from a tex file, parses them in parallel,
- * and convert the graph into the form of adjacency lists.
+/*
+ * Start the threads that convert edge lists to edges. Each thread keeps
+ * the edges in its own edge vector.
  */
 template<class edge_data_type>
-edge_graph::ptr par_load_edge_list_text(const std::vector<std::string> &files,
-		bool has_edge_data, bool directed, bool in_mem)
+static std::vector<task_thread *> start_edge_list_threads(bool in_mem)
 {
-	struct timeval start, end;
-	gettimeofday(&start, NULL);
 	std::vector<task_thread *> threads(num_threads);
 	for (int i = 0; i < num_threads; i++) {
 		task_thread *t = new task_thread(std::string(
@@ -2306,9 +2868,85 @@ edge_graph::ptr par_load_edge_list_text(const std::vector<std::string> &files,
 		t->start();
 		threads[i] = t;
 	}
+	return threads;
+}
+
+/*
+ * Construct the edge graph from the edges in the threads, and stop
+ * the threads.
+ */
+template<class edge_data_type>
+static edge_graph::ptr construct_edge_graph(std::vector<task_thread *> &threads,
+		bool has_edge_data, bool directed)
+{
+	size_t num_edges = 0;
+	std::vector<std::shared_ptr<edge_vector<edge_data_type> > > edge_lists(
+			num_threads);
+	for (int i = 0; i < num_threads; i++) {
+		edge_vector<edge_data_type> *local_edges
+			= (edge_vector<edge_data_type> *) threads[i]->get_user_data();
+		num_edges += local_edges->size();
+		edge_lists[i] = std::shared_ptr<edge_vector<edge_data_type> >(
+				local_edges);
+	}
+	BOOST_LOG_TRIVIAL(info) << boost::format("There are %1% edges") % num_edges;
+
+	edge_graph::ptr edge_g;
+	if (directed)
+		edge_g = edge_graph::ptr(new directed_edge_graph<edge_data_type>(
+					edge_lists, has_edge_data));
+	else
+		edge_g = edge_graph::ptr(new undirected_edge_graph<edge_data_type>(
+					edge_lists, has_edge_data));
+
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"There are %1% edges in the edge graph") % edge_g->get_num_edges();
+
+	for (int i = 0; i < num_threads; i++) {
+		threads[i]->stop();
+		threads[i]->join();
+		delete threads[i];
+	}
+
+	return edge_g;
+}
+
+/**
+ * This function loads edge lists from a tex file, parses them in parallel,
+ * and convert the graph into the form of adjacency lists.
+ */
+template<class edge_data_type>
+edge_graph::ptr par_load_edge_list_text(const std::vector<std::string> &files,
+		bool has_edge_data, bool directed, bool in_mem)
+{
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	std::vector<task_thread *> threads
+		= start_edge_list_threads<edge_data_type>(in_mem);
 	int thread_no = 0;
-	if (files.size() == 1) {
-		const std::string file = files[0];
+	// An uncompressed edge list file is mapped to memory and split at
+	// line boundaries, so all threads parse it in parallel.
+	std::vector<std::string> unmapped_files;
+	for (size_t i = 0; i < files.size(); i++) {
+		mapped_edge_file::ptr mapped;
+		if (!is_compressed(files[i]))
+			mapped = mapped_edge_file::create(files[i]);
+		if (mapped == NULL) {
+			unmapped_files.push_back(files[i]);
+			continue;
+		}
+		BOOST_LOG_TRIVIAL(info) << (std::string("map file ") + files[i]);
+		for (size_t off = 0; off < mapped->get_size(); ) {
+			size_t end = mapped->get_line_start(off + EDGE_LIST_BLOCK_SIZE);
+			thread_task *task = new mapped_edge_task<edge_data_type>(mapped,
+					off, end, directed);
+			threads[thread_no % num_threads]->add_task(task);
+			thread_no++;
+			off = end;
+		}
+	}
+	if (unmapped_files.size() == 1) {
+		const std::string file = unmapped_files[0];
 		BOOST_LOG_TRIVIAL(info) << (std::string(
 					"start to read the edge list from ") + file.c_str());
 		graph_file_io::ptr io;
@@ -2334,9 +2972,11 @@ edge_graph::ptr par_load_edge_list_text(const std::vector<std::string> &files,
 		}
 	}
 	else {
-		for (size_t i = 0; i < files.size(); i++) {
-			BOOST_LOG_TRIVIAL(info) << (std::string("read file " ) + files[i]);
-			thread_task *task = new text_edge_file_task<edge_data_type>(files[i]);
+		for (size_t i = 0; i < unmapped_files.size(); i++) {
+			BOOST_LOG_TRIVIAL(info) << (std::string("read file " )
+					+ unmapped_files[i]);
+			thread_task *task = new text_edge_file_task<edge_data_type>(
+					unmapped_files[i], directed);
 			threads[thread_no % num_threads]->add_task(task);
 			thread_no++;
 		}
@@ -2347,37 +2987,63 @@ edge_graph::ptr par_load_edge_list_text(const std::vector<std::string> &files,
 	BOOST_LOG_TRIVIAL(info) << boost::format(
 			"It takes %1% seconds to construct edge list") % time_diff(start, end);
 
-	size_t num_edges = 0;
-	std::vector<std::shared_ptr<edge_vector<edge_data_type> > > edge_lists(
-			num_threads);
-	for (int i = 0; i < num_threads; i++) {
-		edge_vector<edge_data_type> *local_edges
-			= (edge_vector<edge_data_type> *) threads[i]->get_user_data();
-		num_edges += local_edges->size();
-		edge_lists[i] = std::shared_ptr<edge_vector<edge_data_type> >(
-				local_edges);
-	}
-	BOOST_LOG_TRIVIAL(info) << boost::format("There are %1% edges") % num_edges;
-
-	edge_graph::ptr edge_g;
-	if (directed)
-		edge_g = edge_graph::ptr(new directed_edge_graph<edge_data_type>(
-					edge_lists, has_edge_data));
-	else
-		edge_g = edge_graph::ptr(new undirected_edge_graph<edge_data_type>(
-					edge_lists, has_edge_data));
+	return construct_edge_graph<edge_data_type>(threads, has_edge_data,
+			directed);
+}
 
-	start = end;
-	BOOST_LOG_TRIVIAL(info) << boost::format(
-			"There are %1% edges in the edge graph") % edge_g->get_num_edges();
+/**
+ * This function loads binary edge lists, converts the records to edges
+ * in parallel, and convert the graph into the form of adjacency lists.
+ */
+template<class edge_data_type>
+edge_graph::ptr par_load_edge_list_bin(const std::vector<std::string> &files,
+		const bin_edge_schema &schema, bool has_edge_data, bool directed,
+		bool in_mem)
+{
+	size_t rec_size = schema.get_record_size();
+	std::vector<mapped_edge_file::ptr> mapped_files;
+	for (size_t i = 0; i < files.size(); i++) {
+		if (is_compressed(files[i])) {
+			BOOST_LOG_TRIVIAL(error) << boost::format(
+					"binary edge list %1% can't be compressed") % files[i];
+			return edge_graph::ptr();
+		}
+		mapped_edge_file::ptr mapped = mapped_edge_file::create(files[i]);
+		if (mapped == NULL)
+			return edge_graph::ptr();
+		if (mapped->get_size() % rec_size != 0) {
+			BOOST_LOG_TRIVIAL(error) << boost::format(
+					"the size of %1% isn't a multiple of the record size %2%")
+				% files[i] % rec_size;
+			return edge_graph::ptr();
+		}
+		mapped_files.push_back(mapped);
+	}
 
-	for (int i = 0; i < num_threads; i++) {
-		threads[i]->stop();
-		threads[i]->join();
-		delete threads[i];
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+	std::vector<task_thread *> threads
+		= start_edge_list_threads<edge_data_type>(in_mem);
+	size_t block_size = EDGE_LIST_BLOCK_SIZE / rec_size * rec_size;
+	int thread_no = 0;
+	for (size_t i = 0; i < mapped_files.size(); i++) {
+		mapped_edge_file::ptr mapped = mapped_files[i];
+		for (size_t off = 0; off < mapped->get_size(); off += block_size) {
+			size_t end = std::min(off + block_size, mapped->get_size());
+			thread_task *task = new bin_edge_task<edge_data_type>(mapped,
+					off, end, schema, directed);
+			threads[thread_no % num_threads]->add_task(task);
+			thread_no++;
+		}
 	}
+	for (int i = 0; i < num_threads; i++)
+		threads[i]->wait4complete();
+	gettimeofday(&end, NULL);
+	BOOST_LOG_TRIVIAL(info) << boost::format(
+			"It takes %1% seconds to construct edge list") % time_diff(start, end);
 
-	return edge_g;
+	return construct_edge_graph<edge_data_type>(threads, has_edge_data,
+			directed);
 }
 
 edge_graph::ptr parse_edge_lists(const std::vector<std::string> &edge_list_files,
@@ -2402,6 +3068,91 @@ edge_graph::ptr parse_edge_lists(const std::vector<std::string> &edge_list_files
 	return g;
 }
 
+static bool parse_field_type(const std::string &str,
+		bin_edge_schema::field_type &type)
+{
+	if (str == "u32")
+		type = bin_edge_schema::U32;
+	else if (str == "u64")
+		type = bin_edge_schema::U64;
+	else if (str == "i64")
+		type = bin_edge_schema::I64;
+	else
+		return false;
+	return true;
+}
+
+static size_t get_field_size(bin_edge_schema::field_type type)
+{
+	switch (type) {
+		case bin_edge_schema::U32:
+			return 4;
+		case bin_edge_schema::U64:
+		case bin_edge_schema::I64:
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+bool bin_edge_schema::parse(const std::string &str)
+{
+	size_t sep = str.find(',');
+	if (!parse_field_type(str.substr(0, sep), id_type)
+			|| (id_type != U32 && id_type != U64))
+		return false;
+	data_type = NONE;
+	if (sep == std::string::npos)
+		return true;
+	std::string data_str = str.substr(sep + 1);
+	/*
+	 * Edge counts are integers. Rounding float weights to edge counts
+	 * would destroy weights such as normalized ones.
+	 */
+	if (data_str == "f32") {
+		BOOST_LOG_TRIVIAL(error)
+			<< "f32 edge data isn't supported: the graph has no float edge data type";
+		return false;
+	}
+	return parse_field_type(data_str, data_type) && data_type != U64;
+}
+
+size_t bin_edge_schema::get_record_size() const
+{
+	return get_field_size(id_type) * 2 + get_field_size(data_type);
+}
+
+int bin_edge_schema::get_edge_attr_type() const
+{
+	switch (data_type) {
+		case U32:
+			return EDGE_COUNT;
+		case I64:
+			return EDGE_TIMESTAMP;
+		default:
+			return DEFAULT_TYPE;
+	}
+}
+
+edge_graph::ptr parse_bin_edge_lists(
+		const std::vector<std::string> &edge_list_files,
+		const bin_edge_schema &schema, bool directed, int nthreads,
+		bool in_mem)
+{
+	num_threads = nthreads;
+	switch(schema.get_edge_attr_type()) {
+		case EDGE_COUNT:
+			return par_load_edge_list_bin<edge_count>(edge_list_files, schema,
+					true, directed, in_mem);
+		case EDGE_TIMESTAMP:
+			return par_load_edge_list_bin<ts_edge_data>(edge_list_files, schema,
+					true, directed, in_mem);
+		default:
+			return par_load_edge_list_bin<empty_data>(edge_list_files, schema,
+					false, directed, in_mem);
+	}
+}
+
 serial_graph::ptr construct_graph(edge_graph::ptr edge_g,
 		const std::string &work_dir, int nthreads)
 {
@@ -2426,15 +3177,22 @@ serial_graph::ptr construct_graph(const std::vector<std::string> &edge_list_file
 	return construct_graph(edge_g, work_dir, nthreads);
 }
 
+std::pair<in_mem_graph::ptr, vertex_index::ptr> construct_mem_graph(
+		edge_graph::ptr edge_g, const std::string &graph_name, int nthreads)
+{
+	serial_graph::ptr g = construct_graph(edge_g, std::string(), nthreads);
+	return std::pair<in_mem_graph::ptr, vertex_index::ptr>(
+			((mem_serial_graph &) *g).dump_graph(graph_name), g->dump_index(true));
+}
+
 std::pair<in_mem_graph::ptr, vertex_index::ptr> construct_mem_graph(
 		const std::vector<std::string> &edge_list_files,
 		const std::string &graph_name, int edge_attr_type, bool directed,
 		int nthreads)
 {
-	serial_graph::ptr g = construct_graph(edge_list_files, edge_attr_type,
-			directed, std::string(), nthreads);
-	return std::pair<in_mem_graph::ptr, vertex_index::ptr>(
-			((mem_serial_graph &) *g).dump_graph(graph_name), g->dump_index(true));
+	edge_graph::ptr edge_g = parse_edge_lists(edge_list_files, edge_attr_type,
+			directed, nthreads, true);
+	return construct_mem_graph(edge_g, graph_name, nthreads);
 }
 
 std::pair<in_mem_graph::ptr, vertex_index::ptr> construct_mem_graph(
@@ -2475,3 +3233,45 @@ std::pair<in_mem_graph::ptr, vertex_index::ptr> construct_mem_graph(
 	return std::pair<in_mem_graph::ptr, vertex_index::ptr>(
 			((mem_serial_graph &) *g).dump_graph(graph_name), g->dump_index(true));
 }
+
+std::pair<in_mem_graph::ptr, vertex_index::ptr> construct_mem_graph(
+		const std::vector<vertex_id_t> &from, const std::vector<vertex_id_t> &to,
+		const std::vector<edge_count> &counts, const std::string &graph_name,
+		bool directed, int num_threads)
+{
+	if (from.size() != to.size() || from.size() != counts.size()) {
+		BOOST_LOG_TRIVIAL(error) << boost::format(
+				"from vector (%1%), to vector (%2%) and count vector (%3%) have different length")
+			% from.size() % to.size() % counts.size();
+		return std::pair<in_mem_graph::ptr, vertex_index::ptr>();
+	}
+
+	size_t num_edges = from.size();
+	std::vector<std::shared_ptr<edge_vector<edge_count> > > edge_lists(1);
+	edge_lists[0] = std::shared_ptr<edge_vector<edge_count> >(
+			new std_edge_vector<edge_count>());
+
+	edge_graph::ptr edge_g;
+	if (directed) {
+		for (size_t i = 0; i < num_edges; i++)
+			edge_lists[0]->push_back(edge<edge_count>(from[i], to[i],
+						counts[i]));
+		edge_g = edge_graph::ptr(new directed_edge_graph<edge_count>(
+					edge_lists, true));
+	}
+	else {
+		for (size_t i = 0; i < num_edges; i++) {
+			// Undirected edge graph assumes each edge has been added twice,
+			// for both directions.
+			edge_lists[0]->push_back(edge<edge_count>(from[i], to[i],
+						counts[i]));
+			edge_lists[0]->push_back(edge<edge_count>(to[i], from[i],
+						counts[i]));
+		}
+		edge_g = edge_graph::ptr(new undirected_edge_graph<edge_count>(
+					edge_lists, true));
+	}
+	serial_graph::ptr g = construct_graph(edge_g, std::string(), num_threads);
+	return std::pair<in_mem_graph::ptr, vertex_index::ptr>(
+			((mem_serial_graph &) *g).dump_graph(graph_name), g->dump_index(true));
+}
@@ -39,6 +39,7 @@ enum {
 
 class in_mem_graph;
 class vertex_index;
+class edge_count;
 
 class serial_subgraph;
 class in_mem_vertex_index;
@@ -150,11 +151,61 @@ public:
 
 edge_graph::ptr parse_edge_lists(const std::vector<std::string> &edge_list_files,
 		int edge_attr_type, bool directed, int num_threads, bool in_mem);
+
+/*
+ * The schema of the records in a binary edge list file. A record has
+ * the source vertex and the destination vertex, followed by the edge data
+ * if the schema has it. The records are packed and stored in the native
+ * byte order.
+ */
+struct bin_edge_schema
+{
+	enum field_type
+	{
+		NONE,
+		U32,
+		U64,
+		I64,
+	};
+
+	// The type of vertex IDs: U32 or U64.
+	field_type id_type;
+	// The type of edge data: U32 for edge counts and I64 for timestamps.
+	field_type data_type;
+
+	bin_edge_schema() {
+		id_type = U32;
+		data_type = NONE;
+	}
+
+	/*
+	 * Parse a schema in the form of "ids[,data]", e.g., "u32" or "u64,i64".
+	 * It returns false if the schema isn't valid.
+	 */
+	bool parse(const std::string &str);
+	size_t get_record_size() const;
+	// The type of edge data in the graph constructed from the edge lists.
+	int get_edge_attr_type() const;
+};
+
+/*
+ * Load binary edge lists. The records are converted to edges directly
+ * without parsing. It returns NULL if the files don't match the schema.
+ */
+edge_graph::ptr parse_bin_edge_lists(
+		const std::vector<std::string> &edge_list_files,
+		const bin_edge_schema &schema, bool directed, int num_threads,
+		bool in_mem);
 serial_graph::ptr construct_graph(edge_graph::ptr edge_g,
 		const std::string &work_dir, int num_threads);
 serial_graph::ptr construct_graph(const std::vector<std::string> &edge_list_files,
 		int edge_attr_type, bool directed, const std::string &work_dir,
 		int num_threads);
+/*
+ * This constructs an in-memory graph from the edges parsed from edge lists.
+ */
+std::pair<std::shared_ptr<in_mem_graph>, std::shared_ptr<vertex_index> > construct_mem_graph(
+		edge_graph::ptr edge_g, const std::string &graph_name, int num_threads);
 std::pair<std::shared_ptr<in_mem_graph>, std::shared_ptr<vertex_index> > construct_mem_graph(
 		const std::vector<std::string> &edge_list_files,
 		const std::string &graph_name, int edge_attr_type, bool directed,
@@ -163,5 +214,22 @@ std::pair<std::shared_ptr<in_mem_graph>, std::shared_ptr<vertex_index> > constru
 		const std::vector<vertex_id_t> from, const std::vector<vertex_id_t> to,
 		const std::string &graph_name, int edge_attr_type, bool directed,
 		int num_threads);
+/*
+ * This moves the edge data of a directed graph out of its adjacency lists
+ * into an edge data column stored behind the adjacency lists, and rewrites
+ * the adjacency list file and the index file. Algorithms that only need
+ * the graph topology don't read edge data any more, while weighted
+ * algorithms request the edge data explicitly.
+ */
+bool store_edge_data_column(const std::string &adj_file,
+		const std::string &index_file);
+/*
+ * This constructs an in-memory graph whose edges have edge counts as
+ * their weights. A pair of vertices may have multiple edges.
+ */
+std::pair<std::shared_ptr<in_mem_graph>, std::shared_ptr<vertex_index> > construct_mem_graph(
+		const std::vector<vertex_id_t> &from, const std::vector<vertex_id_t> &to,
+		const std::vector<edge_count> &counts, const std::string &graph_name,
+		bool directed, int num_threads);
 
 #endif
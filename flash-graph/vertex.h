@@ -722,6 +722,20 @@ class page_directed_vertex: public page_vertex
 	size_t out_size;
 	const page_byte_array *in_array;
 	const page_byte_array *out_array;
+	// The edge data read from the edge data column.
+	const page_byte_array *in_data_array;
+	const page_byte_array *out_data_array;
+
+	const page_byte_array *get_data_array(edge_type type) const {
+		switch(type) {
+			case IN_EDGE:
+				return in_data_array;
+			case OUT_EDGE:
+				return out_data_array;
+			default:
+				abort();
+		}
+	}
 public:
 	static vertex_id_t get_id(const page_byte_array &arr) {
 		BOOST_VERIFY(arr.get_size()
@@ -741,6 +755,8 @@ public:
 		size_t size = arr.get_size();
 		BOOST_VERIFY(size >= ext_mem_undirected_vertex::get_header_size());
 		ext_mem_undirected_vertex v = arr.get<ext_mem_undirected_vertex>(0);
+		in_data_array = NULL;
+		out_data_array = NULL;
 
 		if (in_part) {
 			in_size = v.get_size();
@@ -767,6 +783,8 @@ public:
 			const page_byte_array &out_arr): page_vertex(true) {
 		this->in_array = &in_arr;
 		this->out_array = &out_arr;
+		this->in_data_array = NULL;
+		this->out_data_array = NULL;
 
 		size_t size = in_arr.get_size();
 		BOOST_VERIFY(size >= ext_mem_undirected_vertex::get_header_size());
@@ -785,6 +803,53 @@ public:
 		num_out_edges = v.get_num_edges();
 	}
 
+	/**
+	 * \internal
+	 * The constructor for a directed vertex in a graph with an edge data
+	 * column. Each of the byte arrays may be NULL if the part isn't
+	 * requested. A record in the edge data column has the same header as
+	 * the adjacency list it mirrors, so we can get the vertex ID and
+	 * the number of edges from either of them.
+	 */
+	page_directed_vertex(const page_byte_array *in_arr,
+			const page_byte_array *out_arr, const page_byte_array *in_data_arr,
+			const page_byte_array *out_data_arr): page_vertex(true) {
+		this->in_array = in_arr;
+		this->out_array = out_arr;
+		this->in_data_array = in_data_arr;
+		this->out_data_array = out_data_arr;
+		id = INVALID_VERTEX_ID;
+		in_size = 0;
+		out_size = 0;
+		num_in_edges = 0;
+		num_out_edges = 0;
+
+		const page_byte_array *in_part = in_arr ? in_arr : in_data_arr;
+		if (in_part) {
+			BOOST_VERIFY(in_part->get_size()
+					>= ext_mem_undirected_vertex::get_header_size());
+			ext_mem_undirected_vertex v
+				= in_part->get<ext_mem_undirected_vertex>(0);
+			id = v.get_id();
+			num_in_edges = v.get_num_edges();
+			if (in_arr)
+				in_size = v.get_size();
+		}
+		const page_byte_array *out_part = out_arr ? out_arr : out_data_arr;
+		if (out_part) {
+			BOOST_VERIFY(out_part->get_size()
+					>= ext_mem_undirected_vertex::get_header_size());
+			ext_mem_undirected_vertex v
+				= out_part->get<ext_mem_undirected_vertex>(0);
+			assert(id == INVALID_VERTEX_ID || id == v.get_id());
+			id = v.get_id();
+			num_out_edges = v.get_num_edges();
+			if (out_arr)
+				out_size = v.get_size();
+		}
+		assert(id != INVALID_VERTEX_ID);
+	}
+
 	size_t get_in_size() const {
 		return in_size;
 	}
@@ -893,6 +958,12 @@ public:
 	template<class edge_data_type>
 	page_byte_array::const_iterator<edge_data_type> get_data_begin(
 			edge_type type) const {
+		const page_byte_array *data_arr = get_data_array(type);
+		if (data_arr) {
+			assert(sizeof(edge_data_type) == sizeof(vertex_id_t));
+			return data_arr->begin<edge_data_type>(
+					ext_mem_undirected_vertex::get_header_size());
+		}
 		switch(type) {
 			case IN_EDGE:
 				assert(in_array);
@@ -937,6 +1008,15 @@ public:
 	template<class edge_data_type>
 	page_byte_array::seq_const_iterator<edge_data_type> get_data_seq_it(
 			edge_type type, size_t start, size_t end) const {
+		const page_byte_array *data_arr = get_data_array(type);
+		if (data_arr) {
+			assert(sizeof(edge_data_type) == sizeof(vertex_id_t));
+			return data_arr->get_seq_iterator<edge_data_type>(
+					ext_mem_undirected_vertex::get_header_size()
+					+ start * sizeof(edge_data_type),
+					ext_mem_undirected_vertex::get_header_size()
+					+ end * sizeof(edge_data_type));
+		}
 		off_t edge_end;
 		switch(type) {
 			case IN_EDGE:
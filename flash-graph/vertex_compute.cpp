@@ -54,7 +54,15 @@ void vertex_compute::finish_run()
 void vertex_compute::request_vertices(vertex_id_t ids[], size_t num)
 {
 	num_requested += num;
-	issue_thread->get_index_reader().request_vertices(ids, num, *this);
+	// If the graph is in memory, we can locate the adjacency lists
+	// with the in-memory vertex index right away.
+	if (issue_thread->has_in_mem_graph()) {
+		const in_mem_query_vertex_index &index = *graph->get_in_mem_index();
+		for (size_t i = 0; i < num; i++)
+			issue_io_request(index.get_vertex_info(ids[i], edge_type::OUT_EDGE));
+	}
+	else
+		issue_thread->get_index_reader().request_vertices(ids, num, *this);
 }
 
 void vertex_compute::request_num_edges(vertex_id_t ids[], size_t num)
@@ -75,10 +83,16 @@ void vertex_compute::run_on_vertex_size(vertex_id_t id, vsize_t size)
 
 void vertex_compute::issue_io_request(const ext_mem_vertex_info &info)
 {
+	// The adjacency list is in memory, the worker thread runs the vertex
+	// on it directly.
+	if (issue_thread->has_in_mem_graph()) {
+		num_issued++;
+		issue_thread->issue_in_mem_request(this, info);
+	}
 	// If the vertex compute has been issued to SAFS, SAFS will get the IO
 	// request from the interface of user_compute. In this case, we only
 	// need to add the I/O request to the queue.
-	if (issued_to_io()) {
+	else if (issued_to_io()) {
 		requested_vertices.push(info);
 	}
 	else {
@@ -99,6 +113,14 @@ void vertex_compute::run(page_byte_array &array)
 	finish_run();
 }
 
+void directed_vertex_compute::run(page_byte_array &in_array,
+		page_byte_array &out_array)
+{
+	num_complete_fetched += 2;
+	page_directed_vertex pg_v(in_array, out_array);
+	run_on_page_vertex(pg_v);
+}
+
 void directed_vertex_compute::run_on_page_vertex(page_directed_vertex &pg_v)
 {
 	start_run();
@@ -106,49 +128,61 @@ void directed_vertex_compute::run_on_page_vertex(page_directed_vertex &pg_v)
 	finish_run();
 }
 
+int directed_vertex_compute::get_array_idx(const page_byte_array &arr) const
+{
+	off_t off = arr.get_offset();
+	int idx = 0;
+	if (graph->has_edge_data_column() && off >= graph->get_edge_data_loc()) {
+		off -= graph->get_edge_data_loc();
+		idx += 2;
+	}
+	if ((size_t) off >= graph->get_in_part_size())
+		idx++;
+	return idx;
+}
+
 void directed_vertex_compute::run(page_byte_array &array)
 {
 	num_complete_fetched++;
+	combine_map_t::iterator it = combine_map.end();
 	// If the combine map is empty, we don't need to merge
 	// byte arrays.
-	if (combine_map.empty()) {
-		page_directed_vertex pg_v(array,
-				(size_t) array.get_offset() < graph->get_in_part_size());
-		run_on_page_vertex(pg_v);
-		return;
-	}
+	if (!combine_map.empty())
+		it = combine_map.find(page_directed_vertex::get_id(array));
 
-	vertex_id_t id = page_directed_vertex::get_id(array);
-	combine_map_t::iterator it = combine_map.find(id);
+	int idx = get_array_idx(array);
 	// If the vertex isn't in the combine map, we don't need to
 	// merge byte arrays.
 	if (it == combine_map.end()) {
-		page_directed_vertex pg_v(array,
-				(size_t) array.get_offset() < graph->get_in_part_size());
-		run_on_page_vertex(pg_v);
+		if (idx < 2) {
+			page_directed_vertex pg_v(array, idx == 0);
+			run_on_page_vertex(pg_v);
+		}
+		else {
+			page_directed_vertex pg_v(NULL, NULL, idx == 2 ? &array : NULL,
+					idx == 3 ? &array : NULL);
+			run_on_page_vertex(pg_v);
+		}
 		return;
 	}
-	else if (it->second == NULL) {
+
+	part_arrays &parts = it->second;
+	assert(parts.arrs[idx] == NULL);
+	parts.num_fetched++;
+	if (parts.num_fetched < parts.num_required) {
 		page_byte_array *arr_copy = array.clone();
 		assert(arr_copy);
-		it->second = arr_copy;
+		parts.arrs[idx] = arr_copy;
 	}
 	else {
-		page_byte_array *in_arr;
-		page_byte_array *out_arr;
-		if ((size_t) it->second->get_offset() < get_graph().get_in_part_size()) {
-			in_arr = it->second;
-			out_arr = &array;
-			assert((size_t) array.get_offset() >= get_graph().get_in_part_size());
-		}
-		else {
-			out_arr = it->second;
-			in_arr = &array;
-			assert((size_t) array.get_offset() < get_graph().get_in_part_size());
-		}
-		page_directed_vertex pg_v(*in_arr, *out_arr);
+		parts.arrs[idx] = &array;
+		page_directed_vertex pg_v(parts.arrs[0], parts.arrs[1],
+				parts.arrs[2], parts.arrs[3]);
 		run_on_page_vertex(pg_v);
-		page_byte_array::destroy(it->second);
+		for (int i = 0; i < 4; i++) {
+			if (i != idx && parts.arrs[i])
+				page_byte_array::destroy(parts.arrs[i]);
+		}
 		combine_map.erase(it);
 	}
 }
@@ -165,12 +199,112 @@ void directed_vertex_compute::request_partial_vertices(
 		directed_vertex_request reqs[], size_t num)
 {
 	for (size_t i = 0; i < num; i++) {
+		size_t num_arrs = 1;
 		if (reqs[i].get_type() == edge_type::BOTH_EDGES)
-			num_requested += 2;
-		else
-			num_requested++;
+			num_arrs = 2;
+		// The edge data is stored with the adjacency lists if the graph
+		// doesn't have an edge data column.
+		if (graph->has_edge_data_column()
+				&& reqs[i].get_part() != request_part::TOPOLOGY) {
+			vertex_id_t id = reqs[i].get_id();
+			if (reqs[i].get_type() != edge_type::OUT_EDGE)
+				requested_parts[get_part_key(id, true, reqs[i].get_part())]++;
+			if (reqs[i].get_type() != edge_type::IN_EDGE)
+				requested_parts[get_part_key(id, false, reqs[i].get_part())]++;
+			if (reqs[i].get_part() == request_part::TOPOLOGY_AND_DATA)
+				num_arrs *= 2;
+		}
+		num_requested += num_arrs;
+	}
+	if (!issue_thread->has_in_mem_graph()) {
+		issue_thread->get_index_reader().request_vertices(reqs, num, *this);
+		return;
+	}
+
+	const in_mem_query_vertex_index &index = *graph->get_in_mem_index();
+	for (size_t i = 0; i < num; i++) {
+		vertex_id_t id = reqs[i].get_id();
+		switch (reqs[i].get_type()) {
+			case edge_type::IN_EDGE:
+			case edge_type::OUT_EDGE:
+				issue_io_request(index.get_vertex_info(id, reqs[i].get_type()));
+				break;
+			case edge_type::BOTH_EDGES:
+				issue_io_request(index.get_vertex_info(id, edge_type::IN_EDGE),
+						index.get_vertex_info(id, edge_type::OUT_EDGE));
+				break;
+			default:
+				ABORT_MSG("wrong edge type");
+		}
+	}
+}
+
+request_part directed_vertex_compute::get_requested_part(vertex_id_t id,
+		bool in_part)
+{
+	if (requested_parts.empty())
+		return request_part::TOPOLOGY;
+	// The requests of the same part of a vertex get the same adjacency
+	// list, so it doesn't matter which request a read is issued for.
+	request_part parts[] = {request_part::EDGE_DATA,
+		request_part::TOPOLOGY_AND_DATA};
+	for (int i = 0; i < 2; i++) {
+		part_map_t::iterator it = requested_parts.find(get_part_key(id,
+					in_part, parts[i]));
+		if (it == requested_parts.end())
+			continue;
+		if (--it->second == 0)
+			requested_parts.erase(it);
+		return parts[i];
+	}
+	return request_part::TOPOLOGY;
+}
+
+ext_mem_vertex_info directed_vertex_compute::get_data_info(
+		const ext_mem_vertex_info &info) const
+{
+	// The edge data column mirrors the adjacency lists.
+	return ext_mem_vertex_info(info.get_id(),
+			info.get_off() + graph->get_edge_data_loc(), info.get_size());
+}
+
+void directed_vertex_compute::issue_io_requests(
+		const ext_mem_vertex_info infos[], int num)
+{
+	if (issue_thread->has_in_mem_graph()) {
+		for (int i = 0; i < num; i++)
+			issue_thread->issue_in_mem_request(this, infos[i]);
+		num_issued += num;
+	}
+	else if (issued_to_io()) {
+		for (int i = 0; i < num; i++)
+			requested_vertices.push(infos[i]);
+	}
+	else {
+		// Otherwise, we need to issue the I/O requests to SAFS explicitly.
+		for (int i = 0; i < num; i++) {
+			data_loc_t loc(graph->get_file_id(), infos[i].get_off());
+			io_request req(this, loc, infos[i].get_size(), READ);
+			issue_thread->issue_io_request(req);
+		}
+		num_issued += num;
+	}
+}
+
+void directed_vertex_compute::issue_io_request(const ext_mem_vertex_info &info)
+{
+	bool in_part = (size_t) info.get_off() < graph->get_in_part_size();
+	request_part part = get_requested_part(info.get_id(), in_part);
+	if (part == request_part::TOPOLOGY)
+		vertex_compute::issue_io_request(info);
+	else if (part == request_part::EDGE_DATA)
+		vertex_compute::issue_io_request(get_data_info(info));
+	else {
+		ext_mem_vertex_info infos[2] = {info, get_data_info(info)};
+		issue_io_requests(infos, 2);
+		combine_map.insert(combine_map_t::value_type(info.get_id(),
+					part_arrays(2)));
 	}
-	issue_thread->get_index_reader().request_vertices(reqs, num, *this);
 }
 
 void directed_vertex_compute::run_on_vertex_size(vertex_id_t id,
@@ -189,23 +323,32 @@ void directed_vertex_compute::issue_io_request(const ext_mem_vertex_info &in_inf
 		const ext_mem_vertex_info &out_info)
 {
 	assert(in_info.get_id() == out_info.get_id());
-	if (issued_to_io()) {
-		requested_vertices.push(in_info);
-		requested_vertices.push(out_info);
+	request_part part = get_requested_part(in_info.get_id(), true);
+	BOOST_VERIFY(get_requested_part(out_info.get_id(), false) == part);
+	if (part == request_part::TOPOLOGY && issue_thread->has_in_mem_graph()) {
+		num_issued += 2;
+		issue_thread->issue_in_mem_request(this, in_info, out_info);
+	}
+	else if (part == request_part::TOPOLOGY) {
+		ext_mem_vertex_info infos[2] = {in_info, out_info};
+		issue_io_requests(infos, 2);
+		combine_map.insert(combine_map_t::value_type(in_info.get_id(),
+					part_arrays(2)));
+	}
+	else if (part == request_part::EDGE_DATA) {
+		ext_mem_vertex_info infos[2] = {get_data_info(in_info),
+			get_data_info(out_info)};
+		issue_io_requests(infos, 2);
+		combine_map.insert(combine_map_t::value_type(in_info.get_id(),
+					part_arrays(2)));
 	}
 	else {
-		// Otherwise, we need to issue the I/O request to SAFS explicitly.
-		data_loc_t loc1(graph->get_file_id(), in_info.get_off());
-		io_request req1(this, loc1, in_info.get_size(), READ);
-		issue_thread->issue_io_request(req1);
-
-		data_loc_t loc2(graph->get_file_id(), out_info.get_off());
-		io_request req2(this, loc2, out_info.get_size(), READ);
-		issue_thread->issue_io_request(req2);
-		num_issued += 2;
+		ext_mem_vertex_info infos[4] = {in_info, out_info,
+			get_data_info(in_info), get_data_info(out_info)};
+		issue_io_requests(infos, 4);
+		combine_map.insert(combine_map_t::value_type(in_info.get_id(),
+					part_arrays(4)));
 	}
-
-	combine_map.insert(combine_map_t::value_type(in_info.get_id(), NULL));
 }
 
 void directed_vertex_compute::request_num_edges(vertex_id_t ids[], size_t num)
@@ -168,7 +168,7 @@ public:
 	 * a vertex is ready, the vertex index notifies the vertex compute
 	 * of the information.
 	 */
-	void issue_io_request(const ext_mem_vertex_info &info);
+	virtual void issue_io_request(const ext_mem_vertex_info &info);
 
 	/*
 	 * The methods below deal with requesting # edges of vertices.
@@ -207,8 +207,48 @@ public:
 
 class directed_vertex_compute: public vertex_compute
 {
-	typedef std::unordered_map<vertex_id_t, page_byte_array *> combine_map_t;
+	/*
+	 * A directed vertex may be read by up to four I/O requests: the in-part
+	 * and the out-part of the adjacency list and of the edge data column.
+	 * The byte arrays are buffered here until all of them are available.
+	 */
+	struct part_arrays
+	{
+		int num_required;
+		int num_fetched;
+		page_byte_array *arrs[4];
+
+		part_arrays(int num_required) {
+			this->num_required = num_required;
+			this->num_fetched = 0;
+			for (int i = 0; i < 4; i++)
+				arrs[i] = NULL;
+		}
+	};
+	typedef std::unordered_map<vertex_id_t, part_arrays> combine_map_t;
 	combine_map_t combine_map;
+	/*
+	 * The number of requests for each part of vertices when the graph has
+	 * an edge data column. The key is the vertex ID, the edge type (in or
+	 * out) and the requested part, so a vertex can be requested several
+	 * times with different parts. We don't keep the requests that only
+	 * ask for the adjacency lists.
+	 */
+	typedef std::unordered_map<uint64_t, int> part_map_t;
+	part_map_t requested_parts;
+
+	static uint64_t get_part_key(vertex_id_t id, bool in_part,
+			request_part part) {
+		return (((uint64_t) id) << 3) + ((in_part ? 0 : 1) << 2) + part;
+	}
+	request_part get_requested_part(vertex_id_t id, bool in_part);
+	/*
+	 * The index of a byte array in part_arrays, which is determined by
+	 * the location of the byte array in the graph file.
+	 */
+	int get_array_idx(const page_byte_array &arr) const;
+	ext_mem_vertex_info get_data_info(const ext_mem_vertex_info &info) const;
+	void issue_io_requests(const ext_mem_vertex_info infos[], int num);
 
 	void run_on_page_vertex(page_directed_vertex &);
 public:
@@ -221,6 +261,11 @@ public:
 	}
 
 	virtual void run(page_byte_array &);
+	/*
+	 * Run on both edge lists of a vertex at once. This is used when
+	 * the graph is in memory, so we don't need to combine the byte arrays.
+	 */
+	void run(page_byte_array &in_array, page_byte_array &out_array);
 
 	/*
 	 * These two methods accept the requests from graph applications and issue
@@ -239,7 +284,7 @@ public:
 	 */
 	void run_on_vertex_size(vertex_id_t id, size_t in_size, size_t out_size);
 
-	using vertex_compute::issue_io_request;
+	virtual void issue_io_request(const ext_mem_vertex_info &info);
 	void issue_io_request(const ext_mem_vertex_info &in_info,
 			const ext_mem_vertex_info &out_info);
 
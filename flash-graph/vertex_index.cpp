@@ -548,6 +548,18 @@ public:
 		}
 	}
 
+	virtual ext_mem_vertex_info get_vertex_info(vertex_id_t id,
+			edge_type type) const {
+		switch (type) {
+			case edge_type::IN_EDGE:
+				return index->get_vertex_info_in(id);
+			case edge_type::OUT_EDGE:
+				return index->get_vertex_info_out(id);
+			default:
+				ABORT_MSG("wrong edge type");
+		}
+	}
+
 	virtual vertex_index::ptr get_raw_index() const {
 		return index;
 	}
@@ -571,6 +583,11 @@ public:
 				index->get_graph_header().get_edge_data_size());
 	}
 
+	virtual ext_mem_vertex_info get_vertex_info(vertex_id_t id,
+			edge_type type) const {
+		return index->get_vertex_info(id);
+	}
+
 	virtual vertex_index::ptr get_raw_index() const {
 		return index;
 	}
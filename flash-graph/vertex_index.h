@@ -45,6 +45,11 @@ protected:
 			bool compressed;
 			size_t num_large_in_vertices;
 			size_t num_large_out_vertices;
+
+			// These are used when the edge data is stored in a column
+			// behind the adjacency lists instead of inside them.
+			off_t edge_data_loc;
+			int edge_data_col_size;
 		} data;
 		char page[PAGE_SIZE];
 	} h;
@@ -60,6 +65,8 @@ protected:
 		h.data.compressed = false;
 		h.data.num_large_in_vertices = 0;
 		h.data.num_large_out_vertices = 0;
+		h.data.edge_data_loc = 0;
+		h.data.edge_data_col_size = 0;
 	}
 
 	class destroy_index
@@ -112,6 +119,25 @@ public:
 		return h.data.compressed;
 	}
 
+	/*
+	 * The edge data column mirrors the adjacency lists byte by byte:
+	 * the edge data of the vertex stored at offset `off' is located at
+	 * `off + get_edge_data_loc()', and the neighbor IDs are replaced by
+	 * the edge data. It's 0 if the graph doesn't have an edge data column.
+	 */
+	off_t get_edge_data_loc() const {
+		return h.data.edge_data_loc;
+	}
+
+	int get_edge_data_col_size() const {
+		return h.data.edge_data_col_size;
+	}
+
+	void set_edge_data_column(off_t loc, int edge_data_size) {
+		h.data.edge_data_loc = loc;
+		h.data.edge_data_col_size = edge_data_size;
+	}
+
 	void dump(const std::string &file) const {
 		FILE *f = fopen(file.c_str(), "w");
 		if (f == NULL) {
@@ -633,6 +659,12 @@ public:
 	}
 
 	virtual vsize_t get_num_edges(vertex_id_t id, edge_type type) const = 0;
+	/*
+	 * Get the location of the in-edge or out-edge list of a vertex in
+	 * the graph file. An undirected vertex has only one edge list.
+	 */
+	virtual ext_mem_vertex_info get_vertex_info(vertex_id_t id,
+			edge_type type) const = 0;
 	virtual vertex_index::ptr get_raw_index() const = 0;
 };
 
@@ -697,6 +729,10 @@ public:
 
 	vertex_offset get_vertex(vertex_id_t id) const;
 
+	ext_mem_vertex_info get_vertex_info(vertex_id_t id, edge_type type) const {
+		return ext_mem_vertex_info(id, get_vertex(id).get_off(), get_size(id));
+	}
+
 	void verify_against(default_vertex_index &index);
 };
 
@@ -792,6 +828,18 @@ public:
 
 	directed_vertex_entry get_vertex(vertex_id_t id) const;
 
+	ext_mem_vertex_info get_vertex_info(vertex_id_t id, edge_type type) const {
+		directed_vertex_entry e = get_vertex(id);
+		switch (type) {
+			case edge_type::IN_EDGE:
+				return ext_mem_vertex_info(id, e.get_in_off(), get_in_size(id));
+			case edge_type::OUT_EDGE:
+				return ext_mem_vertex_info(id, e.get_out_off(), get_out_size(id));
+			default:
+				ABORT_MSG("wrong edge type");
+		}
+	}
+
 	void verify_against(directed_vertex_index &index);
 };
 
@@ -52,21 +52,42 @@ public:
 	}
 };
 
+/**
+ * The parts of a vertex that can be requested. When the edge data of a graph
+ * is stored in a column separated from the adjacency lists, a vertex can
+ * request the adjacency list, the edge data or both of them. Otherwise,
+ * the edge data is always read together with the adjacency list.
+ */
+enum request_part
+{
+	TOPOLOGY = 1,
+	EDGE_DATA = 2,
+	TOPOLOGY_AND_DATA = 3,
+};
+
 class directed_vertex_request: public vertex_request
 {
 	edge_type type;
+	request_part part;
 public:
 	directed_vertex_request() {
 		type = edge_type::NONE;
+		part = request_part::TOPOLOGY;
 	}
 
-	directed_vertex_request(vertex_id_t id, edge_type type): vertex_request(id) {
+	directed_vertex_request(vertex_id_t id, edge_type type,
+			request_part part = request_part::TOPOLOGY): vertex_request(id) {
 		this->type = type;
+		this->part = part;
 	}
 
 	edge_type get_type() const {
 		return type;
 	}
+
+	request_part get_part() const {
+		return part;
+	}
 };
 
 /**
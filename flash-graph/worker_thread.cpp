@@ -27,6 +27,7 @@
 #include "load_balancer.h"
 #include "steal_state.h"
 #include "vertex_index_reader.h"
+#include "in_mem_storage.h"
 
 static void delete_val(std::vector<vertex_id_t> &vec, vertex_id_t val)
 {
@@ -302,6 +303,9 @@ void customized_vertex_queue::init(worker_thread &t)
 	pthread_spin_lock(&lock);
 	sorted_vertices.clear();
 	std::vector<local_vid_t> local_ids;
+	// Remove duplicated vertices and prepare to scan the entire bitmap.
+	t.next_activated_vertices->finalize();
+	t.next_activated_vertices->set_dir(true);
 	t.next_activated_vertices->fetch_reset_active_vertices(local_ids);
 
 	// the bitmap only contains the locations of vertices in the bitmap.
@@ -410,6 +414,10 @@ void worker_thread::init()
 				new default_vertex_queue(*graph, worker_id, get_node_id()));
 
 	io = graph_factory->create_io(this);
+	graph_data = graph->get_graph_data();
+	if (graph_data)
+		in_mem_array_alloc = std::unique_ptr<byte_array_allocator>(
+				in_mem_byte_array::create_allocator(this));
 	if (graph->get_in_mem_index())
 		index_reader = simple_index_reader::create(
 				graph->get_in_mem_index(),
@@ -549,6 +557,42 @@ size_t worker_thread::enter_next_level()
 	return curr_activated_vertices->get_num_vertices();
 }
 
+/*
+ * Run the vertex computes on the adjacency lists in memory. It's called
+ * after the vertices return from the run, so the vertices aren't invoked
+ * while they are requesting vertices. Vertices may request more vertices
+ * when they run on the adjacency lists, so we process the requests until
+ * there are none.
+ */
+void worker_thread::process_in_mem_requests()
+{
+	while (!in_mem_reqs.empty()) {
+		in_mem_req_buf.swap(in_mem_reqs);
+		for (size_t i = 0; i < in_mem_req_buf.size(); i++) {
+			in_mem_request &req = in_mem_req_buf[i];
+			vertex_compute *compute = req.compute;
+			// The vertex may complete in the run, so we hold a reference
+			// to the vertex compute until the run returns.
+			compute->inc_ref();
+			in_mem_byte_array arr(*graph_data, req.infos[0].get_off(),
+					req.infos[0].get_size(), *in_mem_array_alloc);
+			if (req.num_infos == 1)
+				compute->run(arr);
+			else {
+				in_mem_byte_array out_arr(*graph_data, req.infos[1].get_off(),
+						req.infos[1].get_size(), *in_mem_array_alloc);
+				((directed_vertex_compute *) compute)->run(arr, out_arr);
+			}
+			compute->dec_ref();
+			if (compute->get_ref() == 0) {
+				compute_allocator *alloc = compute->get_allocator();
+				alloc->free(compute);
+			}
+		}
+		in_mem_req_buf.clear();
+	}
+}
+
 /**
  * This method is the main function of the graph engine.
  */
@@ -565,6 +609,7 @@ void worker_thread::run()
 			num_visited += num;
 			msg_processor->process_msgs();
 			index_reader->wait4complete(0);
+			process_in_mem_requests();
 			io->access(adj_reqs.data(), adj_reqs.size());
 			adj_reqs.clear();
 			if (io->num_pending_ios() == 0 && index_reader->get_num_pending_tasks() > 0)
@@ -580,6 +625,7 @@ void worker_thread::run()
 				// other threads in order to balance the load.
 				|| graph->get_num_remaining_vertices() > 0);
 		assert(index_reader->get_num_pending_tasks() == 0);
+		assert(in_mem_reqs.empty());
 		assert(io->num_pending_ios() == 0);
 		assert(active_computes.size() == 0);
 		assert(curr_activated_vertices->is_empty());
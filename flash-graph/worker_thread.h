@@ -32,6 +32,7 @@
 static const size_t MAX_ACTIVE_V = 1024;
 
 class worker_thread;
+class in_mem_graph;
 
 /*
  * This data structure contains two data structures to represent active
@@ -298,6 +299,23 @@ class worker_thread: public thread
 	// This buffers the I/O requests for adjacency lists.
 	std::vector<io_request> adj_reqs;
 
+	/*
+	 * If the graph is in memory, vertex computes request the adjacency
+	 * lists from the graph data directly. A directed vertex can request
+	 * both of its edge lists in a request.
+	 */
+	struct in_mem_request
+	{
+		vertex_compute *compute;
+		int num_infos;
+		ext_mem_vertex_info infos[2];
+	};
+	std::shared_ptr<in_mem_graph> graph_data;
+	// The allocator is only used to clone the byte arrays on the graph data.
+	std::unique_ptr<byte_array_allocator> in_mem_array_alloc;
+	std::vector<in_mem_request> in_mem_reqs;
+	std::vector<in_mem_request> in_mem_req_buf;
+
 	// When a thread process a vertex, the worker thread should keep
 	// a vertex compute for the vertex. This is useful when a user-defined
 	// compute vertex needs to reference its vertex compute.
@@ -353,6 +371,7 @@ class worker_thread: public thread
 			- num_completed_vertices_in_level.get();
 	}
 	int process_activated_vertices(int max);
+	void process_in_mem_requests();
 public:
 	worker_thread(graph_engine *graph, file_io_factory::shared_ptr graph_factory,
 			file_io_factory::shared_ptr index_factory, vertex_program::ptr prog,
@@ -460,6 +479,30 @@ public:
 		adj_reqs.push_back(req);
 	}
 
+	bool has_in_mem_graph() const {
+		return graph_data != NULL;
+	}
+
+	void issue_in_mem_request(vertex_compute *compute,
+			const ext_mem_vertex_info &info) {
+		in_mem_request req;
+		req.compute = compute;
+		req.num_infos = 1;
+		req.infos[0] = info;
+		in_mem_reqs.push_back(req);
+	}
+
+	void issue_in_mem_request(vertex_compute *compute,
+			const ext_mem_vertex_info &in_info,
+			const ext_mem_vertex_info &out_info) {
+		in_mem_request req;
+		req.compute = compute;
+		req.num_infos = 2;
+		req.infos[0] = in_info;
+		req.infos[1] = out_info;
+		in_mem_reqs.push_back(req);
+	}
+
 	size_t get_activates() const {
 		return curr_activated_vertices->get_num_vertices();
 	}